@@ -36,7 +36,7 @@ extern pi_p4info_t *p4info;
 char add_p4_hs[] =
     "Add a P4 configuration and receive an ID for it, "
     "default config type is bmv2: "
-    "add_p4 <path_to_config> [bmv2|native]*";
+    "add_p4 <path_to_config> [bmv2|native|binary]*";
 
 pi_cli_status_t do_add_p4(char *subcmd) {
   const char *args[1];
@@ -52,8 +52,11 @@ pi_cli_status_t do_add_p4(char *subcmd) {
       config_type = PI_CONFIG_TYPE_BMV2_JSON;
     } else if (!strncmp(config_type_str, "native", sizeof "native")) {
       config_type = PI_CONFIG_TYPE_NATIVE_JSON;
+    } else if (!strncmp(config_type_str, "binary", sizeof "binary")) {
+      config_type = PI_CONFIG_TYPE_BINARY;
     } else {
-      fprintf(stderr, "Invalid config type, must be one of bmv2 | native.\n");
+      fprintf(stderr,
+              "Invalid config type, must be one of bmv2 | native | binary.\n");
       return PI_CLI_STATUS_INVALID_P4_CONFIG_TYPE;
     }
   }
@@ -18,7 +18,8 @@
  *
  */
 
-// Generates the PI JSON from the Bmv2 JSON
+// Generates the PI JSON from the Bmv2 JSON, and optionally a binary p4info
+// snapshot which can be loaded with PI_CONFIG_TYPE_BINARY
 
 #include <PI/p4info.h>
 #include <PI/pi.h>
@@ -30,9 +31,10 @@
 extern void pi_logs_off();
 
 int main(int argc, char *argv[]) {
-  if (argc != 2) {
+  if (argc != 2 && argc != 3) {
     fprintf(stderr, "P4 configuration needed.\n");
-    fprintf(stderr, "Usage: %s <path to config>\n", argv[0]);
+    fprintf(stderr, "Usage: %s <path to config> [<binary output path>]\n",
+            argv[0]);
     return 1;
   }
 
@@ -46,6 +48,12 @@ int main(int argc, char *argv[]) {
     return 1;
   }
 
+  if (argc == 3 && pi_serialize_config_binary_to_file(p4info, argv[2]) < 0) {
+    fprintf(stderr, "Error while writing binary config.\n");
+    pi_destroy_config(p4info);
+    return 1;
+  }
+
   char *native_json = pi_serialize_config(p4info, 1);
 
   printf("%s\n", native_json);
@@ -26,7 +26,11 @@
 #include <stdlib.h>
 #include <unistd.h>
 
-extern pi_status_t pi_rpc_server_run(const pi_remote_addr_t *remote_addr);
+extern pi_status_t pi_rpc_server_run_with_workers(
+    const pi_remote_addr_t *remote_addr, size_t num_workers);
+extern void pi_rpc_server_set_packetin_batching(size_t max_packets,
+                                                size_t max_bytes,
+                                                uint32_t max_delay_us);
 
 static void cleanup_handler(int signum) {
   (void)signum;
@@ -36,13 +40,23 @@ static void cleanup_handler(int signum) {
 // command-line options
 static char *opt_rpc_addr = NULL;
 static char *opt_notifications_addr = NULL;
+static size_t opt_num_workers = 0;
+static unsigned long opt_batch_packets = 0;
+static unsigned long opt_batch_bytes = 0;
+static unsigned long opt_batch_delay_us = 0;
 
 static void print_help(const char *name) {
   fprintf(stderr,
           "Usage: %s [OPTIONS]...\n"
           "PI RPC server\n\n"
-          "-a          nanomsg address for RPC\n"
-          "-n          nanomsg address for notifications\n",
+          "-a          nanomsg address for RPC, or shm://<name> to use shared\n"
+          "            memory with a client on the same host\n"
+          "-n          nanomsg address for notifications\n"
+          "-w          number of worker threads, requests are handled by the\n"
+          "            main thread if 0 (default)\n"
+          "-b          batch packet-in notifications, as\n"
+          "            <max packets>[:<max bytes>[:<max delay in us>]]\n"
+          "            (default is no batching)\n",
           name);
 }
 
@@ -51,7 +65,7 @@ static int parse_opts(int argc, char *const argv[]) {
 
   opterr = 0;
 
-  while ((c = getopt(argc, argv, "a:n:h")) != -1) {
+  while ((c = getopt(argc, argv, "a:n:w:b:h")) != -1) {
     switch (c) {
       case 'a':
         opt_rpc_addr = optarg;
@@ -59,11 +73,23 @@ static int parse_opts(int argc, char *const argv[]) {
       case 'n':
         opt_notifications_addr = optarg;
         break;
+      case 'w':
+        opt_num_workers = strtoul(optarg, NULL, 0);
+        break;
+      case 'b':
+        if (sscanf(optarg, "%lu:%lu:%lu", &opt_batch_packets, &opt_batch_bytes,
+                   &opt_batch_delay_us) < 1) {
+          fprintf(stderr, "Invalid argument for -b.\n\n");
+          print_help(argv[0]);
+          return 1;
+        }
+        break;
       case 'h':
         print_help(argv[0]);
         exit(0);
       case '?':
-        if (optopt == 'a' || optopt == 'n') {
+        if (optopt == 'a' || optopt == 'n' || optopt == 'w' ||
+            optopt == 'b') {
           fprintf(stderr, "Option -%c requires an argument.\n\n", optopt);
           print_help(argv[0]);
         } else if (isprint(optopt)) {
@@ -107,6 +133,8 @@ int main(int argc, char *argv[]) {
   assert(sigaction(SIGINT, &sa, NULL) == 0);
   assert(sigaction(SIGTERM, &sa, NULL) == 0);
 
+  pi_rpc_server_set_packetin_batching(opt_batch_packets, opt_batch_bytes,
+                                      opt_batch_delay_us);
   pi_remote_addr_t remote_addr = {opt_rpc_addr, opt_notifications_addr};
-  pi_rpc_server_run(&remote_addr);
+  pi_rpc_server_run_with_workers(&remote_addr, opt_num_workers);
 }
@@ -36,6 +36,8 @@ typedef int error_code_t;
 class MatchKeyReader {
  public:
   explicit MatchKeyReader(const pi_match_key_t *match_key);
+  MatchKeyReader(const pi_match_key_t *match_key,
+                 const pi_p4info_match_key_layout_t *layout);
 
   error_code_t get_exact(pi_p4_id_t f_id, std::string *key) const;
 
@@ -53,12 +55,17 @@ class MatchKeyReader {
   int get_priority() const;
 
  private:
-  error_code_t read_one(pi_p4_id_t f_id, const char *src, std::string *v) const;
+  // returns nullptr if f_id is not a valid match field id for the table
+  const char *field_data(pi_p4_id_t f_id,
+                         const pi_p4info_match_field_layout_t **f) const;
+
   const pi_match_key_t *match_key;
+  const pi_p4info_match_key_layout_t *layout;
 };
 
 class MatchKey {
   friend class MatchTable;
+  friend struct MatchKeyView;
   friend struct MatchKeyHash;
   friend struct MatchKeyEq;
 
@@ -113,16 +120,24 @@ class MatchKey {
   error_code_t set_valid(pi_p4_id_t f_id, bool key);
   error_code_t get_valid(pi_p4_id_t f_id, bool *key) const;
 
+  // read-only access to the underlying PI match key, e.g. to use it in a
+  // pi_table_fetch_filter_t
+  const pi_match_key_t *get_pi_match_key() const { return match_key; }
+
   MatchKey(const MatchKey &other);
   MatchKey &operator=(const MatchKey &other);
   MatchKey(MatchKey &&other) = default;
   MatchKey &operator=(MatchKey &&other) = default;
 
  private:
+  // returns nullptr if f_id is not a valid match field id for the table
+  const pi_p4info_match_field_layout_t *field_layout(pi_p4_id_t f_id) const;
+
   template <typename T>
-  error_code_t format(pi_p4_id_t f_id, T v, size_t offset, size_t *written);
-  error_code_t format(pi_p4_id_t f_id, const char *ptr, size_t s,
-                      size_t offset, size_t *written);
+  error_code_t format(const pi_p4info_match_field_layout_t *f, T v,
+                      size_t offset);
+  error_code_t format(const pi_p4info_match_field_layout_t *f, const char *ptr,
+                      size_t s, size_t offset);
 
   pi_match_key_t *get() const {
     return match_key;
@@ -130,6 +145,7 @@ class MatchKey {
 
   const pi_p4info_t *p4info;
   pi_p4_id_t table_id;
+  const pi_p4info_match_key_layout_t *layout;
   size_t nset{0};
   size_t mk_size;
   std::vector<char> _data;
@@ -137,21 +153,42 @@ class MatchKey {
   MatchKeyReader reader;
 };
 
-// MatchKeyHash and MatchKeyEq can be used to store MatchKey objects into an
-// unordered_map. They take into account the table id and the match key data
-// (including the priority).
+// Non-owning view of the data of a match key, which can be constructed
+// implicitly from a MatchKey or from the pi_match_key_t objects returned by the
+// PI library (e.g. in the results of pi_table_entries_fetch). The viewed match
+// key must outlive the view.
+struct MatchKeyView {
+  MatchKeyView(const MatchKey &mk);  // NOLINT(runtime/explicit)
+  explicit MatchKeyView(const pi_match_key_t *pi_match_key);
+  MatchKeyView(pi_p4_id_t table_id, int priority, const char *data,
+               size_t size);
+
+  pi_p4_id_t table_id;
+  int priority;
+  const char *data;
+  size_t size;
+};
+
+// MatchKeyHash and MatchKeyEq can be used to store MatchKey objects (or
+// MatchKeyView objects pointing to match key data owned by the container) into
+// an unordered_map. They take into account the table id and the match key data
+// (including the priority). A MatchKey and a view of it have the same hash.
 
 struct MatchKeyHash {
   size_t operator()(const MatchKey &mk) const;
+  size_t operator()(const MatchKeyView &mk) const;
 };
 
 struct MatchKeyEq {
   bool operator()(const MatchKey &mk1, const MatchKey &mk2) const;
+  bool operator()(const MatchKeyView &mk1, const MatchKeyView &mk2) const;
 };
 
 class ActionDataReader {
  public:
   explicit ActionDataReader(const pi_action_data_t *action_data);
+  ActionDataReader(const pi_action_data_t *action_data,
+                   const pi_p4info_action_data_layout_t *layout);
 
   error_code_t get_arg(pi_p4_id_t ap_id, std::string *arg) const;
 
@@ -159,6 +196,7 @@ class ActionDataReader {
 
  private:
   const pi_action_data_t *action_data;
+  const pi_p4info_action_data_layout_t *layout;
 };
 
 class ActionData {
@@ -179,6 +217,9 @@ class ActionData {
   error_code_t get_arg(pi_p4_id_t ap_id, std::string *arg) const;
 
  private:
+  // returns nullptr if ap_id is not a valid parameter id for the action
+  const pi_p4info_action_param_layout_t *param_layout(pi_p4_id_t ap_id) const;
+
   template <typename T>
   error_code_t format(pi_p4_id_t ap_id, T v);
   error_code_t format(pi_p4_id_t ap_id, const char *ptr, size_t s);
@@ -192,6 +233,7 @@ class ActionData {
   __attribute__((unused))
 #endif
   pi_p4_id_t action_id;
+  const pi_p4info_action_data_layout_t *layout;
   size_t nset{0};
   size_t ad_size;
   std::vector<char> _data;
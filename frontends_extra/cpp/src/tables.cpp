@@ -91,35 +91,40 @@ int64_t endianness(int64_t v) {
 }  // namespace
 
 MatchKeyReader::MatchKeyReader(const pi_match_key_t *match_key)
-    : match_key(match_key) { }
+    : match_key(match_key),
+      layout(pi_p4info_table_match_key_layout(match_key->p4info,
+                                              match_key->table_id)) { }
 
-error_code_t
-MatchKeyReader::read_one(pi_p4_id_t f_id, const char *src,
-                         std::string *v) const {
-  const size_t bitwidth = pi_p4info_table_match_field_bitwidth(
-      match_key->p4info, match_key->table_id, f_id);
-  const size_t bytes = (bitwidth + 7) / 8;
-  *v = std::string(src, bytes);
-  return 0;
+MatchKeyReader::MatchKeyReader(const pi_match_key_t *match_key,
+                               const pi_p4info_match_key_layout_t *layout)
+    : match_key(match_key), layout(layout) { }
+
+const char *
+MatchKeyReader::field_data(pi_p4_id_t f_id,
+                           const pi_p4info_match_field_layout_t **f) const {
+  auto index = pi_p4info_match_key_layout_index(layout, f_id);
+  if (index == static_cast<size_t>(-1)) return nullptr;
+  *f = &layout->fields[index];
+  return match_key->data + (*f)->offset;
 }
 
 error_code_t
 MatchKeyReader::get_exact(pi_p4_id_t f_id, std::string *key) const {
-  size_t offset = pi_p4info_table_match_field_offset(
-      match_key->p4info, match_key->table_id, f_id);
-  return read_one(f_id, match_key->data + offset, key);
+  const pi_p4info_match_field_layout_t *f;
+  auto src = field_data(f_id, &f);
+  if (!src) return 1;
+  *key = std::string(src, f->nbytes);
+  return 0;
 }
 
 error_code_t
 MatchKeyReader::get_lpm(pi_p4_id_t f_id, std::string *key,
                         int *prefix_length) const {
-  size_t offset = pi_p4info_table_match_field_offset(
-      match_key->p4info, match_key->table_id, f_id);
-  error_code_t rc;
-  auto src = match_key->data + offset;
-  rc = read_one(f_id, src, key);
-  if (rc) return rc;
-  src += key->size();
+  const pi_p4info_match_field_layout_t *f;
+  auto src = field_data(f_id, &f);
+  if (!src) return 1;
+  *key = std::string(src, f->nbytes);
+  src += f->nbytes;
   uint32_t pLen;
   retrieve_uint32(src, &pLen);
   *prefix_length = static_cast<int>(pLen);
@@ -129,15 +134,13 @@ MatchKeyReader::get_lpm(pi_p4_id_t f_id, std::string *key,
 error_code_t
 MatchKeyReader::get_ternary(pi_p4_id_t f_id, std::string *key,
                             std::string *mask) const {
-  size_t offset = pi_p4info_table_match_field_offset(
-      match_key->p4info, match_key->table_id, f_id);
-  error_code_t rc;
-  auto src = match_key->data + offset;
-  rc = read_one(f_id, src, key);
-  if (rc) return rc;
-  src += key->size();
-  rc = read_one(f_id, src, mask);
-  return rc;
+  const pi_p4info_match_field_layout_t *f;
+  auto src = field_data(f_id, &f);
+  if (!src) return 1;
+  *key = std::string(src, f->nbytes);
+  src += f->nbytes;
+  *mask = std::string(src, f->nbytes);
+  return 0;
 }
 
 error_code_t
@@ -148,9 +151,9 @@ MatchKeyReader::get_range(pi_p4_id_t f_id, std::string *start,
 
 error_code_t
 MatchKeyReader::get_valid(pi_p4_id_t f_id, bool *key) const {
-  size_t offset = pi_p4info_table_match_field_offset(
-      match_key->p4info, match_key->table_id, f_id);
-  auto src = match_key->data + offset;
+  const pi_p4info_match_field_layout_t *f;
+  auto src = field_data(f_id, &f);
+  if (!src) return 1;
   *key = (*src != 0);
   return 0;
 }
@@ -162,10 +165,11 @@ MatchKeyReader::get_priority() const {
 
 MatchKey::MatchKey(const pi_p4info_t *p4info, pi_p4_id_t table_id)
     : p4info(p4info), table_id(table_id),
-      mk_size(pi_p4info_table_match_key_size(p4info, table_id)),
+      layout(pi_p4info_table_match_key_layout(p4info, table_id)),
+      mk_size(layout->match_key_size),
       _data(sizeof(*match_key) + mk_size),
       match_key(reinterpret_cast<decltype(match_key)>(_data.data())),
-      reader(match_key) {
+      reader(match_key, layout) {
   // std::allocator is using standard new, no alignment issue with the cast
   // above
   match_key->p4info = p4info;
@@ -177,10 +181,11 @@ MatchKey::MatchKey(const pi_p4info_t *p4info, pi_p4_id_t table_id)
 
 MatchKey::MatchKey(const pi_match_key_t *pi_match_key)
     : p4info(pi_match_key->p4info), table_id(pi_match_key->table_id),
+      layout(pi_p4info_table_match_key_layout(p4info, table_id)),
       mk_size(pi_match_key->data_size),
       _data(sizeof(*match_key) + mk_size),
       match_key(reinterpret_cast<decltype(match_key)>(_data.data())),
-      reader(match_key) {
+      reader(match_key, layout) {
   *match_key = *pi_match_key;
   match_key->data = _data.data() + sizeof(*match_key);
   memcpy(match_key->data, pi_match_key->data, mk_size);
@@ -214,39 +219,35 @@ MatchKey::get_priority() const {
   return reader.get_priority();
 }
 
+const pi_p4info_match_field_layout_t *
+MatchKey::field_layout(pi_p4_id_t f_id) const {
+  auto index = pi_p4info_match_key_layout_index(layout, f_id);
+  if (index == static_cast<size_t>(-1)) return nullptr;
+  return &layout->fields[index];
+}
+
 template <typename T>
 error_code_t
-MatchKey::format(pi_p4_id_t f_id, T v, size_t offset, size_t *written) {
+MatchKey::format(const pi_p4info_match_field_layout_t *f, T v, size_t offset) {
   constexpr size_t type_bitwidth = sizeof(T) * 8;
-  const size_t bitwidth = pi_p4info_table_match_field_bitwidth(
-      p4info, table_id, f_id);
-  const size_t bytes = (bitwidth + 7) / 8;
-  const char byte0_mask = pi_p4info_table_match_field_byte0_mask(
-      p4info, table_id, f_id);
-  if (bitwidth > type_bitwidth) return 1;
+  const size_t bytes = f->nbytes;
+  if (f->bitwidth > type_bitwidth) return 1;
   v = endianness(v);
   char *data = reinterpret_cast<char *>(&v);
   data += sizeof(T) - bytes;
-  data[0] &= byte0_mask;
+  data[0] &= f->byte0_mask;
   memcpy(match_key->data + offset, data, bytes);
-  *written = bytes;
   return 0;
 }
 
 error_code_t
-MatchKey::format(pi_p4_id_t f_id, const char *ptr, size_t s, size_t offset,
-                 size_t *written) {
-  // constexpr size_t type_bitwidth = sizeof(T) * 8;
-  const size_t bitwidth = pi_p4info_table_match_field_bitwidth(
-      p4info, table_id, f_id);
-  const size_t bytes = (bitwidth + 7) / 8;
-  const char byte0_mask = pi_p4info_table_match_field_byte0_mask(
-      p4info, table_id, f_id);
+MatchKey::format(const pi_p4info_match_field_layout_t *f, const char *ptr,
+                 size_t s, size_t offset) {
+  const size_t bytes = f->nbytes;
   if (bytes != s) return 1;
   char *dst = match_key->data + offset;
   memcpy(dst, ptr, bytes);
-  dst[0] &= byte0_mask;
-  *written = bytes;
+  dst[0] &= f->byte0_mask;
   return 0;
 }
 
@@ -255,9 +256,9 @@ typename std::enable_if<std::is_integral<T>::value, error_code_t>::type
 MatchKey::set_exact(pi_p4_id_t f_id, T key) {
   // explicit instantiation below so compile time check not possible
   assert((!std::is_signed<T>::value) && "signed fields not supported yet");
-  size_t offset = pi_p4info_table_match_field_offset(p4info, table_id, f_id);
-  size_t written = 0;
-  return format(f_id, key, offset, &written);
+  auto f = field_layout(f_id);
+  if (!f) return 1;
+  return format(f, key, f->offset);
 }
 
 template error_code_t MatchKey::set_exact<uint8_t>(pi_p4_id_t, uint8_t);
@@ -271,9 +272,9 @@ template error_code_t MatchKey::set_exact<int64_t>(pi_p4_id_t, int64_t);
 
 error_code_t
 MatchKey::set_exact(pi_p4_id_t f_id, const char *key, size_t s) {
-  size_t offset = pi_p4info_table_match_field_offset(p4info, table_id, f_id);
-  size_t written = 0;
-  return format(f_id, key, s, offset, &written);
+  auto f = field_layout(f_id);
+  if (!f) return 1;
+  return format(f, key, s, f->offset);
 }
 
 error_code_t
@@ -286,12 +287,11 @@ typename std::enable_if<std::is_integral<T>::value, error_code_t>::type
 MatchKey::set_lpm(pi_p4_id_t f_id, T key, int prefix_length) {
   // explicit instantiation below so compile time check not possible
   assert((!std::is_signed<T>::value) && "signed fields not supported yet");
-  size_t offset = pi_p4info_table_match_field_offset(p4info, table_id, f_id);
-  size_t written = 0;
+  auto f = field_layout(f_id);
+  if (!f) return 1;
   error_code_t rc;
-  rc = format(f_id, key, offset, &written);
-  offset += written;
-  emit_uint32(match_key->data + offset, prefix_length);
+  rc = format(f, key, f->offset);
+  emit_uint32(match_key->data + f->offset + f->nbytes, prefix_length);
   return rc;
 }
 
@@ -307,12 +307,11 @@ template error_code_t MatchKey::set_lpm<int64_t>(pi_p4_id_t, int64_t, int);
 error_code_t
 MatchKey::set_lpm(pi_p4_id_t f_id, const char *key, size_t s,
                   int prefix_length) {
-  size_t offset = pi_p4info_table_match_field_offset(p4info, table_id, f_id);
-  size_t written = 0;
+  auto f = field_layout(f_id);
+  if (!f) return 1;
   error_code_t rc;
-  rc = format(f_id, key, s, offset, &written);
-  offset += written;
-  emit_uint32(match_key->data + offset, prefix_length);
+  rc = format(f, key, s, f->offset);
+  emit_uint32(match_key->data + f->offset + f->nbytes, prefix_length);
   return rc;
 }
 
@@ -326,13 +325,12 @@ typename std::enable_if<std::is_integral<T>::value, error_code_t>::type
 MatchKey::set_ternary(pi_p4_id_t f_id, T key, T mask) {
   // explicit instantiation below so compile time check not possible
   assert((!std::is_signed<T>::value) && "signed fields not supported yet");
-  size_t offset = pi_p4info_table_match_field_offset(p4info, table_id, f_id);
-  size_t written = 0;
+  auto f = field_layout(f_id);
+  if (!f) return 1;
   error_code_t rc;
-  rc = format(f_id, key, offset, &written);
-  offset += written;
+  rc = format(f, key, f->offset);
   if (rc) return rc;
-  rc = format(f_id, mask, offset, &written);
+  rc = format(f, mask, f->offset + f->nbytes);
   return rc;
 }
 
@@ -356,13 +354,12 @@ template error_code_t MatchKey::set_ternary<int64_t>(pi_p4_id_t, int64_t,
 error_code_t
 MatchKey::set_ternary(pi_p4_id_t f_id, const char *key, const char *mask,
                       size_t s) {
-  size_t offset = pi_p4info_table_match_field_offset(p4info, table_id, f_id);
-  size_t written = 0;
+  auto f = field_layout(f_id);
+  if (!f) return 1;
   error_code_t rc;
-  rc = format(f_id, key, s, offset, &written);
+  rc = format(f, key, s, f->offset);
   if (rc) return rc;
-  offset += written;
-  rc = format(f_id, mask, s, offset, &written);
+  rc = format(f, mask, s, f->offset + f->nbytes);
   return rc;
 }
 
@@ -409,8 +406,9 @@ MatchKey::get_range(pi_p4_id_t f_id, std::string *start,
 
 error_code_t
 MatchKey::set_valid(pi_p4_id_t f_id, bool key) {
-  size_t offset = pi_p4info_table_match_field_offset(p4info, table_id, f_id);
-  auto dst = match_key->data + offset;
+  auto f = field_layout(f_id);
+  if (!f) return 1;
+  auto dst = match_key->data + f->offset;
   *dst = key ? 1 : 0;
   return 0;
 }
@@ -423,11 +421,12 @@ MatchKey::get_valid(pi_p4_id_t f_id, bool *key) const {
 MatchKey::MatchKey(const MatchKey &other)
     : p4info(other.p4info),
       table_id(other.table_id),
+      layout(other.layout),
       nset(other.nset),
       mk_size(other.mk_size),
       _data(other._data),
       match_key(reinterpret_cast<decltype(match_key)>(_data.data())),
-      reader(match_key) {
+      reader(match_key, layout) {
   match_key->data = _data.data() + sizeof(*match_key);
 }
 
@@ -438,14 +437,31 @@ MatchKey::operator=(const MatchKey &other) {
   return *this;
 }
 
+MatchKeyView::MatchKeyView(const MatchKey &mk)
+    : table_id(mk.table_id), priority(mk.match_key->priority),
+      data(mk.match_key->data), size(mk.mk_size) { }
+
+MatchKeyView::MatchKeyView(const pi_match_key_t *pi_match_key)
+    : table_id(pi_match_key->table_id), priority(pi_match_key->priority),
+      data(pi_match_key->data), size(pi_match_key->data_size) { }
+
+MatchKeyView::MatchKeyView(pi_p4_id_t table_id, int priority,
+                           const char *data, size_t size)
+    : table_id(table_id), priority(priority), data(data), size(size) { }
+
 size_t
 MatchKeyHash::operator()(const MatchKey &mk) const {
+  return (*this)(MatchKeyView(mk));
+}
+
+size_t
+MatchKeyHash::operator()(const MatchKeyView &mk) const {
   // compute Jenkins hash
   // see https://en.wikipedia.org/wiki/Jenkins_hash_function
   // "seed", maybe not the best choice...
-  uint32_t hash = mk.table_id ^ mk.match_key->priority;
-  for (size_t i = 0; i < mk.mk_size; i++) {
-    hash += mk.match_key->data[i];
+  uint32_t hash = mk.table_id ^ mk.priority;
+  for (size_t i = 0; i < mk.size; i++) {
+    hash += mk.data[i];
     hash += hash << 10;
     hash ^= hash >> 6;
   }
@@ -457,22 +473,34 @@ MatchKeyHash::operator()(const MatchKey &mk) const {
 
 bool
 MatchKeyEq::operator()(const MatchKey &mk1, const MatchKey &mk2) const {
+  return (*this)(MatchKeyView(mk1), MatchKeyView(mk2));
+}
+
+bool
+MatchKeyEq::operator()(const MatchKeyView &mk1,
+                       const MatchKeyView &mk2) const {
   return (mk1.table_id == mk2.table_id)
-      && (mk1.match_key->priority == mk2.match_key->priority)
-      && (!std::memcmp(mk1.match_key->data, mk2.match_key->data, mk1.mk_size));
+      && (mk1.priority == mk2.priority)
+      && (mk1.size == mk2.size)
+      && (!std::memcmp(mk1.data, mk2.data, mk1.size));
 }
 
 ActionDataReader::ActionDataReader(const pi_action_data_t *action_data)
-    : action_data(action_data) { }
+    : action_data(action_data),
+      layout(pi_p4info_action_data_layout(action_data->p4info,
+                                          action_data->action_id)) { }
+
+ActionDataReader::ActionDataReader(
+    const pi_action_data_t *action_data,
+    const pi_p4info_action_data_layout_t *layout)
+    : action_data(action_data), layout(layout) { }
 
 error_code_t
 ActionDataReader::get_arg(pi_p4_id_t ap_id, std::string *arg) const {
-  const size_t offset = pi_p4info_action_param_offset(
-      action_data->p4info, action_data->action_id, ap_id);
-  const size_t bitwidth = pi_p4info_action_param_bitwidth(
-      action_data->p4info, action_data->action_id, ap_id);
-  const size_t bytes = (bitwidth + 7) / 8;
-  *arg = std::string(action_data->data + offset, bytes);
+  auto index = pi_p4info_action_data_layout_index(layout, ap_id);
+  if (index == static_cast<size_t>(-1)) return 1;
+  const auto &p = layout->params[index];
+  *arg = std::string(action_data->data + p.offset, p.nbytes);
   return 0;
 }
 
@@ -483,10 +511,11 @@ ActionDataReader::get_action_id() const {
 
 ActionData::ActionData(const pi_p4info_t *p4info, pi_p4_id_t action_id)
     : p4info(p4info), action_id(action_id),
-      ad_size(pi_p4info_action_data_size(p4info, action_id)),
+      layout(pi_p4info_action_data_layout(p4info, action_id)),
+      ad_size(layout->action_data_size),
       _data(sizeof(*action_data) + ad_size),
       action_data(reinterpret_cast<decltype(action_data)>(_data.data())),
-      reader(action_data) {
+      reader(action_data, layout) {
   // using standard new, no alignment issue with cast above
   action_data->p4info = p4info;
   action_data->action_id = action_id;
@@ -501,38 +530,38 @@ ActionData::reset() {
   nset = 0;
 }
 
+const pi_p4info_action_param_layout_t *
+ActionData::param_layout(pi_p4_id_t ap_id) const {
+  auto index = pi_p4info_action_data_layout_index(layout, ap_id);
+  if (index == static_cast<size_t>(-1)) return nullptr;
+  return &layout->params[index];
+}
+
 template <typename T>
 error_code_t
 ActionData::format(pi_p4_id_t ap_id, T v) {
   constexpr size_t type_bitwidth = sizeof(T) * 8;
-  const size_t offset = pi_p4info_action_param_offset(p4info, action_id, ap_id);
-  const size_t bitwidth = pi_p4info_action_param_bitwidth(
-      p4info, action_id, ap_id);
-  const size_t bytes = (bitwidth + 7) / 8;
-  const char byte0_mask = pi_p4info_action_param_byte0_mask(
-      p4info, action_id, ap_id);
-  if (bitwidth > type_bitwidth) return 1;
+  auto p = param_layout(ap_id);
+  if (!p) return 1;
+  const size_t bytes = p->nbytes;
+  if (p->bitwidth > type_bitwidth) return 1;
   v = endianness(v);
   char *data = reinterpret_cast<char *>(&v);
   data += sizeof(T) - bytes;
-  data[0] &= byte0_mask;
-  memcpy(action_data->data + offset, data, bytes);
+  data[0] &= p->byte0_mask;
+  memcpy(action_data->data + p->offset, data, bytes);
   return 0;
 }
 
 error_code_t
 ActionData::format(pi_p4_id_t ap_id, const char *ptr, size_t s) {
-  // constexpr size_t type_bitwidth = sizeof(T) * 8;
-  const size_t offset = pi_p4info_action_param_offset(p4info, action_id, ap_id);
-  const size_t bitwidth = pi_p4info_action_param_bitwidth(
-      p4info, action_id, ap_id);
-  const size_t bytes = (bitwidth + 7) / 8;
-  const char byte0_mask = pi_p4info_action_param_byte0_mask(
-      p4info, action_id, ap_id);
+  auto p = param_layout(ap_id);
+  if (!p) return 1;
+  const size_t bytes = p->nbytes;
   if (bytes != s) return 1;
-  char *dst = action_data->data + offset;
+  char *dst = action_data->data + p->offset;
   memcpy(dst, ptr, bytes);
-  dst[0] &= byte0_mask;
+  dst[0] &= p->byte0_mask;
   return 0;
 }
 
@@ -90,14 +90,28 @@ struct pi_table_fetch_res_s {
   size_t num_entries;
   size_t mkey_nbytes;
   size_t idx;
-  size_t curr;
   size_t entries_size;
   char *entries;
-  // just pointers to entries byte array
+  // decoded entries, allocated along with this struct by the PI core; match
+  // keys and action data point directly into the entries byte array
+  pi_table_ma_entry_t *ma_entries;
+  pi_entry_handle_t *entry_handles;
   struct pi_match_key_s *match_keys;
   struct pi_action_data_s *action_datas;
   struct pi_entry_properties_s *properties;
-  // direct resources
+  // with PI_TABLE_FETCH_FLAGS_DIRECT_RES, each encoded entry ends with its
+  // direct resource configs
+  pi_direct_res_config_t *direct_res_configs;
+  pi_direct_res_config_one_t *direct_res_config_ones;
+  char *direct_res_data;
+  // PI_TABLE_FETCH_FLAGS_* value used for the fetch
+  int flags;
+  // set if the entries byte array was allocated by the PI core instead of the
+  // target (see pi_table_entries_fetch_wflags)
+  bool core_entries;
+  // set for the chunks of a cursor which splits a full fetch result itself, in
+  // which case the entries byte array belongs to the cursor
+  struct pi_table_fetch_cursor_s *cursor;
 };
 
 struct pi_act_prof_fetch_res_s {
@@ -130,6 +144,18 @@ pi_device_info_t *pi_get_devices(size_t *num_devices);
 void pi_update_device_config(pi_dev_id_t dev_id, const pi_p4info_t *p4info);
 void pi_reset_device_config(pi_dev_id_t dev_id);
 
+// Same as pi_table_entries_fetch_next_chunk, but the entries are not decoded:
+// only num_entries, mkey_nbytes, entries and entries_size are set in \p chunk,
+// like for _pi_table_entries_fetch, and num_entries is 0 once all the entries
+// have been returned. Used by the RPC server, which forwards the encoded
+// entries as is. The chunk must be released with
+// pi_table_entries_fetch_chunk_raw_done before the next one is retrieved.
+pi_status_t pi_table_entries_fetch_next_chunk_raw(
+    pi_table_fetch_cursor_t *cursor, pi_table_fetch_res_t *chunk);
+
+pi_status_t pi_table_entries_fetch_chunk_raw_done(
+    pi_table_fetch_cursor_t *cursor, pi_table_fetch_res_t *chunk);
+
 #ifdef __cplusplus
 }
 #endif
@@ -77,11 +77,32 @@ typedef enum {
   // packet in/out
   PI_RPC_PACKETOUT_SEND,
 
+  // new message types are appended here, so that the values of the ones above
+  // do not change and older clients can still talk to the server
+
+  // several requests for the same session in a single message
+  PI_RPC_BATCH,
+
+  PI_RPC_TABLE_ENTRIES_ADD_BATCH,
+  PI_RPC_TABLE_ENTRIES_MODIFY_WKEY_BATCH,
+  PI_RPC_TABLE_ENTRIES_DELETE_WKEY_BATCH,
+  PI_RPC_TABLE_ENTRIES_FETCH_BEGIN,
+  PI_RPC_TABLE_ENTRIES_FETCH_NEXT_CHUNK,
+  PI_RPC_TABLE_ENTRIES_FETCH_END,
+  PI_RPC_TABLE_ENTRIES_FETCH_WFLAGS,
+
+  PI_RPC_COUNTER_READ_RANGE,
+
   // rpc management
   // retrieve state for sync-up when rpc client is started
   PI_RPC_INT_GET_STATE = 256,
 } pi_rpc_type_t;
 
+// flags for PI_RPC_BATCH messages
+#define PI_RPC_BATCH_FLAGS_BEGIN (1 << 0)
+#define PI_RPC_BATCH_FLAGS_END (1 << 1)
+#define PI_RPC_BATCH_FLAGS_HW_SYNC (1 << 2)
+
 typedef uint32_t pi_rpc_id_t;
 typedef pi_rpc_id_t s_pi_rpc_id_t;
 
@@ -131,4 +152,12 @@ typedef struct __attribute__((packed)) {
   uint32_t entry_size;
 } s_pi_learn_msg_hdr_t;
 
+// "PIPKB|" notifications carry several packet-ins for the same device: the
+// header is followed by num packets, each one preceded by its size (uint32)
+typedef struct __attribute__((packed)) {
+  s_pi_notifications_topic_t topic;
+  s_pi_dev_id_t dev_id;
+  uint32_t num;
+} s_pi_packetin_batch_hdr_t;
+
 #endif  // PI_INT_RPC_COMMON_H_
@@ -0,0 +1,92 @@
+/* Copyright 2013-present Barefoot Networks, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Antonin Bas (antonin@barefootnetworks.com)
+ *
+ */
+
+// Shared memory transport for an RPC client and server running on the same
+// host, used instead of nanomsg when the RPC address is "shm://<name>". The
+// server creates a shared memory segment with 2 single-producer /
+// single-consumer rings, one for requests and one for replies; a given segment
+// can only be used by one client at a time, and connecting fails while another
+// live process is attached. Messages are the ones exchanged over nanomsg,
+// serialized with the same emit / retrieve functions. They are received in
+// place: the receiver gets a pointer into the ring and releases it once done,
+// without any copy. When a ring is empty (or full), the consumer (or producer)
+// spins for a while before going to sleep on a futex.
+//
+// The address accepts 2 optional parameters: "shm://<name>?size=<bytes>" sets
+// the capacity of each ring (server only, rounded up to a power of 2) and
+// "shm://<name>?spin=<iterations>" the number of polling iterations before
+// sleeping. They can be combined with '&'.
+
+#ifndef PI_INT_SHM_TRANSPORT_H_
+#define PI_INT_SHM_TRANSPORT_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PI_SHM_ADDR_PREFIX "shm://"
+
+#define PI_SHM_DEFAULT_RING_SIZE (8 * 1024 * 1024)
+#define PI_SHM_DEFAULT_SPIN_ITERATIONS 2000
+
+typedef struct pi_shm_transport_s pi_shm_transport_t;
+
+bool pi_shm_is_shm_addr(const char *addr);
+
+//! Server side, creates the shared memory segment, replacing any existing one
+//! with the same name. Returns NULL on error.
+pi_shm_transport_t *pi_shm_transport_create(const char *addr);
+
+//! Client side, opens the segment created by the server. Returns NULL on
+//! error, or if another client is already attached to the segment.
+pi_shm_transport_t *pi_shm_transport_connect(const char *addr);
+
+//! The segment is only removed by the side which created it.
+void pi_shm_transport_destroy(pi_shm_transport_t *transport);
+
+//! Copies the message to the outgoing ring, blocking if there is not enough
+//! space. Returns len, or -1 if the message can never fit or if the transport
+//! was shut down. Can be called concurrently from different threads.
+int pi_shm_send(pi_shm_transport_t *transport, const void *buf, size_t len);
+
+//! Waits for the next message on the incoming ring and returns its size, or -1
+//! if the transport was shut down or if the ring is corrupted. On success, \p
+//! msg points to the message in the ring, which must be released with
+//! pi_shm_release. Only one thread can receive at a time.
+int pi_shm_recv(pi_shm_transport_t *transport, char **msg);
+
+//! Releases a message returned by pi_shm_recv; can be called from any thread
+//! and messages can be released in any order. However, the space used by a
+//! message only becomes available to the sender once all the messages received
+//! before it have been released too, so messages should not be held for long.
+void pi_shm_release(pi_shm_transport_t *transport, char *msg);
+
+//! Wakes up all the threads blocked in pi_shm_send or pi_shm_recv, which
+//! return -1, as will all subsequent calls.
+void pi_shm_shutdown(pi_shm_transport_t *transport);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // PI_INT_SHM_TRANSPORT_H_
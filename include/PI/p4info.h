@@ -44,7 +44,8 @@ pi_status_t pi_empty_config(pi_p4info_t **p4info);
 pi_status_t pi_add_config(const char *config, pi_config_type_t config_type,
                           pi_p4info_t **p4info);
 
-//! Adds a config by from a file. Reads the file and calls pi_add_config.
+//! Adds a config by from a file. Reads the file and calls pi_add_config. For
+//! PI_CONFIG_TYPE_BINARY, the file is mmap'd instead of being read.
 pi_status_t pi_add_config_from_file(const char *config_path,
                                     pi_config_type_t config_type,
                                     pi_p4info_t **p4info);
@@ -67,6 +68,30 @@ int pi_serialize_config_to_fd(const pi_p4info_t *p4info, int fd, int fmt);
 int pi_serialize_config_to_file(const pi_p4info_t *p4info, const char *path,
                                 int fmt);
 
+//! Serialize p4info in the versioned PI binary format, which can be loaded
+//! with pi_add_config and PI_CONFIG_TYPE_BINARY much faster than the JSON
+//! formats. The blob is position-independent, so it can be sent over the wire
+//! or mmap'd from disk as is. The returned buffer must be released with free
+//! and its size is written to \p size. Returns NULL on failure.
+char *pi_serialize_config_binary(const pi_p4info_t *p4info, size_t *size);
+
+//! Serialize p4info in the PI binary format to specified filename \p path. The
+//! file is replaced atomically, which makes it suitable for on-disk caching of
+//! p4info objects. Returns the number of bytes written on success, or -1 on
+//! failure.
+int pi_serialize_config_binary_to_file(const pi_p4info_t *p4info,
+                                       const char *path);
+
+//! Size in bytes of the header of a binary config.
+#define PI_CONFIG_BINARY_HEADER_SIZE 88
+
+//! Returns the size in bytes of the binary config starting at \p config, as
+//! recorded in its header, or 0 if \p config does not start with a valid binary
+//! config header. Reads PI_CONFIG_BINARY_HEADER_SIZE bytes from \p config. When
+//! using pi_add_config with PI_CONFIG_TYPE_BINARY, the caller must ensure that
+//! this many bytes are readable from \p config.
+size_t pi_config_binary_size(const char *config);
+
 // generic iterators, to iterate over all types of resources, still a work in
 // progress
 pi_p4_id_t pi_p4info_any_begin(const pi_p4info_t *p4info,
@@ -89,6 +114,15 @@ pi_p4_id_t pi_p4info_any_id_from_name(const pi_p4info_t *p4info,
 //! Returns true iff the id is valid.
 bool pi_p4info_is_valid_id(const pi_p4info_t *p4info, pi_p4_id_t id);
 
+//! Returns true iff the object with id \p id exists in both \p p4info_1 and \p
+//! p4info_2 and has the same shape in both, i.e. any state associated with the
+//! object (e.g. table entries) remains valid when switching from one p4info to
+//! the other. For a table, this includes its match fields, its actions and
+//! their parameters, its implementation and its direct resources. Annotations
+//! and aliases are ignored.
+bool pi_p4info_object_equal(const pi_p4info_t *p4info_1,
+                            const pi_p4info_t *p4info_2, pi_p4_id_t id);
+
 #ifdef __cplusplus
 }
 #endif
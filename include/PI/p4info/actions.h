@@ -30,6 +30,47 @@
 extern "C" {
 #endif
 
+//! Precomputed information required to read / write one parameter in the
+//! action data.
+typedef struct {
+  pi_p4_id_t param_id;
+  size_t bitwidth;
+  //! offset of the parameter in the action data
+  size_t offset;
+  //! (bitwidth + 7) / 8
+  size_t nbytes;
+  char byte0_mask;
+} pi_p4info_action_param_layout_t;
+
+//! Precomputed layout of the action data for an action, which can be used to
+//! build or read action data without any further p4info query. Use
+//! pi_p4info_action_data_layout_index to map a parameter id to an index in
+//! params.
+typedef struct {
+  size_t num_params;
+  size_t action_data_size;
+  //! one entry per parameter, in action data order
+  pi_p4info_action_param_layout_t *params;
+  //! maps a parameter id to its index in params; NULL if the id space is too
+  //! sparse
+  size_t *id_to_index;
+  size_t id_to_index_size;
+} pi_p4info_action_data_layout_t;
+
+//! Returns the index (in \p layout->params) of the parameter with id \p
+//! param_id, or (size_t)-1 if the action does not have such a parameter.
+static inline size_t pi_p4info_action_data_layout_index(
+    const pi_p4info_action_data_layout_t *layout, pi_p4_id_t param_id) {
+  if (layout->id_to_index) {
+    return (param_id < layout->id_to_index_size)
+               ? layout->id_to_index[param_id]
+               : (size_t)-1;
+  }
+  for (size_t i = 0; i < layout->num_params; i++)
+    if (layout->params[i].param_id == param_id) return i;
+  return (size_t)-1;
+}
+
 size_t pi_p4info_action_get_num(const pi_p4info_t *p4info);
 
 pi_p4_id_t pi_p4info_action_id_from_name(const pi_p4info_t *p4info,
@@ -70,6 +111,11 @@ size_t pi_p4info_action_param_offset(const pi_p4info_t *p4info,
 size_t pi_p4info_action_data_size(const pi_p4info_t *p4info,
                                   pi_p4_id_t action_id);
 
+//! Returns the action data layout for the action. The returned pointer remains
+//! valid for the lifetime of the \p p4info object.
+const pi_p4info_action_data_layout_t *pi_p4info_action_data_layout(
+    const pi_p4info_t *p4info, pi_p4_id_t action_id);
+
 pi_p4_id_t pi_p4info_action_begin(const pi_p4info_t *p4info);
 pi_p4_id_t pi_p4info_action_next(const pi_p4info_t *p4info, pi_p4_id_t id);
 pi_p4_id_t pi_p4info_action_end(const pi_p4info_t *p4info);
@@ -37,6 +37,8 @@ typedef enum {
   PI_P4INFO_COUNTER_UNIT_BOTH
 } pi_p4info_counter_unit_t;
 
+#define PI_P4INFO_COUNTER_MAX_WIDTH 64
+
 pi_p4_id_t pi_p4info_counter_id_from_name(const pi_p4info_t *p4info,
                                           const char *name);
 
@@ -52,6 +54,12 @@ pi_p4info_counter_unit_t pi_p4info_counter_get_unit(const pi_p4info_t *p4info,
 size_t pi_p4info_counter_get_size(const pi_p4info_t *p4info,
                                   pi_p4_id_t counter_id);
 
+//! Width in bits of the counter cells in hardware. Cells narrower than 64 bits
+//! wrap around, which the PI counter cache accounts for. Defaults to
+//! PI_P4INFO_COUNTER_MAX_WIDTH if the P4 config does not specify it.
+size_t pi_p4info_counter_get_width(const pi_p4info_t *p4info,
+                                   pi_p4_id_t counter_id);
+
 pi_p4_id_t pi_p4info_counter_begin(const pi_p4info_t *p4info);
 pi_p4_id_t pi_p4info_counter_next(const pi_p4info_t *p4info, pi_p4_id_t id);
 pi_p4_id_t pi_p4info_counter_end(const pi_p4info_t *p4info);
@@ -46,6 +46,47 @@ typedef struct {
   size_t bitwidth;
 } pi_p4info_match_field_info_t;
 
+//! Precomputed information required to read / write one match field in the
+//! match key data.
+typedef struct {
+  pi_p4_id_t mf_id;
+  pi_p4info_match_type_t match_type;
+  size_t bitwidth;
+  //! offset of the field in the match key data
+  size_t offset;
+  //! number of bytes used for one value of the field, i.e. (bitwidth + 7) / 8
+  size_t nbytes;
+  char byte0_mask;
+} pi_p4info_match_field_layout_t;
+
+//! Precomputed layout of the match key for a table, which can be used to build
+//! or read match keys without any further p4info query. Use
+//! pi_p4info_match_key_layout_index to map a match field id to an index in
+//! fields.
+typedef struct {
+  size_t num_fields;
+  size_t match_key_size;
+  //! one entry per match field, in match key order
+  pi_p4info_match_field_layout_t *fields;
+  //! maps a match field id to its index in fields; NULL if the id space is too
+  //! sparse
+  size_t *id_to_index;
+  size_t id_to_index_size;
+} pi_p4info_match_key_layout_t;
+
+//! Returns the index (in \p layout->fields) of the match field with id \p
+//! mf_id, or (size_t)-1 if the table does not include such a field.
+static inline size_t pi_p4info_match_key_layout_index(
+    const pi_p4info_match_key_layout_t *layout, pi_p4_id_t mf_id) {
+  if (layout->id_to_index) {
+    return (mf_id < layout->id_to_index_size) ? layout->id_to_index[mf_id]
+                                              : (size_t)-1;
+  }
+  for (size_t i = 0; i < layout->num_fields; i++)
+    if (layout->fields[i].mf_id == mf_id) return i;
+  return (size_t)-1;
+}
+
 pi_p4_id_t pi_p4info_table_id_from_name(const pi_p4info_t *p4info,
                                         const char *name);
 
@@ -91,6 +132,11 @@ size_t pi_p4info_table_match_key_size(const pi_p4info_t *p4info,
 const pi_p4info_match_field_info_t *pi_p4info_table_match_field_info(
     const pi_p4info_t *p4info, pi_p4_id_t table_id, size_t index);
 
+//! Returns the match key layout for the table. The returned pointer remains
+//! valid for the lifetime of the \p p4info object.
+const pi_p4info_match_key_layout_t *pi_p4info_table_match_key_layout(
+    const pi_p4info_t *p4info, pi_p4_id_t table_id);
+
 size_t pi_p4info_table_num_actions(const pi_p4info_t *p4info,
                                    pi_p4_id_t table_id);
 
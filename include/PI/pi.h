@@ -72,6 +72,13 @@ pi_status_t pi_update_device_start(pi_dev_id_t dev_id,
 //! Terminates a P4 config update sequence, see pi_update_device_start.
 pi_status_t pi_update_device_end(pi_dev_id_t dev_id);
 
+//! Returns true if the target keeps the state (table entries, action profile
+//! members and groups, ...) of the objects which are common to the old and new
+//! P4 configs across a pi_update_device_start / pi_update_device_end sequence.
+//! Returns false if the target resets the device state on an update, or if it
+//! does not say.
+bool pi_update_device_preserves_state(pi_dev_id_t dev_id);
+
 //! Check if a device was assigned.
 bool pi_is_device_assigned(pi_dev_id_t dev_id);
 
@@ -90,6 +97,13 @@ pi_status_t pi_batch_begin(pi_session_handle_t session_handle);
 
 //! End the ongoing batch for the session. If \p hw_sync is true, the call will
 //! block until all the operations have been committed to hardware.
+//! Some targets (e.g. the RPC target) defer the operations in the batch whose
+//! only result is a status (e.g. entry modify and delete, default entry set,
+//! counter and meter writes): these return PI_STATUS_SUCCESS immediately, and
+//! their errors are only reported by the return value of this call, which is
+//! the status of the first deferred operation which failed. Operations which
+//! return a handle (e.g. entry add, member and group create) or some data
+//! (e.g. reads) first send the deferred operations and then run synchronously.
 pi_status_t pi_batch_end(pi_session_handle_t session_handle, bool hw_sync);
 
 //! PI cleanup function.
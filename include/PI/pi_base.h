@@ -38,7 +38,9 @@ extern "C" {
 typedef enum {
   PI_CONFIG_TYPE_NONE = 0,  // for testing
   PI_CONFIG_TYPE_BMV2_JSON,
-  PI_CONFIG_TYPE_NATIVE_JSON
+  PI_CONFIG_TYPE_NATIVE_JSON,
+  //! see pi_serialize_config_binary
+  PI_CONFIG_TYPE_BINARY
 } pi_config_type_t;
 
 //! Possible status codes for PI calls. Values above 1000 are reserved for
@@ -93,6 +95,9 @@ typedef enum {
 
   PI_STATUS_NOT_IMPLEMENTED_BY_TARGET,
 
+  PI_STATUS_COUNTER_CACHE_INVALID_CONFIG,
+  PI_STATUS_COUNTER_NOT_CACHED,
+
   //! everything above 1000 is reserved for targets
   PI_STATUS_TARGET_ERROR = 1000
 } pi_status_t;
@@ -45,6 +45,9 @@ typedef struct {
 #define PI_COUNTER_FLAGS_NONE 0
 // do a sync with the hw when reading a counter
 #define PI_COUNTER_FLAGS_HW_SYNC (1 << 0)
+// serve the read from the counter cache (see pi_counter_cache_enable); if the
+// counter is not cached or its last snapshot is too old, the target is queried
+#define PI_COUNTER_FLAGS_CACHED (1 << 1)
 
 //! Reads an indirect counter at the given \p index.
 pi_status_t pi_counter_read(pi_session_handle_t session_handle,
@@ -52,6 +55,15 @@ pi_status_t pi_counter_read(pi_session_handle_t session_handle,
                             size_t index, int flags,
                             pi_counter_data_t *counter_data);
 
+//! Reads \p count consecutive entries of an indirect counter, starting at
+//! index \p start. \p counter_data must have room for \p count entries; entry
+//! i of the output corresponds to index \p start + i. The whole range must be
+//! within the counter size.
+pi_status_t pi_counter_read_range(pi_session_handle_t session_handle,
+                                  pi_dev_tgt_t dev_tgt, pi_p4_id_t counter_id,
+                                  size_t start, size_t count, int flags,
+                                  pi_counter_data_t *counter_data);
+
 //! Writes an indirect counter at the given \p index.
 pi_status_t pi_counter_write(pi_session_handle_t session_handle,
                              pi_dev_tgt_t dev_tgt, pi_p4_id_t counter_id,
@@ -80,6 +92,47 @@ pi_status_t pi_counter_hw_sync(pi_session_handle_t session_handle,
                                pi_dev_tgt_t dev_tgt, pi_p4_id_t counter_id,
                                PICounterHwSyncCb cb, void *cb_cookie);
 
+//! Configuration for a cached counter array.
+typedef struct {
+  //! how often the background poller reads the whole counter array from the
+  //! target, must be non-zero
+  uint32_t poll_interval_ms;
+  //! maximum age of the snapshot used to serve a read with
+  //! PI_COUNTER_FLAGS_CACHED; 0 means twice the poll interval
+  uint32_t max_staleness_ms;
+} pi_counter_cache_config_t;
+
+//! Difference between the 2 most recent snapshots of a cached counter cell.
+typedef struct {
+  pi_counter_data_t delta;
+  //! time elapsed between the 2 snapshots
+  uint64_t interval_ns;
+  double packets_per_sec;
+  double bytes_per_sec;
+} pi_counter_rate_t;
+
+//! Starts caching an indirect counter array. A background thread reads the
+//! whole array from the target every \p config->poll_interval_ms, with bulk
+//! range reads, and keeps the 2 most recent snapshots in memory. These
+//! snapshots are used to serve reads done with PI_COUNTER_FLAGS_CACHED and
+//! reads of per-cell rates. Snapshot values are accumulated in 64-bit software
+//! counters, using the counter width from the P4 config to detect hardware
+//! counters which wrapped around between 2 polls. Calling this function again
+//! for the same counter updates its configuration. Cached counters are dropped
+//! when the device is removed or its P4 config is updated.
+pi_status_t pi_counter_cache_enable(pi_dev_tgt_t dev_tgt, pi_p4_id_t counter_id,
+                                    const pi_counter_cache_config_t *config);
+
+//! Stops caching an indirect counter array and releases its snapshots.
+pi_status_t pi_counter_cache_disable(pi_dev_tgt_t dev_tgt,
+                                     pi_p4_id_t counter_id);
+
+//! Computes the delta and the rates of a cached counter cell from the 2 most
+//! recent snapshots. Returns PI_STATUS_COUNTER_NOT_CACHED if the counter is not
+//! cached or if fewer than 2 snapshots have been taken so far.
+pi_status_t pi_counter_read_rate(pi_dev_tgt_t dev_tgt, pi_p4_id_t counter_id,
+                                 size_t index, pi_counter_rate_t *rate);
+
 #ifdef __cplusplus
 }
 #endif
@@ -158,6 +158,37 @@ pi_status_t pi_table_entry_modify_wkey(pi_session_handle_t session_handle,
                                        const pi_match_key_t *match_key,
                                        const pi_table_entry_t *table_entry);
 
+//! Adds \p num entries to a table in a single call. \p match_keys and \p
+//! table_entries are arrays of size \p num. The status of each individual
+//! operation is written to \p statuses and the handle of each new entry to \p
+//! entry_handles, which are also arrays of size \p num. Entries are added in
+//! order, and a failure does not prevent the next entries from being
+//! added. Returns PI_STATUS_SUCCESS if all entries were added, or else the
+//! status of the first entry which could not be added. Targets which do not
+//! support batching are handled by calling pi_table_entry_add for each entry,
+//! but for other targets (e.g. the RPC target), this is much faster.
+pi_status_t pi_table_entries_add_batch(pi_session_handle_t session_handle,
+                                       pi_dev_tgt_t dev_tgt,
+                                       pi_p4_id_t table_id, size_t num,
+                                       const pi_match_key_t *const *match_keys,
+                                       const pi_table_entry_t *table_entries,
+                                       int overwrite, pi_status_t *statuses,
+                                       pi_entry_handle_t *entry_handles);
+
+//! Batched version of pi_table_entry_modify_wkey, see
+//! pi_table_entries_add_batch.
+pi_status_t pi_table_entries_modify_wkey_batch(
+    pi_session_handle_t session_handle, pi_dev_id_t dev_id, pi_p4_id_t table_id,
+    size_t num, const pi_match_key_t *const *match_keys,
+    const pi_table_entry_t *table_entries, pi_status_t *statuses);
+
+//! Batched version of pi_table_entry_delete_wkey, see
+//! pi_table_entries_add_batch.
+pi_status_t pi_table_entries_delete_wkey_batch(
+    pi_session_handle_t session_handle, pi_dev_id_t dev_id, pi_p4_id_t table_id,
+    size_t num, const pi_match_key_t *const *match_keys,
+    pi_status_t *statuses);
+
 typedef struct pi_table_fetch_res_s pi_table_fetch_res_t;
 
 //! Retrieve all entries in table as one big blob.
@@ -165,6 +196,57 @@ pi_status_t pi_table_entries_fetch(pi_session_handle_t session_handle,
                                    pi_dev_id_t dev_id, pi_p4_id_t table_id,
                                    pi_table_fetch_res_t **res);
 
+#define PI_TABLE_FETCH_FLAGS_NONE 0
+// also retrieve the direct counters / meters of every entry; they can be
+// accessed through the direct_res_config field of the entries, which only
+// includes the types of resources which were requested
+#define PI_TABLE_FETCH_FLAGS_DIRECT_COUNTERS (1 << 0)
+#define PI_TABLE_FETCH_FLAGS_DIRECT_METERS (1 << 1)
+#define PI_TABLE_FETCH_FLAGS_DIRECT_RES \
+  (PI_TABLE_FETCH_FLAGS_DIRECT_COUNTERS | PI_TABLE_FETCH_FLAGS_DIRECT_METERS)
+
+//! Same as pi_table_entries_fetch, with \p flags (see PI_TABLE_FETCH_FLAGS_*)
+//! controlling what is retrieved for each entry. If the target does not
+//! support retrieving direct resources with the entries, the PI core reads them
+//! for each entry.
+pi_status_t pi_table_entries_fetch_wflags(pi_session_handle_t session_handle,
+                                          pi_dev_id_t dev_id,
+                                          pi_p4_id_t table_id, int flags,
+                                          pi_table_fetch_res_t **res);
+
+typedef enum {
+  PI_TABLE_FETCH_FILTER_ENTRY_HANDLE = (1 << 0),
+  PI_TABLE_FETCH_FILTER_MATCH_KEY = (1 << 1),
+  PI_TABLE_FETCH_FILTER_PRIORITY = (1 << 2),
+  PI_TABLE_FETCH_FILTER_ACTION_ID = (1 << 3),
+} pi_table_fetch_filter_flag_t;
+
+//! Describes which entries to return for pi_table_entries_fetch_filtered. Only
+//! the fields enabled in \p flags (bitwise OR of pi_table_fetch_filter_flag_t
+//! values) are used, and an entry is returned if it matches all of them.
+typedef struct {
+  uint32_t flags;
+  pi_entry_handle_t entry_handle;
+  //! The match key data is compared with the entry's, after applying \p
+  //! match_key_mask to both of them if it is not NULL. The mask has the same
+  //! size as the match key data and can be used for example to only compare
+  //! some fields of the match key.
+  const pi_match_key_t *match_key;
+  const char *match_key_mask;
+  uint32_t priority;
+  //! Entries which do not use direct action data never match.
+  pi_p4_id_t action_id;
+} pi_table_fetch_filter_t;
+
+//! Same as pi_table_entries_fetch, but only returns entries matching \p
+//! filter. If the target supports it, the filter is evaluated by the target;
+//! otherwise it is evaluated by the PI core and entries which do not match are
+//! never decoded. Filtering on the entry handle lets targets retrieve a single
+//! entry in constant time.
+pi_status_t pi_table_entries_fetch_filtered(
+    pi_session_handle_t session_handle, pi_dev_id_t dev_id, pi_p4_id_t table_id,
+    const pi_table_fetch_filter_t *filter, pi_table_fetch_res_t **res);
+
 //! Need to be called after a pi_table_entries_fetch, once you wish the memory
 //! to be released.
 pi_status_t pi_table_entries_fetch_done(pi_session_handle_t session_handle,
@@ -178,6 +260,54 @@ size_t pi_table_entries_next(pi_table_fetch_res_t *res,
                              pi_table_ma_entry_t *entry,
                              pi_entry_handle_t *entry_handle);
 
+//! Random access to the entries retrieved with pi_table_entries_fetch, in
+//! constant time. \p i must be less than pi_table_entries_num(res). No copy is
+//! made: the returned entry points inside \p res and remains valid until
+//! pi_table_entries_fetch_done is called.
+const pi_table_ma_entry_t *pi_table_entries_get(const pi_table_fetch_res_t *res,
+                                                size_t i);
+
+//! Returns the handle of the i-th entry retrieved with pi_table_entries_fetch.
+pi_entry_handle_t pi_table_entries_get_handle(const pi_table_fetch_res_t *res,
+                                              size_t i);
+
+typedef struct pi_table_fetch_cursor_s pi_table_fetch_cursor_t;
+
+//! Starts a paginated fetch of the entries of a table. Rather than returning
+//! the whole table at once like pi_table_entries_fetch, the entries are
+//! returned in chunks by pi_table_entries_fetch_next_chunk. A chunk includes at
+//! most \p max_entries entries and at most \p max_bytes bytes of encoded
+//! entries (but always at least one entry); 0 means no limit. Targets which do
+//! not support paginated fetches are handled by the PI core, but the whole
+//! table is then retrieved from the target at once.
+pi_status_t pi_table_entries_fetch_begin(pi_session_handle_t session_handle,
+                                         pi_dev_id_t dev_id,
+                                         pi_p4_id_t table_id,
+                                         size_t max_entries, size_t max_bytes,
+                                         pi_table_fetch_cursor_t **cursor);
+
+//! Same as pi_table_entries_fetch_begin, with \p flags (see
+//! PI_TABLE_FETCH_FLAGS_*). Targets only return direct resources with the whole
+//! table, so when \p flags is not PI_TABLE_FETCH_FLAGS_NONE the entries are
+//! always retrieved at once and split into chunks by the PI core.
+pi_status_t pi_table_entries_fetch_begin_wflags(
+    pi_session_handle_t session_handle, pi_dev_id_t dev_id,
+    pi_p4_id_t table_id, int flags, size_t max_entries, size_t max_bytes,
+    pi_table_fetch_cursor_t **cursor);
+
+//! Retrieves the next chunk of entries. \p res can be accessed with the same
+//! functions as the result of pi_table_entries_fetch and needs to be released
+//! with pi_table_entries_fetch_done. Once all the entries have been returned,
+//! \p res is set to NULL. When the PI core splits the table itself, the match
+//! keys and action data of a chunk point into the entries held by the cursor:
+//! a chunk is only valid until pi_table_entries_fetch_end is called.
+pi_status_t pi_table_entries_fetch_next_chunk(pi_table_fetch_cursor_t *cursor,
+                                              pi_table_fetch_res_t **res);
+
+//! Releases the cursor, which can be done before all the entries have been
+//! retrieved. Chunks obtained with the cursor must be released first.
+pi_status_t pi_table_entries_fetch_end(pi_table_fetch_cursor_t *cursor);
+
 #ifdef __cplusplus
 }
 #endif
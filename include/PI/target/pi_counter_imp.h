@@ -32,6 +32,15 @@ pi_status_t _pi_counter_read(pi_session_handle_t session_handle,
                              size_t index, int flags,
                              pi_counter_data_t *counter_data);
 
+// Optional. Reads \p count consecutive entries starting at \p start in a single
+// call. If the target does not implement it, the PI core falls back to calling
+// _pi_counter_read for each index. The range has already been checked against
+// the counter size.
+pi_status_t _pi_counter_read_range(pi_session_handle_t session_handle,
+                                   pi_dev_tgt_t dev_tgt, pi_p4_id_t counter_id,
+                                   size_t start, size_t count, int flags,
+                                   pi_counter_data_t *counter_data);
+
 pi_status_t _pi_counter_write(pi_session_handle_t session_handle,
                               pi_dev_tgt_t dev_tgt, pi_p4_id_t counter_id,
                               size_t index,
@@ -39,6 +39,10 @@ pi_status_t _pi_update_device_start(pi_dev_id_t dev_id,
 
 pi_status_t _pi_update_device_end(pi_dev_id_t dev_id);
 
+// Optional, see pi_update_device_preserves_state. A target which does not
+// implement it is assumed to reset the device state on a config update.
+bool _pi_update_device_preserves_state(pi_dev_id_t dev_id);
+
 pi_status_t _pi_remove_device(pi_dev_id_t dev_id);
 
 pi_status_t _pi_session_init(pi_session_handle_t *session_handle);
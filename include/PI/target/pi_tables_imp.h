@@ -27,6 +27,12 @@
 extern "C" {
 #endif
 
+// The functions documented as optional below are declared weak by the PI core
+// (with #pragma weak in src/pi_tables.c): a target can leave them undefined, in
+// which case their address is NULL and the PI core uses the fallback described
+// for each of them. A target cannot implement only part of a group (batch
+// functions, paginated fetch functions).
+
 pi_status_t _pi_table_entry_add(pi_session_handle_t session_handle,
                                 pi_dev_tgt_t dev_tgt, pi_p4_id_t table_id,
                                 const pi_match_key_t *match_key,
@@ -64,6 +70,30 @@ pi_status_t _pi_table_entry_modify_wkey(pi_session_handle_t session_handle,
                                         const pi_match_key_t *match_key,
                                         const pi_table_entry_t *table_entry);
 
+// The batch functions are optional: if a target does not implement them, the
+// PI core calls the corresponding single-entry function for each entry
+// instead. They must write the status of each entry to \p statuses. The
+// returned status is only used for errors which apply to the whole batch
+// (e.g. transport errors), in which case \p statuses is ignored.
+
+pi_status_t _pi_table_entries_add_batch(pi_session_handle_t session_handle,
+                                        pi_dev_tgt_t dev_tgt,
+                                        pi_p4_id_t table_id, size_t num,
+                                        const pi_match_key_t *const *match_keys,
+                                        const pi_table_entry_t *table_entries,
+                                        int overwrite, pi_status_t *statuses,
+                                        pi_entry_handle_t *entry_handles);
+
+pi_status_t _pi_table_entries_modify_wkey_batch(
+    pi_session_handle_t session_handle, pi_dev_id_t dev_id, pi_p4_id_t table_id,
+    size_t num, const pi_match_key_t *const *match_keys,
+    const pi_table_entry_t *table_entries, pi_status_t *statuses);
+
+pi_status_t _pi_table_entries_delete_wkey_batch(
+    pi_session_handle_t session_handle, pi_dev_id_t dev_id, pi_p4_id_t table_id,
+    size_t num, const pi_match_key_t *const *match_keys,
+    pi_status_t *statuses);
+
 pi_status_t _pi_table_entries_fetch(pi_session_handle_t session_handle,
                                     pi_dev_id_t dev_id, pi_p4_id_t table_id,
                                     pi_table_fetch_res_t *res);
@@ -71,6 +101,47 @@ pi_status_t _pi_table_entries_fetch(pi_session_handle_t session_handle,
 pi_status_t _pi_table_entries_fetch_done(pi_session_handle_t session_handle,
                                          pi_table_fetch_res_t *res);
 
+// Optional. The target may use \p filter to avoid returning all the entries
+// of the table (in particular when filtering on the entry handle), but it does
+// not have to evaluate all of it: the PI core discards the returned entries
+// which do not match the filter. If the target does not implement this
+// function, the PI core uses _pi_table_entries_fetch.
+pi_status_t _pi_table_entries_fetch_filtered(
+    pi_session_handle_t session_handle, pi_dev_id_t dev_id, pi_p4_id_t table_id,
+    const pi_table_fetch_filter_t *filter, pi_table_fetch_res_t *res);
+
+// Optional. The target must honor \p flags: with any of the
+// PI_TABLE_FETCH_FLAGS_DIRECT_RES bits set, each encoded entry is followed by
+// its direct resource configs of the requested types, encoded the same way as
+// when adding an entry (number of configs, then resource id, size and data for
+// each config). If the target does not implement this function, the PI core
+// uses _pi_table_entries_fetch and reads the direct resources itself.
+pi_status_t _pi_table_entries_fetch_wflags(pi_session_handle_t session_handle,
+                                           pi_dev_id_t dev_id,
+                                           pi_p4_id_t table_id, int flags,
+                                           pi_table_fetch_res_t *res);
+
+// The paginated fetch functions are optional: if a target does not implement
+// them, the PI core uses _pi_table_entries_fetch to retrieve all the entries
+// when the cursor is created and splits them into chunks itself. The target
+// identifies the cursor with \p cursor_handle. A chunk is filled the same way
+// as with _pi_table_entries_fetch and is released with
+// _pi_table_entries_fetch_done; a chunk with no entries means that all entries
+// have been returned.
+
+pi_status_t _pi_table_entries_fetch_begin(pi_session_handle_t session_handle,
+                                          pi_dev_id_t dev_id,
+                                          pi_p4_id_t table_id,
+                                          size_t max_entries, size_t max_bytes,
+                                          uint64_t *cursor_handle);
+
+pi_status_t _pi_table_entries_fetch_next_chunk(
+    pi_session_handle_t session_handle, uint64_t cursor_handle,
+    pi_table_fetch_res_t *res);
+
+pi_status_t _pi_table_entries_fetch_end(pi_session_handle_t session_handle,
+                                        uint64_t cursor_handle);
+
 #ifdef __cplusplus
 }
 #endif
@@ -48,6 +48,8 @@ class DeviceMgr {
   using Status = ::google::rpc::Status;
   using PacketInCb =
       std::function<void(device_id_t, p4::PacketIn *packet, void *cookie)>;
+  using ReadResponseSink =
+      std::function<bool(const p4::ReadResponse &response)>;
 
   explicit DeviceMgr(device_id_t device_id);
 
@@ -64,7 +66,29 @@ class DeviceMgr {
   // New write and read methods, meant to replace all the methods below
   Status write(const p4::WriteRequest &request);
 
+  // By default, the updates in a WriteRequest are executed sequentially, in
+  // order. With num_workers > 0, they are partitioned by P4 object (table,
+  // action profile, meter) and the partitions are executed concurrently by a
+  // pool of num_workers threads. Ordering is preserved for updates to the same
+  // object, and entries for indirect tables are ordered with respect to the
+  // members and groups of the table's action profile. As with sequential
+  // execution, write returns the status of the first update which failed, but
+  // updates to other objects which come after it in the request may have been
+  // applied. Must not be called concurrently with write.
+  void set_write_parallelism(size_t num_workers);
+
   Status read(const p4::ReadRequest &request, p4::ReadResponse *response) const;
+
+  // Streaming version of read: the entities are returned in chunks, and a chunk
+  // is passed to the sink as soon as it includes max_entities entities or its
+  // size reaches max_bytes (0 means no limit). A chunk can exceed max_bytes by
+  // at most one entity. The sink is called at least once, with an empty
+  // response if there is nothing to return. If the sink returns false (e.g.
+  // because the client went away), the read is aborted and CANCELLED is
+  // returned. The sink is never called with a table lock held, so it may block
+  // (e.g. on a slow client) without blocking writes to the tables.
+  Status read(const p4::ReadRequest &request, const ReadResponseSink &sink,
+              size_t max_entities, size_t max_bytes) const;
   Status read_one(const p4::Entity &entity, p4::ReadResponse *response) const;
 
   Status packet_out_send(const p4::PacketOut &packet) const;
@@ -102,7 +102,7 @@ ActionProfGroupMembership::compute_members_to_remove(
 using Status = ActionProfMgr::Status;
 
 ActionProfMgr::ActionProfMgr(pi_dev_tgt_t device_tgt, pi_p4_id_t act_prof_id,
-                             pi_p4info_t *p4info)
+                             const pi_p4info_t *p4info)
     : device_tgt(device_tgt), act_prof_id(act_prof_id), p4info(p4info) { }
 
 Status
@@ -156,7 +156,7 @@ ActionProfMgr::group_create(const p4::ActionProfileGroup &group,
   }
   group_bimap.add(group.group_id(), group_h);
   group_members.emplace(group.group_id(), ActionProfGroupMembership());
-  auto code = group_update_members(ap, group);
+  auto code = group_update_members(ap, session, group);
   status.set_code(code);
   return status;
 }
@@ -204,7 +204,7 @@ ActionProfMgr::group_modify(const p4::ActionProfileGroup &group,
     Logger::get()->error("Group id does not exist: {}", group.group_id());
     return status;
   }
-  auto code = group_update_members(ap, group);
+  auto code = group_update_members(ap, session, group);
   status.set_code(code);
   return status;
 }
@@ -223,6 +223,9 @@ ActionProfMgr::member_delete(const p4::ActionProfileMember &member,
     return status;
   }
   auto pi_status = ap.member_delete(*member_h);
+  // the member is only removed from the local state once the target has
+  // actually deleted it, which may be deferred until the end of the batch
+  if (pi_status == PI_STATUS_SUCCESS) pi_status = session.sync();
   if (pi_status != PI_STATUS_SUCCESS) {
     status.set_code(Code::UNKNOWN);
     Logger::get()->error("Error when deleting member on target");
@@ -248,6 +251,7 @@ ActionProfMgr::group_delete(const p4::ActionProfileGroup &group,
     return status;
   }
   auto pi_status = ap.group_delete(*group_h);
+  if (pi_status == PI_STATUS_SUCCESS) pi_status = session.sync();
   if (pi_status != PI_STATUS_SUCCESS) {
     status.set_code(Code::UNKNOWN);
     Logger::get()->error("Error when deleting group on target");
@@ -298,6 +302,7 @@ ActionProfMgr::update_group_membership(const Id &removed_member_id) {
 
 Code
 ActionProfMgr::group_update_members(pi::ActProf &ap,
+                                    const SessionTemp &session,
                                     const p4::ActionProfileGroup &group) {
   Code code;
   std::vector<Id> new_membership(group.members().size());
@@ -311,18 +316,19 @@ ActionProfMgr::group_update_members(pi::ActProf &ap,
   auto members_to_remove = membership.compute_members_to_remove(new_membership);
   // remove members as needed
   code = group_remove_members(
-      ap, group_id, members_to_remove.cbegin(), members_to_remove.cend());
+      ap, session, group_id,
+      members_to_remove.cbegin(), members_to_remove.cend());
   if (code != Code::OK) return code;
   // add members as needed
   code = group_add_members(
-      ap, group_id, members_to_add.cbegin(), members_to_add.cend());
+      ap, session, group_id, members_to_add.cbegin(), members_to_add.cend());
   if (code != Code::OK) return code;
   return Code::OK;
 }
 
 Code
-ActionProfMgr::group_add_member(pi::ActProf &ap, const Id &group_id,
-                                const Id &member_id) {
+ActionProfMgr::group_add_member(pi::ActProf &ap, const SessionTemp &session,
+                                const Id &group_id, const Id &member_id) {
   auto &membership = group_members.at(group_id);
   auto group_h = group_bimap.retrieve_handle(group_id);
   assert(group_h);
@@ -332,6 +338,7 @@ ActionProfMgr::group_add_member(pi::ActProf &ap, const Id &group_id,
     return Code::INVALID_ARGUMENT;
   }
   auto pi_status = ap.group_add_member(*group_h, *member_h);
+  if (pi_status == PI_STATUS_SUCCESS) pi_status = session.sync();
   if (pi_status != PI_STATUS_SUCCESS) {
     Logger::get()->error("Error when adding member to group on target");
     return Code::UNKNOWN;
@@ -341,8 +348,9 @@ ActionProfMgr::group_add_member(pi::ActProf &ap, const Id &group_id,
 }
 
 Code
-ActionProfMgr::group_remove_member(pi::ActProf &ap, const Id &group_id,
-                                   const Id &member_id) {
+ActionProfMgr::group_remove_member(pi::ActProf &ap,
+                                   const SessionTemp &session,
+                                   const Id &group_id, const Id &member_id) {
   auto &membership = group_members.at(group_id);
   auto group_h = group_bimap.retrieve_handle(group_id);
   assert(group_h);
@@ -352,6 +360,7 @@ ActionProfMgr::group_remove_member(pi::ActProf &ap, const Id &group_id,
     return Code::INVALID_ARGUMENT;
   }
   auto pi_status = ap.group_remove_member(*group_h, *member_h);
+  if (pi_status == PI_STATUS_SUCCESS) pi_status = session.sync();
   if (pi_status != PI_STATUS_SUCCESS) {
     Logger::get()->error("Error when removing member from group on target");
     return Code::UNKNOWN;
@@ -360,6 +369,12 @@ ActionProfMgr::group_remove_member(pi::ActProf &ap, const Id &group_id,
   return Code::OK;
 }
 
+void
+ActionProfMgr::p4_change(const pi_p4info_t *p4info_new) {
+  Lock lock(mutex);
+  p4info = p4info_new;
+}
+
 const pi_indirect_handle_t *
 ActionProfMgr::retrieve_member_handle(const Id &member_id) {
   Lock lock(mutex);
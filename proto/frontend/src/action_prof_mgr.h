@@ -122,7 +122,7 @@ class ActionProfMgr {
   using SessionTemp = common::SessionTemp;
 
   ActionProfMgr(pi_dev_tgt_t device_tgt, pi_p4_id_t act_prof_id,
-                pi_p4info_t *p4info);
+                const pi_p4info_t *p4info);
 
   Status member_create(const p4::ActionProfileMember &member,
                        const SessionTemp &session);
@@ -142,6 +142,10 @@ class ActionProfMgr {
   Status group_delete(const p4::ActionProfileGroup &group,
                       const SessionTemp &session);
 
+  // used to carry over the state of the action profile when the new p4info
+  // does not change it (see pi_p4info_object_equal)
+  void p4_change(const pi_p4info_t *p4info_new);
+
   // returns nullptr if no matching id
   const pi_indirect_handle_t *retrieve_member_handle(const Id &member_id);
   const pi_indirect_handle_t *retrieve_group_handle(const Id &group_id);
@@ -158,35 +162,36 @@ class ActionProfMgr {
   // using RepeatedMembers = decltype(
   //     static_cast<p4::ActionProfileGroup *>(nullptr)->member_id());
   Code group_update_members(pi::ActProf &ap,  // NOLINT(runtime/references)
+                            const SessionTemp &session,
                             const p4::ActionProfileGroup &group);
 
   template <typename It>
   // NOLINTNEXTLINE(runtime/references)
-  Code group_add_members(pi::ActProf &ap, const Id &group_id,
-                         It first, It last) {
+  Code group_add_members(pi::ActProf &ap, const SessionTemp &session,
+                         const Id &group_id, It first, It last) {
     for (auto it = first; it != last; ++it) {
-      auto code = group_add_member(ap, group_id, *it);
+      auto code = group_add_member(ap, session, group_id, *it);
       if (code != Code::OK) return code;
     }
     return Code::OK;
   }
   // NOLINTNEXTLINE(runtime/references)
-  Code group_add_member(pi::ActProf &ap, const Id &group_id,
-                        const Id &member_id);
+  Code group_add_member(pi::ActProf &ap, const SessionTemp &session,
+                        const Id &group_id, const Id &member_id);
 
   template <typename It>
   // NOLINTNEXTLINE(runtime/references)
-  Code group_remove_members(pi::ActProf &ap, const Id &group_id,
-                            It first, It last) {
+  Code group_remove_members(pi::ActProf &ap, const SessionTemp &session,
+                            const Id &group_id, It first, It last) {
     for (auto it = first; it != last; ++it) {
-      auto code = group_remove_member(ap, group_id, *it);
+      auto code = group_remove_member(ap, session, group_id, *it);
       if (code != Code::OK) return code;
     }
     return Code::OK;
   }
   // NOLINTNEXTLINE(runtime/references)
-  Code group_remove_member(pi::ActProf &ap, const Id &group_id,
-                           const Id &member_id);
+  Code group_remove_member(pi::ActProf &ap, const SessionTemp &session,
+                           const Id &group_id, const Id &member_id);
 
   // iterates over groups to remove member
   void update_group_membership(const Id &removed_member_id);
@@ -195,7 +200,7 @@ class ActionProfMgr {
   using Lock = std::lock_guard<ActionProfMgr::Mutex>;
   pi_dev_tgt_t device_tgt;
   pi_p4_id_t act_prof_id;
-  pi_p4info_t *p4info;
+  const pi_p4info_t *p4info;
   ActionProfBiMap member_bimap{};
   ActionProfBiMap group_bimap{};
   std::map<Id, ActionProfGroupMembership> group_members{};
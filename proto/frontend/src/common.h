@@ -53,6 +53,24 @@ struct SessionTemp {
 
   pi_session_handle_t get() const { return sess; }
 
+  // ends the batch, returning the status of the first deferred operation which
+  // failed; the destructor does not end it again
+  pi_status_t end_batch() {
+    if (!batch) return PI_STATUS_SUCCESS;
+    batch = false;
+    return pi_batch_end(sess, false  /* hw_sync */);
+  }
+
+  // returns the status of the operations deferred so far and starts a new
+  // batch; to be called before updating any local state which depends on the
+  // success of an operation
+  pi_status_t sync() const {
+    if (!batch) return PI_STATUS_SUCCESS;
+    auto status = pi_batch_end(sess, false  /* hw_sync */);
+    pi_batch_begin(sess);
+    return status;
+  }
+
   pi_session_handle_t sess;
   bool batch;
 };
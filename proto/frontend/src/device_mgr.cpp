@@ -23,8 +23,10 @@
 #include <PI/pi.h>
 #include <PI/proto/util.h>
 
+#include <algorithm>
 #include <memory>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "google/rpc/code.pb.h"
@@ -33,9 +35,11 @@
 #include "action_prof_mgr.h"
 #include "common.h"
 #include "logger.h"
-#include "p4info_to_and_from_proto.h"  // for p4info_proto_reader
+#include "match_key_validator.h"
+#include "p4info_cache.h"
 #include "packet_io_mgr.h"
 #include "table_info_store.h"
+#include "worker_pool.h"
 
 #include "p4/tmp/p4config.pb.h"
 
@@ -49,9 +53,9 @@ using device_id_t = DeviceMgr::device_id_t;
 using p4_id_t = DeviceMgr::p4_id_t;
 using Status = DeviceMgr::Status;
 using PacketInCb = DeviceMgr::PacketInCb;
+using ReadResponseSink = DeviceMgr::ReadResponseSink;
 using Code = ::google::rpc::Code;
 using common::SessionTemp;
-using common::check_proto_bytestring;
 using common::make_invalid_p4_id_status;
 using pi::proto::util::P4ResourceType;
 
@@ -61,11 +65,19 @@ using pi::proto::util::P4ResourceType;
 
 namespace {
 
-// wraps the p4info pointer provided by the PI library into a unique_ptr
-auto p4info_deleter = [](pi_p4info_t *p4info) {
-  pi_destroy_config(p4info);
-};
-using P4InfoWrapper = std::unique_ptr<pi_p4info_t, decltype(p4info_deleter)>;
+bool same_packet_metadata(const p4::config::P4Info &p4info_1,
+                          const p4::config::P4Info &p4info_2) {
+  const auto &metadata_1 = p4info_1.controller_packet_metadata();
+  const auto &metadata_2 = p4info_2.controller_packet_metadata();
+  if (metadata_1.size() != metadata_2.size()) return false;
+  for (int i = 0; i < metadata_1.size(); i++) {
+    if (metadata_1.Get(i).SerializeAsString() !=
+        metadata_2.Get(i).SerializeAsString()) {
+      return false;
+    }
+  }
+  return true;
+}
 
 pi_meter_spec_t meter_spec_proto_to_pi(const p4::MeterConfig &config) {
   pi_meter_spec_t pi_meter_spec;
@@ -78,6 +90,72 @@ pi_meter_spec_t meter_spec_proto_to_pi(const p4::MeterConfig &config) {
   return pi_meter_spec;
 }
 
+// Read entities are added to a ReadResponse message. When there is a sink, the
+// message is flushed to the sink and cleared each time it reaches the entity
+// or byte budget, which bounds memory usage for large reads. The size of an
+// entity is only known once it has been filled in, so it is accounted for when
+// the next entity is added; a chunk can therefore exceed the byte budget by one
+// entity.
+class ReadResponseStream {
+ public:
+  // all the entities are accumulated in response
+  explicit ReadResponseStream(p4::ReadResponse *response)
+      : response(response) { }
+
+  // 0 means no limit for max_entities and max_bytes
+  ReadResponseStream(const ReadResponseSink *sink, size_t max_entities,
+                     size_t max_bytes)
+      : response(&chunk), sink(sink), max_entities(max_entities),
+        max_bytes(max_bytes) { }
+
+  p4::Entity *add_entity() {
+    if (sink != nullptr) {
+      if (num_accounted < response->entities_size()) {
+        chunk_bytes += response->entities(num_accounted).ByteSizeLong();
+        num_accounted++;
+      }
+      if ((max_entities > 0 &&
+           static_cast<size_t>(response->entities_size()) >= max_entities) ||
+          (max_bytes > 0 && chunk_bytes >= max_bytes)) {
+        flush();
+      }
+    }
+    return response->add_entities();
+  }
+
+  // Sends the last chunk; the sink is always called at least once, even if
+  // there is no entity to return. Returns false if the sink aborted the read.
+  bool finish() {
+    if (sink != nullptr && (response->entities_size() > 0 || num_flushed == 0))
+      flush();
+    return !aborted;
+  }
+
+  // the read can stop early, the entities are discarded anyway
+  bool is_aborted() const { return aborted; }
+
+ private:
+  void flush() {
+    if (!aborted) aborted = !(*sink)(*response);
+    num_flushed++;
+    // cleared entities are kept around by protobuf and reused for the next
+    // chunk
+    response->clear_entities();
+    chunk_bytes = 0;
+    num_accounted = 0;
+  }
+
+  p4::ReadResponse chunk{};
+  p4::ReadResponse *response;
+  const ReadResponseSink *sink{nullptr};
+  size_t max_entities{0};
+  size_t max_bytes{0};
+  size_t chunk_bytes{0};
+  int num_accounted{0};
+  size_t num_flushed{0};
+  bool aborted{false};
+};
+
 }  // namespace
 
 class DeviceMgrImp {
@@ -94,30 +172,67 @@ class DeviceMgrImp {
   // we assume that the DeviceMgr client is smart enough here: for p4info
   // updates we do not do any locking; we assume that the client will not issue
   // table commands... while updating p4info
-  void p4_change(const p4::config::P4Info &p4info_proto_new,
-                 pi_p4info_t *p4info_new) {
-    table_info_store.reset();
+  // if preserve_state is true (i.e. the target kept the device state across the
+  // config update), the state of the tables and action profiles which are the
+  // same in the old and new p4info is carried over and only the state of the
+  // other ones is reset; otherwise all the state is reset
+  void p4_change(P4InfoCache::EntryPtr p4info_entry_new, bool preserve_state) {
+    const auto *p4info_new = p4info_entry_new->p4info;
+    // p4info is nullptr if the device was not configured or was removed
+    auto is_unchanged = [this, p4info_new, preserve_state](pi_p4_id_t id) {
+      return preserve_state && p4info != nullptr &&
+          pi_p4info_object_equal(p4info, p4info_new, id);
+    };
+
+    if (!preserve_state) {
+      table_info_store.reset();
+    } else if (p4info != nullptr) {
+      for (auto t_id = pi_p4info_table_begin(p4info);
+           t_id != pi_p4info_table_end(p4info);
+           t_id = pi_p4info_table_next(p4info, t_id)) {
+        if (!is_unchanged(t_id)) table_info_store.remove_table(t_id);
+      }
+    }
+    decltype(match_key_validators) match_key_validators_new;
     for (auto t_id = pi_p4info_table_begin(p4info_new);
          t_id != pi_p4info_table_end(p4info_new);
          t_id = pi_p4info_table_next(p4info_new, t_id)) {
-      table_info_store.add_table(t_id);
+      // no-op if the table was carried over
+      table_info_store.add_table(
+          t_id,
+          pi_p4info_table_match_key_layout(p4info_new, t_id)->match_key_size);
+      match_key_validators_new.emplace(
+          t_id, MatchKeyValidator(p4info_new, t_id));
     }
+    match_key_validators.swap(match_key_validators_new);
 
-    action_profs.clear();
+    decltype(action_profs) action_profs_new;
     for (auto act_prof_id = pi_p4info_act_prof_begin(p4info_new);
          act_prof_id != pi_p4info_act_prof_end(p4info_new);
          act_prof_id = pi_p4info_act_prof_next(p4info_new, act_prof_id)) {
+      auto it = action_profs.find(act_prof_id);
+      if (it != action_profs.end() && is_unchanged(act_prof_id)) {
+        it->second->p4_change(p4info_new);
+        action_profs_new.emplace(act_prof_id, std::move(it->second));
+        continue;
+      }
       std::unique_ptr<ActionProfMgr> mgr(
           new ActionProfMgr(device_tgt, act_prof_id, p4info_new));
-      action_profs.emplace(act_prof_id, std::move(mgr));
+      action_profs_new.emplace(act_prof_id, std::move(mgr));
     }
+    action_profs.swap(action_profs_new);
 
-    packet_io.p4_change(p4info_proto_new);
+    if (!p4info_entry ||
+        !same_packet_metadata(p4info_entry->p4info_proto,
+                              p4info_entry_new->p4info_proto)) {
+      packet_io.p4_change(p4info_entry_new->p4info_proto);
+    }
 
     // we do this last, so that the ActProfMgr instances never point to an
-    // invalid p4info, even though this is not strictly required here
-    p4info.reset(p4info_new);
-    p4info_proto.CopyFrom(p4info_proto_new);
+    // invalid p4info, even though this is not strictly required here; this
+    // releases our reference to the previous cache entry
+    p4info = p4info_new;
+    p4info_entry = std::move(p4info_entry_new);
   }
 
   Status pipeline_config_set(p4::SetForwardingPipelineConfigRequest_Action a,
@@ -130,11 +245,14 @@ class DeviceMgrImp {
       return status;
     }
 
-    pi_p4info_t *p4info_tmp = nullptr;
+    // if another device is already using the same P4Info, we share its
+    // pi_p4info_t object instead of importing the P4Info again
+    P4InfoCache::EntryPtr p4info_entry_tmp{nullptr};
     if (a == p4::SetForwardingPipelineConfigRequest_Action_VERIFY ||
         a == p4::SetForwardingPipelineConfigRequest_Action_VERIFY_AND_SAVE ||
         a == p4::SetForwardingPipelineConfigRequest_Action_VERIFY_AND_COMMIT) {
-      if (!pi::p4info::p4info_proto_reader(config.p4info(), &p4info_tmp)) {
+      p4info_entry_tmp = P4InfoCache::get_instance()->get(config.p4info());
+      if (!p4info_entry_tmp) {
         Logger::get()->error("Error when importing p4info");
         status.set_code(Code::UNKNOWN);
         return status;
@@ -158,8 +276,10 @@ class DeviceMgrImp {
     auto remove_device = [this]() {
       pi_remove_device(device_id);
       table_info_store.reset();
+      match_key_validators.clear();
       action_profs.clear();
-      p4info.reset(nullptr);
+      p4info = nullptr;
+      p4info_entry.reset();
     };
 
     auto make_assign_options = [&p4_device_config]() {
@@ -181,14 +301,13 @@ class DeviceMgrImp {
       if (pi_is_device_assigned(device_id)) remove_device();
       assert(!pi_is_device_assigned(device_id));
       auto assign_options = make_assign_options();
-      pi_status = pi_assign_device(device_id, p4info_tmp,
+      pi_status = pi_assign_device(device_id, p4info_entry_tmp->p4info,
                                    assign_options.data());
       if (pi_status != PI_STATUS_SUCCESS) {
         status.set_code(Code::UNKNOWN);
-        pi_destroy_config(p4info_tmp);
         return status;
       }
-      p4_change(config.p4info(), p4info_tmp);
+      p4_change(std::move(p4info_entry_tmp), false);
       return status;
     }
 
@@ -204,7 +323,6 @@ class DeviceMgrImp {
         if (pi_status != PI_STATUS_SUCCESS) {
           Logger::get()->error("Error when trying to assign device");
           status.set_code(Code::UNKNOWN);
-          pi_destroy_config(p4info_tmp);
           return status;
         }
       }
@@ -213,16 +331,16 @@ class DeviceMgrImp {
     if (a == p4::SetForwardingPipelineConfigRequest_Action_VERIFY_AND_SAVE ||
         a == p4::SetForwardingPipelineConfigRequest_Action_VERIFY_AND_COMMIT) {
       const auto &device_data = p4_device_config.device_data();
-      pi_status = pi_update_device_start(device_id, p4info_tmp,
+      pi_status = pi_update_device_start(device_id, p4info_entry_tmp->p4info,
                                          device_data.data(),
                                          device_data.size());
       if (pi_status != PI_STATUS_SUCCESS) {
         Logger::get()->error("Error in first phase of device update");
         status.set_code(Code::UNKNOWN);
-        pi_destroy_config(p4info_tmp);
         return status;
       }
-      p4_change(config.p4info(), p4info_tmp);
+      p4_change(std::move(p4info_entry_tmp),
+                pi_update_device_preserves_state(device_id));
     }
 
     if (a == p4::SetForwardingPipelineConfigRequest_Action_VERIFY_AND_COMMIT ||
@@ -240,7 +358,10 @@ class DeviceMgrImp {
   Status pipeline_config_get(p4::ForwardingPipelineConfig *config) {
     Status status;
     config->set_device_id(device_id);
-    config->mutable_p4info()->CopyFrom(p4info_proto);
+    if (p4info_entry)
+      config->mutable_p4info()->CopyFrom(p4info_entry->p4info_proto);
+    else
+      config->clear_p4info();
     // TODO(antonin): we do not set the p4_device_config bytes field, as we do
     // not have a local copy of it; if it is needed by the controller, we will
     // find a way to return it as well.
@@ -249,64 +370,61 @@ class DeviceMgrImp {
   }
 
   Status write(const p4::WriteRequest &request) {
+    if (write_pool != nullptr && request.updates_size() > 1)
+      return write_parallel(request);
     Status status;
     status.set_code(Code::OK);
     SessionTemp session(true  /* = batch */);
     for (const auto &update : request.updates()) {
-      const auto &entity = update.entity();
-      switch (entity.entity_case()) {
-        case p4::Entity::kExternEntry:
-          Logger::get()->error("No extern support yet");
-          status.set_code(Code::UNIMPLEMENTED);
-          break;
-        case p4::Entity::kTableEntry:
-          status = table_write(update.type(), entity.table_entry(), session);
-          break;
-        case p4::Entity::kActionProfileMember:
-          status = action_profile_member_write(
-              update.type(), entity.action_profile_member(), session);
-          break;
-        case p4::Entity::kActionProfileGroup:
-          status = action_profile_group_write(
-              update.type(), entity.action_profile_group(), session);
-          break;
-        case p4::Entity::kMeterEntry:
-          status = meter_write(update.type(), entity.meter_entry(), session);
-          break;
-        case p4::Entity::kDirectMeterEntry:
-          status = direct_meter_write(
-              update.type(), entity.direct_meter_entry(), session);
-          break;
-        case p4::Entity::kCounterEntry:
-          Logger::get()->error("Writing to counters is not supported yet");
-          status.set_code(Code::UNIMPLEMENTED);
-          break;
-        case p4::Entity::kDirectCounterEntry:
-          Logger::get()->error(
-              "Writing to direct counters is not supported yet");
-          status.set_code(Code::UNIMPLEMENTED);
-          break;
-        default:
-          status.set_code(Code::UNKNOWN);
-          break;
-      }
+      status = write_one(update, session);
       if (status.code() != Code::OK) break;
     }
-    return status;
+    auto batch_status = end_batch(&session);
+    return (status.code() != Code::OK) ? status : batch_status;
+  }
+
+  void set_write_parallelism(size_t num_workers) {
+    write_pool.reset(
+        (num_workers > 0) ? new WorkerPool(num_workers) : nullptr);
   }
 
   Status read(const p4::ReadRequest &request,
               p4::ReadResponse *response) const {
+    ReadResponseStream stream(response);
+    return read_common(request, &stream);
+  }
+
+  Status read(const p4::ReadRequest &request, const ReadResponseSink &sink,
+              size_t max_entities, size_t max_bytes) const {
+    ReadResponseStream stream(&sink, max_entities, max_bytes);
+    auto status = read_common(request, &stream);
+    if (!stream.finish() && status.code() == Code::OK)
+      status.set_code(Code::CANCELLED);
+    return status;
+  }
+
+  Status read_one(const p4::Entity &entity, p4::ReadResponse *response) const {
+    ReadResponseStream stream(response);
+    return read_one(entity, &stream);
+  }
+
+  Status read_common(const p4::ReadRequest &request,
+                     ReadResponseStream *response) const {
     Status status;
     status.set_code(Code::OK);
     for (const auto &entity : request.entities()) {
       status = read_one(entity, response);
       if (status.code() != Code::OK) break;
+      if (response->is_aborted()) {
+        status.set_code(Code::CANCELLED);
+        break;
+      }
     }
     return status;
   }
 
-  Status read_one(const p4::Entity &entity, p4::ReadResponse *response) const {
+  Status read_one(const p4::Entity &entity,
+                  ReadResponseStream *response) const {
     Status status;
     SessionTemp session(false  /* = batch */);
     switch (entity.entity_case()) {
@@ -333,7 +451,49 @@ class DeviceMgrImp {
         status = counter_read(entity.counter_entry(), session, response);
         break;
       case p4::Entity::kDirectCounterEntry:
-        Logger::get()->error("Reading direct counters is not supported yet");
+        status = direct_counter_read(entity.direct_counter_entry(), session,
+                                     response);
+        break;
+      default:
+        status.set_code(Code::UNKNOWN);
+        break;
+    }
+    return status;
+  }
+
+  Status write_one(const p4::Update &update, const SessionTemp &session) {
+    Status status;
+    const auto &entity = update.entity();
+    switch (entity.entity_case()) {
+      case p4::Entity::kExternEntry:
+        Logger::get()->error("No extern support yet");
+        status.set_code(Code::UNIMPLEMENTED);
+        break;
+      case p4::Entity::kTableEntry:
+        status = table_write(update.type(), entity.table_entry(), session);
+        break;
+      case p4::Entity::kActionProfileMember:
+        status = action_profile_member_write(
+            update.type(), entity.action_profile_member(), session);
+        break;
+      case p4::Entity::kActionProfileGroup:
+        status = action_profile_group_write(
+            update.type(), entity.action_profile_group(), session);
+        break;
+      case p4::Entity::kMeterEntry:
+        status = meter_write(update.type(), entity.meter_entry(), session);
+        break;
+      case p4::Entity::kDirectMeterEntry:
+        status = direct_meter_write(
+            update.type(), entity.direct_meter_entry(), session);
+        break;
+      case p4::Entity::kCounterEntry:
+        Logger::get()->error("Writing to counters is not supported yet");
+        status.set_code(Code::UNIMPLEMENTED);
+        break;
+      case p4::Entity::kDirectCounterEntry:
+        Logger::get()->error(
+            "Writing to direct counters is not supported yet");
         status.set_code(Code::UNIMPLEMENTED);
         break;
       default:
@@ -343,6 +503,94 @@ class DeviceMgrImp {
     return status;
   }
 
+  // Updates are partitioned based on the P4 object they target; the relative
+  // order of updates is preserved within a partition, and each partition is
+  // executed by a worker with its own session. Entries for an indirect table
+  // go to the partition of its action profile, since they may refer to members
+  // and groups created earlier in the same request. A partition stops at its
+  // first error, but the other partitions are still executed to completion.
+  Status write_parallel(const p4::WriteRequest &request) {
+    const auto &updates = request.updates();
+    std::unordered_map<p4_id_t, size_t> partition_idx;
+    std::vector<std::vector<int> > partitions;
+    for (int i = 0; i < updates.size(); i++) {
+      auto key = write_partition_key(updates.Get(i).entity());
+      auto p = partition_idx.emplace(key, partitions.size());
+      if (p.second) partitions.emplace_back();
+      partitions[p.first->second].push_back(i);
+    }
+
+    std::vector<Status> statuses(updates.size());
+    std::vector<WorkerPool::Task> tasks;
+    for (const auto &partition : partitions) {
+      tasks.emplace_back([this, &updates, &partition, &statuses]() {
+        SessionTemp session(true  /* = batch */);
+        int last = -1;
+        for (auto i : partition) {
+          last = i;
+          statuses[i] = write_one(updates.Get(i), session);
+          if (statuses[i].code() != Code::OK) break;
+        }
+        // a deferred operation which fails is reported by the last update
+        // executed in the partition, unless that update already failed
+        auto batch_status = end_batch(&session);
+        if (last >= 0 && statuses[last].code() == Code::OK)
+          statuses[last] = batch_status;
+      });
+    }
+    write_pool->run_all(tasks);
+
+    // we return the status of the first update which failed in the original
+    // order, which is what sequential execution would return; the updates
+    // which were not executed are left with an OK status, but they always
+    // follow an error in their partition
+    for (const auto &status : statuses)
+      if (status.code() != Code::OK) return status;
+    Status status;
+    status.set_code(Code::OK);
+    return status;
+  }
+
+  // some targets defer the operations in a batch, in which case their status
+  // is only known once the batch ends
+  static Status end_batch(SessionTemp *session) {
+    Status status;
+    if (session->end_batch() != PI_STATUS_SUCCESS) {
+      status.set_code(Code::UNKNOWN);
+      status.set_message("Error when committing batch to target");
+      Logger::get()->error(status.message());
+      return status;
+    }
+    status.set_code(Code::OK);
+    return status;
+  }
+
+  // invalid ids are returned as is, the update will be rejected anyway
+  p4_id_t write_partition_key(const p4::Entity &entity) const {
+    switch (entity.entity_case()) {
+      case p4::Entity::kTableEntry:
+        return table_partition_key(entity.table_entry().table_id());
+      case p4::Entity::kActionProfileMember:
+        return entity.action_profile_member().action_profile_id();
+      case p4::Entity::kActionProfileGroup:
+        return entity.action_profile_group().action_profile_id();
+      case p4::Entity::kMeterEntry:
+        return entity.meter_entry().meter_id();
+      case p4::Entity::kDirectMeterEntry:
+        return table_partition_key(
+            entity.direct_meter_entry().table_entry().table_id());
+      default:
+        return PI_INVALID_ID;
+    }
+  }
+
+  p4_id_t table_partition_key(p4_id_t table_id) const {
+    if (!check_p4_id(table_id, P4ResourceType::TABLE)) return table_id;
+    auto action_prof_id = pi_p4info_table_get_implementation(p4info,
+                                                             table_id);
+    return (action_prof_id == PI_INVALID_ID) ? table_id : action_prof_id;
+  }
+
   Status table_write(p4::Update_Type update, const p4::TableEntry &table_entry,
                      const SessionTemp &session) {
     Status status;
@@ -411,7 +659,7 @@ class DeviceMgrImp {
 
   Code entry_handle_from_table_entry(const p4::TableEntry &table_entry,
                                      pi_entry_handle_t *handle) const {
-    pi::MatchKey match_key(p4info.get(), table_entry.table_id());
+    pi::MatchKey match_key(p4info, table_entry.table_id());
     {
       auto code = construct_match_key(table_entry, &match_key);
       if (code != Code::OK) return code;
@@ -487,12 +735,12 @@ class DeviceMgrImp {
   Code parse_match_key(p4_id_t table_id, const pi_match_key_t *match_key,
                        p4::TableEntry *entry) const {
     auto num_match_fields = pi_p4info_table_num_match_fields(
-        p4info.get(), table_id);
+        p4info, table_id);
     MatchKeyReader mk_reader(match_key);
     auto priority = mk_reader.get_priority();
     if (priority > 0) entry->set_priority(priority);
     for (size_t j = 0; j < num_match_fields; j++) {
-      auto finfo = pi_p4info_table_match_field_info(p4info.get(), table_id, j);
+      auto finfo = pi_p4info_table_match_field_info(p4info, table_id, j);
       auto mf = entry->add_match();
       mf->set_field_id(finfo->mf_id);
       switch (finfo->match_type) {
@@ -546,7 +794,7 @@ class DeviceMgrImp {
     action->set_action_id(action_id);
     size_t num_params;
     auto param_ids = pi_p4info_action_get_params(
-        p4info.get(), action_id, &num_params);
+        p4info, action_id, &num_params);
     for (size_t j = 0; j < num_params; j++) {
       auto param = action->add_params();
       param->set_param_id(param_ids[j]);
@@ -562,7 +810,7 @@ class DeviceMgrImp {
     auto table_action = entry->mutable_action();
     if (pi_entry->entry_type == PI_ACTION_ENTRY_TYPE_INDIRECT) {
       auto indirect_h = pi_entry->entry.indirect_handle;
-      auto action_prof_id = pi_p4info_table_get_implementation(p4info.get(),
+      auto action_prof_id = pi_p4info_table_get_implementation(p4info,
                                                                table_id);
       // check that table is indirect
       if (action_prof_id == PI_INVALID_ID) return Code::UNKNOWN;
@@ -582,81 +830,205 @@ class DeviceMgrImp {
                              table_action->mutable_action());
   }
 
-  // An is a functor which will be called on entries and needs to append a new
-  // p4::TableEntry to entries and return a pointer to it
-  template <typename T, typename Accessor>
-  Status table_read_common(p4_id_t table_id, const SessionTemp &session,
-                           T *entries, Accessor An) const {
+  // Entries are retrieved from the target in chunks, so that we never hold a
+  // decoded copy of the whole table in addition to the p4::ReadResponse.
+  static constexpr size_t kTableReadChunkMaxEntries = 1024;
+  static constexpr size_t kTableReadChunkMaxBytes = 1 << 20;
+  // number of indices requested from the target at a time when reading a
+  // whole indirect counter
+  static constexpr size_t kCounterReadChunkSize = 1024;
+
+  using TableEntries = google::protobuf::RepeatedPtrField<p4::TableEntry>;
+
+  // Decodes the entries in res and appends them to entries. Must be called with
+  // the table lock held, since the controller metadata of each entry is looked
+  // up in the TableInfoStore.
+  Code table_read_chunk(p4_id_t table_id, pi_table_fetch_res_t *res,
+                        TableEntries *entries) const {
+    auto num_entries = pi_table_entries_num(res);
+    for (size_t i = 0; i < num_entries; i++) {
+      // no copy, entry points inside res
+      const auto *entry = pi_table_entries_get(res, i);
+      // the lookup uses the match key data in res directly, no copy
+      auto entry_data = table_info_store.get_entry(
+          table_id, pi::MatchKeyView(entry->match_key));
+      // the table lock is released between chunks, so the entry may have been
+      // deleted since the target returned it
+      if (entry_data == nullptr) continue;
+      auto table_entry = entries->Add();
+      table_entry->set_table_id(table_id);
+      auto code = parse_match_key(table_id, entry->match_key, table_entry);
+      if (code != Code::OK) return code;
+      code = parse_action_entry(table_id, &entry->entry, table_entry);
+      if (code != Code::OK) return code;
+      table_entry->set_controller_metadata(entry_data->controller_metadata);
+    }
+    return Code::OK;
+  }
+
+  // Adding entities to the response may flush it to the client, which can
+  // block for a while, so this is never done with a table lock held: decoded
+  // entries are buffered and moved to the response once the lock is released.
+  static void table_entries_flush(TableEntries *entries,
+                                  ReadResponseStream *response) {
+    for (auto &entry : *entries)
+      response->add_entity()->mutable_table_entry()->Swap(&entry);
+    // the cleared entries are reused for the next chunk
+    entries->Clear();
+  }
+
+  // The table lock is only held while a chunk is retrieved from the target and
+  // decoded, so writes to the table are not blocked for the whole read.
+  Status table_read_one(p4_id_t table_id, const SessionTemp &session,
+                        ReadResponseStream *response) const {
     Status status;
-    pi_table_fetch_res_t *res;
+    pi_table_fetch_cursor_t *cursor;
     auto table_lock = table_info_store.lock_table(table_id);
-    auto pi_status = pi_table_entries_fetch(session.get(), device_id,
-                                            table_id, &res);
+    auto pi_status = pi_table_entries_fetch_begin(
+        session.get(), device_id, table_id,
+        kTableReadChunkMaxEntries, kTableReadChunkMaxBytes, &cursor);
+    table_lock.unlock();
     if (pi_status != PI_STATUS_SUCCESS) {
       Logger::get()->error("Error when fetching entries from target");
       status.set_code(Code::UNKNOWN);
       return status;
     }
-    auto num_entries = pi_table_entries_num(res);
-    pi_table_ma_entry_t entry;
-    pi_entry_handle_t entry_handle;
+    TableEntries entries;
     Code code = Code::OK;
-    pi::MatchKey mk(p4info.get(), table_id);
-    for (size_t i = 0; i < num_entries; i++) {
-      pi_table_entries_next(res, &entry, &entry_handle);
-      auto table_entry = An(entries);
-      table_entry->set_table_id(table_id);
-      code = parse_match_key(table_id, entry.match_key, table_entry);
-      if (code != Code::OK) break;
-      code = parse_action_entry(table_id, &entry.entry, table_entry);
-      if (code != Code::OK) break;
-      // TODO(antonin): what I really want to do here is a heterogeneous lookup;
-      // instead I make a copy of the match key in the right format and I use
-      // this for the lookup. If this is a performance issue, we can find a
-      // better solution.
-      mk.from(entry.match_key);
-      auto entry_data = table_info_store.get_entry(table_id, mk);
-      // this would point to a serious bug in the implementation, and shoudn't
-      // occur given that we keep the local state in sync with lower level state
-      // thanks to our per-table lock.
-      if (entry_data == nullptr) {
-        Logger::get()->critical("Table state out-of-sync with target");
-        assert(0 && "Invalid state");
+    while (code == Code::OK) {
+      pi_table_fetch_res_t *res;
+      table_lock.lock();
+      pi_status = pi_table_entries_fetch_next_chunk(cursor, &res);
+      if (pi_status != PI_STATUS_SUCCESS) {
+        Logger::get()->error("Error when fetching entries from target");
+        code = Code::UNKNOWN;
+        break;
       }
-      table_entry->set_controller_metadata(entry_data->controller_metadata);
+      if (res == nullptr) break;  // no more entries
+      code = table_read_chunk(table_id, res, &entries);
+      pi_table_entries_fetch_done(session.get(), res);
+      table_lock.unlock();
+      table_entries_flush(&entries, response);
+      // no need to go through the rest of the table
+      if (response->is_aborted()) break;
     }
 
-    pi_table_entries_fetch_done(session.get(), res);
+    pi_table_entries_fetch_end(cursor);
 
     status.set_code(code);
     return status;
   }
 
-  Status table_read_one(p4_id_t table_id, const SessionTemp &session,
-                        p4::ReadResponse *response) const {
-    return table_read_common(
-        table_id, session, response,
-        [] (decltype(response) r) {
-          return r->add_entities()->mutable_table_entry(); });
+  // table_lock must be held on entry and is released before the entries are
+  // added to the response
+  Status table_read_filtered(p4_id_t table_id,
+                             const pi_table_fetch_filter_t &filter,
+                             const SessionTemp &session,
+                             TableInfoStore::Lock *table_lock,
+                             ReadResponseStream *response) const {
+    Status status;
+    pi_table_fetch_res_t *res;
+    auto pi_status = pi_table_entries_fetch_filtered(
+        session.get(), device_id, table_id, &filter, &res);
+    if (pi_status != PI_STATUS_SUCCESS) {
+      Logger::get()->error("Error when fetching entries from target");
+      status.set_code(Code::UNKNOWN);
+      return status;
+    }
+    TableEntries entries;
+    auto code = table_read_chunk(table_id, res, &entries);
+    pi_table_entries_fetch_done(session.get(), res);
+    table_lock->unlock();
+    table_entries_flush(&entries, response);
+    status.set_code(code);
+    return status;
   }
 
-  // TODO(antonin): full filtering on the match key, action, ...
+  // Only returns the entries matching the fields, priority and action present
+  // in table_entry. When the match key is complete (and includes a priority if
+  // the table needs one), the entry handle is resolved with the
+  // TableInfoStore, which lets the target retrieve a single entry (if it
+  // supports it) instead of going through the whole table. Otherwise, the
+  // match key data is compared for the fields present in table_entry only.
   // TODO(antonin): direct resources
+  Status table_read_single_table(const p4::TableEntry &table_entry,
+                                 const SessionTemp &session,
+                                 ReadResponseStream *response) const {
+    Status status;
+    auto table_id = table_entry.table_id();
+    bool has_action = table_entry.has_action() &&
+        table_entry.action().type_case() == p4::TableAction::kAction;
+    if (table_entry.match().empty() && table_entry.priority() == 0 &&
+        !has_action) {
+      return table_read_one(table_id, session, response);
+    }
+
+    pi_table_fetch_filter_t filter = {};
+    if (table_entry.priority() != 0) {
+      filter.flags |= PI_TABLE_FETCH_FILTER_PRIORITY;
+      filter.priority = table_entry.priority();
+    }
+    if (has_action) {
+      filter.flags |= PI_TABLE_FETCH_FILTER_ACTION_ID;
+      filter.action_id = table_entry.action().action().action_id();
+    }
+    if (table_entry.match().empty()) {
+      auto table_lock = table_info_store.lock_table(table_id);
+      return table_read_filtered(table_id, filter, session, &table_lock,
+                                 response);
+    }
+
+    auto it = match_key_validators.find(table_id);
+    if (it == match_key_validators.end()) {
+      status.set_code(Code::INVALID_ARGUMENT);
+      return status;
+    }
+    const auto &validator = it->second;
+    pi::MatchKey mk(p4info, table_id);
+    std::vector<char> mask;
+    bool complete;
+    auto code = validator.construct_partial(table_entry, &mk, &mask,
+                                            &complete);
+    if (code != Code::OK) {
+      status.set_code(code);
+      return status;
+    }
+    mk.set_priority(table_entry.priority());
+
+    auto table_lock = table_info_store.lock_table(table_id);
+    if (complete &&
+        (!validator.requires_priority() || table_entry.priority() != 0)) {
+      auto entry_data = table_info_store.get_entry(table_id, mk);
+      if (entry_data == nullptr) {  // no such entry, nothing to return
+        status.set_code(Code::OK);
+        return status;
+      }
+      filter.flags |= PI_TABLE_FETCH_FILTER_ENTRY_HANDLE;
+      filter.entry_handle = entry_data->handle;
+    } else {
+      filter.flags |= PI_TABLE_FETCH_FILTER_MATCH_KEY;
+      filter.match_key = mk.get_pi_match_key();
+      filter.match_key_mask = mask.data();
+    }
+    return table_read_filtered(table_id, filter, session, &table_lock,
+                               response);
+  }
+
   Status table_read(const p4::TableEntry &table_entry,
                     const SessionTemp &session,
-                    p4::ReadResponse *response) const {
+                    ReadResponseStream *response) const {
     Status status;
     if (table_entry.table_id() == 0) {  // read all entries for all tables
-      for (auto t_id = pi_p4info_table_begin(p4info.get());
-           t_id != pi_p4info_table_end(p4info.get());
-           t_id = pi_p4info_table_next(p4info.get(), t_id)) {
+      for (auto t_id = pi_p4info_table_begin(p4info);
+           t_id != pi_p4info_table_end(p4info);
+           t_id = pi_p4info_table_next(p4info, t_id)) {
         status = table_read_one(t_id, session, response);
         if (status.code() != Code::OK) break;
       }
     } else {  // read for a single table
       if (!check_p4_id(table_entry.table_id(), P4ResourceType::TABLE))
         return make_invalid_p4_id_status();
-      status = table_read_one(table_entry.table_id(), session, response);
+      status = table_read_single_table(table_entry, session, response);
     }
     return status;
   }
@@ -802,11 +1174,11 @@ class DeviceMgrImp {
 
   Status action_profile_member_read_one(p4_id_t action_profile_id,
                                         const SessionTemp &session,
-                                        p4::ReadResponse *response) const {
+                                        ReadResponseStream *response) const {
     return action_profile_read_common(
         action_profile_id, session, response,
         [] (decltype(response) r) {
-          return r->add_entities()->mutable_action_profile_member(); },
+          return r->add_entity()->mutable_action_profile_member(); },
         [] (decltype(response)) -> p4::ActionProfileGroup * {
           return nullptr; });
   }
@@ -814,13 +1186,13 @@ class DeviceMgrImp {
   // TODO(antonin): full filtering
   Status action_profile_member_read(const p4::ActionProfileMember &member,
                                     const SessionTemp &session,
-                                    p4::ReadResponse *response) const {
+                                    ReadResponseStream *response) const {
     Status status;
     status.set_code(Code::OK);
     if (member.action_profile_id() == 0) {
-      for (auto act_prof_id = pi_p4info_act_prof_begin(p4info.get());
-           act_prof_id != pi_p4info_act_prof_end(p4info.get());
-           act_prof_id = pi_p4info_act_prof_next(p4info.get(), act_prof_id)) {
+      for (auto act_prof_id = pi_p4info_act_prof_begin(p4info);
+           act_prof_id != pi_p4info_act_prof_end(p4info);
+           act_prof_id = pi_p4info_act_prof_next(p4info, act_prof_id)) {
         status = action_profile_member_read_one(act_prof_id, session, response);
         if (status.code() != Code::OK) break;
       }
@@ -836,25 +1208,25 @@ class DeviceMgrImp {
 
   Status action_profile_group_read_one(p4_id_t action_profile_id,
                                        const SessionTemp &session,
-                                       p4::ReadResponse *response) const {
+                                       ReadResponseStream *response) const {
     return action_profile_read_common(
         action_profile_id, session, response,
         [] (decltype(response)) -> p4::ActionProfileMember * {
           return nullptr; },
         [] (decltype(response) r) {
-          return r->add_entities()->mutable_action_profile_group(); });
+          return r->add_entity()->mutable_action_profile_group(); });
   }
 
   // TODO(antonin): full filtering
   Status action_profile_group_read(const p4::ActionProfileGroup &group,
                                    const SessionTemp &session,
-                                   p4::ReadResponse *response) const {
+                                   ReadResponseStream *response) const {
     Status status;
     status.set_code(Code::OK);
     if (group.action_profile_id() == 0) {
-      for (auto act_prof_id = pi_p4info_act_prof_begin(p4info.get());
-           act_prof_id != pi_p4info_act_prof_end(p4info.get());
-           act_prof_id = pi_p4info_act_prof_next(p4info.get(), act_prof_id)) {
+      for (auto act_prof_id = pi_p4info_act_prof_begin(p4info);
+           act_prof_id != pi_p4info_act_prof_end(p4info);
+           act_prof_id = pi_p4info_act_prof_next(p4info, act_prof_id)) {
         status = action_profile_group_read_one(act_prof_id, session, response);
         if (status.code() != Code::OK) break;
       }
@@ -879,42 +1251,53 @@ class DeviceMgrImp {
   Status counter_read_one(p4_id_t counter_id,
                           const p4::CounterEntry &counter_entry,
                           const SessionTemp &session,
-                          p4::ReadResponse *response) const {
+                          ReadResponseStream *response) const {
     Status status;
     status.set_code(Code::OK);
-    assert(!(pi_p4info_counter_get_direct(p4info.get(), counter_id)
+    assert(!(pi_p4info_counter_get_direct(p4info, counter_id)
                       != PI_INVALID_ID));
     if (counter_entry.index() != 0) {
-      auto entry = response->add_entities()->mutable_counter_entry();
+      auto entry = response->add_entity()->mutable_counter_entry();
       entry->CopyFrom(counter_entry);
       auto code = counter_read_one_index(session, counter_id, entry);
       if (code != Code::OK) status.set_code(code);
       return status;
     }
-    // default index, read all
-    auto counter_size = pi_p4info_counter_get_size(p4info.get(), counter_id);
-    for (size_t index = 0; index < counter_size; index++) {
-      auto entry = response->add_entities()->mutable_counter_entry();
-      entry->set_index(index);
-      auto code = counter_read_one_index(session, counter_id, entry);
-      if (code != Code::OK) {
-        status.set_code(code);
+    // default index, read all, one range of indices at a time
+    auto counter_size = pi_p4info_counter_get_size(p4info, counter_id);
+    const size_t chunk_size = kCounterReadChunkSize;
+    std::vector<pi_counter_data_t> counter_data(
+        std::min(counter_size, chunk_size));
+    for (size_t start = 0; start < counter_size; start += chunk_size) {
+      auto count = std::min(counter_size - start, chunk_size);
+      auto pi_status = pi_counter_read_range(
+          session.get(), device_tgt, counter_id, start, count,
+          PI_COUNTER_FLAGS_NONE, counter_data.data());
+      if (pi_status != PI_STATUS_SUCCESS) {
+        Logger::get()->error("Error when reading counter from target");
+        status.set_code(Code::UNKNOWN);
         return status;
       }
+      for (size_t i = 0; i < count; i++) {
+        auto entry = response->add_entity()->mutable_counter_entry();
+        entry->set_counter_id(counter_id);
+        entry->set_index(start + i);
+        counter_data_pi_to_proto(counter_data[i], entry->mutable_data());
+      }
     }
     return status;
   }
 
   Status counter_read(const p4::CounterEntry &counter_entry,
                       const SessionTemp &session,
-                      p4::ReadResponse *response) const {
+                      ReadResponseStream *response) const {
     Status status;
     status.set_code(Code::OK);
     if (counter_entry.counter_id() == 0) {  // read all entries for all counters
-      for (auto c_id = pi_p4info_counter_begin(p4info.get());
-           c_id != pi_p4info_counter_end(p4info.get());
-           c_id = pi_p4info_counter_next(p4info.get(), c_id)) {
-        if (pi_p4info_counter_get_direct(p4info.get(), c_id) != PI_INVALID_ID)
+      for (auto c_id = pi_p4info_counter_begin(p4info);
+           c_id != pi_p4info_counter_end(p4info);
+           c_id = pi_p4info_counter_next(p4info, c_id)) {
+        if (pi_p4info_counter_get_direct(p4info, c_id) != PI_INVALID_ID)
           continue;
         status = counter_read_one(c_id, counter_entry, session, response);
         if (status.code() != Code::OK) break;
@@ -928,6 +1311,164 @@ class DeviceMgrImp {
     return status;
   }
 
+  using DirectCounterEntries =
+      google::protobuf::RepeatedPtrField<p4::DirectCounterEntry>;
+
+  // Decodes the direct counter data of the entries in res and appends it to
+  // entries. Must be called with the table lock held, like table_read_chunk.
+  Code direct_counter_read_chunk(p4_id_t counter_id, p4_id_t table_id,
+                                 pi_table_fetch_res_t *res,
+                                 DirectCounterEntries *entries) const {
+    auto num_entries = pi_table_entries_num(res);
+    for (size_t i = 0; i < num_entries; i++) {
+      const auto *entry = pi_table_entries_get(res, i);
+      auto counter_entry = entries->Add();
+      counter_entry->set_counter_id(counter_id);
+      auto table_entry = counter_entry->mutable_table_entry();
+      table_entry->set_table_id(table_id);
+      auto code = parse_match_key(table_id, entry->match_key, table_entry);
+      if (code != Code::OK) return code;
+      const auto *direct_res_config = entry->entry.direct_res_config;
+      for (size_t j = 0; j < direct_res_config->num_configs; j++) {
+        const auto &config = direct_res_config->configs[j];
+        if (config.res_id != counter_id) continue;
+        // NULL if the resource could not be decoded
+        if (config.config == nullptr) {
+          Logger::get()->error(
+              "Invalid direct counter data returned by target");
+          return Code::UNKNOWN;
+        }
+        counter_data_pi_to_proto(
+            *static_cast<const pi_counter_data_t *>(config.config),
+            counter_entry->mutable_data());
+      }
+    }
+    return Code::OK;
+  }
+
+  // same as table_entries_flush, never called with a table lock held
+  static void direct_counter_entries_flush(DirectCounterEntries *entries,
+                                           ReadResponseStream *response) {
+    for (auto &entry : *entries)
+      response->add_entity()->mutable_direct_counter_entry()->Swap(&entry);
+    entries->Clear();
+  }
+
+  // if a match key is provided, we read the counter for this entry only,
+  // otherwise we read the counters of all entries, one chunk at a time; like
+  // for table reads, the table lock is released between chunks and when adding
+  // entities to the response
+  Status direct_counter_read_one(p4_id_t counter_id,
+                                 const p4::DirectCounterEntry &counter_entry,
+                                 const SessionTemp &session,
+                                 ReadResponseStream *response) const {
+    Status status;
+    auto table_id = pi_p4info_counter_get_direct(p4info, counter_id);
+    if (table_id == PI_INVALID_ID) {
+      status.set_code(Code::INVALID_ARGUMENT);
+      status.set_message("Not a direct counter");
+      Logger::get()->error(status.message());
+      return status;
+    }
+
+    const auto &table_entry = counter_entry.table_entry();
+    if (!table_entry.match().empty()) {
+      if (table_entry.table_id() != table_id) {
+        status.set_code(Code::INVALID_ARGUMENT);
+        status.set_message("Table entry does not match direct counter");
+        Logger::get()->error(status.message());
+        return status;
+      }
+      auto table_lock = table_info_store.lock_table(table_id);
+      pi_entry_handle_t entry_handle;
+      auto code = entry_handle_from_table_entry(table_entry, &entry_handle);
+      if (code != Code::OK) {
+        status.set_code(code);
+        return status;
+      }
+      pi_counter_data_t counter_data;
+      auto pi_status = pi_counter_read_direct(
+          session.get(), device_tgt, counter_id, entry_handle,
+          PI_COUNTER_FLAGS_NONE, &counter_data);
+      table_lock.unlock();
+      if (pi_status != PI_STATUS_SUCCESS) {
+        Logger::get()->error("Error when reading direct counter from target");
+        status.set_code(Code::UNKNOWN);
+        return status;
+      }
+      auto entry = response->add_entity()->mutable_direct_counter_entry();
+      entry->set_counter_id(counter_id);
+      entry->mutable_table_entry()->CopyFrom(table_entry);
+      counter_data_pi_to_proto(counter_data, entry->mutable_data());
+      status.set_code(Code::OK);
+      return status;
+    }
+
+    pi_table_fetch_cursor_t *cursor;
+    auto table_lock = table_info_store.lock_table(table_id);
+    auto pi_status = pi_table_entries_fetch_begin_wflags(
+        session.get(), device_id, table_id,
+        PI_TABLE_FETCH_FLAGS_DIRECT_COUNTERS,
+        kTableReadChunkMaxEntries, kTableReadChunkMaxBytes, &cursor);
+    table_lock.unlock();
+    if (pi_status != PI_STATUS_SUCCESS) {
+      Logger::get()->error("Error when fetching entries from target");
+      status.set_code(Code::UNKNOWN);
+      return status;
+    }
+    DirectCounterEntries entries;
+    Code code = Code::OK;
+    while (code == Code::OK) {
+      pi_table_fetch_res_t *res;
+      table_lock.lock();
+      pi_status = pi_table_entries_fetch_next_chunk(cursor, &res);
+      if (pi_status != PI_STATUS_SUCCESS) {
+        Logger::get()->error("Error when fetching entries from target");
+        code = Code::UNKNOWN;
+        break;
+      }
+      if (res == nullptr) break;  // no more entries
+      code = direct_counter_read_chunk(counter_id, table_id, res, &entries);
+      pi_table_entries_fetch_done(session.get(), res);
+      table_lock.unlock();
+      direct_counter_entries_flush(&entries, response);
+      if (response->is_aborted()) break;
+    }
+
+    pi_table_entries_fetch_end(cursor);
+
+    status.set_code(code);
+    return status;
+  }
+
+  Status direct_counter_read(const p4::DirectCounterEntry &counter_entry,
+                             const SessionTemp &session,
+                             ReadResponseStream *response) const {
+    Status status;
+    status.set_code(Code::OK);
+    if (counter_entry.counter_id() == 0) {  // read all direct counters
+      for (auto c_id = pi_p4info_counter_begin(p4info);
+           c_id != pi_p4info_counter_end(p4info);
+           c_id = pi_p4info_counter_next(p4info, c_id)) {
+        auto direct_table_id = pi_p4info_counter_get_direct(p4info, c_id);
+        if (direct_table_id == PI_INVALID_ID) continue;
+        // a match key only refers to entries of its own table
+        if (!counter_entry.table_entry().match().empty() &&
+            direct_table_id != counter_entry.table_entry().table_id())
+          continue;
+        status = direct_counter_read_one(c_id, counter_entry, session,
+                                         response);
+        if (status.code() != Code::OK) break;
+      }
+    } else {  // read for a single counter
+      if (!check_p4_id(counter_entry.counter_id(), P4ResourceType::COUNTER))
+        return make_invalid_p4_id_status();
+      status = direct_counter_read_one(counter_entry.counter_id(),
+                                       counter_entry, session, response);
+    }
+    return status;
+  }
+
   static void init(size_t max_devices) {
     auto pi_status = pi_init(max_devices, NULL);
     (void) pi_status;
@@ -941,105 +1482,15 @@ class DeviceMgrImp {
  private:
   bool check_p4_id(p4_id_t p4_id, P4ResourceType expected_type) const {
     return (pi::proto::util::resource_type_from_id(p4_id) == expected_type)
-        && pi_p4info_is_valid_id(p4info.get(), p4_id);
-  }
-
-  Code validate_match_key(const p4::TableEntry &entry) const {
-    Code code;
-    auto t_id = entry.table_id();
-    size_t num_match_fields;
-    auto expected_mf_ids = pi_p4info_table_get_match_fields(
-        p4info.get(), t_id, &num_match_fields);
-    if (static_cast<size_t>(entry.match().size()) > num_match_fields) {
-      Logger::get()->error("Too many fields in match key");
-      return Code::INVALID_ARGUMENT;
-    }
-
-    int num_mf_matched = 0;  // check if some extra fields in the match key
-    // the double loop is potentially too slow; refactor this code if it proves
-    // to be a bottleneck
-    for (size_t i = 0; i < num_match_fields; i++) {
-      auto mf_id = expected_mf_ids[i];
-      auto mf_info = pi_p4info_table_match_field_info(p4info.get(), t_id, i);
-      bool mf_is_missing = true;
-      for (const auto &mf : entry.match()) {
-        if (mf.field_id() != mf_id) continue;
-        mf_is_missing = false;
-        num_mf_matched++;
-        auto bitwidth = mf_info->bitwidth;
-        switch (mf.field_match_type_case()) {
-          case p4::FieldMatch::kExact:
-            code = check_proto_bytestring(mf.exact().value(), bitwidth);
-            break;
-          case p4::FieldMatch::kLpm:
-            code = check_proto_bytestring(mf.lpm().value(), bitwidth);
-            break;
-          case p4::FieldMatch::kTernary:
-            code = check_proto_bytestring(mf.ternary().value(), bitwidth);
-            if (code != Code::OK) break;
-            code = check_proto_bytestring(mf.ternary().mask(), bitwidth);
-            break;
-          case p4::FieldMatch::kValid:
-            break;
-          case p4::FieldMatch::kRange:
-            code = check_proto_bytestring(mf.range().low(), bitwidth);
-            if (code != Code::OK) break;
-            code = check_proto_bytestring(mf.range().high(), bitwidth);
-            break;
-          default:
-            return Code::INVALID_ARGUMENT;
-        }
-        if (code != Code::OK) {
-          Logger::get()->error("Invalid bytestring format");
-          return code;
-        }
-      }
-      if (mf_is_missing
-          && mf_info->match_type != PI_P4INFO_MATCH_TYPE_TERNARY) {
-        Logger::get()->error("Missing non-ternary field in match key");
-        return Code::INVALID_ARGUMENT;
-      }
-    }
-    if (num_mf_matched != entry.match().size()) {
-      Logger::get()->error("Unknown field in match key");
-      return Code::INVALID_ARGUMENT;
-    }
-    return Code::OK;
+        && pi_p4info_is_valid_id(p4info, p4_id);
   }
 
   Code construct_match_key(const p4::TableEntry &entry,
                            pi::MatchKey *match_key) const {
     if (entry.match().empty()) return Code::OK;
-    auto code = validate_match_key(entry);
-    if (code != Code::OK) return code;
-    for (const auto &mf : entry.match()) {
-      switch (mf.field_match_type_case()) {
-        case p4::FieldMatch::kExact:
-          match_key->set_exact(mf.field_id(), mf.exact().value().data(),
-                               mf.exact().value().size());
-          break;
-        case p4::FieldMatch::kLpm:
-          match_key->set_lpm(mf.field_id(), mf.lpm().value().data(),
-                             mf.lpm().value().size(), mf.lpm().prefix_len());
-          break;
-        case p4::FieldMatch::kTernary:
-          match_key->set_ternary(mf.field_id(), mf.ternary().value().data(),
-                                 mf.ternary().mask().data(),
-                                 mf.ternary().value().size());
-          break;
-        case p4::FieldMatch::kValid:
-          match_key->set_valid(mf.field_id(), mf.valid().value());
-          break;
-        case p4::FieldMatch::kRange:
-          match_key->set_range(mf.field_id(), mf.range().low().data(),
-                               mf.range().high().data(),
-                               mf.range().low().size());
-          break;
-        default:
-          return Code::INVALID_ARGUMENT;
-      }
-    }
-    return Code::OK;
+    auto it = match_key_validators.find(entry.table_id());
+    if (it == match_key_validators.end()) return Code::INVALID_ARGUMENT;
+    return it->second.construct(entry, match_key);
   }
 
   Status construct_action_data(uint32_t table_id, const p4::Action &action,
@@ -1048,15 +1499,15 @@ class DeviceMgrImp {
     auto action_id = action.action_id();
     if (!check_p4_id(action_id, P4ResourceType::ACTION))
       return make_invalid_p4_id_status();
-    if (!pi_p4info_table_is_action_of(p4info.get(), table_id, action_id)) {
+    if (!pi_p4info_table_is_action_of(p4info, table_id, action_id)) {
       status.set_code(Code::INVALID_ARGUMENT);
       status.set_message("Invalid action for table");
       Logger::get()->error(status.message());
       return status;
     }
-    status = validate_action_data(p4info.get(), action);
+    status = validate_action_data(p4info, action);
     if (status.code() != Code::OK) return status;
-    action_entry->init_action_data(p4info.get(), action.action_id());
+    action_entry->init_action_data(p4info, action.action_id());
     auto action_data = action_entry->mutable_action_data();
     for (const auto &p : action.params()) {
       action_data->set_arg(p.param_id(), p.value().data(), p.value().size());
@@ -1068,7 +1519,7 @@ class DeviceMgrImp {
                                          const p4::TableAction &table_action,
                                          pi::ActionEntry *action_entry) {
     Status status;
-    auto action_prof_id = pi_p4info_table_get_implementation(p4info.get(),
+    auto action_prof_id = pi_p4info_table_get_implementation(p4info,
                                                              table_id);
     // check that table is indirect
     if (action_prof_id == PI_INVALID_ID) {
@@ -1128,7 +1579,7 @@ class DeviceMgrImp {
     Status status;
     Code code;
     const auto table_id = table_entry.table_id();
-    pi::MatchKey match_key(p4info.get(), table_id);
+    pi::MatchKey match_key(p4info, table_id);
     code = construct_match_key(table_entry, &match_key);
     if (code != Code::OK) {
       status.set_code(code);
@@ -1147,16 +1598,14 @@ class DeviceMgrImp {
 
     auto table_lock = table_info_store.lock_table(table_id);
 
-    pi::MatchTable mt(session.get(), device_tgt, p4info.get(), table_id);
+    pi::MatchTable mt(session.get(), device_tgt, p4info, table_id);
     pi_status_t pi_status;
-    pi_entry_handle_t handle;
+    pi_entry_handle_t handle = 0;
     // an empty match means default entry
     if (table_entry.match().empty()) {
       pi_status = mt.default_entry_set(action_entry);
     } else {
       pi_status = mt.entry_add(match_key, action_entry, false, &handle);
-      // handle is not used as this frontend do all operations using match key
-      (void) handle;
     }
     if (pi_status != PI_STATUS_SUCCESS) {
       status.set_code(Code::UNKNOWN);
@@ -1178,7 +1627,7 @@ class DeviceMgrImp {
     Status status;
     Code code;
     const auto table_id = table_entry.table_id();
-    pi::MatchKey match_key(p4info.get(), table_id);
+    pi::MatchKey match_key(p4info, table_id);
     code = construct_match_key(table_entry, &match_key);
     if (code != Code::OK) {
       status.set_code(code);
@@ -1207,7 +1656,7 @@ class DeviceMgrImp {
       return status;
     }
 
-    pi::MatchTable mt(session.get(), device_tgt, p4info.get(), table_id);
+    pi::MatchTable mt(session.get(), device_tgt, p4info, table_id);
     pi_status_t pi_status;
     // an empty match means default entry
     if (table_entry.match().empty()) {
@@ -1215,6 +1664,9 @@ class DeviceMgrImp {
     } else {
       pi_status = mt.entry_modify_wkey(match_key, action_entry);
     }
+    // the controller metadata is only updated once the target has accepted
+    // the entry, which may be deferred until the end of the batch
+    if (pi_status == PI_STATUS_SUCCESS) pi_status = session.sync();
     if (pi_status != PI_STATUS_SUCCESS) {
       status.set_code(Code::UNKNOWN);
       status.set_message("Error when modifying match entry in target");
@@ -1233,7 +1685,7 @@ class DeviceMgrImp {
     Status status;
     Code code;
     const auto table_id = table_entry.table_id();
-    pi::MatchKey match_key(p4info.get(), table_id);
+    pi::MatchKey match_key(p4info, table_id);
     code = construct_match_key(table_entry, &match_key);
     if (code != Code::OK) {
       status.set_code(code);
@@ -1244,7 +1696,7 @@ class DeviceMgrImp {
 
     auto table_lock = table_info_store.lock_table(table_id);
 
-    pi::MatchTable mt(session.get(), device_tgt, p4info.get(), table_id);
+    pi::MatchTable mt(session.get(), device_tgt, p4info, table_id);
     pi_status_t pi_status;
     // an empty match means default entry
     if (table_entry.match().empty()) {
@@ -1256,6 +1708,7 @@ class DeviceMgrImp {
     } else {
       pi_status = mt.entry_delete_wkey(match_key);
     }
+    if (pi_status == PI_STATUS_SUCCESS) pi_status = session.sync();
     if (pi_status != PI_STATUS_SUCCESS) {
       status.set_code(Code::UNKNOWN);
       status.set_message("Error when deleting match entry in target");
@@ -1287,20 +1740,26 @@ class DeviceMgrImp {
       Logger::get()->error("Error when reading counter from target");
       return Code::UNKNOWN;
     }
-    auto data = cell->mutable_data();
+    counter_data_pi_to_proto(counter_data, cell->mutable_data());
+    return Code::OK;
+  }
+
+  static void counter_data_pi_to_proto(const pi_counter_data_t &counter_data,
+                                       p4::CounterData *data) {
     if (counter_data.valid & PI_COUNTER_UNIT_PACKETS)
       data->set_packet_count(counter_data.packets);
     if (counter_data.valid & PI_COUNTER_UNIT_BYTES)
       data->set_byte_count(counter_data.bytes);
-    return Code::OK;
   }
 
   device_id_t device_id;
   // for now, we assume all possible pipes of device are programmed in the same
   // way
   pi_dev_tgt_t device_tgt;
-  p4::config::P4Info p4info_proto{};
-  P4InfoWrapper p4info{nullptr, p4info_deleter};
+  // shared with all the other devices using the same P4Info
+  P4InfoCache::EntryPtr p4info_entry{nullptr};
+  // cached from p4info_entry, as it is used in every request
+  const pi_p4info_t *p4info{nullptr};
 
   PacketIOMgr packet_io;
 
@@ -1309,6 +1768,13 @@ class DeviceMgrImp {
   action_profs{};
 
   TableInfoStore table_info_store;
+
+  // built for each table when the P4Info changes, point to the match key
+  // layouts of the current p4info
+  std::unordered_map<pi_p4_id_t, MatchKeyValidator> match_key_validators{};
+
+  // nullptr unless parallel execution of write requests is enabled
+  std::unique_ptr<WorkerPool> write_pool{nullptr};
 };
 
 DeviceMgr::DeviceMgr(device_id_t device_id) {
@@ -1336,12 +1802,23 @@ DeviceMgr::write(const p4::WriteRequest &request) {
   return pimp->write(request);
 }
 
+void
+DeviceMgr::set_write_parallelism(size_t num_workers) {
+  pimp->set_write_parallelism(num_workers);
+}
+
 Status
 DeviceMgr::read(const p4::ReadRequest &request,
                 p4::ReadResponse *response) const {
   return pimp->read(request, response);
 }
 
+Status
+DeviceMgr::read(const p4::ReadRequest &request, const ReadResponseSink &sink,
+                size_t max_entities, size_t max_bytes) const {
+  return pimp->read(request, sink, max_entities, max_bytes);
+}
+
 Status
 DeviceMgr::read_one(const p4::Entity &entity,
                     p4::ReadResponse *response) const {
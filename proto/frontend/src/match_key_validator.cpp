@@ -0,0 +1,199 @@
+/* Copyright 2013-present Barefoot Networks, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Antonin Bas (antonin@barefootnetworks.com)
+ *
+ */
+
+#include "match_key_validator.h"
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "p4/p4runtime.pb.h"
+
+#include "logger.h"
+
+namespace pi {
+
+namespace fe {
+
+namespace proto {
+
+namespace {
+
+constexpr size_t kBitsPerWord = 64;
+
+// equivalent to common::check_proto_bytestring, using the precomputed layout
+bool is_valid_bytestring(const pi_p4info_match_field_layout_t &f,
+                         const std::string &str) {
+  return str.size() == f.nbytes && (str[0] & ~f.byte0_mask) == 0;
+}
+
+Code set_field(const pi_p4info_match_field_layout_t &f,
+               const p4::FieldMatch &mf, pi::MatchKey *match_key) {
+  bool valid_bytestring = true;
+  pi_p4info_match_type_t match_type;
+  switch (mf.field_match_type_case()) {
+    case p4::FieldMatch::kExact:
+      match_type = PI_P4INFO_MATCH_TYPE_EXACT;
+      if (f.match_type != match_type) break;
+      valid_bytestring = is_valid_bytestring(f, mf.exact().value());
+      if (!valid_bytestring) break;
+      match_key->set_exact(f.mf_id, mf.exact().value().data(), f.nbytes);
+      break;
+    case p4::FieldMatch::kLpm:
+      match_type = PI_P4INFO_MATCH_TYPE_LPM;
+      if (f.match_type != match_type) break;
+      valid_bytestring = is_valid_bytestring(f, mf.lpm().value());
+      if (!valid_bytestring) break;
+      match_key->set_lpm(f.mf_id, mf.lpm().value().data(), f.nbytes,
+                         mf.lpm().prefix_len());
+      break;
+    case p4::FieldMatch::kTernary:
+      match_type = PI_P4INFO_MATCH_TYPE_TERNARY;
+      if (f.match_type != match_type) break;
+      valid_bytestring = is_valid_bytestring(f, mf.ternary().value()) &&
+          is_valid_bytestring(f, mf.ternary().mask());
+      if (!valid_bytestring) break;
+      match_key->set_ternary(f.mf_id, mf.ternary().value().data(),
+                             mf.ternary().mask().data(), f.nbytes);
+      break;
+    case p4::FieldMatch::kValid:
+      match_type = PI_P4INFO_MATCH_TYPE_VALID;
+      if (f.match_type != match_type) break;
+      match_key->set_valid(f.mf_id, mf.valid().value());
+      break;
+    case p4::FieldMatch::kRange:
+      match_type = PI_P4INFO_MATCH_TYPE_RANGE;
+      if (f.match_type != match_type) break;
+      valid_bytestring = is_valid_bytestring(f, mf.range().low()) &&
+          is_valid_bytestring(f, mf.range().high());
+      if (!valid_bytestring) break;
+      match_key->set_range(f.mf_id, mf.range().low().data(),
+                           mf.range().high().data(), f.nbytes);
+      break;
+    default:
+      return Code::INVALID_ARGUMENT;
+  }
+  if (f.match_type != match_type) {
+    Logger::get()->error("Invalid match type for field {}", f.mf_id);
+    return Code::INVALID_ARGUMENT;
+  }
+  if (!valid_bytestring) {
+    Logger::get()->error("Invalid bytestring format");
+    return Code::INVALID_ARGUMENT;
+  }
+  return Code::OK;
+}
+
+}  // namespace
+
+MatchKeyValidator::MatchKeyValidator(const pi_p4info_t *p4info,
+                                     pi_p4_id_t table_id)
+    : layout(pi_p4info_table_match_key_layout(p4info, table_id)),
+      required((layout->num_fields + kBitsPerWord - 1) / kBitsPerWord, 0) {
+  for (size_t i = 0; i < layout->num_fields; i++) {
+    auto match_type = layout->fields[i].match_type;
+    if (match_type == PI_P4INFO_MATCH_TYPE_TERNARY ||
+        match_type == PI_P4INFO_MATCH_TYPE_RANGE) {
+      has_priority = true;
+    }
+    if (match_type == PI_P4INFO_MATCH_TYPE_TERNARY) continue;
+    required[i / kBitsPerWord] |= (uint64_t(1) << (i % kBitsPerWord));
+  }
+}
+
+Code
+MatchKeyValidator::construct(const p4::TableEntry &entry,
+                             pi::MatchKey *match_key) const {
+  bool complete;
+  auto code = construct_common(entry, match_key, nullptr, &complete);
+  if (code != Code::OK) return code;
+  if (!complete) {
+    Logger::get()->error("Missing non-ternary field in match key");
+    return Code::INVALID_ARGUMENT;
+  }
+  return Code::OK;
+}
+
+Code
+MatchKeyValidator::construct_partial(const p4::TableEntry &entry,
+                                     pi::MatchKey *match_key,
+                                     std::vector<char> *mask,
+                                     bool *complete) const {
+  mask->assign(layout->match_key_size, 0);
+  return construct_common(entry, match_key, mask, complete);
+}
+
+Code
+MatchKeyValidator::construct_common(const p4::TableEntry &entry,
+                                    pi::MatchKey *match_key,
+                                    std::vector<char> *mask,
+                                    bool *complete) const {
+  const auto &match = entry.match();
+  if (static_cast<size_t>(match.size()) > layout->num_fields) {
+    Logger::get()->error("Too many fields in match key");
+    return Code::INVALID_ARGUMENT;
+  }
+
+  // bitmap of the fields present in the entry, only allocated for tables with
+  // more than 64 match fields
+  uint64_t seen_one = 0;
+  std::vector<uint64_t> seen_many;
+  uint64_t *seen = &seen_one;
+  if (required.size() > 1) {
+    seen_many.resize(required.size(), 0);
+    seen = seen_many.data();
+  }
+
+  for (const auto &mf : match) {
+    auto index = pi_p4info_match_key_layout_index(layout, mf.field_id());
+    if (index == static_cast<size_t>(-1)) {
+      Logger::get()->error("Unknown field in match key");
+      return Code::INVALID_ARGUMENT;
+    }
+    auto &word = seen[index / kBitsPerWord];
+    auto bit = uint64_t(1) << (index % kBitsPerWord);
+    if (word & bit) {
+      Logger::get()->error("Duplicate field in match key");
+      return Code::INVALID_ARGUMENT;
+    }
+    word |= bit;
+    auto code = set_field(layout->fields[index], mf, match_key);
+    if (code != Code::OK) return code;
+    if (mask != nullptr) {
+      // the field spans all the match key data up to the next field
+      auto begin = layout->fields[index].offset;
+      auto end = (index + 1 < layout->num_fields) ?
+          layout->fields[index + 1].offset : layout->match_key_size;
+      std::fill(mask->begin() + begin, mask->begin() + end, '\xff');
+    }
+  }
+
+  *complete = true;
+  for (size_t i = 0; i < required.size(); i++) {
+    if (required[i] & ~seen[i]) *complete = false;
+  }
+  return Code::OK;
+}
+
+}  // namespace proto
+
+}  // namespace fe
+
+}  // namespace pi
@@ -0,0 +1,88 @@
+/* Copyright 2013-present Barefoot Networks, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Antonin Bas (antonin@barefootnetworks.com)
+ *
+ */
+
+#ifndef SRC_MATCH_KEY_VALIDATOR_H_
+#define SRC_MATCH_KEY_VALIDATOR_H_
+
+#include <PI/frontends/cpp/tables.h>
+#include <PI/pi.h>
+
+#include <cstdint>
+#include <vector>
+
+#include "google/rpc/code.pb.h"
+
+namespace p4 {
+
+class TableEntry;
+
+}  // namespace p4
+
+namespace pi {
+
+namespace fe {
+
+namespace proto {
+
+using Code = ::google::rpc::Code;
+
+// Validates the match key of a p4::TableEntry and writes it to a pi::MatchKey
+// in a single pass over the match fields. One instance is built for each table
+// when the P4Info changes; it relies on the match key layout precomputed by
+// p4info to map each match field id to its slot in the match key, with the
+// field's match type, bitwidth and first byte mask.
+class MatchKeyValidator {
+ public:
+  // the p4info object must outlive the validator
+  MatchKeyValidator(const pi_p4info_t *p4info, pi_p4_id_t table_id);
+
+  // match_key must have been constructed for the same table; ternary fields
+  // missing from the entry are left untouched (i.e. as wildcards for a newly
+  // constructed match key)
+  Code construct(const p4::TableEntry &entry, pi::MatchKey *match_key) const;
+
+  // same as construct, but the entry can omit any field, e.g. for a read
+  // request; mask is resized to the match key data size and has all its bits
+  // set for the fields present in the entry, and complete is set to true iff
+  // the entry includes all the fields required by construct
+  Code construct_partial(const p4::TableEntry &entry, pi::MatchKey *match_key,
+                         std::vector<char> *mask, bool *complete) const;
+
+  // true iff entries in the table have a priority (ternary or range match)
+  bool requires_priority() const { return has_priority; }
+
+ private:
+  Code construct_common(const p4::TableEntry &entry, pi::MatchKey *match_key,
+                        std::vector<char> *mask, bool *complete) const;
+
+  const pi_p4info_match_key_layout_t *layout;
+  // one bit per match field, in match key order, set for the fields which are
+  // required in the match key (i.e. all except ternary ones)
+  std::vector<uint64_t> required;
+  bool has_priority{false};
+};
+
+}  // namespace proto
+
+}  // namespace fe
+
+}  // namespace pi
+
+#endif  // SRC_MATCH_KEY_VALIDATOR_H_
@@ -0,0 +1,129 @@
+/* Copyright 2013-present Barefoot Networks, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Antonin Bas (antonin@barefootnetworks.com)
+ *
+ */
+
+#include "p4info_cache.h"
+
+#include <google/protobuf/io/coded_stream.h>
+#include <google/protobuf/io/zero_copy_stream_impl_lite.h>
+
+#include <functional>  // std::hash
+#include <string>
+#include <utility>  // std::move
+#include <vector>
+
+#include "p4info_to_and_from_proto.h"  // for p4info_proto_reader
+
+namespace pi {
+
+namespace fe {
+
+namespace proto {
+
+P4InfoCache::Entry::Entry(const p4::config::P4Info &p4info_proto,
+                          std::string serialized, pi_p4info_t *p4info)
+    : p4info_proto(p4info_proto), serialized(std::move(serialized)),
+      p4info(p4info) { }
+
+P4InfoCache::Entry::~Entry() {
+  pi_destroy_config(const_cast<pi_p4info_t *>(p4info));
+}
+
+P4InfoCache *
+P4InfoCache::get_instance() {
+  static P4InfoCache instance;
+  return &instance;
+}
+
+namespace {
+
+// SerializeAsString does not guarantee that equal messages are serialized to
+// the same bytes (e.g. because of map fields), which would defeat the cache
+std::string serialize_deterministic(const p4::config::P4Info &p4info_proto) {
+  std::string serialized;
+  {
+    // the string is only resized to the actual size when the streams are
+    // destroyed
+    google::protobuf::io::StringOutputStream stream(&serialized);
+    google::protobuf::io::CodedOutputStream output(&stream);
+    output.SetSerializationDeterministic(true);
+    p4info_proto.SerializeToCodedStream(&output);
+  }
+  return serialized;
+}
+
+}  // namespace
+
+P4InfoCache::EntryPtr
+P4InfoCache::get(const p4::config::P4Info &p4info_proto) {
+  auto serialized = serialize_deterministic(p4info_proto);
+  auto h = std::hash<std::string>()(serialized);
+
+  // The entries locked while scanning are only released after the mutex: if
+  // another device drops its last reference in the meantime, we become the
+  // last owner, and the deleter calls evict, which takes the mutex and erases
+  // from entries. Declared before the lock so that it is destroyed after.
+  std::vector<EntryPtr> scanned;
+  // the lock is held while importing the P4Info, so that concurrent requests
+  // for the same P4Info (e.g. when pushing a program to many devices at once)
+  // only import it once
+  Lock lock(mutex);
+  auto range = entries.equal_range(h);
+  for (auto it = range.first; it != range.second; ++it) {
+    auto entry = it->second.ref.lock();
+    // the entry may have expired but not have been evicted yet
+    if (entry && entry->serialized == serialized) return entry;
+    if (entry) scanned.push_back(std::move(entry));
+  }
+
+  pi_p4info_t *p4info = nullptr;
+  if (!pi::p4info::p4info_proto_reader(p4info_proto, &p4info)) return nullptr;
+  auto raw_entry = new Entry(p4info_proto, std::move(serialized), p4info);
+  EntryPtr entry(raw_entry, [this](const Entry *e) {
+      evict(e);
+      delete e;
+    });
+  entries.emplace(h, Slot{raw_entry, entry});
+  return entry;
+}
+
+void
+P4InfoCache::evict(const Entry *entry) {
+  auto h = std::hash<std::string>()(entry->serialized);
+  Lock lock(mutex);
+  auto range = entries.equal_range(h);
+  for (auto it = range.first; it != range.second; ++it) {
+    if (it->second.entry == entry) {
+      entries.erase(it);
+      return;
+    }
+  }
+}
+
+size_t
+P4InfoCache::size() const {
+  Lock lock(mutex);
+  return entries.size();
+}
+
+}  // namespace proto
+
+}  // namespace fe
+
+}  // namespace pi
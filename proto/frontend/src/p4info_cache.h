@@ -0,0 +1,94 @@
+/* Copyright 2013-present Barefoot Networks, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Antonin Bas (antonin@barefootnetworks.com)
+ *
+ */
+
+#ifndef SRC_P4INFO_CACHE_H_
+#define SRC_P4INFO_CACHE_H_
+
+#include <PI/pi.h>
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "p4/config/p4info.pb.h"
+
+namespace pi {
+
+namespace fe {
+
+namespace proto {
+
+// Process-wide cache of imported P4Info messages. Devices which are programmed
+// with the same P4Info share a single, immutable, pi_p4info_t object and a
+// single copy of the P4Info message. Entries are keyed by a hash of the
+// serialized P4Info and are reference-counted: an entry is evicted as soon as
+// the last device using it moves to a different P4Info or is destroyed.
+class P4InfoCache {
+ public:
+  class Entry {
+   public:
+    Entry(const p4::config::P4Info &p4info_proto, std::string serialized,
+          pi_p4info_t *p4info);
+
+    ~Entry();
+
+    const p4::config::P4Info p4info_proto;
+    // used to resolve hash collisions
+    const std::string serialized;
+    const pi_p4info_t *const p4info;
+  };
+
+  using EntryPtr = std::shared_ptr<const Entry>;
+
+  static P4InfoCache *get_instance();
+
+  // Returns the cache entry for this P4Info, importing the P4Info message if
+  // needed. Returns nullptr if the P4Info message is invalid.
+  EntryPtr get(const p4::config::P4Info &p4info_proto);
+
+  // number of entries currently in use
+  size_t size() const;
+
+ private:
+  P4InfoCache() = default;
+
+  void evict(const Entry *entry);
+
+  using Mutex = std::mutex;
+  using Lock = std::unique_lock<Mutex>;
+
+  mutable Mutex mutex{};
+  struct Slot {
+    // used to find the slot when evicting the entry, at which point the weak
+    // reference has already expired
+    const Entry *entry;
+    std::weak_ptr<const Entry> ref;
+  };
+  std::unordered_multimap<size_t, Slot> entries{};
+};
+
+}  // namespace proto
+
+}  // namespace fe
+
+}  // namespace pi
+
+#endif  // SRC_P4INFO_CACHE_H_
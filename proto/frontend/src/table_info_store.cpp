@@ -21,9 +21,12 @@
 #include <PI/frontends/cpp/tables.h>
 #include <PI/pi.h>
 
+#include <cassert>
+#include <cstdint>
+#include <cstring>
 #include <memory>
-#include <sstream>
 #include <unordered_map>
+#include <vector>
 
 #include "table_info_store.h"
 
@@ -33,34 +36,181 @@ namespace fe {
 
 namespace proto {
 
-using MatchKey = TableInfoStore::MatchKey;
+using MatchKeyView = TableInfoStore::MatchKeyView;
 using Data = TableInfoStore::Data;
+using MemoryUsage = TableInfoStore::MemoryUsage;
 using Mutex = TableInfoStore::Mutex;
 using Lock = TableInfoStore::Lock;
 
+// Entries are stored in an open-addressing hash table (linear probing, with
+// backward shift deletion so that we do not need tombstones). The match key
+// data is not stored in the buckets but in a per-table arena, as a dense array
+// of fixed-size slots: when an entry is removed, the last slot is moved to the
+// freed one. Memory usage is therefore linear in the number of entries, with a
+// bounded amount of slack (at most one spare arena chunk and a load factor of
+// at least 1/8 for the hash table).
 class TableInfoStoreOne {
  public:
-  void add_entry(const MatchKey &mk, const Data &data) {
-    data_map.emplace(mk, data);
+  TableInfoStoreOne(pi_p4_id_t t_id, size_t mk_size)
+      : t_id(t_id), mk_size(mk_size) {
+    while (slots_per_chunk_log2 < 16 &&
+           (mk_size << (slots_per_chunk_log2 + 1)) <= kArenaChunkSize) {
+      slots_per_chunk_log2++;
+    }
   }
 
-  void remove_entry(const MatchKey &mk) {
-    data_map.erase(mk);
+  void add_entry(const MatchKeyView &mk, const Data &data) {
+    assert(mk.size == mk_size);
+    if (find(mk) != kNotFound) return;
+    assert(num_entries < kEmpty);
+    if ((num_entries + 1) * kMaxLoadDen > buckets.size() * kMaxLoadNum) {
+      resize(buckets.empty() ? kMinBuckets : buckets.size() * 2);
+    }
+    auto slot = static_cast<uint32_t>(num_entries);
+    if ((slot >> slots_per_chunk_log2) == chunks.size())
+      chunks.emplace_back(new char[chunk_size()]);
+    std::memcpy(slot_data(slot), mk.data, mk_size);
+    insert_bucket(Bucket(slot, mk.priority, data));
+    num_entries++;
   }
 
-  Data *get_entry(const MatchKey &mk) {
-    auto it = data_map.find(mk);
-    return (it == data_map.end()) ? nullptr : &it->second;
+  void remove_entry(const MatchKeyView &mk) {
+    assert(mk.size == mk_size);
+    auto idx = find(mk);
+    if (idx == kNotFound) return;
+    auto slot = buckets[idx].slot;
+    erase_bucket(idx);
+    auto last = static_cast<uint32_t>(--num_entries);
+    if (slot != last) {
+      // keep the arena dense, the bucket pointing to the last slot is found by
+      // probing from its home position
+      std::memcpy(slot_data(slot), slot_data(last), mk_size);
+      for (auto i = home(slot_data(slot)); ; i = next(i)) {
+        if (buckets[i].slot != last) continue;
+        buckets[i].slot = slot;
+        break;
+      }
+    }
+    // keep at most one spare chunk, to avoid allocating / releasing a chunk
+    // repeatedly at the boundary
+    auto slots_per_chunk = static_cast<size_t>(1) << slots_per_chunk_log2;
+    auto needed_chunks = (num_entries + slots_per_chunk - 1) / slots_per_chunk;
+    while (chunks.size() > needed_chunks + 1) chunks.pop_back();
+    if (buckets.size() > kMinBuckets && num_entries < buckets.size() / 8)
+      resize(buckets.size() / 2);
+  }
+
+  Data *get_entry(const MatchKeyView &mk) {
+    assert(mk.size == mk_size);
+    auto idx = find(mk);
+    return (idx == kNotFound) ? nullptr : &buckets[idx].data;
+  }
+
+  MemoryUsage get_memory_usage() const {
+    MemoryUsage usage;
+    usage.num_entries = num_entries;
+    usage.bytes = buckets.capacity() * sizeof(Bucket) +
+        chunks.capacity() * sizeof(chunks[0]) + chunks.size() * chunk_size();
+    return usage;
   }
 
   Lock lock() const { return Lock(mutex); }
 
  private:
+  static constexpr uint32_t kEmpty = static_cast<uint32_t>(-1);
+  static constexpr size_t kNotFound = static_cast<size_t>(-1);
+  static constexpr size_t kMinBuckets = 16;
+  // maximum load factor for the hash table
+  static constexpr size_t kMaxLoadNum = 3;
+  static constexpr size_t kMaxLoadDen = 4;
+  // target size in bytes for the arena chunks
+  static constexpr size_t kArenaChunkSize = 1 << 16;
+
+  struct Bucket {
+    Bucket() : data(0, 0) { }
+    Bucket(uint32_t slot, int priority, const Data &data)
+        : slot(slot), priority(priority), data(data) { }
+
+    // index of the match key data in the arena, kEmpty for an empty bucket
+    uint32_t slot{kEmpty};
+    int priority{0};
+    Data data;
+  };
+
+  size_t chunk_size() const { return mk_size << slots_per_chunk_log2; }
+
+  char *slot_data(uint32_t slot) const {
+    auto mask = (static_cast<uint32_t>(1) << slots_per_chunk_log2) - 1;
+    return chunks[slot >> slots_per_chunk_log2].get() + (slot & mask) * mk_size;
+  }
+
+  // the priority is not included in the hash, as it is not stored in the
+  // arena; this is not an issue as there are few entries with the same key and
+  // a different priority
+  size_t home(const char *mk_data) const {
+    return pi::MatchKeyHash()(MatchKeyView(t_id, 0, mk_data, mk_size)) &
+        (buckets.size() - 1);
+  }
+
+  size_t next(size_t i) const { return (i + 1) & (buckets.size() - 1); }
+
+  size_t find(const MatchKeyView &mk) const {
+    if (num_entries == 0) return kNotFound;
+    for (auto i = home(mk.data); ; i = next(i)) {
+      const auto &b = buckets[i];
+      if (b.slot == kEmpty) return kNotFound;
+      if (b.priority == mk.priority &&
+          !std::memcmp(slot_data(b.slot), mk.data, mk_size)) {
+        return i;
+      }
+    }
+  }
+
+  void insert_bucket(const Bucket &bucket) {
+    auto i = home(slot_data(bucket.slot));
+    while (buckets[i].slot != kEmpty) i = next(i);
+    buckets[i] = bucket;
+  }
+
+  // backward shift deletion: the following buckets in the cluster are moved
+  // back if this brings them closer to their home position
+  void erase_bucket(size_t i) {
+    for (auto j = next(i); buckets[j].slot != kEmpty; j = next(j)) {
+      auto k = home(slot_data(buckets[j].slot));
+      // move the bucket to i unless its home position k is cyclically in
+      // (i, j]
+      bool in_range = (i <= j) ? (i < k && k <= j) : (i < k || k <= j);
+      if (in_range) continue;
+      buckets[i] = buckets[j];
+      i = j;
+    }
+    buckets[i].slot = kEmpty;
+  }
+
+  void resize(size_t num_buckets) {
+    std::vector<Bucket> old_buckets(num_buckets);
+    old_buckets.swap(buckets);
+    for (const auto &b : old_buckets)
+      if (b.slot != kEmpty) insert_bucket(b);
+  }
+
   mutable Mutex mutex{};
-  std::unordered_map<MatchKey, Data, pi::MatchKeyHash, pi::MatchKeyEq>
-  data_map{};
+  const pi_p4_id_t t_id;
+  const size_t mk_size;
+  size_t slots_per_chunk_log2{0};
+  size_t num_entries{0};
+  // size is always a power of 2
+  std::vector<Bucket> buckets{};
+  std::vector<std::unique_ptr<char[]> > chunks{};
 };
 
+constexpr uint32_t TableInfoStoreOne::kEmpty;
+constexpr size_t TableInfoStoreOne::kNotFound;
+constexpr size_t TableInfoStoreOne::kMinBuckets;
+constexpr size_t TableInfoStoreOne::kMaxLoadNum;
+constexpr size_t TableInfoStoreOne::kMaxLoadDen;
+constexpr size_t TableInfoStoreOne::kArenaChunkSize;
+
 TableInfoStore::TableInfoStore() = default;
 TableInfoStore::~TableInfoStore() = default;
 
@@ -71,30 +221,53 @@ TableInfoStore::lock_table(pi_p4_id_t t_id) const {
 }
 
 void
-TableInfoStore::add_table(pi_p4_id_t t_id) {
-  tables.emplace(
-      t_id, std::unique_ptr<TableInfoStoreOne>(new TableInfoStoreOne()));
+TableInfoStore::add_table(pi_p4_id_t t_id, size_t mk_size) {
+  if (tables.find(t_id) != tables.end()) return;
+  tables.emplace(t_id, std::unique_ptr<TableInfoStoreOne>(
+      new TableInfoStoreOne(t_id, mk_size)));
 }
 
 void
-TableInfoStore::add_entry(pi_p4_id_t t_id, const MatchKey &mk,
+TableInfoStore::remove_table(pi_p4_id_t t_id) {
+  tables.erase(t_id);
+}
+
+void
+TableInfoStore::add_entry(pi_p4_id_t t_id, const MatchKeyView &mk,
                           const Data &data) {
   auto &table = tables.at(t_id);
   table->add_entry(mk, data);
 }
 
 void
-TableInfoStore::remove_entry(pi_p4_id_t t_id, const MatchKey &mk) {
+TableInfoStore::remove_entry(pi_p4_id_t t_id, const MatchKeyView &mk) {
   auto &table = tables.at(t_id);
   table->remove_entry(mk);
 }
 
 Data *
-TableInfoStore::get_entry(pi_p4_id_t t_id, const MatchKey &mk) const {
+TableInfoStore::get_entry(pi_p4_id_t t_id, const MatchKeyView &mk) const {
   auto &table = tables.at(t_id);
   return table->get_entry(mk);
 }
 
+MemoryUsage
+TableInfoStore::get_memory_usage(pi_p4_id_t t_id) const {
+  auto &table = tables.at(t_id);
+  return table->get_memory_usage();
+}
+
+MemoryUsage
+TableInfoStore::get_memory_usage() const {
+  MemoryUsage usage;
+  for (const auto &p : tables) {
+    auto table_usage = p.second->get_memory_usage();
+    usage.num_entries += table_usage.num_entries;
+    usage.bytes += table_usage.bytes;
+  }
+  return usage;
+}
+
 void
 TableInfoStore::reset() {
   tables.clear();
@@ -44,16 +44,27 @@ class TableInfoStore {
   // key should be able to change without impacting the hash or equality
   // operator.
   using MatchKey = pi::MatchKey;
+  // used for lookups, so that the match keys returned by the target can be
+  // used directly, without copying them to a MatchKey object first; a MatchKey
+  // can be implicitly converted to a MatchKeyView
+  using MatchKeyView = pi::MatchKeyView;
 
   // wish I could use boost::variant for these
+  // not const, as Data objects are moved around in the hash table
   struct Data {
     Data(pi_entry_handle_t handle, uint64_t controller_metadata)
         : handle(handle), controller_metadata(controller_metadata) { }
 
-    const pi_entry_handle_t handle{0};
+    pi_entry_handle_t handle{0};
     uint64_t controller_metadata{0};
   };
 
+  struct MemoryUsage {
+    size_t num_entries{0};
+    // bytes allocated for the hash table and the match key arena
+    size_t bytes{0};
+  };
+
   using Mutex = std::mutex;
   using Lock = std::unique_lock<Mutex>;
 
@@ -66,13 +77,27 @@ class TableInfoStore {
   // consistent with lower level driver operations.
   Lock lock_table(pi_p4_id_t t_id) const;
 
-  void add_table(pi_p4_id_t t_id);
+  // does nothing if the table already exists; mk_size is the size of the match
+  // key data for the table, as all the entries of a table are stored in a
+  // fixed-size format
+  void add_table(pi_p4_id_t t_id, size_t mk_size);
+
+  void remove_table(pi_p4_id_t t_id);
+
+  // the match key data is copied
+  void add_entry(pi_p4_id_t t_id, const MatchKeyView &mk, const Data &data);
+
+  void remove_entry(pi_p4_id_t t_id, const MatchKeyView &mk);
 
-  void add_entry(pi_p4_id_t t_id, const MatchKey &mk, const Data &data);
+  // the returned pointer is invalidated by the next add_entry or remove_entry
+  // call for the same table
+  Data *get_entry(pi_p4_id_t t_id, const MatchKeyView &mk) const;
 
-  void remove_entry(pi_p4_id_t t_id, const MatchKey &mk);
+  // the table lock must be held by the caller
+  MemoryUsage get_memory_usage(pi_p4_id_t t_id) const;
 
-  Data *get_entry(pi_p4_id_t t_id, const MatchKey &mk) const;
+  // sum for all tables, the caller must ensure that no table is being modified
+  MemoryUsage get_memory_usage() const;
 
   void reset();
 
@@ -0,0 +1,86 @@
+/* Copyright 2013-present Barefoot Networks, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Antonin Bas (antonin@barefootnetworks.com)
+ *
+ */
+
+#include "worker_pool.h"
+
+#include <vector>
+
+namespace pi {
+
+namespace fe {
+
+namespace proto {
+
+WorkerPool::WorkerPool(size_t num_workers) {
+  for (size_t i = 0; i < num_workers; i++)
+    workers.emplace_back(&WorkerPool::worker_loop, this);
+}
+
+WorkerPool::~WorkerPool() {
+  {
+    std::lock_guard<std::mutex> lock(m);
+    stop = true;
+  }
+  cv.notify_all();
+  for (auto &worker : workers) worker.join();
+}
+
+void
+WorkerPool::run_all(const std::vector<Task> &tasks) {
+  std::mutex done_m;
+  std::condition_variable done_cv;
+  size_t remaining = tasks.size();
+  {
+    std::lock_guard<std::mutex> lock(m);
+    for (const auto &task : tasks) {
+      queue.emplace([&task, &done_m, &done_cv, &remaining]() {
+        task();
+        // notify with the lock held, as done_cv goes out of scope as soon as
+        // run_all returns
+        std::lock_guard<std::mutex> lock(done_m);
+        if (--remaining == 0) done_cv.notify_one();
+      });
+    }
+  }
+  cv.notify_all();
+  std::unique_lock<std::mutex> lock(done_m);
+  done_cv.wait(lock, [&remaining]() { return remaining == 0; });
+}
+
+void
+WorkerPool::worker_loop() {
+  while (true) {
+    Task task;
+    {
+      std::unique_lock<std::mutex> lock(m);
+      cv.wait(lock, [this]() { return stop || !queue.empty(); });
+      if (queue.empty()) return;
+      task = std::move(queue.front());
+      queue.pop();
+    }
+    task();
+  }
+}
+
+}  // namespace proto
+
+}  // namespace fe
+
+}  // namespace pi
@@ -0,0 +1,71 @@
+/* Copyright 2013-present Barefoot Networks, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Antonin Bas (antonin@barefootnetworks.com)
+ *
+ */
+
+#ifndef SRC_WORKER_POOL_H_
+#define SRC_WORKER_POOL_H_
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+namespace pi {
+
+namespace fe {
+
+namespace proto {
+
+// Fixed-size pool of threads, used by DeviceMgr to execute the updates of a
+// WriteRequest concurrently.
+class WorkerPool {
+ public:
+  using Task = std::function<void()>;
+
+  explicit WorkerPool(size_t num_workers);
+
+  // waits for the queued tasks to complete
+  ~WorkerPool();
+
+  // executes all the tasks and returns once they have all completed; can be
+  // called concurrently from different threads, in which case the tasks are
+  // interleaved
+  void run_all(const std::vector<Task> &tasks);
+
+  size_t size() const { return workers.size(); }
+
+ private:
+  void worker_loop();
+
+  std::mutex m{};
+  std::condition_variable cv{};
+  std::queue<Task> queue{};
+  bool stop{false};
+  std::vector<std::thread> workers{};
+};
+
+}  // namespace proto
+
+}  // namespace fe
+
+}  // namespace pi
+
+#endif  // SRC_WORKER_POOL_H_
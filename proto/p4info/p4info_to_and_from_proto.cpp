@@ -247,6 +247,7 @@ bool p4info_proto_reader(const p4::config::P4Info &p4info_proto,
     std::cerr << e.what() << "\n";
     return false;
   }
+  pi_p4info_freeze(*p4info);
   return true;
 }
 
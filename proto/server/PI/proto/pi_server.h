@@ -20,6 +20,8 @@
 
 #pragma once
 
+#include <stddef.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -30,6 +32,12 @@ void PIGrpcServerRun();
 // 192.168.1.1:31416, [::1]:27182, etc.)
 void PIGrpcServerRunAddr(const char *server_address);
 
+// Entities returned by a Read RPC are streamed in several ReadResponse
+// messages, each one including at most max_entities entities and about
+// max_bytes bytes (0 means no limit). The default is 1MB per message, with no
+// limit on the number of entities.
+void PIGrpcServerSetReadResponseLimits(size_t max_entities, size_t max_bytes);
+
 // Wait for the server to shutdown. Note that some other thread must be
 // responsible for shutting down the server for this call to ever return.
 void PIGrpcServerWait();
@@ -183,6 +183,11 @@ class gNMIServiceImpl : public gnmi::gNMI::Service {
   }
 };
 
+// budget for each ReadResponse message; the default stays well below the 4MB
+// limit used by default by gRPC clients for incoming messages
+size_t read_response_max_entities = 0;
+size_t read_response_max_bytes = 1 << 20;
+
 class StreamChannelClientMgr;
 
 StreamChannelClientMgr *packet_in_mgr;
@@ -209,11 +214,15 @@ class P4RuntimeServiceImpl : public p4::P4Runtime::Service {
               ServerWriter<p4::ReadResponse> *writer) override {
     SIMPLELOG << "P4Runtime Read\n";
     SIMPLELOG << request->DebugString();
-    p4::ReadResponse response;
     auto device_mgr = Devices::get(request->device_id());
     if (device_mgr == nullptr) return no_pipeline_config_status();
-    auto status = device_mgr->read(*request, &response);
-    writer->Write(response);
+    // responses are streamed as they are produced, so that we never build a
+    // message with the whole table in memory
+    auto status = device_mgr->read(
+        *request,
+        [writer](const p4::ReadResponse &response) {
+          return writer->Write(response); },
+        read_response_max_entities, read_response_max_bytes);
     return to_grpc_status(status);
   }
 
@@ -522,6 +531,12 @@ void PIGrpcServerRun() {
   PIGrpcServerRunAddr("0.0.0.0:50051");
 }
 
+void PIGrpcServerSetReadResponseLimits(size_t max_entities,
+                                       size_t max_bytes) {
+  read_response_max_entities = max_entities;
+  read_response_max_bytes = max_bytes;
+}
+
 void PIGrpcServerWait() {
   server_data->server->Wait();
 }
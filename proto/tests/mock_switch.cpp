@@ -26,6 +26,8 @@
 #include <boost/optional.hpp>
 
 #include <algorithm>  // std::copy
+#include <cstring>
+#include <mutex>
 #include <string>
 #include <unordered_map>
 #include <unordered_set>
@@ -333,11 +335,35 @@ class DummyActionProf {
 
 class DummyMeter {
  public:
-  // TODO(antonin): store meter_spec for read API
   template <typename T>
   pi_status_t set(T index, const pi_meter_spec_t *meter_spec) {
+    specs[index] = *meter_spec;
+    return PI_STATUS_SUCCESS;
+  }
+
+  template <typename T>
+  pi_status_t read(T index, pi_meter_spec_t *meter_spec) const {
+    auto it = specs.find(index);
+    if (it == specs.end())
+      std::memset(meter_spec, 0, sizeof(*meter_spec));
+    else
+      *meter_spec = it->second;
+    return PI_STATUS_SUCCESS;
+  }
+
+ private:
+  std::unordered_map<uint64_t, pi_meter_spec_t> specs{};
+};
+
+class DummyCounter {
+ public:
+  // counters are never incremented, so they always read as 0
+  template <typename T>
+  pi_status_t read(T index, pi_counter_data_t *counter_data) const {
     (void) index;
-    (void) meter_spec;
+    counter_data->valid = PI_COUNTER_UNIT_PACKETS | PI_COUNTER_UNIT_BYTES;
+    counter_data->bytes = 0;
+    counter_data->packets = 0;
     return PI_STATUS_SUCCESS;
   }
 };
@@ -353,39 +379,46 @@ class DummySwitch {
                               const pi_match_key_t *match_key,
                               const pi_table_entry_t *table_entry,
                               pi_entry_handle_t *entry_handle) {
+    std::lock_guard<std::mutex> lock(m);
     // constructs DummyTable if not already in map
     return tables[table_id].entry_add(match_key, table_entry, entry_handle);
   }
 
   pi_status_t table_default_action_set(pi_p4_id_t table_id,
                                        const pi_table_entry_t *table_entry) {
+    std::lock_guard<std::mutex> lock(m);
     return tables[table_id].default_action_set(table_entry);
   }
 
   pi_status_t table_default_action_get(pi_p4_id_t table_id,
                                        pi_table_entry_t *table_entry) {
+    std::lock_guard<std::mutex> lock(m);
     return tables[table_id].default_action_get(table_entry);
   }
 
   pi_status_t table_entry_delete_wkey(pi_p4_id_t table_id,
                                       const pi_match_key_t *match_key) {
+    std::lock_guard<std::mutex> lock(m);
     return tables[table_id].entry_delete_wkey(match_key);
   }
 
   pi_status_t table_entry_modify_wkey(pi_p4_id_t table_id,
                                       const pi_match_key_t *match_key,
                                       const pi_table_entry_t *table_entry) {
+    std::lock_guard<std::mutex> lock(m);
     return tables[table_id].entry_modify_wkey(match_key, table_entry);
   }
 
   pi_status_t table_entries_fetch(pi_p4_id_t table_id,
                                   pi_table_fetch_res_t *res) {
+    std::lock_guard<std::mutex> lock(m);
     return tables[table_id].entries_fetch(res);
   }
 
   pi_status_t action_prof_member_create(pi_p4_id_t act_prof_id,
                                         const pi_action_data_t *action_data,
                                         pi_indirect_handle_t *mbr_handle) {
+    std::lock_guard<std::mutex> lock(m);
     // constructs DummyActionProf if not already in map
     return action_profs[act_prof_id].member_create(action_data, mbr_handle);
   }
@@ -393,55 +426,79 @@ class DummySwitch {
   pi_status_t action_prof_member_modify(pi_p4_id_t act_prof_id,
                                         pi_indirect_handle_t mbr_handle,
                                         const pi_action_data_t *action_data) {
+    std::lock_guard<std::mutex> lock(m);
     return action_profs[act_prof_id].member_modify(mbr_handle, action_data);
   }
 
   pi_status_t action_prof_member_delete(pi_p4_id_t act_prof_id,
                                         pi_indirect_handle_t mbr_handle) {
+    std::lock_guard<std::mutex> lock(m);
     return action_profs[act_prof_id].member_delete(mbr_handle);
   }
 
   pi_status_t action_prof_group_create(pi_p4_id_t act_prof_id,
                                        size_t max_size,
                                        pi_indirect_handle_t *grp_handle) {
+    std::lock_guard<std::mutex> lock(m);
     return action_profs[act_prof_id].group_create(max_size, grp_handle);
   }
 
   pi_status_t action_prof_group_delete(pi_p4_id_t act_prof_id,
                                        pi_indirect_handle_t grp_handle) {
+    std::lock_guard<std::mutex> lock(m);
     return action_profs[act_prof_id].group_delete(grp_handle);
   }
 
   pi_status_t action_prof_group_add_member(pi_p4_id_t act_prof_id,
                                            pi_indirect_handle_t grp_handle,
                                            pi_indirect_handle_t mbr_handle) {
+    std::lock_guard<std::mutex> lock(m);
     return action_profs[act_prof_id].group_add_member(grp_handle, mbr_handle);
   }
 
   pi_status_t action_prof_group_remove_member(pi_p4_id_t act_prof_id,
                                            pi_indirect_handle_t grp_handle,
                                            pi_indirect_handle_t mbr_handle) {
+    std::lock_guard<std::mutex> lock(m);
     return action_profs[act_prof_id].group_remove_member(
         grp_handle, mbr_handle);
   }
 
   pi_status_t action_prof_entries_fetch(pi_p4_id_t act_prof_id,
                                         pi_act_prof_fetch_res_t *res) {
+    std::lock_guard<std::mutex> lock(m);
     return action_profs[act_prof_id].entries_fetch(res);
   }
 
   pi_status_t meter_set(pi_p4_id_t meter_id, size_t index,
                         const pi_meter_spec_t *meter_spec) {
+    std::lock_guard<std::mutex> lock(m);
     return meters[meter_id].set(index, meter_spec);
   }
 
   pi_status_t meter_set_direct(pi_p4_id_t meter_id,
                                pi_entry_handle_t entry_handle,
                                const pi_meter_spec_t *meter_spec) {
+    std::lock_guard<std::mutex> lock(m);
     return meters[meter_id].set(entry_handle, meter_spec);
   }
 
+  pi_status_t meter_read_direct(pi_p4_id_t meter_id,
+                                pi_entry_handle_t entry_handle,
+                                pi_meter_spec_t *meter_spec) {
+    std::lock_guard<std::mutex> lock(m);
+    return meters[meter_id].read(entry_handle, meter_spec);
+  }
+
+  pi_status_t counter_read_direct(pi_p4_id_t counter_id,
+                                  pi_entry_handle_t entry_handle,
+                                  pi_counter_data_t *counter_data) {
+    std::lock_guard<std::mutex> lock(m);
+    return counters[counter_id].read(entry_handle, counter_data);
+  }
+
   pi_status_t packetout_send(const char *, size_t) {
+    std::lock_guard<std::mutex> lock(m);
     return PI_STATUS_SUCCESS;
   }
 
@@ -453,7 +510,10 @@ class DummySwitch {
   std::unordered_map<pi_p4_id_t, DummyTable> tables{};
   std::unordered_map<pi_p4_id_t, DummyActionProf> action_profs{};
   std::unordered_map<pi_p4_id_t, DummyMeter> meters{};
+  std::unordered_map<pi_p4_id_t, DummyCounter> counters{};
   device_id_t device_id;
+  // DeviceMgr may call the target concurrently from different sessions
+  std::mutex m{};
 };
 
 DummySwitchMock::DummySwitchMock(device_id_t device_id)
@@ -505,6 +565,11 @@ DummySwitchMock::DummySwitchMock(device_id_t device_id)
       .WillByDefault(Invoke(sw_, &DummySwitch::meter_set));
   ON_CALL(*this, meter_set_direct(_, _, _))
       .WillByDefault(Invoke(sw_, &DummySwitch::meter_set_direct));
+  ON_CALL(*this, meter_read_direct(_, _, _))
+      .WillByDefault(Invoke(sw_, &DummySwitch::meter_read_direct));
+
+  ON_CALL(*this, counter_read_direct(_, _, _))
+      .WillByDefault(Invoke(sw_, &DummySwitch::counter_read_direct));
 
   ON_CALL(*this, packetout_send(_, _))
       .WillByDefault(Invoke(sw_, &DummySwitch::packetout_send));
@@ -555,6 +620,16 @@ DummySwitchMock::packetin_inject(const std::string &packet) const {
   return sw->packetin_inject(packet);
 }
 
+void
+DummySwitchMock::set_preserves_state(bool preserves_state) {
+  this->preserves_state = preserves_state;
+}
+
+bool
+DummySwitchMock::get_preserves_state() const {
+  return preserves_state;
+}
+
 namespace {
 
 // here we implement the _pi_* methods which are needed for our tests
@@ -576,6 +651,10 @@ pi_status_t _pi_update_device_start(pi_dev_id_t, const pi_p4info_t *,
 
 pi_status_t _pi_update_device_end(pi_dev_id_t) { return PI_STATUS_SUCCESS; }
 
+bool _pi_update_device_preserves_state(pi_dev_id_t dev_id) {
+  return DeviceResolver::get_switch(dev_id)->get_preserves_state();
+}
+
 pi_status_t _pi_remove_device(pi_dev_id_t) { return PI_STATUS_SUCCESS; }
 
 pi_status_t _pi_session_init(pi_session_handle_t *) {
@@ -743,6 +822,23 @@ pi_status_t _pi_meter_set_direct(pi_session_handle_t,
       meter_id, entry_handle, meter_spec);
 }
 
+pi_status_t _pi_meter_read_direct(pi_session_handle_t,
+                                  pi_dev_tgt_t dev_tgt, pi_p4_id_t meter_id,
+                                  pi_entry_handle_t entry_handle,
+                                  pi_meter_spec_t *meter_spec) {
+  return DeviceResolver::get_switch(dev_tgt.dev_id)->meter_read_direct(
+      meter_id, entry_handle, meter_spec);
+}
+
+pi_status_t _pi_counter_read_direct(pi_session_handle_t,
+                                    pi_dev_tgt_t dev_tgt,
+                                    pi_p4_id_t counter_id,
+                                    pi_entry_handle_t entry_handle, int,
+                                    pi_counter_data_t *counter_data) {
+  return DeviceResolver::get_switch(dev_tgt.dev_id)->counter_read_direct(
+      counter_id, entry_handle, counter_data);
+}
+
 pi_status_t _pi_packetout_send(pi_dev_id_t dev_id, const char *pkt,
                                size_t size) {
   return DeviceResolver::get_switch(dev_id)->packetout_send(pkt, size);
@@ -67,6 +67,11 @@ class DummySwitchMock {
 
   pi_status_t packetin_inject(const std::string &packet) const;
 
+  // whether the switch keeps its state across config updates, false by default
+  void set_preserves_state(bool preserves_state);
+
+  bool get_preserves_state() const;
+
   MOCK_METHOD4(table_entry_add,
                pi_status_t(pi_p4_id_t, const pi_match_key_t *,
                            const pi_table_entry_t *, pi_entry_handle_t *));
@@ -108,6 +113,12 @@ class DummySwitchMock {
   MOCK_METHOD3(meter_set_direct,
                pi_status_t(pi_p4_id_t, pi_entry_handle_t,
                            const pi_meter_spec_t *));
+  MOCK_METHOD3(meter_read_direct,
+               pi_status_t(pi_p4_id_t, pi_entry_handle_t, pi_meter_spec_t *));
+
+  MOCK_METHOD3(counter_read_direct,
+               pi_status_t(pi_p4_id_t, pi_entry_handle_t,
+                           pi_counter_data_t *));
 
   MOCK_METHOD2(packetout_send, pi_status_t(const char *, size_t));
 
@@ -115,6 +126,7 @@ class DummySwitchMock {
   std::unique_ptr<DummySwitch> sw;
   pi_indirect_handle_t action_prof_h;
   pi_entry_handle_t table_h;
+  bool preserves_state{false};
 };
 
 // used to map device ids to DummySwitchMock instances; thread safe in case we
@@ -24,6 +24,7 @@
 
 #include <google/protobuf/util/message_differencer.h>
 
+#include <algorithm>  // std::max
 #include <fstream>  // std::ifstream
 #include <iterator>  // std::distance
 #include <memory>
@@ -41,6 +42,7 @@
 #include "p4info_to_and_from_proto.h"
 
 #include "google/rpc/code.pb.h"
+#include "p4/tmp/p4config.pb.h"
 
 #include "mock_switch.h"
 
@@ -142,6 +144,36 @@ TEST_F(DeviceMgrTest, PipelineConfigGet) {
   EXPECT_TRUE(MessageDifferencer::Equals(p4info_proto, config.p4info()));
 }
 
+// devices programmed with the same P4Info share the same p4info object
+TEST_F(DeviceMgrTest, SharedP4Info) {
+  p4::ForwardingPipelineConfig config;
+  config.set_allocated_p4info(&p4info_proto);
+  const auto *p4info_1 = pi_get_device_p4info(device_id);
+  ASSERT_NE(nullptr, p4info_1);
+  {
+    DummySwitchWrapper wrapper_2;
+    DeviceMgr mgr_2(wrapper_2.device_id());
+    auto status = mgr_2.pipeline_config_set(
+        p4::SetForwardingPipelineConfigRequest_Action_VERIFY_AND_COMMIT,
+        config);
+    EXPECT_EQ(status.code(), Code::OK);
+    EXPECT_EQ(p4info_1, pi_get_device_p4info(wrapper_2.device_id()));
+    p4::ForwardingPipelineConfig config_2;
+    status = mgr_2.pipeline_config_get(&config_2);
+    EXPECT_EQ(status.code(), Code::OK);
+    EXPECT_TRUE(MessageDifferencer::Equals(p4info_proto, config_2.p4info()));
+  }
+  config.release_p4info();
+  // the first device is still usable once the second one is gone
+  EXPECT_EQ(p4info_1, pi_get_device_p4info(device_id));
+  p4::ForwardingPipelineConfig config_1;
+  auto status = mgr.pipeline_config_get(&config_1);
+  ASSERT_EQ(status.code(), Code::OK);
+  EXPECT_TRUE(MessageDifferencer::Equals(p4info_proto, config_1.p4info()));
+  auto t_id = pi_p4info_table_id_from_name(p4info_1, "ExactOne");
+  EXPECT_NE(t_id, PI_INVALID_ID);
+}
+
 using ::testing::WithParamInterface;
 using ::testing::Values;
 using ::testing::Combine;
@@ -261,6 +293,8 @@ class MatchTableTest
   DeviceMgr::Status remove(p4::TableEntry *entry);
   DeviceMgr::Status modify(p4::TableEntry *entry);
 
+  DeviceMgr::Status update_pipeline(const p4::config::P4Info &p4info_new);
+
   pi_p4_id_t t_id = pi_p4info_table_id_from_name(
       p4info, std::get<0>(GetParam()));
   pi_p4_id_t mf_id = pi_p4info_table_match_field_id_from_name(
@@ -414,6 +448,46 @@ TEST_P(MatchTableTest, AddAndRead) {
   ASSERT_TRUE(MessageDifferencer::Equals(entry, entities.Get(0).table_entry()));
 }
 
+TEST_P(MatchTableTest, PointRead) {
+  std::string adata(6, '\x00');
+  auto mk_input = std::get<1>(GetParam());
+  auto mk_matcher = Truly(MatchKeyMatcher(t_id, mk_input.get_match_key()));
+  auto entry_matcher = Truly(TableEntryMatcher_Direct(a_id, adata));
+  EXPECT_CALL(*mock, table_entry_add(t_id, mk_matcher, entry_matcher, _));
+  DeviceMgr::Status status;
+  auto entry = generic_make(t_id, mk_input.get_proto(mf_id), adata);
+  status = add_one(&entry);
+  ASSERT_EQ(status.code(), Code::OK);
+
+  p4::Entity entity;
+  auto table_entry = entity.mutable_table_entry();
+  table_entry->set_table_id(t_id);
+  table_entry->mutable_match()->CopyFrom(entry.match());
+  {
+    EXPECT_CALL(*mock, table_entries_fetch(t_id, _));
+    p4::ReadResponse response;
+    status = mgr.read_one(entity, &response);
+    ASSERT_EQ(status.code(), Code::OK);
+    const auto &entities = response.entities();
+    ASSERT_EQ(1, entities.size());
+    ASSERT_TRUE(
+        MessageDifferencer::Equals(entry, entities.Get(0).table_entry()));
+  }
+
+  EXPECT_CALL(*mock, table_entry_delete_wkey(t_id, mk_matcher));
+  status = remove(&entry);
+  ASSERT_EQ(status.code(), Code::OK);
+  // the entry is not in the TableInfoStore anymore, so the target is not
+  // queried
+  {
+    EXPECT_CALL(*mock, table_entries_fetch(t_id, _)).Times(0);
+    p4::ReadResponse response;
+    status = mgr.read_one(entity, &response);
+    ASSERT_EQ(status.code(), Code::OK);
+    ASSERT_EQ(0, response.entities().size());
+  }
+}
+
 TEST_P(MatchTableTest, AddAndDelete) {
   std::string adata(6, '\x00');
   auto mk_input = std::get<1>(GetParam());
@@ -452,6 +526,124 @@ TEST_P(MatchTableTest, AddAndModify) {
   EXPECT_EQ(status.code(), Code::OK);
 }
 
+// pushes a new P4Info with non-empty device data, so that the device is updated
+// and not re-assigned
+DeviceMgr::Status
+MatchTableTest::update_pipeline(const p4::config::P4Info &p4info_new) {
+  p4::tmp::P4DeviceConfig p4_device_config;
+  p4_device_config.set_device_data("data");
+  p4::ForwardingPipelineConfig config;
+  *config.mutable_p4info() = p4info_new;
+  config.set_p4_device_config(p4_device_config.SerializeAsString());
+  return mgr.pipeline_config_set(
+      p4::SetForwardingPipelineConfigRequest_Action_VERIFY_AND_COMMIT, config);
+}
+
+// the table state is carried over when the target preserves it and the P4Info
+// does not change the table, even if other tables are added, removed or changed
+TEST_P(MatchTableTest, PipelineUpdatePreservesState) {
+  mock->set_preserves_state(true);
+  std::string adata(6, '\x00');
+  auto mk_input = std::get<1>(GetParam());
+  auto mk_matcher = Truly(MatchKeyMatcher(t_id, mk_input.get_match_key()));
+  auto entry_matcher = Truly(TableEntryMatcher_Direct(a_id, adata));
+  EXPECT_CALL(*mock, table_entry_add(t_id, mk_matcher, entry_matcher, _));
+  DeviceMgr::Status status;
+  auto entry = generic_make(t_id, mk_input.get_proto(mf_id), adata);
+  status = add_one(&entry);
+  ASSERT_EQ(status.code(), Code::OK);
+
+  auto p4info_new = p4info_proto;
+  auto *tables = p4info_new.mutable_tables();
+  uint32_t new_t_id = 0;
+  const p4::config::Table *t = nullptr;
+  for (const auto &table : *tables) {
+    new_t_id = std::max(new_t_id, table.preamble().id() + 1);
+    if (table.preamble().id() == t_id) t = &table;
+  }
+  ASSERT_NE(nullptr, t);
+  // add a copy of the table
+  auto new_table = *t;
+  new_table.mutable_preamble()->set_id(new_t_id);
+  new_table.mutable_preamble()->set_name("NewTable");
+  new_table.clear_direct_resource_ids();
+  *tables->Add() = new_table;
+  // change one table and remove another one, which no other object references
+  bool changed = false, removed = false;
+  for (auto it = tables->begin(); it != tables->end();) {
+    auto id = it->preamble().id();
+    if (id == t_id || id == new_t_id) {
+      ++it;
+    } else if (!changed) {
+      it->set_size(it->size() + 1);
+      changed = true;
+      ++it;
+    } else if (!removed && it->implementation_id() == 0 &&
+               it->direct_resource_ids().empty()) {
+      it = tables->erase(it);
+      removed = true;
+    } else {
+      ++it;
+    }
+  }
+  ASSERT_TRUE(changed && removed);
+  status = update_pipeline(p4info_new);
+  ASSERT_EQ(status.code(), Code::OK);
+
+  // modify requires the match key to be in the table state
+  EXPECT_CALL(*mock, table_entry_modify_wkey(t_id, mk_matcher, entry_matcher));
+  status = modify(&entry);
+  EXPECT_EQ(status.code(), Code::OK);
+
+  // the new table can be used
+  auto new_entry = generic_make(new_t_id, mk_input.get_proto(mf_id), adata);
+  EXPECT_CALL(*mock, table_entry_add(new_t_id, _, entry_matcher, _));
+  status = add_one(&new_entry);
+  EXPECT_EQ(status.code(), Code::OK);
+}
+
+// the table state is reset when the P4Info changes the table
+TEST_P(MatchTableTest, PipelineUpdateResetsChangedTable) {
+  mock->set_preserves_state(true);
+  std::string adata(6, '\x00');
+  auto mk_input = std::get<1>(GetParam());
+  EXPECT_CALL(*mock, table_entry_add(t_id, _, _, _));
+  DeviceMgr::Status status;
+  auto entry = generic_make(t_id, mk_input.get_proto(mf_id), adata);
+  status = add_one(&entry);
+  ASSERT_EQ(status.code(), Code::OK);
+
+  auto p4info_new = p4info_proto;
+  for (auto &table : *p4info_new.mutable_tables()) {
+    if (table.preamble().id() == t_id) table.set_size(table.size() + 1);
+  }
+  status = update_pipeline(p4info_new);
+  ASSERT_EQ(status.code(), Code::OK);
+
+  EXPECT_CALL(*mock, table_entry_modify_wkey(_, _, _)).Times(0);
+  status = modify(&entry);
+  EXPECT_EQ(status.code(), Code::INVALID_ARGUMENT);
+}
+
+// all the state is reset when the target does not preserve it (e.g. bmv2,
+// which swaps in a fresh switch instance), even if the P4Info is the same
+TEST_P(MatchTableTest, PipelineUpdateResetsState) {
+  std::string adata(6, '\x00');
+  auto mk_input = std::get<1>(GetParam());
+  EXPECT_CALL(*mock, table_entry_add(t_id, _, _, _));
+  DeviceMgr::Status status;
+  auto entry = generic_make(t_id, mk_input.get_proto(mf_id), adata);
+  status = add_one(&entry);
+  ASSERT_EQ(status.code(), Code::OK);
+
+  status = update_pipeline(p4info_proto);
+  ASSERT_EQ(status.code(), Code::OK);
+
+  EXPECT_CALL(*mock, table_entry_modify_wkey(_, _, _)).Times(0);
+  status = modify(&entry);
+  EXPECT_EQ(status.code(), Code::INVALID_ARGUMENT);
+}
+
 TEST_P(MatchTableTest, SetDefault) {
   std::string adata(6, '\x00');
   auto entry_matcher = Truly(TableEntryMatcher_Direct(a_id, adata));
@@ -1063,6 +1255,114 @@ TEST_F(MatchTableIndirectTest, Group) {
 }
 
 
+class ParallelWriteTest : public MatchTableIndirectTest {
+ protected:
+  ParallelWriteTest() {
+    t_id = pi_p4info_table_id_from_name(p4info, "ExactOne");
+    indirect_t_id = pi_p4info_table_id_from_name(p4info, "IndirectWS");
+  }
+
+  void SetUp() override {
+    MatchTableIndirectTest::SetUp();
+    mgr.set_write_parallelism(4);
+  }
+
+  p4::TableEntry make_entry(const std::string &mf_v) {
+    p4::TableEntry table_entry;
+    table_entry.set_table_id(t_id);
+    auto mf = table_entry.add_match();
+    mf->set_field_id(pi_p4info_table_match_field_id_from_name(
+        p4info, t_id, "header_test.field32"));
+    mf->mutable_exact()->set_value(mf_v);
+    set_action(table_entry.mutable_action()->mutable_action(),
+               std::string(6, '\x00'));
+    return table_entry;
+  }
+
+  static void add_insert(p4::WriteRequest *request,
+                         const p4::TableEntry &entry) {
+    auto update = request->add_updates();
+    update->set_type(p4::Update_Type_INSERT);
+    update->mutable_entity()->mutable_table_entry()->CopyFrom(entry);
+  }
+
+  size_t num_entries(pi_p4_id_t table_id) {
+    p4::ReadResponse response;
+    p4::Entity entity;
+    entity.mutable_table_entry()->set_table_id(table_id);
+    auto status = mgr.read_one(entity, &response);
+    EXPECT_EQ(status.code(), Code::OK);
+    return response.entities().size();
+  }
+
+  static std::string mf_from_int(uint32_t v) {
+    std::string mf(4, '\x00');
+    for (int i = 3; i >= 0; i--, v >>= 8) mf[i] = static_cast<char>(v & 0xff);
+    return mf;
+  }
+
+  pi_p4_id_t t_id;
+  pi_p4_id_t indirect_t_id;
+};
+
+// the indirect entry refers to a member created in the same request, which
+// requires the 2 updates to be executed in order
+TEST_F(ParallelWriteTest, DependentUpdates) {
+  auto act_prof_id = pi_p4info_act_prof_id_from_name(p4info, "ActProfWS");
+  uint32_t member_id = 123;
+  const size_t num_direct_entries = 64;
+  p4::WriteRequest request;
+  for (size_t i = 0; i < num_direct_entries / 2; i++)
+    add_insert(&request, make_entry(mf_from_int(i)));
+  {
+    auto update = request.add_updates();
+    update->set_type(p4::Update_Type_INSERT);
+    update->mutable_entity()->mutable_action_profile_member()->CopyFrom(
+        make_member(member_id, std::string(6, '\x00')));
+  }
+  add_insert(&request, make_indirect_entry_to_member(mf_from_int(0),
+                                                     member_id));
+  for (size_t i = num_direct_entries / 2; i < num_direct_entries; i++)
+    add_insert(&request, make_entry(mf_from_int(i)));
+
+  EXPECT_CALL(*mock, action_prof_member_create(act_prof_id, _, _));
+  EXPECT_CALL(*mock, table_entry_add(t_id, _, _, _))
+      .Times(num_direct_entries);
+  EXPECT_CALL(*mock, table_entry_add(indirect_t_id, _, _, _));
+  auto status = mgr.write(request);
+  ASSERT_EQ(status.code(), Code::OK);
+
+  EXPECT_CALL(*mock, table_entries_fetch(t_id, _));
+  EXPECT_EQ(num_direct_entries, num_entries(t_id));
+  EXPECT_CALL(*mock, table_entries_fetch(indirect_t_id, _));
+  EXPECT_EQ(1u, num_entries(indirect_t_id));
+}
+
+// the returned status is the one of the first failed update in the request,
+// even if an update for another table failed first
+TEST_F(ParallelWriteTest, FirstError) {
+  auto entry_1 = make_entry(mf_from_int(1));
+  auto entry_2 = make_entry(mf_from_int(2));
+  p4::WriteRequest request;
+  add_insert(&request, entry_1);
+  // invalid member id
+  add_insert(&request, make_indirect_entry_to_member(mf_from_int(0), 999));
+  add_insert(&request, entry_2);
+  // duplicate entry
+  add_insert(&request, entry_1);
+
+  EXPECT_CALL(*mock, table_entry_add(t_id, _, _, _)).Times(3);
+  EXPECT_CALL(*mock, table_entry_add(indirect_t_id, _, _, _)).Times(0);
+  auto status = mgr.write(request);
+  EXPECT_EQ(status.code(), Code::INVALID_ARGUMENT);
+  EXPECT_EQ(status.message(), "Invalid member / group id");
+
+  // the updates to the other table are still executed
+  EXPECT_CALL(*mock, table_entries_fetch(t_id, _));
+  EXPECT_EQ(2u, num_entries(t_id));
+}
+
+
 class ExactOneTest : public DeviceMgrTest {
  protected:
   ExactOneTest(const std::string &t_name, const std::string &f_name)
@@ -1097,6 +1397,165 @@ class ExactOneTest : public DeviceMgrTest {
 };
 
 
+class StreamingReadTest : public ExactOneTest {
+ protected:
+  StreamingReadTest()
+      : ExactOneTest("ExactOne", "header_test.field32") { }
+
+  void add_entries(size_t num_entries) {
+    EXPECT_CALL(*mock, table_entry_add(t_id, _, _, _)).Times(num_entries);
+    for (size_t i = 0; i < num_entries; i++) {
+      std::string mf(4, '\x00');
+      mf[3] = static_cast<char>(i);
+      auto entry = make_entry(mf, std::string(6, '\x00'));
+      ASSERT_EQ(add_entry(&entry).code(), Code::OK);
+    }
+  }
+
+  p4::ReadRequest make_request() const {
+    p4::ReadRequest request;
+    request.add_entities()->mutable_table_entry()->set_table_id(t_id);
+    return request;
+  }
+
+  // returns the number of entities in each chunk
+  std::vector<int> read_chunks(size_t max_entities, size_t max_bytes) {
+    std::vector<int> chunks;
+    auto sink = [&chunks](const p4::ReadResponse &response) {
+      chunks.push_back(response.entities_size());
+      return true;
+    };
+    EXPECT_CALL(*mock, table_entries_fetch(t_id, _));
+    auto status = mgr.read(make_request(), sink, max_entities, max_bytes);
+    EXPECT_EQ(status.code(), Code::OK);
+    return chunks;
+  }
+};
+
+TEST_F(StreamingReadTest, MaxEntities) {
+  add_entries(10);
+  EXPECT_EQ(std::vector<int>({4, 4, 2}), read_chunks(4, 0));
+}
+
+TEST_F(StreamingReadTest, MaxBytes) {
+  add_entries(10);
+  p4::ReadResponse response;
+  EXPECT_CALL(*mock, table_entries_fetch(t_id, _));
+  ASSERT_EQ(mgr.read(make_request(), &response).code(), Code::OK);
+  ASSERT_EQ(10, response.entities_size());
+  // all entities have the same size
+  auto entity_size = response.entities(0).ByteSizeLong();
+  EXPECT_EQ(std::vector<int>({3, 3, 3, 1}), read_chunks(0, 3 * entity_size));
+  EXPECT_EQ(std::vector<int>({4, 4, 2}),
+            read_chunks(0, 3 * entity_size + 1));
+}
+
+TEST_F(StreamingReadTest, NoLimit) {
+  add_entries(10);
+  EXPECT_EQ(std::vector<int>({10}), read_chunks(0, 0));
+}
+
+TEST_F(StreamingReadTest, Empty) {
+  EXPECT_EQ(std::vector<int>({0}), read_chunks(4, 0));
+}
+
+TEST_F(StreamingReadTest, Abort) {
+  add_entries(10);
+  int num_calls = 0;
+  auto sink = [&num_calls](const p4::ReadResponse &) {
+    num_calls++;
+    return false;
+  };
+  EXPECT_CALL(*mock, table_entries_fetch(t_id, _));
+  auto status = mgr.read(make_request(), sink, 4, 0);
+  EXPECT_EQ(status.code(), Code::CANCELLED);
+  EXPECT_EQ(1, num_calls);
+}
+
+// Exercises the TableInfoStore hash table (growth, shrinking, deletions) with
+// enough entries to trigger several resizes.
+class ManyEntriesTest : public ExactOneTest {
+ protected:
+  ManyEntriesTest()
+      : ExactOneTest("ExactOne", "header_test.field32") { }
+
+  static std::string make_mf(uint32_t i) {
+    std::string mf(4, '\x00');
+    for (size_t j = 0; j < 4; j++) mf[3 - j] = static_cast<char>(i >> (8 * j));
+    return mf;
+  }
+
+  p4::TableEntry make_entry(uint32_t i) {
+    auto entry = ExactOneTest::make_entry(make_mf(i), std::string(6, '\x00'));
+    entry.set_controller_metadata(i);
+    return entry;
+  }
+
+  DeviceMgr::Status write(p4::Update_Type type, p4::TableEntry *entry) {
+    p4::WriteRequest request;
+    auto update = request.add_updates();
+    update->set_type(type);
+    auto entity = update->mutable_entity();
+    entity->set_allocated_table_entry(entry);
+    auto status = mgr.write(request);
+    entity->release_table_entry();
+    return status;
+  }
+
+  p4::ReadResponse read(const p4::TableEntry &table_entry) {
+    p4::Entity entity;
+    entity.mutable_table_entry()->CopyFrom(table_entry);
+    p4::ReadResponse response;
+    EXPECT_EQ(mgr.read_one(entity, &response).code(), Code::OK);
+    return response;
+  }
+
+  static constexpr uint32_t num_entries = 1000;
+};
+
+constexpr uint32_t ManyEntriesTest::num_entries;
+
+TEST_F(ManyEntriesTest, AddRemoveAndRead) {
+  EXPECT_CALL(*mock, table_entry_add(t_id, _, _, _)).Times(num_entries);
+  for (uint32_t i = 0; i < num_entries; i++) {
+    auto entry = make_entry(i);
+    ASSERT_EQ(write(p4::Update_Type_INSERT, &entry).code(), Code::OK);
+  }
+  // only keep one entry out of 10, which causes the hash table to shrink
+  EXPECT_CALL(*mock, table_entry_delete_wkey(t_id, _))
+      .Times(num_entries - num_entries / 10);
+  for (uint32_t i = 0; i < num_entries; i++) {
+    if (i % 10 == 0) continue;
+    auto entry = make_entry(i);
+    ASSERT_EQ(write(p4::Update_Type_DELETE, &entry).code(), Code::OK);
+  }
+
+  EXPECT_CALL(*mock, table_entries_fetch(t_id, _));
+  p4::TableEntry wildcard;
+  wildcard.set_table_id(t_id);
+  auto response = read(wildcard);
+  ASSERT_EQ(num_entries / 10, response.entities_size());
+  for (const auto &entity : response.entities()) {
+    const auto &table_entry = entity.table_entry();
+    auto expected = make_entry(table_entry.controller_metadata());
+    EXPECT_TRUE(MessageDifferencer::Equals(expected, table_entry));
+  }
+
+  // removed entries are not found, remaining entries are
+  EXPECT_CALL(*mock, table_entries_fetch(t_id, _)).Times(num_entries / 10);
+  for (uint32_t i = 0; i < num_entries; i++) {
+    auto entry = make_entry(i);
+    entry.clear_action();
+    entry.clear_controller_metadata();
+    EXPECT_EQ((i % 10 == 0) ? 1 : 0, read(entry).entities_size());
+  }
+
+  // removed entries can be added again
+  EXPECT_CALL(*mock, table_entry_add(t_id, _, _, _)).Times(1);
+  auto entry = make_entry(1);
+  EXPECT_EQ(write(p4::Update_Type_INSERT, &entry).code(), Code::OK);
+}
+
 class DirectMeterTest : public ExactOneTest {
  protected:
   DirectMeterTest()
@@ -1232,6 +1691,86 @@ TEST_F(DirectMeterTest, InvalidMeterId) {
 
 // Only testing for exact match tables for now, there is not much code variation
 // between different table types.
+class DirectCounterTest : public ExactOneTest {
+ protected:
+  DirectCounterTest()
+      : ExactOneTest("ExactOne", "header_test.field32") {
+    c_id = pi_p4info_counter_id_from_name(p4info, "ExactOne_counter");
+  }
+
+  DeviceMgr::Status read_counter(p4::DirectCounterEntry *direct_counter_entry,
+                                 p4::ReadResponse *response) {
+    p4::Entity entity;
+    entity.set_allocated_direct_counter_entry(direct_counter_entry);
+    auto status = mgr.read_one(entity, response);
+    entity.release_direct_counter_entry();
+    return status;
+  }
+
+  pi_p4_id_t c_id;
+};
+
+TEST_F(DirectCounterTest, ReadOne) {
+  std::string mf("\xaa\xbb\xcc\xdd", 4);
+  std::string adata(6, '\x00');
+  auto entry = make_entry(mf, adata);
+  EXPECT_CALL(*mock, table_entry_add(t_id, _, _, _));
+  {
+    auto status = add_entry(&entry);
+    ASSERT_EQ(status.code(), Code::OK);
+  }
+  auto entry_h = mock->get_table_entry_handle();
+
+  EXPECT_CALL(*mock, table_entries_fetch(t_id, _)).Times(0);
+  EXPECT_CALL(*mock, counter_read_direct(c_id, entry_h, _));
+  p4::DirectCounterEntry counter_entry;
+  counter_entry.set_counter_id(c_id);
+  counter_entry.mutable_table_entry()->CopyFrom(entry);
+  p4::ReadResponse response;
+  auto status = read_counter(&counter_entry, &response);
+  ASSERT_EQ(status.code(), Code::OK);
+  const auto &entities = response.entities();
+  ASSERT_EQ(1, entities.size());
+  const auto &read_entry = entities.Get(0).direct_counter_entry();
+  EXPECT_EQ(c_id, read_entry.counter_id());
+  EXPECT_TRUE(MessageDifferencer::Equals(entry, read_entry.table_entry()));
+  EXPECT_EQ(0, read_entry.data().packet_count());
+}
+
+TEST_F(DirectCounterTest, ReadAll) {
+  std::string adata(6, '\x00');
+  std::string mf_1("\xaa\xbb\xcc\xdd", 4);
+  std::string mf_2("\xaa\xbb\xcc\xee", 4);
+  auto entry_1 = make_entry(mf_1, adata);
+  auto entry_2 = make_entry(mf_2, adata);
+  EXPECT_CALL(*mock, table_entry_add(t_id, _, _, _)).Times(2);
+  {
+    auto status = add_entry(&entry_1);
+    ASSERT_EQ(status.code(), Code::OK);
+    status = add_entry(&entry_2);
+    ASSERT_EQ(status.code(), Code::OK);
+  }
+
+  // a single fetch for the whole table; the mock does not return direct
+  // resources with the entries so the PI core reads them for each entry
+  EXPECT_CALL(*mock, table_entries_fetch(t_id, _));
+  EXPECT_CALL(*mock, counter_read_direct(c_id, _, _)).Times(2);
+  p4::DirectCounterEntry counter_entry;
+  counter_entry.set_counter_id(c_id);
+  p4::ReadResponse response;
+  auto status = read_counter(&counter_entry, &response);
+  ASSERT_EQ(status.code(), Code::OK);
+  const auto &entities = response.entities();
+  ASSERT_EQ(2, entities.size());
+  for (const auto &entity : entities) {
+    const auto &read_entry = entity.direct_counter_entry();
+    EXPECT_EQ(c_id, read_entry.counter_id());
+    EXPECT_EQ(t_id, read_entry.table_entry().table_id());
+    EXPECT_EQ(1, read_entry.table_entry().match().size());
+    EXPECT_EQ(0, read_entry.data().byte_count());
+  }
+}
+
 class MatchKeyFormatTest : public ExactOneTest {
  protected:
   MatchKeyFormatTest()
@@ -1319,6 +1858,18 @@ TEST_F(MatchKeyFormatTest, BadLeadingZeros) {
   ASSERT_EQ(status.code(), Code::INVALID_ARGUMENT);
 }
 
+TEST_F(MatchKeyFormatTest, BadMatchType) {
+  auto entry = make_entry_no_mk();
+  auto mf = entry.add_match();
+  mf->set_field_id(pi_p4info_table_match_field_id_from_name(
+      p4info, t_id, "header_test.field12"));
+  auto mf_ternary = mf->mutable_ternary();
+  mf_ternary->set_value(std::string("\x0a\xbb", 2));
+  mf_ternary->set_mask(std::string("\x0f\xff", 2));
+  auto status = add_entry(&entry);
+  ASSERT_EQ(status.code(), Code::INVALID_ARGUMENT);
+}
+
 class TernaryTwoTest : public DeviceMgrTest {
  protected:
   TernaryTwoTest() {
@@ -1390,6 +1941,18 @@ TEST_F(TernaryTwoTest, MissingMatchField) {
   ASSERT_EQ(status.code(), Code::OK);
 }
 
+// the number of fields matches the number of fields in the table, but one of
+// them is repeated
+TEST_F(TernaryTwoTest, DuplicateMatchField) {
+  const std::string mf_v("\xaa\xbb", 2);
+  const std::string mask_v("\xff\xff", 2);
+  const std::string param_v(6, '\x00');
+  auto entry = make_entry("", "", mf_v, mask_v, param_v);
+  entry.add_match()->CopyFrom(entry.match(0));
+  auto status = add_entry(&entry);
+  ASSERT_EQ(status.code(), Code::INVALID_ARGUMENT);
+}
+
 }  // namespace
 }  // namespace testing
 }  // namespace proto
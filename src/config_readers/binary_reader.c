@@ -0,0 +1,487 @@
+/* Copyright 2013-present Barefoot Networks, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Antonin Bas (antonin@barefootnetworks.com)
+ *
+ */
+
+#include "PI/int/pi_int.h"
+#include "PI/p4info.h"
+#include "PI/pi_base.h"
+#include "p4info/act_profs_int.h"
+#include "p4info/p4info_binary.h"
+#include "p4info/p4info_struct.h"
+#include "p4info/tables_int.h"
+#include "p4info_int.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Every offset, count, id and enum value in the blob is checked before use,
+// since the blob may come from disk or from the network. Records are read in
+// place, without any intermediate parsing step, and the p4info keeps the blob:
+// object names point directly into it (see p4info_storage_init).
+
+// upper bound on the bitwidth of match fields and action parameters, way above
+// anything found in practice; it keeps the size of match keys and action data
+// in check for a corrupted blob
+#define MAX_BITWIDTH (1u << 16)
+
+typedef struct {
+  const char *base;
+  const void *sections[PI_BIN_SECTION_MAX];
+  size_t counts[PI_BIN_SECTION_MAX];
+} reader_t;
+
+static const size_t record_sizes[PI_BIN_SECTION_MAX] = {
+    sizeof(pi_bin_action_t),   sizeof(pi_bin_param_t),
+    sizeof(pi_bin_table_t),    sizeof(pi_bin_match_field_t),
+    sizeof(pi_bin_act_prof_t), sizeof(pi_bin_counter_t),
+    sizeof(pi_bin_meter_t),    sizeof(uint32_t),
+    1};
+
+// offset of the id in the records of each object section, (size_t)-1 for the
+// other sections
+static const size_t id_offsets[PI_BIN_SECTION_MAX] = {
+    offsetof(pi_bin_action_t, id),   (size_t)-1,
+    offsetof(pi_bin_table_t, id),    (size_t)-1,
+    offsetof(pi_bin_act_prof_t, id), offsetof(pi_bin_counter_t, id),
+    offsetof(pi_bin_meter_t, id),    (size_t)-1,
+    (size_t)-1};
+
+static const pi_res_type_id_t section_types[PI_BIN_SECTION_MAX] = {
+    PI_ACTION_ID, 0, PI_TABLE_ID, 0, PI_ACT_PROF_ID, PI_COUNTER_ID, PI_METER_ID,
+    0,            0};
+
+static uint32_t get_id(const reader_t *reader, pi_bin_section_id_t id,
+                       size_t index) {
+  const char *record =
+      (const char *)reader->sections[id] + index * record_sizes[id];
+  uint32_t v;
+  memcpy(&v, record + id_offsets[id], sizeof(v));
+  return v;
+}
+
+// The writer emits objects in id order. Enforcing it guarantees that ids are
+// unique, so that each section yields exactly the number of objects the p4info
+// was initialized with, and lets us look up ids with a binary search.
+static bool check_ids(const reader_t *reader, pi_bin_section_id_t id) {
+  size_t count = reader->counts[id];
+  for (size_t i = 0; i < count; i++) {
+    uint32_t obj_id = get_id(reader, id, i);
+    if (PI_GET_TYPE_ID(obj_id) != section_types[id]) return false;
+    if (i > 0 && obj_id <= get_id(reader, id, i - 1)) return false;
+  }
+  return true;
+}
+
+// returns true if the blob defines an object with this id and of this type
+static bool has_object(const reader_t *reader, pi_res_type_id_t type,
+                       uint32_t obj_id) {
+  if (PI_GET_TYPE_ID(obj_id) != type) return false;
+  pi_bin_section_id_t id;
+  for (id = 0; id < PI_BIN_SECTION_MAX; id++) {
+    if (id_offsets[id] != (size_t)-1 && section_types[id] == type) break;
+  }
+  if (id == PI_BIN_SECTION_MAX) return false;
+  size_t lo = 0, hi = reader->counts[id];
+  while (lo < hi) {
+    size_t mid = lo + (hi - lo) / 2;
+    uint32_t mid_id = get_id(reader, id, mid);
+    if (mid_id == obj_id) return true;
+    if (mid_id < obj_id)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  return false;
+}
+
+static bool init_reader(reader_t *reader, const char *config) {
+  const pi_bin_header_t *header = (const pi_bin_header_t *)config;
+  size_t total_size = pi_config_binary_size(config);
+  if (total_size < sizeof(*header)) return false;
+  reader->base = config;
+  for (size_t i = 0; i < PI_BIN_SECTION_MAX; i++) {
+    const pi_bin_section_t *section = &header->sections[i];
+    uint64_t end =
+        (uint64_t)section->offset + (uint64_t)section->count * record_sizes[i];
+    if (section->offset % PI_BIN_ALIGN != 0 || end > total_size) return false;
+    reader->sections[i] = config + section->offset;
+    reader->counts[i] = section->count;
+  }
+  // guarantees that any offset in the string section yields a NULL-terminated
+  // string
+  size_t strings_size = reader->counts[PI_BIN_SECTION_STRINGS];
+  const char *strings = reader->sections[PI_BIN_SECTION_STRINGS];
+  if (strings_size > 0 && strings[strings_size - 1] != '\0') return false;
+  for (size_t i = 0; i < PI_BIN_SECTION_MAX; i++) {
+    if (id_offsets[i] != (size_t)-1 && !check_ids(reader, i)) return false;
+  }
+  return true;
+}
+
+static bool check_bitwidth(uint32_t bitwidth) {
+  return bitwidth > 0 && bitwidth <= MAX_BITWIDTH;
+}
+
+static int compare_ids(const void *a, const void *b) {
+  uint32_t id_a = *(const uint32_t *)a;
+  uint32_t id_b = *(const uint32_t *)b;
+  return (id_a > id_b) - (id_a < id_b);
+}
+
+// Match field ids (resp. parameter ids) index the match key (resp. action data)
+// layout, so they must be unique within a table (resp. action). Unlike objects,
+// they are not required to be sorted, so we sort a copy of them.
+static bool check_unique_ids(const void *records, size_t record_size,
+                             size_t id_offset, size_t count) {
+  if (count < 2) return true;
+  uint32_t *ids = malloc(count * sizeof(*ids));
+  if (!ids) return false;
+  for (size_t i = 0; i < count; i++) {
+    memcpy(&ids[i], (const char *)records + i * record_size + id_offset,
+           sizeof(*ids));
+  }
+  qsort(ids, count, sizeof(*ids), compare_ids);
+  bool unique = true;
+  for (size_t i = 1; i < count && unique; i++) unique = (ids[i] != ids[i - 1]);
+  free(ids);
+  return unique;
+}
+
+static const char *get_string(const reader_t *reader, uint32_t offset) {
+  if (offset >= reader->counts[PI_BIN_SECTION_STRINGS]) return NULL;
+  return (const char *)reader->sections[PI_BIN_SECTION_STRINGS] + offset;
+}
+
+static bool check_range(const reader_t *reader, pi_bin_section_id_t id,
+                        uint32_t first, uint32_t count) {
+  return (uint64_t)first + count <= reader->counts[id];
+}
+
+static const uint32_t *get_list(const reader_t *reader,
+                                const pi_bin_list_t *list) {
+  if (!check_range(reader, PI_BIN_SECTION_U32, list->first, list->count))
+    return NULL;
+  return (const uint32_t *)reader->sections[PI_BIN_SECTION_U32] + list->first;
+}
+
+static pi_status_t import_strings(const reader_t *reader,
+                                  const pi_bin_list_t *list,
+                                  pi_p4info_t *p4info, pi_p4_id_t id,
+                                  bool aliases) {
+  const uint32_t *offsets = get_list(reader, list);
+  if (!offsets) return PI_STATUS_CONFIG_READER_ERROR;
+  for (size_t i = 0; i < list->count; i++) {
+    const char *str = get_string(reader, offsets[i]);
+    if (!str) return PI_STATUS_CONFIG_READER_ERROR;
+    if (aliases)
+      pi_p4info_add_alias(p4info, id, str);
+    else
+      pi_p4info_add_annotation(p4info, id, str);
+  }
+  return PI_STATUS_SUCCESS;
+}
+
+static pi_status_t import_common(const reader_t *reader,
+                                 const pi_bin_common_t *common,
+                                 pi_p4info_t *p4info, pi_p4_id_t id) {
+  pi_status_t status;
+  status = import_strings(reader, &common->annotations, p4info, id, false);
+  if (status != PI_STATUS_SUCCESS) return status;
+  return import_strings(reader, &common->aliases, p4info, id, true);
+}
+
+static pi_status_t read_actions(const reader_t *reader, pi_p4info_t *p4info) {
+  const pi_bin_action_t *actions = reader->sections[PI_BIN_SECTION_ACTIONS];
+  const pi_bin_param_t *params = reader->sections[PI_BIN_SECTION_PARAMS];
+  size_t num_actions = reader->counts[PI_BIN_SECTION_ACTIONS];
+  pi_p4info_action_init(p4info, num_actions);
+
+  for (size_t i = 0; i < num_actions; i++) {
+    const pi_bin_action_t *action = &actions[i];
+    const char *name = get_string(reader, action->name);
+    if (!name) return PI_STATUS_CONFIG_READER_ERROR;
+    if (!check_range(reader, PI_BIN_SECTION_PARAMS, action->first_param,
+                     action->num_params))
+      return PI_STATUS_CONFIG_READER_ERROR;
+    if (!check_unique_ids(&params[action->first_param], sizeof(*params),
+                          offsetof(pi_bin_param_t, id), action->num_params))
+      return PI_STATUS_CONFIG_READER_ERROR;
+
+    pi_p4info_action_add(p4info, action->id, name, action->num_params);
+
+    for (size_t j = 0; j < action->num_params; j++) {
+      const pi_bin_param_t *param = &params[action->first_param + j];
+      const char *param_name = get_string(reader, param->name);
+      if (!param_name) return PI_STATUS_CONFIG_READER_ERROR;
+      if (!check_bitwidth(param->bitwidth))
+        return PI_STATUS_CONFIG_READER_ERROR;
+      pi_p4info_action_add_param(p4info, action->id, param->id, param_name,
+                                 param->bitwidth);
+    }
+
+    pi_status_t status =
+        import_common(reader, &action->common, p4info, action->id);
+    if (status != PI_STATUS_SUCCESS) return status;
+  }
+
+  return PI_STATUS_SUCCESS;
+}
+
+static bool check_table_refs(const reader_t *reader,
+                             const pi_bin_table_t *table,
+                             const uint32_t *actions,
+                             const uint32_t *direct_resources) {
+  bool const_default_action_found = false;
+  for (size_t j = 0; j < table->actions.count; j++) {
+    if (!has_object(reader, PI_ACTION_ID, actions[j])) return false;
+    if (actions[j] == table->const_default_action_id)
+      const_default_action_found = true;
+  }
+  if (table->const_default_action_id != PI_INVALID_ID &&
+      !const_default_action_found)
+    return false;
+  if (table->implementation != PI_INVALID_ID &&
+      !has_object(reader, PI_ACT_PROF_ID, table->implementation))
+    return false;
+  if (table->direct_resources.count > PI_P4INFO_TABLE_MAX_DIRECT_RESOURCES)
+    return false;
+  for (size_t j = 0; j < table->direct_resources.count; j++) {
+    if (!has_object(reader, PI_COUNTER_ID, direct_resources[j]) &&
+        !has_object(reader, PI_METER_ID, direct_resources[j]))
+      return false;
+  }
+  return true;
+}
+
+static pi_status_t read_tables(const reader_t *reader, pi_p4info_t *p4info) {
+  const pi_bin_table_t *tables = reader->sections[PI_BIN_SECTION_TABLES];
+  const pi_bin_match_field_t *match_fields =
+      reader->sections[PI_BIN_SECTION_MATCH_FIELDS];
+  size_t num_tables = reader->counts[PI_BIN_SECTION_TABLES];
+  pi_p4info_table_init(p4info, num_tables);
+
+  for (size_t i = 0; i < num_tables; i++) {
+    const pi_bin_table_t *table = &tables[i];
+    const char *name = get_string(reader, table->name);
+    if (!name) return PI_STATUS_CONFIG_READER_ERROR;
+    if (!check_range(reader, PI_BIN_SECTION_MATCH_FIELDS,
+                     table->first_match_field, table->num_match_fields))
+      return PI_STATUS_CONFIG_READER_ERROR;
+    if (!check_unique_ids(&match_fields[table->first_match_field],
+                          sizeof(*match_fields),
+                          offsetof(pi_bin_match_field_t, id),
+                          table->num_match_fields))
+      return PI_STATUS_CONFIG_READER_ERROR;
+    const uint32_t *actions = get_list(reader, &table->actions);
+    if (!actions) return PI_STATUS_CONFIG_READER_ERROR;
+    const uint32_t *direct_resources =
+        get_list(reader, &table->direct_resources);
+    if (!direct_resources) return PI_STATUS_CONFIG_READER_ERROR;
+    if (!check_table_refs(reader, table, actions, direct_resources))
+      return PI_STATUS_CONFIG_READER_ERROR;
+
+    pi_p4info_table_add(p4info, table->id, name, table->num_match_fields,
+                        table->actions.count, table->max_size);
+
+    pi_status_t status =
+        import_common(reader, &table->common, p4info, table->id);
+    if (status != PI_STATUS_SUCCESS) return status;
+
+    for (size_t j = 0; j < table->num_match_fields; j++) {
+      const pi_bin_match_field_t *mf =
+          &match_fields[table->first_match_field + j];
+      const char *fname = get_string(reader, mf->name);
+      if (!fname) return PI_STATUS_CONFIG_READER_ERROR;
+      if (mf->match_type >= PI_P4INFO_MATCH_TYPE_END ||
+          !check_bitwidth(mf->bitwidth))
+        return PI_STATUS_CONFIG_READER_ERROR;
+      pi_p4info_table_add_match_field(p4info, table->id, mf->id, fname,
+                                      mf->match_type, mf->bitwidth);
+    }
+
+    for (size_t j = 0; j < table->actions.count; j++)
+      pi_p4info_table_add_action(p4info, table->id, actions[j]);
+
+    if (table->const_default_action_id != PI_INVALID_ID) {
+      pi_p4info_table_set_const_default_action(
+          p4info, table->id, table->const_default_action_id,
+          table->has_mutable_action_params != 0);
+    }
+
+    if (table->implementation != PI_INVALID_ID)
+      pi_p4info_table_set_implementation(p4info, table->id,
+                                         table->implementation);
+
+    for (size_t j = 0; j < table->direct_resources.count; j++)
+      pi_p4info_table_add_direct_resource(p4info, table->id,
+                                          direct_resources[j]);
+  }
+
+  return PI_STATUS_SUCCESS;
+}
+
+static pi_status_t read_act_profs(const reader_t *reader,
+                                  pi_p4info_t *p4info) {
+  const pi_bin_act_prof_t *act_profs =
+      reader->sections[PI_BIN_SECTION_ACT_PROFS];
+  size_t num_act_profs = reader->counts[PI_BIN_SECTION_ACT_PROFS];
+  pi_p4info_act_prof_init(p4info, num_act_profs);
+
+  for (size_t i = 0; i < num_act_profs; i++) {
+    const pi_bin_act_prof_t *act_prof = &act_profs[i];
+    const char *name = get_string(reader, act_prof->name);
+    if (!name) return PI_STATUS_CONFIG_READER_ERROR;
+    const uint32_t *tables = get_list(reader, &act_prof->tables);
+    if (!tables) return PI_STATUS_CONFIG_READER_ERROR;
+    if (act_prof->tables.count > PI_P4INFO_ACT_PROF_MAX_TABLES)
+      return PI_STATUS_CONFIG_READER_ERROR;
+    for (size_t j = 0; j < act_prof->tables.count; j++) {
+      if (!has_object(reader, PI_TABLE_ID, tables[j]))
+        return PI_STATUS_CONFIG_READER_ERROR;
+    }
+
+    pi_p4info_act_prof_add(p4info, act_prof->id, name,
+                           act_prof->with_selector != 0, act_prof->max_size);
+
+    pi_status_t status =
+        import_common(reader, &act_prof->common, p4info, act_prof->id);
+    if (status != PI_STATUS_SUCCESS) return status;
+
+    for (size_t j = 0; j < act_prof->tables.count; j++)
+      pi_p4info_act_prof_add_table(p4info, act_prof->id, tables[j]);
+  }
+
+  return PI_STATUS_SUCCESS;
+}
+
+static pi_status_t read_counters(const reader_t *reader, pi_p4info_t *p4info) {
+  const pi_bin_counter_t *counters = reader->sections[PI_BIN_SECTION_COUNTERS];
+  size_t num_counters = reader->counts[PI_BIN_SECTION_COUNTERS];
+  pi_p4info_counter_init(p4info, num_counters);
+
+  for (size_t i = 0; i < num_counters; i++) {
+    const pi_bin_counter_t *counter = &counters[i];
+    const char *name = get_string(reader, counter->name);
+    if (!name) return PI_STATUS_CONFIG_READER_ERROR;
+
+    if (counter->width == 0 || counter->width > PI_P4INFO_COUNTER_MAX_WIDTH)
+      return PI_STATUS_CONFIG_READER_ERROR;
+    if (counter->counter_unit > PI_P4INFO_COUNTER_UNIT_BOTH)
+      return PI_STATUS_CONFIG_READER_ERROR;
+    if (counter->direct_table != PI_INVALID_ID &&
+        !has_object(reader, PI_TABLE_ID, counter->direct_table))
+      return PI_STATUS_CONFIG_READER_ERROR;
+
+    pi_p4info_counter_add(p4info, counter->id, name, counter->counter_unit,
+                          counter->size);
+    pi_p4info_counter_set_width(p4info, counter->id, counter->width);
+
+    pi_status_t status =
+        import_common(reader, &counter->common, p4info, counter->id);
+    if (status != PI_STATUS_SUCCESS) return status;
+
+    if (counter->direct_table != PI_INVALID_ID)
+      pi_p4info_counter_make_direct(p4info, counter->id, counter->direct_table);
+  }
+
+  return PI_STATUS_SUCCESS;
+}
+
+static pi_status_t read_meters(const reader_t *reader, pi_p4info_t *p4info) {
+  const pi_bin_meter_t *meters = reader->sections[PI_BIN_SECTION_METERS];
+  size_t num_meters = reader->counts[PI_BIN_SECTION_METERS];
+  pi_p4info_meter_init(p4info, num_meters);
+
+  for (size_t i = 0; i < num_meters; i++) {
+    const pi_bin_meter_t *meter = &meters[i];
+    const char *name = get_string(reader, meter->name);
+    if (!name) return PI_STATUS_CONFIG_READER_ERROR;
+    if (meter->meter_unit != PI_P4INFO_METER_UNIT_PACKETS &&
+        meter->meter_unit != PI_P4INFO_METER_UNIT_BYTES)
+      return PI_STATUS_CONFIG_READER_ERROR;
+    if (meter->meter_type != PI_P4INFO_METER_TYPE_COLOR_AWARE &&
+        meter->meter_type != PI_P4INFO_METER_TYPE_COLOR_UNAWARE)
+      return PI_STATUS_CONFIG_READER_ERROR;
+    if (meter->direct_table != PI_INVALID_ID &&
+        !has_object(reader, PI_TABLE_ID, meter->direct_table))
+      return PI_STATUS_CONFIG_READER_ERROR;
+
+    pi_p4info_meter_add(p4info, meter->id, name, meter->meter_unit,
+                        meter->meter_type, meter->size);
+
+    pi_status_t status =
+        import_common(reader, &meter->common, p4info, meter->id);
+    if (status != PI_STATUS_SUCCESS) return status;
+
+    if (meter->direct_table != PI_INVALID_ID)
+      pi_p4info_meter_make_direct(p4info, meter->id, meter->direct_table);
+  }
+
+  return PI_STATUS_SUCCESS;
+}
+
+static pi_status_t read_all(const reader_t *reader, pi_p4info_t *p4info) {
+  pi_status_t status;
+
+  if ((status = read_actions(reader, p4info)) != PI_STATUS_SUCCESS) {
+    return status;
+  }
+
+  if ((status = read_tables(reader, p4info)) != PI_STATUS_SUCCESS) {
+    return status;
+  }
+
+  if ((status = read_act_profs(reader, p4info)) != PI_STATUS_SUCCESS) {
+    return status;
+  }
+
+  if ((status = read_counters(reader, p4info)) != PI_STATUS_SUCCESS) {
+    return status;
+  }
+
+  return read_meters(reader, p4info);
+}
+
+pi_status_t pi_binary_reader_owned(char *config, size_t size, bool mapped,
+                                   pi_p4info_t *p4info) {
+  // from now on the blob is released with the p4info
+  p4info_storage_init(p4info, config, size, mapped);
+  // the records are read in place, which requires the blob to be suitably
+  // aligned, as is always the case for malloc'd or mmap'd buffers
+  if ((uintptr_t)config % PI_BIN_ALIGN != 0 ||
+      pi_config_binary_size(config) != size)
+    return PI_STATUS_CONFIG_READER_ERROR;
+  reader_t reader;
+  if (!init_reader(&reader, config)) return PI_STATUS_CONFIG_READER_ERROR;
+  return read_all(&reader, p4info);
+}
+
+pi_status_t pi_binary_reader(const char *config, pi_p4info_t *p4info) {
+  // the p4info keeps its own copy of the blob (a single allocation), as the
+  // caller's buffer may be released or may not be aligned (e.g. when the blob
+  // is embedded in a larger message)
+  size_t size = pi_config_binary_size(config);
+  if (size == 0) return PI_STATUS_CONFIG_READER_ERROR;
+  char *copy = malloc(size);
+  if (!copy) return PI_STATUS_ALLOC_ERROR;
+  memcpy(copy, config, size);
+  return pi_binary_reader_owned(copy, size, false, p4info);
+}
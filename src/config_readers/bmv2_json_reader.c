@@ -29,6 +29,7 @@
 
 #include <assert.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 #define MAX_IDS_IN_ANNOTATION 16
@@ -63,29 +64,28 @@ static void destroy_reader_state(reader_state_t *state) {
   (void)Rc_word;
 }
 
+static bool is_id_delim(char c) { return c == ' ' || c == '\t'; }
+
+// single pass over the string, without copying it
 static void parse_ids(const char *str, const char *name, pi_p4_id_t *ids,
                       size_t *num_ids) {
-  char *str_copy = strdup(str);
-  char *str_pos = str_copy;
-  char *saveptr;
-  const char *delim = " \t";
-  char *token = NULL;
   *num_ids = 0;
-  while ((token = strtok_r(str_pos, delim, &saveptr))) {
-    if (*num_ids > MAX_IDS_IN_ANNOTATION) {
+  while (true) {
+    while (is_id_delim(*str)) str++;
+    if (*str == '\0') break;
+    if (*num_ids >= MAX_IDS_IN_ANNOTATION) {
       PI_LOG_ERROR("Too many ids for object '%s'\n", name);
       exit(1);
     }
     char *endptr = NULL;
-    ids[*num_ids] = strtol(token, &endptr, 0);
+    ids[*num_ids] = strtol(str, &endptr, 0);
     (*num_ids)++;
-    if (*endptr != '\0') {
+    if (endptr == str || (*endptr != '\0' && !is_id_delim(*endptr))) {
       PI_LOG_ERROR("Invalid 'id' annotation for object '%s'\n", name);
       exit(1);
     }
-    str_pos = NULL;
+    str = endptr;
   }
-  free(str_copy);
 }
 
 // iterates over annotations looking for the right one ("id"); if does not
@@ -95,11 +95,11 @@ static void find_annotation_id(cJSON *object, pi_p4_id_t *ids,
   *num_ids = 0;
   cJSON *pragmas = cJSON_GetObjectItem(object, "pragmas");
   if (!pragmas) return;
-  const cJSON *item = cJSON_GetObjectItem(object, "name");
-  const char *name = item->valuestring;
   cJSON *pragma;
   cJSON_ArrayForEach(pragma, pragmas) {
     if (!strncmp(pragma->valuestring, "id ", 3)) {
+      const cJSON *item = cJSON_GetObjectItem(object, "name");
+      const char *name = item->valuestring;
       const char *id_str = strchr(pragma->valuestring, ' ');
       parse_ids(id_str, name, ids, num_ids);
       return;
@@ -223,35 +223,54 @@ static void import_pragmas(cJSON *object, pi_p4info_t *p4info, pi_p4_id_t id) {
   }
 }
 
-// a simple bubble sort to sort objects in a list based on alphabetical order of
-// their name attribute
+typedef struct {
+  const char *name;
+  cJSON *object;
+  size_t index;  // original position, used to make the sort stable
+} named_object_t;
+
+static int cmp_named_objects(const void *e1, const void *e2) {
+  const named_object_t *object_1 = (const named_object_t *)e1;
+  const named_object_t *object_2 = (const named_object_t *)e2;
+  int rc = strcmp(object_1->name, object_2->name);
+  if (rc != 0) return rc;
+  return (object_1->index < object_2->index) ? -1 : 1;
+}
+
+// sorts objects based on alphabetical order of their name attribute; names are
+// looked-up only once per object, and not for every comparison
+static void sort_json_objects(cJSON **objects, size_t num_objects) {
+  if (num_objects < 2) return;
+  named_object_t *named_objects = malloc(num_objects * sizeof(*named_objects));
+  for (size_t i = 0; i < num_objects; i++) {
+    const cJSON *item = cJSON_GetObjectItem(objects[i], "name");
+    // missing names are reported by the caller when iterating over the objects
+    named_objects[i].name =
+        (item && item->valuestring) ? item->valuestring : "";
+    named_objects[i].object = objects[i];
+    named_objects[i].index = i;
+  }
+  qsort(named_objects, num_objects, sizeof(*named_objects), cmp_named_objects);
+  for (size_t i = 0; i < num_objects; i++) objects[i] = named_objects[i].object;
+  free(named_objects);
+}
+
+// sorts the objects in a cJSON array in place (by re-linking the list nodes)
 static void sort_json_array(cJSON *array) {
   assert(array->type == cJSON_Array);
-  int size = cJSON_GetArraySize(array);
-  const cJSON *item = NULL;
-  for (int i = size - 1; i > 0; i--) {
-    cJSON *object = array->child;
-    cJSON *next_object = NULL;
-    cJSON **prev_ptr = &(array->child);
-    while (object->next) {
-      next_object = object->next;
-      item = cJSON_GetObjectItem(object, "name");
-      const char *name = item->valuestring;
-      item = cJSON_GetObjectItem(next_object, "name");
-      const char *next_name = item->valuestring;
-
-      if (strcmp(name, next_name) > 0) {  // do swap
-        *prev_ptr = next_object;
-        next_object->prev = *prev_ptr;
-        object->prev = next_object;
-        object->next = next_object->next;
-        next_object->next = object;
-      }
-      prev_ptr = &(object->next);
-      object = next_object;
-    }
-    array->child->prev = NULL;
+  size_t size = cJSON_GetArraySize(array);
+  if (size < 2) return;
+  cJSON **objects = malloc(size * sizeof(*objects));
+  size_t i = 0;
+  cJSON *object;
+  cJSON_ArrayForEach(object, array) { objects[i++] = object; }
+  sort_json_objects(objects, size);
+  array->child = objects[0];
+  for (i = 0; i < size; i++) {
+    objects[i]->prev = (i == 0) ? NULL : objects[i - 1];
+    objects[i]->next = (i == size - 1) ? NULL : objects[i + 1];
   }
+  free(objects);
 }
 
 static pi_status_t read_actions(reader_state_t *state, cJSON *root,
@@ -409,15 +428,6 @@ static pi_p4info_match_type_t match_type_from_str(const char *type) {
   return PI_P4INFO_MATCH_TYPE_END;
 }
 
-static int cmp_json_object_generic(const void *e1, const void *e2) {
-  cJSON *object_1 = *(cJSON * const *)e1;
-  cJSON *object_2 = *(cJSON * const *)e2;
-  const cJSON *item_1, *item_2;
-  item_1 = cJSON_GetObjectItem(object_1, "name");
-  item_2 = cJSON_GetObjectItem(object_2, "name");
-  return strcmp(item_1->valuestring, item_2->valuestring);
-}
-
 // common code for action profiles and tables, returns NULL in case of incorrect
 // JSON input
 static vector_t *extract_from_pipelines(reader_state_t *state, cJSON *root,
@@ -427,7 +437,7 @@ static vector_t *extract_from_pipelines(reader_state_t *state, cJSON *root,
   if (!pipelines) return NULL;
 
   // cannot use sort_json_array as we have to sort them across multiple
-  // pipelines so instead we create a temporary vector which we sort with qsort
+  // pipelines so instead we create a temporary vector which we sort directly
   const size_t init_capacity = 16;
   vector_t *res_vec = vector_create(sizeof(cJSON *), init_capacity);
   cJSON *entry;
@@ -440,8 +450,7 @@ static vector_t *extract_from_pipelines(reader_state_t *state, cJSON *root,
       vector_push_back(res_vec, (void *)&entry);
     }
   }
-  qsort(vector_data(res_vec), vector_size(res_vec), sizeof(cJSON *),
-        cmp_json_object_generic);
+  sort_json_objects(vector_data(res_vec), vector_size(res_vec));
   return res_vec;
 }
 
@@ -602,6 +611,15 @@ static pi_status_t read_counters(reader_state_t *state, cJSON *root,
     pi_p4info_counter_add(p4info, pi_id, name, PI_P4INFO_COUNTER_UNIT_BOTH,
                           size);
 
+    // optional, bmv2 counters are always 64-bit but the JSON may be targeting
+    // hardware with narrower counters
+    item = cJSON_GetObjectItem(counter, "width");
+    if (item) {
+      if (item->valueint <= 0 || item->valueint > PI_P4INFO_COUNTER_MAX_WIDTH)
+        return PI_STATUS_CONFIG_READER_ERROR;
+      pi_p4info_counter_set_width(p4info, pi_id, item->valueint);
+    }
+
     if (is_direct) {
       item = cJSON_GetObjectItem(counter, "binding");
       if (!item) return PI_STATUS_CONFIG_READER_ERROR;
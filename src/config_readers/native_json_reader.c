@@ -249,6 +249,14 @@ static pi_status_t read_counters(cJSON *root, pi_p4info_t *p4info) {
 
     pi_p4info_counter_add(p4info, pi_id, name, counter_unit, size);
 
+    // optional, for configs serialized before it was introduced
+    item = cJSON_GetObjectItem(counter, "width");
+    if (item) {
+      if (item->valueint <= 0 || item->valueint > PI_P4INFO_COUNTER_MAX_WIDTH)
+        return PI_STATUS_CONFIG_READER_ERROR;
+      pi_p4info_counter_set_width(p4info, pi_id, item->valueint);
+    }
+
     import_common(counter, p4info, pi_id);
 
     if (direct_tid != PI_INVALID_ID)
@@ -23,8 +23,19 @@
 
 #include "PI/pi_base.h"
 
+#include <stdbool.h>
+#include <stddef.h>
+
 pi_status_t pi_bmv2_json_reader(const char *config, pi_p4info_t *p4info);
 
 pi_status_t pi_native_json_reader(const char *config, pi_p4info_t *p4info);
 
+pi_status_t pi_binary_reader(const char *config, pi_p4info_t *p4info);
+
+// Same as pi_binary_reader, but the p4info takes ownership of the blob (even in
+// case of error) instead of copying it. If mapped is true, the blob of size
+// bytes was obtained with mmap, otherwise with malloc.
+pi_status_t pi_binary_reader_owned(char *config, size_t size, bool mapped,
+                                   pi_p4info_t *p4info);
+
 #endif  // PI_SRC_CONFIG_READERS_READERS_H_
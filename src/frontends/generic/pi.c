@@ -45,6 +45,7 @@ typedef struct {
 typedef struct {
   int safeguard;
   pi_p4_id_t table_id;
+  const pi_p4info_match_key_layout_t *layout;
   uint32_t nset;
   size_t num_fields;
   _fegen_mbr_info_t f_info[1];
@@ -63,33 +64,24 @@ static size_t get_mk_prefix_space(size_t num_match_fields) {
 pi_status_t pi_match_key_allocate(const pi_p4info_t *p4info,
                                   const pi_p4_id_t table_id,
                                   pi_match_key_t **key) {
-  size_t s = 0;
-
-  size_t num_match_fields = pi_p4info_table_num_match_fields(p4info, table_id);
-
-  _fegen_mbr_info_t *offsets =
-      malloc(sizeof(_fegen_mbr_info_t) * num_match_fields);
-
-  for (size_t i = 0; i < num_match_fields; i++) {
-    offsets[i].is_set = 0;
-    offsets[i].offset = s;
-    const pi_p4info_match_field_info_t *finfo =
-        pi_p4info_table_match_field_info(p4info, table_id, i);
-    s += get_match_key_size_one_field(finfo->match_type, finfo->bitwidth);
-  }
-  size_t mk_size = s;
+  const pi_p4info_match_key_layout_t *layout =
+      pi_p4info_table_match_key_layout(p4info, table_id);
+  size_t num_match_fields = layout->num_fields;
+  size_t mk_size = layout->match_key_size;
 
   size_t prefix_space = get_mk_prefix_space(num_match_fields);
-  s += prefix_space;
-  s += sizeof(pi_match_key_t);
+  size_t s = mk_size + prefix_space + sizeof(pi_match_key_t);
   char *key_w_prefix = malloc(s);
   _fegen_mk_prefix_t *prefix = (_fegen_mk_prefix_t *)key_w_prefix;
   prefix->safeguard = SAFEGUARD;
   prefix->nset = 0;
   prefix->num_fields = num_match_fields;
   prefix->table_id = table_id;
-  memcpy(prefix->f_info, offsets, sizeof(prefix->f_info[0]) * num_match_fields);
-  free(offsets);
+  prefix->layout = layout;
+  for (size_t i = 0; i < num_match_fields; i++) {
+    prefix->f_info[i].is_set = 0;
+    prefix->f_info[i].offset = layout->fields[i].offset;
+  }
 
   *key = (pi_match_key_t *)(key_w_prefix + prefix_space);
   (*key)->p4info = p4info;
@@ -131,6 +123,25 @@ uint32_t pi_match_key_get_priority(pi_match_key_t *key) {
   return key->priority;
 }
 
+// equivalent to pi_getnetv_ptr, but without any p4info query
+static void get_fv_from_layout(pi_p4_id_t parent_id, pi_p4_id_t obj_id,
+                               size_t nbytes, const char *src, pi_netv_t *fv) {
+  fv->is_ptr = 1;
+  fv->parent_id = parent_id;
+  fv->obj_id = obj_id;
+  fv->size = nbytes;
+  fv->v.ptr = src;
+}
+
+static const pi_p4info_match_field_layout_t *get_mf_layout(
+    const pi_match_key_t *key, pi_p4_id_t fid) {
+  const pi_p4info_match_key_layout_t *layout =
+      pi_p4info_table_match_key_layout(key->p4info, key->table_id);
+  size_t f_index = pi_p4info_match_key_layout_index(layout, fid);
+  assert(f_index != (size_t)-1);
+  return &layout->fields[f_index];
+}
+
 static char *dump_fv(char *dst, const pi_netv_t *fv) {
   const char *src = fv->is_ptr ? fv->v.ptr : &fv->v.data[0];
   memcpy(dst, src, fv->size);
@@ -147,8 +158,7 @@ static void mk_update_fset(_fegen_mk_prefix_t *prefix, size_t index) {
 pi_status_t pi_match_key_exact_set(pi_match_key_t *key, const pi_netv_t *fv) {
   assert(key->table_id == fv->parent_id);
   _fegen_mk_prefix_t *prefix = get_mk_prefix(key);
-  size_t f_index = pi_p4info_table_match_field_index(
-      key->p4info, prefix->table_id, fv->obj_id);
+  size_t f_index = pi_p4info_match_key_layout_index(prefix->layout, fv->obj_id);
   _fegen_mbr_info_t *info = &prefix->f_info[f_index];
   char *dst = key->data + info->offset;
   dump_fv(dst, fv);
@@ -157,9 +167,8 @@ pi_status_t pi_match_key_exact_set(pi_match_key_t *key, const pi_netv_t *fv) {
 
 pi_status_t pi_match_key_exact_get(const pi_match_key_t *key, pi_p4_id_t fid,
                                    pi_netv_t *fv) {
-  size_t f_offset =
-      pi_p4info_table_match_field_offset(key->p4info, key->table_id, fid);
-  pi_getnetv_ptr(key->p4info, key->table_id, fid, key->data + f_offset, 0, fv);
+  const pi_p4info_match_field_layout_t *f = get_mf_layout(key, fid);
+  get_fv_from_layout(key->table_id, fid, f->nbytes, key->data + f->offset, fv);
   return PI_STATUS_SUCCESS;
 }
 
@@ -167,8 +176,7 @@ pi_status_t pi_match_key_lpm_set(pi_match_key_t *key, const pi_netv_t *fv,
                                  const pi_prefix_length_t prefix_length) {
   assert(key->table_id == fv->parent_id);
   _fegen_mk_prefix_t *prefix = get_mk_prefix(key);
-  size_t f_index = pi_p4info_table_match_field_index(
-      key->p4info, prefix->table_id, fv->obj_id);
+  size_t f_index = pi_p4info_match_key_layout_index(prefix->layout, fv->obj_id);
   _fegen_mbr_info_t *info = &prefix->f_info[f_index];
   char *dst = key->data + info->offset;
   dst = dump_fv(dst, fv);
@@ -180,10 +188,9 @@ pi_status_t pi_match_key_lpm_set(pi_match_key_t *key, const pi_netv_t *fv,
 pi_status_t pi_match_key_lpm_get(const pi_match_key_t *key, pi_p4_id_t fid,
                                  pi_netv_t *fv,
                                  pi_prefix_length_t *prefix_length) {
-  size_t f_offset =
-      pi_p4info_table_match_field_offset(key->p4info, key->table_id, fid);
-  const char *src = key->data + f_offset;
-  pi_getnetv_ptr(key->p4info, key->table_id, fid, src, 0, fv);
+  const pi_p4info_match_field_layout_t *f = get_mf_layout(key, fid);
+  const char *src = key->data + f->offset;
+  get_fv_from_layout(key->table_id, fid, f->nbytes, src, fv);
   src += fv->size;
   uint32_t pLen;
   retrieve_uint32(src, &pLen);
@@ -196,8 +203,7 @@ pi_status_t pi_match_key_ternary_set(pi_match_key_t *key, const pi_netv_t *fv,
   assert(key->table_id == fv->parent_id && key->table_id == mask->parent_id);
   assert(fv->obj_id == mask->obj_id);
   _fegen_mk_prefix_t *prefix = get_mk_prefix(key);
-  size_t f_index = pi_p4info_table_match_field_index(
-      key->p4info, prefix->table_id, fv->obj_id);
+  size_t f_index = pi_p4info_match_key_layout_index(prefix->layout, fv->obj_id);
   _fegen_mbr_info_t *info = &prefix->f_info[f_index];
   char *dst = key->data + info->offset;
   dst = dump_fv(dst, fv);
@@ -208,12 +214,11 @@ pi_status_t pi_match_key_ternary_set(pi_match_key_t *key, const pi_netv_t *fv,
 
 pi_status_t pi_match_key_ternary_get(const pi_match_key_t *key, pi_p4_id_t fid,
                                      pi_netv_t *fv, pi_netv_t *mask) {
-  size_t f_offset =
-      pi_p4info_table_match_field_offset(key->p4info, key->table_id, fid);
-  const char *src = key->data + f_offset;
-  pi_getnetv_ptr(key->p4info, key->table_id, fid, src, 0, fv);
+  const pi_p4info_match_field_layout_t *f = get_mf_layout(key, fid);
+  const char *src = key->data + f->offset;
+  get_fv_from_layout(key->table_id, fid, f->nbytes, src, fv);
   src += fv->size;
-  pi_getnetv_ptr(key->p4info, key->table_id, fid, src, 0, mask);
+  get_fv_from_layout(key->table_id, fid, f->nbytes, src, mask);
   return PI_STATUS_SUCCESS;
 }
 
@@ -222,8 +227,8 @@ pi_status_t pi_match_key_range_set(pi_match_key_t *key, const pi_netv_t *start,
   assert(key->table_id == start->parent_id && key->table_id == end->parent_id);
   assert(start->obj_id == end->obj_id);
   _fegen_mk_prefix_t *prefix = get_mk_prefix(key);
-  size_t f_index = pi_p4info_table_match_field_index(
-      key->p4info, prefix->table_id, start->obj_id);
+  size_t f_index =
+      pi_p4info_match_key_layout_index(prefix->layout, start->obj_id);
   _fegen_mbr_info_t *info = &prefix->f_info[f_index];
   char *dst = key->data + info->offset;
   dst = dump_fv(dst, start);
@@ -234,12 +239,11 @@ pi_status_t pi_match_key_range_set(pi_match_key_t *key, const pi_netv_t *start,
 
 pi_status_t pi_match_key_range_get(const pi_match_key_t *key, pi_p4_id_t fid,
                                    pi_netv_t *start, pi_netv_t *end) {
-  size_t f_offset =
-      pi_p4info_table_match_field_offset(key->p4info, key->table_id, fid);
-  const char *src = key->data + f_offset;
-  pi_getnetv_ptr(key->p4info, key->table_id, fid, src, 0, start);
+  const pi_p4info_match_field_layout_t *f = get_mf_layout(key, fid);
+  const char *src = key->data + f->offset;
+  get_fv_from_layout(key->table_id, fid, f->nbytes, src, start);
   src += start->size;
-  pi_getnetv_ptr(key->p4info, key->table_id, fid, src, 0, end);
+  get_fv_from_layout(key->table_id, fid, f->nbytes, src, end);
   return PI_STATUS_SUCCESS;
 }
 
@@ -255,6 +259,7 @@ pi_status_t pi_match_key_destroy(pi_match_key_t *key) {
 typedef struct {
   int safeguard;
   pi_p4_id_t action_id;
+  const pi_p4info_action_data_layout_t *layout;
   uint32_t nset;
   size_t num_params;
   _fegen_mbr_info_t p_info[1];
@@ -273,34 +278,24 @@ static size_t get_ad_prefix_space(size_t num_params) {
 pi_status_t pi_action_data_allocate(const pi_p4info_t *p4info,
                                     const pi_p4_id_t action_id,
                                     pi_action_data_t **adata) {
-  size_t s = 0;
-
-  size_t num_params;
-  const pi_p4_id_t *params =
-      pi_p4info_action_get_params(p4info, action_id, &num_params);
-
-  _fegen_mbr_info_t *offsets = malloc(sizeof(_fegen_mbr_info_t) * num_params);
-
-  for (size_t i = 0; i < num_params; i++) {
-    size_t bitwidth =
-        pi_p4info_action_param_bitwidth(p4info, action_id, params[i]);
-    offsets[i].is_set = 0;
-    offsets[i].offset = s;
-    s += (bitwidth + 7) / 8;
-  }
-  size_t ad_size = s;
+  const pi_p4info_action_data_layout_t *layout =
+      pi_p4info_action_data_layout(p4info, action_id);
+  size_t num_params = layout->num_params;
+  size_t ad_size = layout->action_data_size;
 
   size_t prefix_space = get_ad_prefix_space(num_params);
-  s += prefix_space;
-  s += sizeof(pi_action_data_t);
+  size_t s = ad_size + prefix_space + sizeof(pi_action_data_t);
   char *adata_w_prefix = malloc(s);
   _fegen_ad_prefix_t *prefix = (_fegen_ad_prefix_t *)adata_w_prefix;
   prefix->safeguard = SAFEGUARD;
   prefix->nset = 0;
   prefix->num_params = num_params;
   prefix->action_id = action_id;
-  memcpy(prefix->p_info, offsets, sizeof(prefix->p_info[0]) * num_params);
-  free(offsets);
+  prefix->layout = layout;
+  for (size_t i = 0; i < num_params; i++) {
+    prefix->p_info[i].is_set = 0;
+    prefix->p_info[i].offset = layout->params[i].offset;
+  }
 
   *adata = (pi_action_data_t *)(adata_w_prefix + prefix_space);
   (*adata)->p4info = p4info;
@@ -343,8 +338,7 @@ pi_status_t pi_action_data_arg_set(pi_action_data_t *adata,
 
   pi_p4_id_t param_id = argv->obj_id;
   assert(adata->action_id == argv->parent_id);
-  size_t index =
-      pi_p4info_action_param_index(adata->p4info, adata->action_id, param_id);
+  size_t index = pi_p4info_action_data_layout_index(prefix->layout, param_id);
 
   const char *src = argv->is_ptr ? argv->v.ptr : &argv->v.data[0];
   char *dst = adata->data + prefix->p_info[index].offset;
@@ -360,10 +354,13 @@ pi_status_t pi_action_data_arg_set(pi_action_data_t *adata,
 
 pi_status_t pi_action_data_arg_get(const pi_action_data_t *adata,
                                    pi_p4_id_t pid, pi_netv_t *argv) {
-  size_t offset =
-      pi_p4info_action_param_offset(adata->p4info, adata->action_id, pid);
-  const char *src = adata->data + offset;
-  pi_getnetv_ptr(adata->p4info, adata->action_id, pid, src, 0, argv);
+  const pi_p4info_action_data_layout_t *layout =
+      pi_p4info_action_data_layout(adata->p4info, adata->action_id);
+  size_t index = pi_p4info_action_data_layout_index(layout, pid);
+  assert(index != (size_t)-1);
+  const pi_p4info_action_param_layout_t *p = &layout->params[index];
+  get_fv_from_layout(adata->action_id, pid, p->nbytes, adata->data + p->offset,
+                     argv);
   return PI_STATUS_SUCCESS;
 }
 
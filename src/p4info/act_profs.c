@@ -29,15 +29,13 @@
 #include <stdlib.h>
 #include <string.h>
 
-#define MAX_TABLES 8
-
 typedef struct _act_prof_data_s {
   p4info_common_t common;
   char *name;
   pi_p4_id_t act_prof_id;
   size_t num_tables;
   // TODO(antonin): remove restriction on amount of table references?
-  pi_p4_id_t table_ids[MAX_TABLES];
+  pi_p4_id_t table_ids[PI_P4INFO_ACT_PROF_MAX_TABLES];
   bool with_selector;
   size_t max_size;
 } _act_prof_data_t;
@@ -56,7 +54,7 @@ static const char *retrieve_name(const void *data) {
 static void free_act_prof_data(void *data) {
   _act_prof_data_t *act_prof = (_act_prof_data_t *)data;
   if (!act_prof->name) return;
-  free(act_prof->name);
+  p4info_free(&act_prof->common, act_prof->name);
   p4info_common_destroy(&act_prof->common);
 }
 
@@ -98,7 +96,7 @@ void pi_p4info_act_prof_add(pi_p4info_t *p4info, pi_p4_id_t act_prof_id,
                             const char *name, bool with_selector,
                             size_t max_size) {
   _act_prof_data_t *act_prof = p4info_add_res(p4info, act_prof_id, name);
-  act_prof->name = strdup(name);
+  act_prof->name = p4info_strdup(p4info, name);
   act_prof->act_prof_id = act_prof_id;
   act_prof->num_tables = 0;
   act_prof->with_selector = with_selector;
@@ -108,7 +106,7 @@ void pi_p4info_act_prof_add(pi_p4info_t *p4info, pi_p4_id_t act_prof_id,
 void pi_p4info_act_prof_add_table(pi_p4info_t *p4info, pi_p4_id_t act_prof_id,
                                   pi_p4_id_t table_id) {
   _act_prof_data_t *act_prof = get_act_prof(p4info, act_prof_id);
-  assert(act_prof->num_tables < MAX_TABLES);
+  assert(act_prof->num_tables < PI_P4INFO_ACT_PROF_MAX_TABLES);
   act_prof->table_ids[act_prof->num_tables] = table_id;
   act_prof->num_tables++;
 }
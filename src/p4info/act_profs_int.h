@@ -27,6 +27,9 @@
 extern "C" {
 #endif
 
+// maximum number of tables which can share an action profile
+#define PI_P4INFO_ACT_PROF_MAX_TABLES 8
+
 void pi_p4info_act_prof_init(pi_p4info_t *p4info, size_t num_act_profs);
 
 void pi_p4info_act_prof_free(pi_p4info_t *p4info);
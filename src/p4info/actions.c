@@ -31,12 +31,13 @@
 
 #define INLINE_PARAMS 8
 
+// the id -> index map for parameters is only used if the largest parameter id
+// is smaller than this
+#define MAX_PARAM_ID_FOR_MAP 1024
+
 typedef struct {
   char *name;
   pi_p4_id_t param_id;
-  size_t bitwidth;
-  char byte0_mask;
-  size_t offset;
 } _action_param_data_t;
 
 typedef struct _action_data_s {
@@ -52,8 +53,11 @@ typedef struct _action_data_s {
     _action_param_data_t direct[INLINE_PARAMS];
     _action_param_data_t *indirect;
   } param_data;
-  size_t action_data_size;
   size_t params_added;
+  // action_data_layout.params is allocated in pi_p4info_action_add and filled
+  // in as parameters are added, the id -> index map is built when the last
+  // parameter is added
+  pi_p4info_action_data_layout_t action_data_layout;
 } _action_data_t;
 
 static _action_data_t *get_action(const pi_p4info_t *p4info,
@@ -74,11 +78,18 @@ static _action_param_data_t *get_param_data(_action_data_t *action) {
 
 static _action_param_data_t *get_param_data_at(_action_data_t *action,
                                                pi_p4_id_t param_id) {
-  _action_param_data_t *param_data = get_param_data(action);
-  for (size_t i = 0; i < action->num_params; i++) {
-    if (param_data[i].param_id == param_id) return &param_data[i];
-  }
-  return NULL;
+  size_t index = pi_p4info_action_data_layout_index(
+      &action->action_data_layout, param_id);
+  if (index == (size_t)-1) return NULL;
+  return &get_param_data(action)[index];
+}
+
+static pi_p4info_action_param_layout_t *get_param_layout_at(
+    _action_data_t *action, pi_p4_id_t param_id) {
+  pi_p4info_action_data_layout_t *layout = &action->action_data_layout;
+  size_t index = pi_p4info_action_data_layout_index(layout, param_id);
+  if (index == (size_t)-1) return NULL;
+  return &layout->params[index];
 }
 
 static pi_p4_id_t get_param_id(_action_data_t *action, const char *name) {
@@ -102,19 +113,22 @@ static const char *retrieve_name(const void *data) {
 static void free_action_data(void *data) {
   _action_data_t *action = (_action_data_t *)data;
   if (!action->name) return;
-  free(action->name);
+  const p4info_common_t *common = &action->common;
+  p4info_free(common, action->name);
   _action_param_data_t *params = get_param_data(action);
   for (size_t j = 0; j < action->num_params; j++) {
     _action_param_data_t *param = &params[j];
     if (!param->name) continue;
-    free(param->name);
+    p4info_free(common, param->name);
   }
   if (action->num_params > INLINE_PARAMS) {
     assert(action->param_ids.indirect);
     assert(action->param_data.indirect);
-    free(action->param_ids.indirect);
-    free(action->param_data.indirect);
+    p4info_free(common, action->param_ids.indirect);
+    p4info_free(common, action->param_data.indirect);
   }
+  p4info_free(common, action->action_data_layout.params);
+  p4info_free(common, action->action_data_layout.id_to_index);
   p4info_common_destroy(&action->common);
 }
 
@@ -130,11 +144,13 @@ void pi_p4info_action_serialize(cJSON *root, const pi_p4info_t *p4info) {
 
     cJSON *pArray = cJSON_CreateArray();
     _action_param_data_t *param_data = get_param_data(action);
+    pi_p4info_action_param_layout_t *param_layouts =
+        action->action_data_layout.params;
     for (size_t j = 0; j < action->num_params; j++) {
       cJSON *p = cJSON_CreateObject();
       cJSON_AddStringToObject(p, "name", param_data[j].name);
       cJSON_AddNumberToObject(p, "id", param_data[j].param_id);
-      cJSON_AddNumberToObject(p, "bitwidth", param_data[j].bitwidth);
+      cJSON_AddNumberToObject(p, "bitwidth", param_layouts[j].bitwidth);
       cJSON_AddItemToArray(pArray, p);
     }
     cJSON_AddItemToObject(aObject, "params", pArray);
@@ -154,16 +170,26 @@ void pi_p4info_action_init(pi_p4info_t *p4info, size_t num_actions) {
 void pi_p4info_action_add(pi_p4info_t *p4info, pi_p4_id_t action_id,
                           const char *name, size_t num_params) {
   _action_data_t *action = p4info_add_res(p4info, action_id, name);
-  action->name = strdup(name);
+  action->name = p4info_strdup(p4info, name);
   action->action_id = action_id;
   action->num_params = num_params;
   if (num_params > INLINE_PARAMS) {
-    action->param_ids.indirect = calloc(num_params, sizeof(pi_p4_id_t));
+    action->param_ids.indirect =
+        p4info_calloc(p4info, num_params, sizeof(pi_p4_id_t));
     action->param_data.indirect =
-        calloc(num_params, sizeof(_action_param_data_t));
+        p4info_calloc(p4info, num_params, sizeof(_action_param_data_t));
   }
-  action->action_data_size = 0;
   action->params_added = 0;
+
+  pi_p4info_action_data_layout_t *layout = &action->action_data_layout;
+  layout->num_params = num_params;
+  layout->action_data_size = 0;
+  layout->params =
+      (num_params > 0)
+          ? p4info_calloc(p4info, num_params, sizeof(*layout->params))
+          : NULL;
+  layout->id_to_index = NULL;
+  layout->id_to_index_size = 0;
 }
 
 static char get_byte0_mask(size_t bitwidth) {
@@ -172,6 +198,23 @@ static char get_byte0_mask(size_t bitwidth) {
   return ((1 << nbits) - 1);
 }
 
+static void build_action_data_layout_map(
+    pi_p4info_t *p4info, pi_p4info_action_data_layout_t *layout) {
+  pi_p4_id_t max_id = 0;
+  for (size_t i = 0; i < layout->num_params; i++) {
+    pi_p4_id_t param_id = layout->params[i].param_id;
+    if (param_id > max_id) max_id = param_id;
+  }
+  if (max_id >= MAX_PARAM_ID_FOR_MAP) return;
+  size_t map_size = max_id + 1;
+  layout->id_to_index =
+      p4info_calloc(p4info, map_size, sizeof(*layout->id_to_index));
+  for (size_t i = 0; i < map_size; i++) layout->id_to_index[i] = (size_t)-1;
+  for (size_t i = 0; i < layout->num_params; i++)
+    layout->id_to_index[layout->params[i].param_id] = i;
+  layout->id_to_index_size = map_size;
+}
+
 void pi_p4info_action_add_param(pi_p4info_t *p4info, pi_p4_id_t action_id,
                                 pi_p4_id_t param_id, const char *name,
                                 size_t bitwidth) {
@@ -179,17 +222,25 @@ void pi_p4info_action_add_param(pi_p4info_t *p4info, pi_p4_id_t action_id,
   assert(action->params_added < action->num_params);
   _action_param_data_t *param_data =
       &get_param_data(action)[action->params_added];
-  param_data->name = strdup(name);
+  param_data->name = p4info_strdup(p4info, name);
   param_data->param_id = param_id;
-  param_data->bitwidth = bitwidth;
-  param_data->byte0_mask = get_byte0_mask(bitwidth);
-  param_data->offset = action->action_data_size;
 
   get_param_ids(action)[action->params_added] = param_id;
 
-  action->action_data_size += (bitwidth + 7) / 8;
+  pi_p4info_action_data_layout_t *layout = &action->action_data_layout;
+  pi_p4info_action_param_layout_t *param_layout =
+      &layout->params[action->params_added];
+  param_layout->param_id = param_id;
+  param_layout->bitwidth = bitwidth;
+  param_layout->offset = layout->action_data_size;
+  param_layout->nbytes = (bitwidth + 7) / 8;
+  param_layout->byte0_mask = get_byte0_mask(bitwidth);
+
+  layout->action_data_size += param_layout->nbytes;
 
   action->params_added++;
+  if (action->params_added == action->num_params)
+    build_action_data_layout_map(p4info, layout);
 }
 
 size_t pi_p4info_action_get_num(const pi_p4info_t *p4info) {
@@ -231,11 +282,8 @@ pi_p4_id_t pi_p4info_action_param_id_from_name(const pi_p4info_t *p4info,
 size_t pi_p4info_action_param_index(const pi_p4info_t *p4info,
                                     pi_p4_id_t action_id, pi_p4_id_t param_id) {
   _action_data_t *action = get_action(p4info, action_id);
-  pi_p4_id_t *param_ids = get_param_ids(action);
-  for (size_t i = 0; i < action->num_params; i++) {
-    if (param_ids[i] == param_id) return i;
-  }
-  return (size_t)-1;
+  return pi_p4info_action_data_layout_index(&action->action_data_layout,
+                                            param_id);
 }
 
 const char *pi_p4info_action_param_name_from_id(const pi_p4info_t *p4info,
@@ -249,27 +297,33 @@ size_t pi_p4info_action_param_bitwidth(const pi_p4info_t *p4info,
                                        pi_p4_id_t action_id,
                                        pi_p4_id_t param_id) {
   _action_data_t *action = get_action(p4info, action_id);
-  return get_param_data_at(action, param_id)->bitwidth;
+  return get_param_layout_at(action, param_id)->bitwidth;
 }
 
 char pi_p4info_action_param_byte0_mask(const pi_p4info_t *p4info,
                                        pi_p4_id_t action_id,
                                        pi_p4_id_t param_id) {
   _action_data_t *action = get_action(p4info, action_id);
-  return get_param_data_at(action, param_id)->byte0_mask;
+  return get_param_layout_at(action, param_id)->byte0_mask;
 }
 
 size_t pi_p4info_action_param_offset(const pi_p4info_t *p4info,
                                      pi_p4_id_t action_id,
                                      pi_p4_id_t param_id) {
   _action_data_t *action = get_action(p4info, action_id);
-  return get_param_data_at(action, param_id)->offset;
+  return get_param_layout_at(action, param_id)->offset;
 }
 
 size_t pi_p4info_action_data_size(const pi_p4info_t *p4info,
                                   pi_p4_id_t action_id) {
   _action_data_t *action = get_action(p4info, action_id);
-  return action->action_data_size;
+  return action->action_data_layout.action_data_size;
+}
+
+const pi_p4info_action_data_layout_t *pi_p4info_action_data_layout(
+    const pi_p4info_t *p4info, pi_p4_id_t action_id) {
+  _action_data_t *action = get_action(p4info, action_id);
+  return &action->action_data_layout;
 }
 
 pi_p4_id_t pi_p4info_action_begin(const pi_p4info_t *p4info) {
@@ -36,6 +36,7 @@ typedef struct _counter_data_s {
   pi_p4_id_t direct_table;                // PI_INVALID_ID if not direct
   pi_p4info_counter_unit_t counter_unit;  // mostly ignored
   size_t size;
+  size_t width;  // in bits
 } _counter_data_t;
 
 static _counter_data_t *get_counter(const pi_p4info_t *p4info,
@@ -52,7 +53,7 @@ static const char *retrieve_name(const void *data) {
 static void free_counter_data(void *data) {
   _counter_data_t *counter = (_counter_data_t *)data;
   if (!counter->name) return;
-  free(counter->name);
+  p4info_free(&counter->common, counter->name);
   p4info_common_destroy(&counter->common);
 }
 
@@ -68,6 +69,7 @@ void pi_p4info_counter_serialize(cJSON *root, const pi_p4info_t *p4info) {
     cJSON_AddNumberToObject(cObject, "direct_table", counter->direct_table);
     cJSON_AddNumberToObject(cObject, "counter_unit", counter->counter_unit);
     cJSON_AddNumberToObject(cObject, "size", counter->size);
+    cJSON_AddNumberToObject(cObject, "width", counter->width);
 
     p4info_common_serialize(cObject, &counter->common);
 
@@ -86,11 +88,19 @@ void pi_p4info_counter_add(pi_p4info_t *p4info, pi_p4_id_t counter_id,
                            const char *name,
                            pi_p4info_counter_unit_t counter_unit, size_t size) {
   _counter_data_t *counter = p4info_add_res(p4info, counter_id, name);
-  counter->name = strdup(name);
+  counter->name = p4info_strdup(p4info, name);
   counter->counter_id = counter_id;
   counter->counter_unit = counter_unit;
   counter->direct_table = PI_INVALID_ID;
   counter->size = size;
+  counter->width = PI_P4INFO_COUNTER_MAX_WIDTH;
+}
+
+void pi_p4info_counter_set_width(pi_p4info_t *p4info, pi_p4_id_t counter_id,
+                                 size_t width) {
+  _counter_data_t *counter = get_counter(p4info, counter_id);
+  assert(width > 0 && width <= PI_P4INFO_COUNTER_MAX_WIDTH);
+  counter->width = width;
 }
 
 void pi_p4info_counter_make_direct(pi_p4info_t *p4info, pi_p4_id_t counter_id,
@@ -130,6 +140,12 @@ size_t pi_p4info_counter_get_size(const pi_p4info_t *p4info,
   return counter->size;
 }
 
+size_t pi_p4info_counter_get_width(const pi_p4info_t *p4info,
+                                   pi_p4_id_t counter_id) {
+  _counter_data_t *counter = get_counter(p4info, counter_id);
+  return counter->width;
+}
+
 pi_p4_id_t pi_p4info_counter_begin(const pi_p4info_t *p4info) {
   return pi_p4info_any_begin(p4info, PI_COUNTER_ID);
 }
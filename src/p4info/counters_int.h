@@ -33,6 +33,10 @@ void pi_p4info_counter_add(pi_p4info_t *p4info, pi_p4_id_t counter_id,
                            const char *name,
                            pi_p4info_counter_unit_t counter_unit, size_t size);
 
+// the width defaults to PI_P4INFO_COUNTER_MAX_WIDTH
+void pi_p4info_counter_set_width(pi_p4info_t *p4info, pi_p4_id_t counter_id,
+                                 size_t width);
+
 void pi_p4info_counter_make_direct(pi_p4info_t *p4info, pi_p4_id_t counter_id,
                                    pi_p4_id_t direct_table_id);
 
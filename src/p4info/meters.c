@@ -55,7 +55,7 @@ static const char *retrieve_name(const void *data) {
 static void free_meter_data(void *data) {
   _meter_data_t *meter = (_meter_data_t *)data;
   if (!meter->name) return;
-  free(meter->name);
+  p4info_free(&meter->common, meter->name);
   p4info_common_destroy(&meter->common);
 }
 
@@ -89,7 +89,7 @@ void pi_p4info_meter_add(pi_p4info_t *p4info, pi_p4_id_t meter_id,
                          const char *name, pi_p4info_meter_unit_t meter_unit,
                          pi_p4info_meter_type_t meter_type, size_t size) {
   _meter_data_t *meter = p4info_add_res(p4info, meter_id, name);
-  meter->name = strdup(name);
+  meter->name = p4info_strdup(p4info, name);
   meter->meter_id = meter_id;
   meter->meter_unit = meter_unit;
   meter->meter_type = meter_type;
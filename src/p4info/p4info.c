@@ -20,15 +20,21 @@
 
 #include "PI/pi_base.h"
 #include "config_readers/readers.h"
+#include "p4info_binary.h"
+#include "p4info_int.h"
 #include "p4info_struct.h"
 #include "read_file.h"
 #include "tables_int.h"
 
 #include <cJSON/cJSON.h>
 
+#include <fcntl.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 pi_status_t pi_empty_config(pi_p4info_t **p4info) {
   pi_p4info_t *p4info_ = malloc(sizeof(pi_p4info_t));
@@ -45,6 +51,15 @@ pi_status_t pi_empty_config(pi_p4info_t **p4info) {
   return PI_STATUS_SUCCESS;
 }
 
+static pi_status_t add_config_done(pi_p4info_t *p4info, pi_status_t status) {
+  if (status != PI_STATUS_SUCCESS) {
+    pi_destroy_config(p4info);
+    return status;
+  }
+  pi_p4info_freeze(p4info);
+  return PI_STATUS_SUCCESS;
+}
+
 pi_status_t pi_add_config(const char *config, pi_config_type_t config_type,
                           pi_p4info_t **p4info) {
   pi_status_t status = pi_empty_config(p4info);
@@ -60,20 +75,41 @@ pi_status_t pi_add_config(const char *config, pi_config_type_t config_type,
     case PI_CONFIG_TYPE_NATIVE_JSON:
       status = pi_native_json_reader(config, p4info_);
       break;
+    case PI_CONFIG_TYPE_BINARY:
+      status = pi_binary_reader(config, p4info_);
+      break;
     default:
       status = PI_STATUS_INVALID_CONFIG_TYPE;
       break;
   }
-  if (status != PI_STATUS_SUCCESS) {
-    free(p4info_);
-    return status;
+  return add_config_done(p4info_, status);
+}
+
+static pi_status_t add_binary_config_from_file(const char *config_path,
+                                               pi_p4info_t **p4info) {
+  int fd = open(config_path, O_RDONLY);
+  if (fd < 0) return PI_STATUS_CONFIG_READER_ERROR;
+  struct stat sb;
+  if (fstat(fd, &sb) != 0 || (size_t)sb.st_size < sizeof(pi_bin_header_t)) {
+    close(fd);
+    return PI_STATUS_CONFIG_READER_ERROR;
   }
-  return PI_STATUS_SUCCESS;
+  char *config = mmap(NULL, sb.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (config == MAP_FAILED) return PI_STATUS_CONFIG_READER_ERROR;
+  // the mapping is kept by the p4info, which reads the blob in place; a
+  // truncated file (e.g. stale cache) is rejected by the reader
+  pi_empty_config(p4info);
+  pi_status_t rc =
+      pi_binary_reader_owned(config, sb.st_size, true /* mapped */, *p4info);
+  return add_config_done(*p4info, rc);
 }
 
 pi_status_t pi_add_config_from_file(const char *config_path,
                                     pi_config_type_t config_type,
                                     pi_p4info_t **p4info) {
+  if (config_type == PI_CONFIG_TYPE_BINARY)
+    return add_binary_config_from_file(config_path, p4info);
   char *config_tmp = read_file(config_path);
   pi_status_t rc = pi_add_config(config_tmp, config_type, p4info);
   free(config_tmp);
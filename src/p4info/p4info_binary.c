@@ -0,0 +1,314 @@
+/* Copyright 2013-present Barefoot Networks, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Antonin Bas (antonin@barefootnetworks.com)
+ *
+ */
+
+#include "PI/p4info.h"
+#include "p4info_binary.h"
+#include "p4info_int.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+typedef struct {
+  char *data;
+  size_t size;
+  size_t capacity;
+} section_buffer_t;
+
+typedef struct {
+  section_buffer_t sections[PI_BIN_SECTION_MAX];
+} writer_t;
+
+// appends s zeroed bytes to the section and returns a pointer to them; the
+// pointer is only valid until the next call for the same section
+static void *section_extend(writer_t *w, pi_bin_section_id_t id, size_t s) {
+  section_buffer_t *buf = &w->sections[id];
+  if (buf->size + s > buf->capacity) {
+    size_t new_capacity = (buf->capacity == 0) ? 256 : buf->capacity;
+    while (new_capacity < buf->size + s) new_capacity *= 2;
+    buf->data = realloc(buf->data, new_capacity);
+    buf->capacity = new_capacity;
+  }
+  void *ptr = buf->data + buf->size;
+  memset(ptr, 0, s);
+  buf->size += s;
+  return ptr;
+}
+
+static uint32_t section_num(const writer_t *w, pi_bin_section_id_t id,
+                            size_t record_size) {
+  return w->sections[id].size / record_size;
+}
+
+static uint32_t add_string(writer_t *w, const char *str) {
+  uint32_t offset = w->sections[PI_BIN_SECTION_STRINGS].size;
+  size_t len = strlen(str) + 1;
+  memcpy(section_extend(w, PI_BIN_SECTION_STRINGS, len), str, len);
+  return offset;
+}
+
+static pi_bin_list_t add_ids(writer_t *w, const pi_p4_id_t *ids, size_t num) {
+  pi_bin_list_t list;
+  list.first = section_num(w, PI_BIN_SECTION_U32, sizeof(uint32_t));
+  list.count = num;
+  uint32_t *dst = section_extend(w, PI_BIN_SECTION_U32, num * sizeof(*dst));
+  for (size_t i = 0; i < num; i++) dst[i] = ids[i];
+  return list;
+}
+
+static pi_bin_list_t add_strings(writer_t *w, char const *const *strs,
+                                 size_t num) {
+  pi_bin_list_t list;
+  list.first = section_num(w, PI_BIN_SECTION_U32, sizeof(uint32_t));
+  list.count = num;
+  section_extend(w, PI_BIN_SECTION_U32, num * sizeof(uint32_t));
+  uint32_t *dst = (uint32_t *)w->sections[PI_BIN_SECTION_U32].data;
+  for (size_t i = 0; i < num; i++) dst[list.first + i] = add_string(w, strs[i]);
+  return list;
+}
+
+static void add_common(writer_t *w, const pi_p4info_t *p4info, pi_p4_id_t id,
+                       pi_bin_common_t *common) {
+  size_t num;
+  char const *const *strs;
+  strs = pi_p4info_get_annotations(p4info, id, &num);
+  common->annotations = add_strings(w, strs, num);
+  strs = pi_p4info_get_aliases(p4info, id, &num);
+  common->aliases = add_strings(w, strs, num);
+}
+
+static void write_actions(writer_t *w, const pi_p4info_t *p4info) {
+  for (pi_p4_id_t id = pi_p4info_action_begin(p4info);
+       id != pi_p4info_action_end(p4info);
+       id = pi_p4info_action_next(p4info, id)) {
+    pi_bin_action_t *action =
+        section_extend(w, PI_BIN_SECTION_ACTIONS, sizeof(*action));
+    action->id = id;
+    action->name = add_string(w, pi_p4info_action_name_from_id(p4info, id));
+    add_common(w, p4info, id, &action->common);
+
+    size_t num_params;
+    const pi_p4_id_t *params =
+        pi_p4info_action_get_params(p4info, id, &num_params);
+    action->first_param =
+        section_num(w, PI_BIN_SECTION_PARAMS, sizeof(pi_bin_param_t));
+    action->num_params = num_params;
+    for (size_t i = 0; i < num_params; i++) {
+      pi_bin_param_t *param =
+          section_extend(w, PI_BIN_SECTION_PARAMS, sizeof(*param));
+      param->id = params[i];
+      param->name = add_string(
+          w, pi_p4info_action_param_name_from_id(p4info, id, params[i]));
+      param->bitwidth = pi_p4info_action_param_bitwidth(p4info, id, params[i]);
+    }
+  }
+}
+
+static void write_tables(writer_t *w, const pi_p4info_t *p4info) {
+  for (pi_p4_id_t id = pi_p4info_table_begin(p4info);
+       id != pi_p4info_table_end(p4info);
+       id = pi_p4info_table_next(p4info, id)) {
+    pi_bin_table_t *table =
+        section_extend(w, PI_BIN_SECTION_TABLES, sizeof(*table));
+    table->id = id;
+    table->name = add_string(w, pi_p4info_table_name_from_id(p4info, id));
+    table->max_size = pi_p4info_table_max_size(p4info, id);
+    add_common(w, p4info, id, &table->common);
+
+    size_t num;
+    const pi_p4_id_t *ids;
+    ids = pi_p4info_table_get_actions(p4info, id, &num);
+    table->actions = add_ids(w, ids, num);
+    ids = pi_p4info_table_get_direct_resources(p4info, id, &num);
+    table->direct_resources = add_ids(w, ids, num);
+
+    if (pi_p4info_table_has_const_default_action(p4info, id)) {
+      bool has_mutable_action_params;
+      table->const_default_action_id = pi_p4info_table_get_const_default_action(
+          p4info, id, &has_mutable_action_params);
+      table->has_mutable_action_params = has_mutable_action_params;
+    }
+    table->implementation = pi_p4info_table_get_implementation(p4info, id);
+
+    size_t num_match_fields = pi_p4info_table_num_match_fields(p4info, id);
+    table->first_match_field = section_num(w, PI_BIN_SECTION_MATCH_FIELDS,
+                                           sizeof(pi_bin_match_field_t));
+    table->num_match_fields = num_match_fields;
+    for (size_t i = 0; i < num_match_fields; i++) {
+      const pi_p4info_match_field_info_t *finfo =
+          pi_p4info_table_match_field_info(p4info, id, i);
+      pi_bin_match_field_t *mf =
+          section_extend(w, PI_BIN_SECTION_MATCH_FIELDS, sizeof(*mf));
+      mf->id = finfo->mf_id;
+      mf->name = add_string(w, finfo->name);
+      mf->match_type = finfo->match_type;
+      mf->bitwidth = finfo->bitwidth;
+    }
+  }
+}
+
+static void write_act_profs(writer_t *w, const pi_p4info_t *p4info) {
+  for (pi_p4_id_t id = pi_p4info_act_prof_begin(p4info);
+       id != pi_p4info_act_prof_end(p4info);
+       id = pi_p4info_act_prof_next(p4info, id)) {
+    pi_bin_act_prof_t *act_prof =
+        section_extend(w, PI_BIN_SECTION_ACT_PROFS, sizeof(*act_prof));
+    act_prof->id = id;
+    act_prof->name = add_string(w, pi_p4info_act_prof_name_from_id(p4info, id));
+    act_prof->with_selector = pi_p4info_act_prof_has_selector(p4info, id);
+    act_prof->max_size = pi_p4info_act_prof_max_size(p4info, id);
+    add_common(w, p4info, id, &act_prof->common);
+    size_t num_tables;
+    const pi_p4_id_t *tables =
+        pi_p4info_act_prof_get_tables(p4info, id, &num_tables);
+    act_prof->tables = add_ids(w, tables, num_tables);
+  }
+}
+
+static void write_counters(writer_t *w, const pi_p4info_t *p4info) {
+  for (pi_p4_id_t id = pi_p4info_counter_begin(p4info);
+       id != pi_p4info_counter_end(p4info);
+       id = pi_p4info_counter_next(p4info, id)) {
+    pi_bin_counter_t *counter =
+        section_extend(w, PI_BIN_SECTION_COUNTERS, sizeof(*counter));
+    counter->id = id;
+    counter->name = add_string(w, pi_p4info_counter_name_from_id(p4info, id));
+    counter->direct_table = pi_p4info_counter_get_direct(p4info, id);
+    counter->counter_unit = pi_p4info_counter_get_unit(p4info, id);
+    counter->size = pi_p4info_counter_get_size(p4info, id);
+    counter->width = pi_p4info_counter_get_width(p4info, id);
+    add_common(w, p4info, id, &counter->common);
+  }
+}
+
+static void write_meters(writer_t *w, const pi_p4info_t *p4info) {
+  for (pi_p4_id_t id = pi_p4info_meter_begin(p4info);
+       id != pi_p4info_meter_end(p4info);
+       id = pi_p4info_meter_next(p4info, id)) {
+    pi_bin_meter_t *meter =
+        section_extend(w, PI_BIN_SECTION_METERS, sizeof(*meter));
+    meter->id = id;
+    meter->name = add_string(w, pi_p4info_meter_name_from_id(p4info, id));
+    meter->direct_table = pi_p4info_meter_get_direct(p4info, id);
+    meter->meter_unit = pi_p4info_meter_get_unit(p4info, id);
+    meter->meter_type = pi_p4info_meter_get_type(p4info, id);
+    meter->size = pi_p4info_meter_get_size(p4info, id);
+    add_common(w, p4info, id, &meter->common);
+  }
+}
+
+static size_t align_up(size_t s) {
+  return (s + PI_BIN_ALIGN - 1) & ~((size_t)PI_BIN_ALIGN - 1);
+}
+
+static const size_t record_sizes[PI_BIN_SECTION_MAX] = {
+    sizeof(pi_bin_action_t),   sizeof(pi_bin_param_t),
+    sizeof(pi_bin_table_t),    sizeof(pi_bin_match_field_t),
+    sizeof(pi_bin_act_prof_t), sizeof(pi_bin_counter_t),
+    sizeof(pi_bin_meter_t),    sizeof(uint32_t),
+    1};
+
+char *pi_serialize_config_binary(const pi_p4info_t *p4info, size_t *size) {
+  writer_t w;
+  memset(&w, 0, sizeof(w));
+
+  write_actions(&w, p4info);
+  write_tables(&w, p4info);
+  write_act_profs(&w, p4info);
+  write_counters(&w, p4info);
+  write_meters(&w, p4info);
+
+  pi_bin_header_t header;
+  memset(&header, 0, sizeof(header));
+  header.magic = PI_BIN_MAGIC;
+  header.version = PI_BIN_VERSION;
+  header.byte_order = PI_BIN_BYTE_ORDER;
+  header.num_sections = PI_BIN_SECTION_MAX;
+
+  size_t total_size = align_up(sizeof(header));
+  for (size_t i = 0; i < PI_BIN_SECTION_MAX; i++) {
+    header.sections[i].offset = total_size;
+    header.sections[i].count = w.sections[i].size / record_sizes[i];
+    total_size = align_up(total_size + w.sections[i].size);
+  }
+
+  char *blob = NULL;
+  // offsets are stored on 32 bits
+  if (total_size <= UINT32_MAX) {
+    header.total_size = total_size;
+    blob = calloc(1, total_size);
+    memcpy(blob, &header, sizeof(header));
+    for (size_t i = 0; i < PI_BIN_SECTION_MAX; i++) {
+      if (w.sections[i].size == 0) continue;
+      memcpy(blob + header.sections[i].offset, w.sections[i].data,
+             w.sections[i].size);
+    }
+    if (size) *size = total_size;
+  }
+
+  for (size_t i = 0; i < PI_BIN_SECTION_MAX; i++) free(w.sections[i].data);
+  return blob;
+}
+
+int pi_serialize_config_binary_to_file(const pi_p4info_t *p4info,
+                                       const char *path) {
+  size_t size;
+  char *blob = pi_serialize_config_binary(p4info, &size);
+  if (!blob) return -1;
+
+  // write to a temporary file and rename it, so that concurrent readers of a
+  // cached config never see a partially-written file
+  size_t tmp_path_size = strlen(path) + sizeof(".XXXXXX");
+  char *tmp_path = malloc(tmp_path_size);
+  snprintf(tmp_path, tmp_path_size, "%s.XXXXXX", path);
+  int fd = mkstemp(tmp_path);
+  int rc = -1;
+  if (fd >= 0) {
+    // mkstemp creates the file with 0600 permissions
+    fchmod(fd, 0644);
+    size_t written = 0;
+    while (written < size) {
+      ssize_t n = write(fd, blob + written, size - written);
+      if (n <= 0) break;
+      written += n;
+    }
+    if (close(fd) == 0 && written == size && rename(tmp_path, path) == 0)
+      rc = (int)size;
+    else
+      unlink(tmp_path);
+  }
+
+  free(tmp_path);
+  free(blob);
+  return rc;
+}
+
+size_t pi_config_binary_size(const char *config) {
+  pi_bin_header_t header;
+  memcpy(&header, config, sizeof(header));
+  if (header.magic != PI_BIN_MAGIC || header.version != PI_BIN_VERSION ||
+      header.byte_order != PI_BIN_BYTE_ORDER ||
+      header.num_sections != PI_BIN_SECTION_MAX)
+    return 0;
+  return header.total_size;
+}
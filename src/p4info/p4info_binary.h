@@ -0,0 +1,154 @@
+/* Copyright 2013-present Barefoot Networks, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Antonin Bas (antonin@barefootnetworks.com)
+ *
+ */
+
+// Layout of the binary p4info format (PI_CONFIG_TYPE_BINARY). A blob is a
+// header followed by a fixed set of sections, each one being a flat array of
+// fixed-size records. Records never contain pointers: strings are referenced by
+// their byte offset in the STRINGS section and variable-length lists (table
+// actions, annotations, ...) by a (first, count) pair in the U32 section. This
+// makes the blob position-independent, so it can be sent as is over the wire
+// or mmap'd from disk and read in place. All integers are in host byte order;
+// the byte_order field is used to reject blobs produced on a host with a
+// different endianness.
+
+#ifndef PI_SRC_P4INFO_P4INFO_BINARY_H_
+#define PI_SRC_P4INFO_P4INFO_BINARY_H_
+
+#include <PI/p4info.h>
+
+#include <stdint.h>
+
+#define PI_BIN_MAGIC 0x42344950u  // "PI4B"
+#define PI_BIN_VERSION 2
+#define PI_BIN_BYTE_ORDER 0x0102
+// every section starts on a multiple of this
+#define PI_BIN_ALIGN 8
+
+typedef enum {
+  PI_BIN_SECTION_ACTIONS = 0,
+  PI_BIN_SECTION_PARAMS,
+  PI_BIN_SECTION_TABLES,
+  PI_BIN_SECTION_MATCH_FIELDS,
+  PI_BIN_SECTION_ACT_PROFS,
+  PI_BIN_SECTION_COUNTERS,
+  PI_BIN_SECTION_METERS,
+  PI_BIN_SECTION_U32,
+  PI_BIN_SECTION_STRINGS,
+  PI_BIN_SECTION_MAX
+} pi_bin_section_id_t;
+
+typedef struct {
+  uint32_t offset;  // from the start of the blob
+  uint32_t count;   // number of records (bytes for STRINGS)
+} pi_bin_section_t;
+
+typedef struct {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t byte_order;
+  uint32_t total_size;
+  uint32_t num_sections;
+  pi_bin_section_t sections[PI_BIN_SECTION_MAX];
+} pi_bin_header_t;
+
+_Static_assert(sizeof(pi_bin_header_t) == PI_CONFIG_BINARY_HEADER_SIZE,
+               "PI_CONFIG_BINARY_HEADER_SIZE is out of date");
+
+// a list in the U32 section
+typedef struct {
+  uint32_t first;
+  uint32_t count;
+} pi_bin_list_t;
+
+// annotations and aliases are lists of string offsets
+typedef struct {
+  pi_bin_list_t annotations;
+  pi_bin_list_t aliases;
+} pi_bin_common_t;
+
+typedef struct {
+  uint32_t id;
+  uint32_t name;
+  uint32_t first_param;  // index in the PARAMS section
+  uint32_t num_params;
+  pi_bin_common_t common;
+} pi_bin_action_t;
+
+typedef struct {
+  uint32_t id;
+  uint32_t name;
+  uint32_t bitwidth;
+} pi_bin_param_t;
+
+typedef struct {
+  uint64_t max_size;
+  uint32_t id;
+  uint32_t name;
+  uint32_t first_match_field;  // index in the MATCH_FIELDS section
+  uint32_t num_match_fields;
+  pi_bin_list_t actions;
+  pi_bin_list_t direct_resources;
+  uint32_t const_default_action_id;
+  uint32_t has_mutable_action_params;
+  uint32_t implementation;
+  uint32_t _padding;
+  pi_bin_common_t common;
+} pi_bin_table_t;
+
+typedef struct {
+  uint32_t id;
+  uint32_t name;
+  uint32_t match_type;
+  uint32_t bitwidth;
+} pi_bin_match_field_t;
+
+typedef struct {
+  uint64_t max_size;
+  uint32_t id;
+  uint32_t name;
+  uint32_t with_selector;
+  uint32_t _padding;
+  pi_bin_list_t tables;
+  pi_bin_common_t common;
+} pi_bin_act_prof_t;
+
+typedef struct {
+  uint64_t size;
+  uint32_t id;
+  uint32_t name;
+  uint32_t direct_table;
+  uint32_t counter_unit;
+  uint32_t width;
+  uint32_t _padding;
+  pi_bin_common_t common;
+} pi_bin_counter_t;
+
+typedef struct {
+  uint64_t size;
+  uint32_t id;
+  uint32_t name;
+  uint32_t direct_table;
+  uint32_t meter_unit;
+  uint32_t meter_type;
+  uint32_t _padding;
+  pi_bin_common_t common;
+} pi_bin_meter_t;
+
+#endif  // PI_SRC_P4INFO_P4INFO_BINARY_H_
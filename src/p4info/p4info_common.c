@@ -28,55 +28,67 @@
 #include <stdlib.h>
 #include <string.h>
 
+static void clean_string(void *e) { free(*(char **)e); }
+
+static void push_back_string(const p4info_common_t *common, vector_t **v,
+                             const char *str) {
+  if (!*v) {
+    *v = vector_create_wclean(sizeof(char *), 4,
+                              common->in_storage ? NULL : clean_string);
+  }
+  vector_push_back(*v, &str);
+}
+
 void p4info_common_push_back_annotation(p4info_common_t *common,
                                         const char *annotation) {
-  const char *annotation_copy = strdup(annotation);
-  vector_push_back(common->annotations, &annotation_copy);
+  push_back_string(common, &common->annotations, annotation);
 }
 
 void p4info_common_push_back_alias(p4info_common_t *common, const char *alias) {
-  const char *alias_copy = strdup(alias);
-  vector_push_back(common->aliases, &alias_copy);
+  push_back_string(common, &common->aliases, alias);
+}
+
+static char const *const *get_strings(const vector_t *v, size_t *num) {
+  *num = (v) ? vector_size(v) : 0;
+  return (v) ? vector_data(v) : NULL;
 }
 
 char const *const *p4info_common_annotations(p4info_common_t *common,
                                              size_t *num_annotations) {
-  *num_annotations = vector_size(common->annotations);
-  return vector_data(common->annotations);
+  return get_strings(common->annotations, num_annotations);
 }
 
 char const *const *p4info_common_aliases(p4info_common_t *common,
                                          size_t *num_aliases) {
-  *num_aliases = vector_size(common->aliases);
-  return vector_data(common->aliases);
+  return get_strings(common->aliases, num_aliases);
 }
 
 void p4info_common_serialize(cJSON *object, const p4info_common_t *common) {
-  size_t num_annotations = vector_size(common->annotations);
+  size_t num_annotations;
+  char const *const *annotations =
+      get_strings(common->annotations, &num_annotations);
   if (num_annotations > 0) {
     cJSON *annotationsArray = cJSON_CreateStringArray(
-        vector_data(common->annotations), num_annotations);
+        (const char **)annotations, num_annotations);
     cJSON_AddItemToObject(object, "annotations", annotationsArray);
   }
 
-  size_t num_aliases = vector_size(common->aliases);
+  size_t num_aliases;
+  char const *const *aliases = get_strings(common->aliases, &num_aliases);
   if (num_aliases > 0) {
     cJSON *aliasesArray =
-        cJSON_CreateStringArray(vector_data(common->aliases), num_aliases);
+        cJSON_CreateStringArray((const char **)aliases, num_aliases);
     cJSON_AddItemToObject(object, "aliases", aliasesArray);
   }
 }
 
-static void clean_annotation(void *e) { free(*(char **)e); }
-static void clean_alias(void *e) { free(*(char **)e); }
-
 void p4info_common_init(p4info_common_t *common) {
-  common->annotations =
-      vector_create_wclean(sizeof(char *), 4, clean_annotation);
-  common->aliases = vector_create_wclean(sizeof(char *), 4, clean_alias);
+  common->annotations = NULL;
+  common->aliases = NULL;
+  common->in_storage = false;
 }
 
 void p4info_common_destroy(p4info_common_t *common) {
-  vector_destroy(common->annotations);
-  vector_destroy(common->aliases);
+  if (common->annotations) vector_destroy(common->annotations);
+  if (common->aliases) vector_destroy(common->aliases);
 }
@@ -27,6 +27,9 @@ extern "C" {
 
 typedef struct p4info_common_s p4info_common_t;
 
+// The push_back functions take ownership of the string, which must have been
+// allocated with p4info_strdup for the p4info which contains the object.
+
 void p4info_common_push_back_annotation(p4info_common_t *common,
                                         const char *annotation);
 
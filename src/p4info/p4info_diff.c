@@ -0,0 +1,222 @@
+/* Copyright 2013-present Barefoot Networks, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Antonin Bas (antonin@barefootnetworks.com)
+ *
+ */
+
+// Compares objects across two p4info instances, by id and by "shape". Two
+// objects are considered the same if any state a client may keep for the
+// object (e.g. table entries keyed by match key, action profile members with
+// their action data) remains valid with the new p4info. Annotations and aliases
+// are ignored, as they have no impact on such state.
+
+#include "PI/int/pi_int.h"
+#include "PI/p4info.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+
+static bool id_in_list(pi_p4_id_t id, const pi_p4_id_t *ids, size_t num) {
+  for (size_t i = 0; i < num; i++)
+    if (ids[i] == id) return true;
+  return false;
+}
+
+// order is ignored, it has no impact on the object shape
+static bool same_id_sets(const pi_p4_id_t *ids_1, size_t num_1,
+                         const pi_p4_id_t *ids_2, size_t num_2) {
+  if (num_1 != num_2) return false;
+  for (size_t i = 0; i < num_1; i++)
+    if (!id_in_list(ids_1[i], ids_2, num_2)) return false;
+  return true;
+}
+
+static bool same_name(const pi_p4info_t *p4info_1, const pi_p4info_t *p4info_2,
+                      pi_p4_id_t id) {
+  return !strcmp(pi_p4info_any_name_from_id(p4info_1, id),
+                 pi_p4info_any_name_from_id(p4info_2, id));
+}
+
+static bool action_equal(const pi_p4info_t *p4info_1,
+                         const pi_p4info_t *p4info_2, pi_p4_id_t action_id) {
+  if (!same_name(p4info_1, p4info_2, action_id)) return false;
+  size_t num_params_1, num_params_2;
+  const pi_p4_id_t *params_1 =
+      pi_p4info_action_get_params(p4info_1, action_id, &num_params_1);
+  const pi_p4_id_t *params_2 =
+      pi_p4info_action_get_params(p4info_2, action_id, &num_params_2);
+  // order matters here, it determines the action data layout
+  if (num_params_1 != num_params_2) return false;
+  for (size_t i = 0; i < num_params_1; i++) {
+    pi_p4_id_t p_id = params_1[i];
+    if (p_id != params_2[i]) return false;
+    if (pi_p4info_action_param_bitwidth(p4info_1, action_id, p_id) !=
+        pi_p4info_action_param_bitwidth(p4info_2, action_id, p_id))
+      return false;
+    if (strcmp(pi_p4info_action_param_name_from_id(p4info_1, action_id, p_id),
+               pi_p4info_action_param_name_from_id(p4info_2, action_id, p_id)))
+      return false;
+  }
+  return true;
+}
+
+static bool actions_equal(const pi_p4info_t *p4info_1,
+                          const pi_p4info_t *p4info_2,
+                          const pi_p4_id_t *actions_1, size_t num_actions_1,
+                          const pi_p4_id_t *actions_2, size_t num_actions_2) {
+  if (!same_id_sets(actions_1, num_actions_1, actions_2, num_actions_2))
+    return false;
+  for (size_t i = 0; i < num_actions_1; i++)
+    if (!action_equal(p4info_1, p4info_2, actions_1[i])) return false;
+  return true;
+}
+
+// does not compare the tables themselves, only their ids, to avoid infinite
+// recursion
+static bool act_prof_equal(const pi_p4info_t *p4info_1,
+                           const pi_p4info_t *p4info_2,
+                           pi_p4_id_t act_prof_id) {
+  if (!same_name(p4info_1, p4info_2, act_prof_id)) return false;
+  if (pi_p4info_act_prof_has_selector(p4info_1, act_prof_id) !=
+      pi_p4info_act_prof_has_selector(p4info_2, act_prof_id))
+    return false;
+  if (pi_p4info_act_prof_max_size(p4info_1, act_prof_id) !=
+      pi_p4info_act_prof_max_size(p4info_2, act_prof_id))
+    return false;
+  size_t num_tables_1, num_tables_2;
+  const pi_p4_id_t *tables_1 =
+      pi_p4info_act_prof_get_tables(p4info_1, act_prof_id, &num_tables_1);
+  const pi_p4_id_t *tables_2 =
+      pi_p4info_act_prof_get_tables(p4info_2, act_prof_id, &num_tables_2);
+  if (!same_id_sets(tables_1, num_tables_1, tables_2, num_tables_2))
+    return false;
+  size_t num_actions_1, num_actions_2;
+  const pi_p4_id_t *actions_1 =
+      pi_p4info_act_prof_get_actions(p4info_1, act_prof_id, &num_actions_1);
+  const pi_p4_id_t *actions_2 =
+      pi_p4info_act_prof_get_actions(p4info_2, act_prof_id, &num_actions_2);
+  return actions_equal(p4info_1, p4info_2, actions_1, num_actions_1, actions_2,
+                       num_actions_2);
+}
+
+static bool counter_equal(const pi_p4info_t *p4info_1,
+                          const pi_p4info_t *p4info_2, pi_p4_id_t counter_id) {
+  return same_name(p4info_1, p4info_2, counter_id) &&
+         pi_p4info_counter_get_direct(p4info_1, counter_id) ==
+             pi_p4info_counter_get_direct(p4info_2, counter_id) &&
+         pi_p4info_counter_get_unit(p4info_1, counter_id) ==
+             pi_p4info_counter_get_unit(p4info_2, counter_id) &&
+         pi_p4info_counter_get_size(p4info_1, counter_id) ==
+             pi_p4info_counter_get_size(p4info_2, counter_id) &&
+         pi_p4info_counter_get_width(p4info_1, counter_id) ==
+             pi_p4info_counter_get_width(p4info_2, counter_id);
+}
+
+static bool meter_equal(const pi_p4info_t *p4info_1,
+                        const pi_p4info_t *p4info_2, pi_p4_id_t meter_id) {
+  return same_name(p4info_1, p4info_2, meter_id) &&
+         pi_p4info_meter_get_direct(p4info_1, meter_id) ==
+             pi_p4info_meter_get_direct(p4info_2, meter_id) &&
+         pi_p4info_meter_get_unit(p4info_1, meter_id) ==
+             pi_p4info_meter_get_unit(p4info_2, meter_id) &&
+         pi_p4info_meter_get_type(p4info_1, meter_id) ==
+             pi_p4info_meter_get_type(p4info_2, meter_id) &&
+         pi_p4info_meter_get_size(p4info_1, meter_id) ==
+             pi_p4info_meter_get_size(p4info_2, meter_id);
+}
+
+static bool table_equal(const pi_p4info_t *p4info_1,
+                        const pi_p4info_t *p4info_2, pi_p4_id_t table_id) {
+  if (!same_name(p4info_1, p4info_2, table_id)) return false;
+  if (pi_p4info_table_max_size(p4info_1, table_id) !=
+      pi_p4info_table_max_size(p4info_2, table_id))
+    return false;
+
+  // order matters here, it determines the match key layout
+  size_t num_mfs = pi_p4info_table_num_match_fields(p4info_1, table_id);
+  if (num_mfs != pi_p4info_table_num_match_fields(p4info_2, table_id))
+    return false;
+  for (size_t i = 0; i < num_mfs; i++) {
+    const pi_p4info_match_field_info_t *finfo_1 =
+        pi_p4info_table_match_field_info(p4info_1, table_id, i);
+    const pi_p4info_match_field_info_t *finfo_2 =
+        pi_p4info_table_match_field_info(p4info_2, table_id, i);
+    if (finfo_1->mf_id != finfo_2->mf_id ||
+        finfo_1->match_type != finfo_2->match_type ||
+        finfo_1->bitwidth != finfo_2->bitwidth ||
+        strcmp(finfo_1->name, finfo_2->name))
+      return false;
+  }
+
+  size_t num_actions_1, num_actions_2;
+  const pi_p4_id_t *actions_1 =
+      pi_p4info_table_get_actions(p4info_1, table_id, &num_actions_1);
+  const pi_p4_id_t *actions_2 =
+      pi_p4info_table_get_actions(p4info_2, table_id, &num_actions_2);
+  if (!actions_equal(p4info_1, p4info_2, actions_1, num_actions_1, actions_2,
+                     num_actions_2))
+    return false;
+
+  bool mutable_params_1 = false, mutable_params_2 = false;
+  if (pi_p4info_table_get_const_default_action(p4info_1, table_id,
+                                               &mutable_params_1) !=
+      pi_p4info_table_get_const_default_action(p4info_2, table_id,
+                                               &mutable_params_2))
+    return false;
+  if (mutable_params_1 != mutable_params_2) return false;
+
+  pi_p4_id_t impl_id = pi_p4info_table_get_implementation(p4info_1, table_id);
+  if (impl_id != pi_p4info_table_get_implementation(p4info_2, table_id))
+    return false;
+  if (impl_id != PI_INVALID_ID && !act_prof_equal(p4info_1, p4info_2, impl_id))
+    return false;
+
+  size_t num_res_1, num_res_2;
+  const pi_p4_id_t *res_1 =
+      pi_p4info_table_get_direct_resources(p4info_1, table_id, &num_res_1);
+  const pi_p4_id_t *res_2 =
+      pi_p4info_table_get_direct_resources(p4info_2, table_id, &num_res_2);
+  if (!same_id_sets(res_1, num_res_1, res_2, num_res_2)) return false;
+  for (size_t i = 0; i < num_res_1; i++) {
+    if (!pi_p4info_object_equal(p4info_1, p4info_2, res_1[i])) return false;
+  }
+
+  return true;
+}
+
+bool pi_p4info_object_equal(const pi_p4info_t *p4info_1,
+                            const pi_p4info_t *p4info_2, pi_p4_id_t id) {
+  if (!pi_p4info_is_valid_id(p4info_1, id) ||
+      !pi_p4info_is_valid_id(p4info_2, id))
+    return false;
+  if (p4info_1 == p4info_2) return true;
+  switch (PI_GET_TYPE_ID(id)) {
+    case PI_ACTION_ID:
+      return action_equal(p4info_1, p4info_2, id);
+    case PI_TABLE_ID:
+      return table_equal(p4info_1, p4info_2, id);
+    case PI_ACT_PROF_ID:
+      return act_prof_equal(p4info_1, p4info_2, id);
+    case PI_COUNTER_ID:
+      return counter_equal(p4info_1, p4info_2, id);
+    case PI_METER_ID:
+      return meter_equal(p4info_1, p4info_2, id);
+    default:
+      return false;
+  }
+}
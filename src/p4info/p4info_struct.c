@@ -24,6 +24,36 @@
 
 #include <PI/p4info.h>
 
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+// a dense map is always built when the id space spans fewer than
+// DENSE_MAP_MIN_SPAN entries; beyond that, only if at least 1 in
+// DENSE_MAP_MAX_SPARSITY entries is in use
+#define DENSE_MAP_MIN_SPAN 4096
+#define DENSE_MAP_MAX_SPARSITY 16
+#define CACHE_LINE_SIZE 64
+
+// arena allocations larger than this get their own block
+#define ARENA_BLOCK_SIZE 65536
+
+typedef struct arena_block_s {
+  struct arena_block_s *next;
+  size_t used;
+  size_t size;
+  // malloc alignment
+  max_align_t data[];
+} arena_block_t;
+
+struct p4info_storage_s {
+  char *blob;
+  size_t blob_size;
+  bool mapped;
+  arena_block_t *blocks;
+};
+
 void p4info_init_res(pi_p4info_t *p4info, pi_res_type_id_t res_type, size_t num,
                      size_t e_size, P4InfoRetrieveNameFn retrieve_name_fn,
                      P4InfoFreeOneFn free_fn, P4InfoSerializeFn serialize_fn) {
@@ -33,10 +63,83 @@ void p4info_init_res(pi_p4info_t *p4info, pi_res_type_id_t res_type, size_t num,
   res->free_fn = free_fn;
   res->serialize_fn = serialize_fn;
   res->id_map = (Pvoid_t)NULL;
+  res->dense_map = NULL;
+  res->dense_size = 0;
   res->vec = vector_create_wclean(e_size, num, free_fn);
   res->name_map = (p4info_name_map_t)NULL;
 }
 
+static void storage_destroy(p4info_storage_t *storage) {
+  if (storage->mapped)
+    munmap(storage->blob, storage->blob_size);
+  else
+    free(storage->blob);
+  arena_block_t *block = storage->blocks;
+  while (block) {
+    arena_block_t *next = block->next;
+    free(block);
+    block = next;
+  }
+  free(storage);
+}
+
+void p4info_storage_init(pi_p4info_t *p4info, char *blob, size_t blob_size,
+                         bool mapped) {
+  assert(!p4info->storage);
+  p4info_storage_t *storage = malloc(sizeof(*storage));
+  storage->blob = blob;
+  storage->blob_size = blob_size;
+  storage->mapped = mapped;
+  storage->blocks = NULL;
+  p4info->storage = storage;
+}
+
+static void *arena_alloc(p4info_storage_t *storage, size_t size) {
+  const size_t align = sizeof(max_align_t);
+  size = (size + align - 1) & ~(align - 1);
+  arena_block_t *block = storage->blocks;
+  if (!block || block->size - block->used < size) {
+    size_t block_size = (size > ARENA_BLOCK_SIZE) ? size : ARENA_BLOCK_SIZE;
+    block = malloc(sizeof(*block) + block_size);
+    block->used = 0;
+    block->size = block_size;
+    // a dedicated block for a large allocation does not replace the current
+    // one, which may still have some room
+    if (size > ARENA_BLOCK_SIZE && storage->blocks) {
+      block->next = storage->blocks->next;
+      storage->blocks->next = block;
+    } else {
+      block->next = storage->blocks;
+      storage->blocks = block;
+    }
+  }
+  void *ptr = (char *)block->data + block->used;
+  block->used += size;
+  return ptr;
+}
+
+char *p4info_strdup(pi_p4info_t *p4info, const char *str) {
+  p4info_storage_t *storage = p4info->storage;
+  if (!storage) return strdup(str);
+  if (str >= storage->blob && str < storage->blob + storage->blob_size)
+    return (char *)str;
+  size_t size = strlen(str) + 1;
+  char *copy = arena_alloc(storage, size);
+  memcpy(copy, str, size);
+  return copy;
+}
+
+void *p4info_calloc(pi_p4info_t *p4info, size_t num, size_t size) {
+  if (!p4info->storage) return calloc(num, size);
+  void *ptr = arena_alloc(p4info->storage, num * size);
+  memset(ptr, 0, num * size);
+  return ptr;
+}
+
+void p4info_free(const p4info_common_t *common, void *ptr) {
+  if (!common->in_storage) free(ptr);
+}
+
 void p4info_struct_destroy(pi_p4info_t *p4info) {
   for (size_t i = 0;
        i < sizeof(p4info->resources) / sizeof(p4info->resources[0]); i++) {
@@ -45,6 +148,7 @@ void p4info_struct_destroy(pi_p4info_t *p4info) {
     assert(res->free_fn);
     vector_destroy(res->vec);
     p4info_name_map_destroy(&res->name_map);
+    free(res->dense_map);
     Word_t Rc_word;
 // there is code in Judy headers that raises a warning with some compiler
 // versions
@@ -53,6 +157,9 @@ void p4info_struct_destroy(pi_p4info_t *p4info) {
     JLFA(Rc_word, res->id_map);
 #pragma GCC diagnostic pop
   }
+  // after the objects, which may point into the storage
+  if (p4info->storage) storage_destroy(p4info->storage);
+  p4info->storage = NULL;
 }
 
 // C1x §6.7.2.1.13: "A pointer to a structure object, suitably converted, points
@@ -64,7 +171,47 @@ static p4info_common_t *pi_p4info_get_common(const pi_p4info_t *p4info,
   return (p4info_common_t *)e;
 }
 
-void *p4info_get_at(const pi_p4info_t *p4info, pi_p4_id_t id) {
+static void drop_dense_map(pi_p4info_res_t *res) {
+  free(res->dense_map);
+  res->dense_map = NULL;
+  res->dense_size = 0;
+}
+
+static void build_dense_map(pi_p4info_res_t *res) {
+  drop_dense_map(res);
+  size_t num = vector_size(res->vec);
+  if (num == 0) return;
+  PWord_t PValue;
+  Word_t index = -1;
+  JLL(PValue, res->id_map, index);
+  assert(PValue);
+  size_t span = index + 1;
+  if (span > DENSE_MAP_MIN_SPAN && span / num > DENSE_MAP_MAX_SPARSITY) return;
+  size_t alloc_size = span * sizeof(void *);
+  alloc_size = (alloc_size + CACHE_LINE_SIZE - 1) & ~(CACHE_LINE_SIZE - 1);
+  void *dense_map = NULL;
+  if (posix_memalign(&dense_map, CACHE_LINE_SIZE, alloc_size) != 0) return;
+  memset(dense_map, 0, alloc_size);
+  res->dense_map = dense_map;
+  index = 0;
+  JLF(PValue, res->id_map, index);
+  while (PValue) {
+    res->dense_map[index] = (void *)*PValue;
+    JLN(PValue, res->id_map, index);
+  }
+  res->dense_size = span;
+}
+
+void pi_p4info_freeze(pi_p4info_t *p4info) {
+  for (size_t i = 0;
+       i < sizeof(p4info->resources) / sizeof(p4info->resources[0]); i++) {
+    pi_p4info_res_t *res = &p4info->resources[i];
+    if (!res->is_init) continue;
+    build_dense_map(res);
+  }
+}
+
+void *p4info_get_at_sparse(const pi_p4info_t *p4info, pi_p4_id_t id) {
   const pi_p4info_res_t *res = &p4info->resources[PI_GET_TYPE_ID(id)];
   PWord_t PValue;
   Word_t index = id & 0xFFFFFF;
@@ -74,10 +221,13 @@ void *p4info_get_at(const pi_p4info_t *p4info, pi_p4_id_t id) {
 
 void *p4info_add_res(pi_p4info_t *p4info, pi_p4_id_t id, const char *name) {
   pi_p4info_res_t *res = &p4info->resources[PI_GET_TYPE_ID(id)];
+  // the p4info is being modified, we can no longer trust the dense map
+  drop_dense_map(res);
   p4info_name_map_add(&res->name_map, name, id);
   vector_push_back_empty(res->vec);
   void *new = vector_back(res->vec);
   p4info_common_init((p4info_common_t *)new);
+  ((p4info_common_t *)new)->in_storage = (p4info->storage != NULL);
   PWord_t PValue;
   Word_t index = id & 0xFFFFFF;
   JLI(PValue, res->id_map, index);
@@ -131,8 +281,9 @@ pi_p4_id_t pi_p4info_any_id_from_name(const pi_p4info_t *p4info,
 bool pi_p4info_is_valid_id(const pi_p4info_t *p4info, pi_p4_id_t id) {
   const pi_p4info_res_t *res = &p4info->resources[PI_GET_TYPE_ID(id)];
   if (!res->is_init) return false;
-  PWord_t PValue;
   Word_t index = id & 0xFFFFFF;
+  if (index < res->dense_size) return (res->dense_map[index] != NULL);
+  PWord_t PValue;
   JLG(PValue, res->id_map, index);
   return (PValue != NULL);
 }
@@ -142,14 +293,15 @@ pi_status_t pi_p4info_add_alias(pi_p4info_t *p4info, pi_p4_id_t id,
   pi_p4info_res_t *res = &p4info->resources[PI_GET_TYPE_ID(id)];
   int rc = p4info_name_map_add(&res->name_map, alias, id);
   if (rc == 0) return PI_STATUS_ALIAS_ALREADY_EXISTS;
-  p4info_common_push_back_alias(pi_p4info_get_common(p4info, id), alias);
+  p4info_common_push_back_alias(pi_p4info_get_common(p4info, id),
+                                p4info_strdup(p4info, alias));
   return PI_STATUS_SUCCESS;
 }
 
 pi_status_t pi_p4info_add_annotation(pi_p4info_t *p4info, pi_p4_id_t id,
                                      const char *annotation) {
   p4info_common_push_back_annotation(pi_p4info_get_common(p4info, id),
-                                     annotation);
+                                     p4info_strdup(p4info, annotation));
   return PI_STATUS_SUCCESS;
 }
 
@@ -24,6 +24,7 @@
 #include <PI/int/pi_int.h>
 #include "vector.h"
 
+#include <stdbool.h>
 #include <stddef.h>
 
 #include "p4info_common.h"
@@ -37,9 +38,13 @@ typedef void (*P4InfoSerializeFn)(cJSON *root, const pi_p4info_t *p4info);
 // best that we can do?
 typedef const char *(*P4InfoRetrieveNameFn)(const void *);
 
+// the vectors are only created when the first annotation / alias is added
 struct p4info_common_s {
   vector_t *annotations;
   vector_t *aliases;
+  // true if the object's strings and arrays belong to the p4info storage (see
+  // p4info_storage_init) and must not be released individually
+  bool in_storage;
 };
 
 typedef void *p4info_id_map_t;
@@ -54,13 +59,23 @@ typedef struct {
   // the objects live in the vector, the map is just a way to access them by id
   // without iterating through the vector
   p4info_id_map_t id_map;
+  // flat array indexed by the low 24 bits of the id, built when the p4info is
+  // frozen (see pi_p4info_freeze); NULL if the id space is too sparse, in which
+  // case we fall back to id_map
+  void **dense_map;
+  size_t dense_size;
   vector_t *vec;
   p4info_name_map_t name_map;
 } pi_p4info_res_t;
 
+typedef struct p4info_storage_s p4info_storage_t;
+
 struct pi_p4info_s {
   pi_p4info_res_t resources[PI_RES_TYPE_MAX];
 
+  // NULL unless the p4info was loaded from a binary blob
+  p4info_storage_t *storage;
+
   // for convenience, maybe remove later
   pi_p4info_res_t *actions;
   pi_p4info_res_t *tables;
@@ -76,7 +91,14 @@ static inline size_t num_res(const pi_p4info_t *p4info,
   return vector_size(res->vec);
 }
 
-void *p4info_get_at(const pi_p4info_t *p4info, pi_p4_id_t id);
+void *p4info_get_at_sparse(const pi_p4info_t *p4info, pi_p4_id_t id);
+
+static inline void *p4info_get_at(const pi_p4info_t *p4info, pi_p4_id_t id) {
+  const pi_p4info_res_t *res = &p4info->resources[PI_GET_TYPE_ID(id)];
+  size_t index = id & 0xFFFFFF;
+  if (index < res->dense_size) return res->dense_map[index];
+  return p4info_get_at_sparse(p4info, id);
+}
 
 void p4info_init_res(pi_p4info_t *p4info, pi_res_type_id_t res_type, size_t num,
                      size_t e_size, P4InfoRetrieveNameFn retrieve_name_fn,
@@ -86,4 +108,25 @@ void p4info_struct_destroy(pi_p4info_t *p4info);
 
 void *p4info_add_res(pi_p4info_t *p4info, pi_p4_id_t id, const char *name);
 
+// Objects loaded from a binary blob (see config_readers/binary_reader.c) do not
+// own their strings and arrays: strings point directly into the blob, which the
+// p4info keeps until it is destroyed, and arrays are carved out of a few large
+// arena blocks. This saves several heap allocations per object. Must be called
+// before any object is added; takes ownership of the blob, which is released
+// with munmap if mapped is true and with free otherwise.
+void p4info_storage_init(pi_p4info_t *p4info, char *blob, size_t blob_size,
+                         bool mapped);
+
+// The following functions behave like their libc counterparts, unless the
+// p4info has a storage, in which case the memory is released with the p4info.
+// p4info_strdup does not copy strings which are already in the blob.
+
+char *p4info_strdup(pi_p4info_t *p4info, const char *str);
+
+void *p4info_calloc(pi_p4info_t *p4info, size_t num, size_t size);
+
+// ptr must have been allocated with one of the functions above, for the object
+// which contains common
+void p4info_free(const p4info_common_t *common, void *ptr);
+
 #endif  // PI_SRC_P4INFO_P4INFO_STRUCT_H_
@@ -31,12 +31,13 @@
 
 #define INLINE_MATCH_FIELDS 8
 #define INLINE_ACTIONS 8
-#define INLINE_DIRECT_RES 4
+
+// the id -> index map for match fields is only used if the largest match field
+// id is smaller than this
+#define MAX_MATCH_FIELD_ID_FOR_MAP 1024
 
 typedef struct {
   pi_p4info_match_field_info_t info;
-  size_t offset;
-  char byte0_mask;
 } _match_field_data_t;
 
 typedef struct _table_data_s {
@@ -65,12 +66,12 @@ typedef struct _table_data_s {
   // PI_INVALID_ID if default
   pi_p4_id_t implementation;
   size_t num_direct_resources;
-  union {
-    pi_p4_id_t direct[INLINE_DIRECT_RES];
-    pi_p4_id_t *indirect;
-  } direct_resources;
+  pi_p4_id_t direct_resources[PI_P4INFO_TABLE_MAX_DIRECT_RESOURCES];
   size_t max_size;
-  size_t match_key_size;
+  // match_key_layout.fields is allocated in pi_p4info_table_add and filled in
+  // as match fields are added, the id -> index map is built when the last match
+  // field is added
+  pi_p4info_match_key_layout_t match_key_layout;
 } _table_data_t;
 
 static _table_data_t *get_table(const pi_p4info_t *p4info,
@@ -97,9 +98,7 @@ static pi_p4_id_t *get_action_ids(_table_data_t *table) {
 }
 
 static pi_p4_id_t *get_direct_resources(_table_data_t *table) {
-  return (table->num_direct_resources <= INLINE_DIRECT_RES)
-             ? table->direct_resources.direct
-             : table->direct_resources.indirect;
+  return table->direct_resources;
 }
 
 static const char *retrieve_name(const void *data) {
@@ -128,23 +127,26 @@ static const char *get_match_field_name(_table_data_t *table, pi_p4_id_t id) {
 static void free_table_data(void *data) {
   _table_data_t *table = (_table_data_t *)data;
   if (!table->name) return;
-  free(table->name);
+  const p4info_common_t *common = &table->common;
+  p4info_free(common, table->name);
   _match_field_data_t *match_fields = get_match_field_data(table);
   for (size_t j = 0; j < table->num_match_fields; j++) {
     pi_p4info_match_field_info_t *mf_info = &match_fields[j].info;
     if (!mf_info->name) continue;
-    free(mf_info->name);
+    p4info_free(common, mf_info->name);
   }
   if (table->num_match_fields > INLINE_MATCH_FIELDS) {
     assert(table->match_field_ids.indirect);
     assert(table->match_field_data.indirect);
-    free(table->match_field_ids.indirect);
-    free(table->match_field_data.indirect);
+    p4info_free(common, table->match_field_ids.indirect);
+    p4info_free(common, table->match_field_data.indirect);
   }
   if (table->num_actions > INLINE_ACTIONS) {
     assert(table->action_ids.indirect);
-    free(table->action_ids.indirect);
+    p4info_free(common, table->action_ids.indirect);
   }
+  p4info_free(common, table->match_key_layout.fields);
+  p4info_free(common, table->match_key_layout.id_to_index);
   p4info_common_destroy(&table->common);
 }
 
@@ -212,18 +214,19 @@ void pi_p4info_table_add(pi_p4info_t *p4info, pi_p4_id_t table_id,
                          const char *name, size_t num_match_fields,
                          size_t num_actions, size_t max_size) {
   _table_data_t *table = p4info_add_res(p4info, table_id, name);
-  table->name = strdup(name);
+  table->name = p4info_strdup(p4info, name);
   table->table_id = table_id;
   table->num_match_fields = num_match_fields;
   table->num_actions = num_actions;
   if (num_match_fields > INLINE_MATCH_FIELDS) {
     table->match_field_ids.indirect =
-        calloc(num_match_fields, sizeof(pi_p4_id_t));
+        p4info_calloc(p4info, num_match_fields, sizeof(pi_p4_id_t));
     table->match_field_data.indirect =
-        calloc(num_match_fields, sizeof(_match_field_data_t));
+        p4info_calloc(p4info, num_match_fields, sizeof(_match_field_data_t));
   }
   if (num_actions > INLINE_ACTIONS) {
-    table->action_ids.indirect = calloc(num_actions, sizeof(pi_p4_id_t));
+    table->action_ids.indirect =
+        p4info_calloc(p4info, num_actions, sizeof(pi_p4_id_t));
   }
 
   table->const_default_action_id = PI_INVALID_ID;
@@ -232,7 +235,16 @@ void pi_p4info_table_add(pi_p4info_t *p4info, pi_p4_id_t table_id,
   table->num_direct_resources = 0;
   table->match_fields_added = 0;
   table->max_size = max_size;
-  table->match_key_size = 0;
+
+  pi_p4info_match_key_layout_t *layout = &table->match_key_layout;
+  layout->num_fields = num_match_fields;
+  layout->match_key_size = 0;
+  layout->fields =
+      (num_match_fields > 0)
+          ? p4info_calloc(p4info, num_match_fields, sizeof(*layout->fields))
+          : NULL;
+  layout->id_to_index = NULL;
+  layout->id_to_index_size = 0;
 }
 
 static char get_byte0_mask(size_t bitwidth) {
@@ -241,6 +253,22 @@ static char get_byte0_mask(size_t bitwidth) {
   return ((1 << nbits) - 1);
 }
 
+static void build_match_key_layout_map(pi_p4info_t *p4info,
+                                       pi_p4info_match_key_layout_t *layout) {
+  pi_p4_id_t max_id = 0;
+  for (size_t i = 0; i < layout->num_fields; i++) {
+    if (layout->fields[i].mf_id > max_id) max_id = layout->fields[i].mf_id;
+  }
+  if (max_id >= MAX_MATCH_FIELD_ID_FOR_MAP) return;
+  size_t map_size = max_id + 1;
+  layout->id_to_index =
+      p4info_calloc(p4info, map_size, sizeof(*layout->id_to_index));
+  for (size_t i = 0; i < map_size; i++) layout->id_to_index[i] = (size_t)-1;
+  for (size_t i = 0; i < layout->num_fields; i++)
+    layout->id_to_index[layout->fields[i].mf_id] = i;
+  layout->id_to_index_size = map_size;
+}
+
 void pi_p4info_table_add_match_field(pi_p4info_t *p4info, pi_p4_id_t table_id,
                                      pi_p4_id_t mf_id, const char *name,
                                      pi_p4info_match_type_t match_type,
@@ -251,20 +279,29 @@ void pi_p4info_table_add_match_field(pi_p4info_t *p4info, pi_p4_id_t table_id,
       &get_match_field_data(table)[table->match_fields_added];
   pi_p4info_match_field_info_t *mf_info = &mf_data->info;
   assert(!mf_info->name);
-  mf_info->name = strdup(name);
+  mf_info->name = p4info_strdup(p4info, name);
   mf_info->mf_id = mf_id;
   mf_info->match_type = match_type;
   mf_info->bitwidth = bitwidth;
   get_match_field_ids(table)[table->match_fields_added] = mf_id;
 
-  mf_data->offset = table->match_key_size;
-  mf_data->byte0_mask = get_byte0_mask(bitwidth);
+  pi_p4info_match_key_layout_t *layout = &table->match_key_layout;
+  pi_p4info_match_field_layout_t *mf_layout =
+      &layout->fields[table->match_fields_added];
+  mf_layout->mf_id = mf_id;
+  mf_layout->match_type = match_type;
+  mf_layout->bitwidth = bitwidth;
+  mf_layout->offset = layout->match_key_size;
+  mf_layout->nbytes = (bitwidth + 7) / 8;
+  mf_layout->byte0_mask = get_byte0_mask(bitwidth);
 
   size_t size =
       get_match_key_size_one_field(mf_info->match_type, mf_info->bitwidth);
-  table->match_key_size += size;
+  layout->match_key_size += size;
 
   table->match_fields_added++;
+  if (table->match_fields_added == table->num_match_fields)
+    build_match_key_layout_map(p4info, layout);
 }
 
 void pi_p4info_table_add_action(pi_p4info_t *p4info, pi_p4_id_t table_id,
@@ -297,6 +334,7 @@ void pi_p4info_table_add_direct_resource(pi_p4info_t *p4info,
                                          pi_p4_id_t table_id,
                                          pi_p4_id_t direct_res_id) {
   _table_data_t *table = get_table(p4info, table_id);
+  assert(table->num_direct_resources < PI_P4INFO_TABLE_MAX_DIRECT_RESOURCES);
   get_direct_resources(table)[table->num_direct_resources] = direct_res_id;
   table->num_direct_resources++;
 }
@@ -329,10 +367,8 @@ const pi_p4_id_t *pi_p4info_table_get_match_fields(const pi_p4info_t *p4info,
 bool pi_p4info_table_is_match_field_of(const pi_p4info_t *p4info,
                                        pi_p4_id_t table_id, pi_p4_id_t mf_id) {
   _table_data_t *table = get_table(p4info, table_id);
-  pi_p4_id_t *ids = get_match_field_ids(table);
-  for (size_t i = 0; i < table->num_match_fields; i++)
-    if (ids[i] == mf_id) return true;
-  return false;
+  return pi_p4info_match_key_layout_index(&table->match_key_layout, mf_id) !=
+         (size_t)-1;
 }
 
 pi_p4_id_t pi_p4info_table_match_field_id_from_name(const pi_p4info_t *p4info,
@@ -353,45 +389,49 @@ size_t pi_p4info_table_match_field_index(const pi_p4info_t *p4info,
                                          pi_p4_id_t table_id,
                                          pi_p4_id_t mf_id) {
   _table_data_t *table = get_table(p4info, table_id);
-  pi_p4_id_t *ids = get_match_field_ids(table);
-  for (size_t i = 0; i < table->num_match_fields; i++)
-    if (ids[i] == mf_id) return i;
-  return (size_t)-1;
+  return pi_p4info_match_key_layout_index(&table->match_key_layout, mf_id);
+}
+
+static const pi_p4info_match_field_layout_t *get_match_field_layout(
+    const pi_p4info_t *p4info, pi_p4_id_t table_id, pi_p4_id_t mf_id) {
+  _table_data_t *table = get_table(p4info, table_id);
+  const pi_p4info_match_key_layout_t *layout = &table->match_key_layout;
+  size_t index = pi_p4info_match_key_layout_index(layout, mf_id);
+  if (index == (size_t)-1) return NULL;
+  return &layout->fields[index];
 }
 
 size_t pi_p4info_table_match_field_offset(const pi_p4info_t *p4info,
                                           pi_p4_id_t table_id,
                                           pi_p4_id_t mf_id) {
-  size_t index = pi_p4info_table_match_field_index(p4info, table_id, mf_id);
-  _table_data_t *table = get_table(p4info, table_id);
-  _match_field_data_t *data = &get_match_field_data(table)[index];
-  return data->offset;
+  return get_match_field_layout(p4info, table_id, mf_id)->offset;
 }
 
 size_t pi_p4info_table_match_field_bitwidth(const pi_p4info_t *p4info,
                                             pi_p4_id_t table_id,
                                             pi_p4_id_t mf_id) {
-  size_t invalid = (size_t)-1;
-  size_t index = pi_p4info_table_match_field_index(p4info, table_id, mf_id);
-  if (invalid == index) return invalid;
-  _table_data_t *table = get_table(p4info, table_id);
-  _match_field_data_t *data = &get_match_field_data(table)[index];
-  return data->info.bitwidth;
+  const pi_p4info_match_field_layout_t *mf_layout =
+      get_match_field_layout(p4info, table_id, mf_id);
+  if (!mf_layout) return (size_t)-1;
+  return mf_layout->bitwidth;
 }
 
 size_t pi_p4info_table_match_field_byte0_mask(const pi_p4info_t *p4info,
                                               pi_p4_id_t table_id,
                                               pi_p4_id_t mf_id) {
-  size_t index = pi_p4info_table_match_field_index(p4info, table_id, mf_id);
-  _table_data_t *table = get_table(p4info, table_id);
-  _match_field_data_t *data = &get_match_field_data(table)[index];
-  return data->byte0_mask;
+  return get_match_field_layout(p4info, table_id, mf_id)->byte0_mask;
 }
 
 size_t pi_p4info_table_match_key_size(const pi_p4info_t *p4info,
                                       pi_p4_id_t table_id) {
   _table_data_t *table = get_table(p4info, table_id);
-  return table->match_key_size;
+  return table->match_key_layout.match_key_size;
+}
+
+const pi_p4info_match_key_layout_t *pi_p4info_table_match_key_layout(
+    const pi_p4info_t *p4info, pi_p4_id_t table_id) {
+  _table_data_t *table = get_table(p4info, table_id);
+  return &table->match_key_layout;
 }
 
 const pi_p4info_match_field_info_t *pi_p4info_table_match_field_info(
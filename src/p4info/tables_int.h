@@ -27,6 +27,9 @@
 extern "C" {
 #endif
 
+// maximum number of direct resources (e.g. counters, meters) per table
+#define PI_P4INFO_TABLE_MAX_DIRECT_RESOURCES 4
+
 void pi_p4info_table_init(pi_p4info_t *p4info, size_t num_tables);
 
 void pi_p4info_table_add(pi_p4info_t *p4info, pi_p4_id_t table_id,
@@ -44,6 +44,12 @@ char const *const *pi_p4info_get_annotations(const pi_p4info_t *p4info,
                                              pi_p4_id_t id,
                                              size_t *num_annotations);
 
+//! Builds the dense id -> object maps used to speed-up all p4info queries. Must
+//! be called once the p4info object is fully populated (the config readers do
+//! it for you). Adding a resource after this call is supported but will
+//! invalidate the dense map for that resource type.
+void pi_p4info_freeze(pi_p4info_t *p4info);
+
 #ifdef __cplusplus
 }
 #endif
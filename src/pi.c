@@ -22,11 +22,16 @@
 #include "PI/int/pi_int.h"
 #include "PI/int/serialize.h"
 #include "PI/target/pi_imp.h"
+#include "pi_counter_cache.h"
 #include "utils/logging.h"
 
 #include <stdlib.h>
 #include <string.h>
 
+// optional target function, its address is NULL if the target does not
+// implement it
+#pragma weak _pi_update_device_preserves_state
+
 #define MAX_DEVICES 256
 
 static size_t num_devices;
@@ -138,6 +143,8 @@ pi_status_t pi_update_device_start(pi_dev_id_t dev_id,
                                    const pi_p4info_t *p4info,
                                    const char *device_data,
                                    size_t device_data_size) {
+  // counter ids and sizes may change with the new config
+  pi_counter_cache_remove_device(dev_id);
   pi_status_t status =
       _pi_update_device_start(dev_id, p4info, device_data, device_data_size);
   if (status == PI_STATUS_SUCCESS) pi_update_device_config(dev_id, p4info);
@@ -149,6 +156,11 @@ pi_status_t pi_update_device_end(pi_dev_id_t dev_id) {
   return _pi_update_device_end(dev_id);
 }
 
+bool pi_update_device_preserves_state(pi_dev_id_t dev_id) {
+  if (!_pi_update_device_preserves_state) return false;
+  return _pi_update_device_preserves_state(dev_id);
+}
+
 bool pi_is_device_assigned(pi_dev_id_t dev_id) {
   if (dev_id >= num_devices) return false;
   pi_device_info_t *info = &device_mapping[dev_id];
@@ -161,6 +173,7 @@ pi_status_t pi_remove_device(pi_dev_id_t dev_id) {
   pi_device_info_t *info = &device_mapping[dev_id];
   if (!info->version) return PI_STATUS_DEV_NOT_ASSIGNED;
 
+  pi_counter_cache_remove_device(dev_id);
   pi_status_t status = _pi_remove_device(dev_id);
   if (status == PI_STATUS_SUCCESS) pi_reset_device_config(dev_id);
 
@@ -184,6 +197,7 @@ pi_status_t pi_batch_end(pi_session_handle_t session_handle, bool hw_sync) {
 }
 
 pi_status_t pi_destroy() {
+  pi_counter_cache_destroy();
   free(device_mapping);
   device_mapping = NULL;
   num_devices = 0;
@@ -22,6 +22,12 @@
 #include <PI/pi_counter.h>
 #include <PI/target/pi_counter_imp.h>
 
+#include "pi_counter_cache.h"
+
+// the range read target function is optional, its address is NULL if the target
+// does not implement it
+#pragma weak _pi_counter_read_range
+
 static bool is_direct_counter(const pi_p4info_t *p4info,
                               pi_p4_id_t counter_id) {
   return (pi_p4info_counter_get_direct(p4info, counter_id) != PI_INVALID_ID);
@@ -34,10 +40,45 @@ pi_status_t pi_counter_read(pi_session_handle_t session_handle,
   const pi_p4info_t *p4info = pi_get_device_p4info(dev_tgt.dev_id);
   if (!p4info) return PI_STATUS_DEV_NOT_ASSIGNED;
   if (is_direct_counter(p4info, counter_id)) return PI_STATUS_COUNTER_IS_DIRECT;
+  if (flags & PI_COUNTER_FLAGS_CACHED) {
+    if (pi_counter_cache_read(dev_tgt, counter_id, index, 1, counter_data) ==
+        PI_STATUS_SUCCESS)
+      return PI_STATUS_SUCCESS;
+    flags &= ~PI_COUNTER_FLAGS_CACHED;
+  }
   return _pi_counter_read(session_handle, dev_tgt, counter_id, index, flags,
                           counter_data);
 }
 
+pi_status_t pi_counter_read_range(pi_session_handle_t session_handle,
+                                  pi_dev_tgt_t dev_tgt, pi_p4_id_t counter_id,
+                                  size_t start, size_t count, int flags,
+                                  pi_counter_data_t *counter_data) {
+  const pi_p4info_t *p4info = pi_get_device_p4info(dev_tgt.dev_id);
+  if (!p4info) return PI_STATUS_DEV_NOT_ASSIGNED;
+  if (is_direct_counter(p4info, counter_id)) return PI_STATUS_COUNTER_IS_DIRECT;
+  size_t size = pi_p4info_counter_get_size(p4info, counter_id);
+  if (start > size || count > size - start) return PI_STATUS_OUT_OF_BOUND_IDX;
+  if (count == 0) return PI_STATUS_SUCCESS;
+  if (flags & PI_COUNTER_FLAGS_CACHED) {
+    if (pi_counter_cache_read(dev_tgt, counter_id, start, count,
+                              counter_data) == PI_STATUS_SUCCESS)
+      return PI_STATUS_SUCCESS;
+    flags &= ~PI_COUNTER_FLAGS_CACHED;
+  }
+  if (_pi_counter_read_range) {
+    return _pi_counter_read_range(session_handle, dev_tgt, counter_id, start,
+                                  count, flags, counter_data);
+  }
+  for (size_t i = 0; i < count; i++) {
+    pi_status_t status =
+        _pi_counter_read(session_handle, dev_tgt, counter_id, start + i, flags,
+                         &counter_data[i]);
+    if (status != PI_STATUS_SUCCESS) return status;
+  }
+  return PI_STATUS_SUCCESS;
+}
+
 pi_status_t pi_counter_write(pi_session_handle_t session_handle,
                              pi_dev_tgt_t dev_tgt, pi_p4_id_t counter_id,
                              size_t index,
@@ -45,8 +86,11 @@ pi_status_t pi_counter_write(pi_session_handle_t session_handle,
   const pi_p4info_t *p4info = pi_get_device_p4info(dev_tgt.dev_id);
   if (!p4info) return PI_STATUS_DEV_NOT_ASSIGNED;
   if (is_direct_counter(p4info, counter_id)) return PI_STATUS_COUNTER_IS_DIRECT;
-  return _pi_counter_write(session_handle, dev_tgt, counter_id, index,
-                           counter_data);
+  pi_status_t status = _pi_counter_write(session_handle, dev_tgt, counter_id,
+                                         index, counter_data);
+  if (status == PI_STATUS_SUCCESS)
+    pi_counter_cache_write(dev_tgt, counter_id, index, counter_data);
+  return status;
 }
 
 pi_status_t pi_counter_read_direct(pi_session_handle_t session_handle,
@@ -0,0 +1,432 @@
+/* Copyright 2013-present Barefoot Networks, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Antonin Bas (antonin@barefootnetworks.com)
+ *
+ */
+
+#include <PI/p4info/counters.h>
+#include <PI/pi.h>
+#include <PI/pi_counter.h>
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "pi_counter_cache.h"
+
+// number of cells requested from the target at a time by the poller
+#define POLL_CHUNK_SIZE 1024
+
+// Snapshots hold 64-bit values accumulated in software, so that hardware
+// counters narrower than 64 bits can wrap around between 2 polls.
+typedef struct {
+  // cells are stored as a structure of arrays
+  uint64_t *packets;
+  uint64_t *bytes;
+  int valid;
+  // 0 if the snapshot has not been taken yet
+  uint64_t ts_ns;
+} snapshot_t;
+
+typedef struct cached_counter_s {
+  struct cached_counter_s *next;
+  pi_dev_tgt_t dev_tgt;
+  pi_p4_id_t counter_id;
+  size_t size;
+  // (1 << width) - 1, where width is the width of the hardware counter
+  uint64_t wrap_mask;
+  // last values read from the target, before accumulation
+  uint64_t *raw_packets;
+  uint64_t *raw_bytes;
+  // incremented every time the poller starts reading the counter; a cell whose
+  // write_gen is equal to poll_gen was written during the current poll, in
+  // which case the value read by the poller may be stale and is ignored
+  uint64_t poll_gen;
+  uint64_t *write_gen;
+  uint64_t poll_interval_ns;
+  uint64_t max_staleness_ns;
+  uint64_t next_poll_ns;
+  // curr is the most recent snapshot and prev the one before it; they are only
+  // accessed with the lock held. The poller fills back without holding the lock
+  // and then rotates the 3 buffers.
+  snapshot_t *curr;
+  snapshot_t *prev;
+  snapshot_t *back;
+  snapshot_t snapshots[3];
+  // true while the poller is reading the counter from the target
+  bool polling;
+} cached_counter_t;
+
+static struct {
+  pthread_mutex_t lock;
+  // signaled to wake up the poller when the set of cached counters changes
+  pthread_cond_t poller_cond;
+  // signaled by the poller every time it is done polling a counter
+  pthread_cond_t poll_done_cond;
+  pthread_t poller;
+  bool running;
+  bool stop;
+  cached_counter_t *counters;
+} cache = {.lock = PTHREAD_MUTEX_INITIALIZER};
+
+static uint64_t now_ns() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+static cached_counter_t **find_counter(pi_dev_id_t dev_id,
+                                       pi_p4_id_t counter_id) {
+  cached_counter_t **c;
+  for (c = &cache.counters; *c; c = &(*c)->next) {
+    if ((*c)->dev_tgt.dev_id == dev_id && (*c)->counter_id == counter_id)
+      break;
+  }
+  return c;
+}
+
+static void counter_free(cached_counter_t *c) {
+  for (size_t i = 0; i < 3; i++) {
+    free(c->snapshots[i].packets);
+    free(c->snapshots[i].bytes);
+  }
+  free(c->raw_packets);
+  free(c->raw_bytes);
+  free(c->write_gen);
+  free(c);
+}
+
+static cached_counter_t *counter_create(pi_dev_tgt_t dev_tgt,
+                                        pi_p4_id_t counter_id, size_t size,
+                                        size_t width) {
+  cached_counter_t *c = calloc(1, sizeof(*c));
+  if (!c) return NULL;
+  c->dev_tgt = dev_tgt;
+  c->counter_id = counter_id;
+  c->size = size;
+  c->wrap_mask = (width >= 64) ? UINT64_MAX : (UINT64_C(1) << width) - 1;
+  // everything starts at 0, so that the first poll accumulates the initial
+  // values read from the target
+  c->raw_packets = calloc(size, sizeof(*c->raw_packets));
+  c->raw_bytes = calloc(size, sizeof(*c->raw_bytes));
+  c->write_gen = calloc(size, sizeof(*c->write_gen));
+  if (!c->raw_packets || !c->raw_bytes || !c->write_gen) {
+    counter_free(c);
+    return NULL;
+  }
+  for (size_t i = 0; i < 3; i++) {
+    snapshot_t *snapshot = &c->snapshots[i];
+    snapshot->packets = calloc(size, sizeof(*snapshot->packets));
+    snapshot->bytes = calloc(size, sizeof(*snapshot->bytes));
+    if (!snapshot->packets || !snapshot->bytes) {
+      counter_free(c);
+      return NULL;
+    }
+  }
+  c->curr = &c->snapshots[0];
+  c->prev = &c->snapshots[1];
+  c->back = &c->snapshots[2];
+  return c;
+}
+
+// unlinks the counter from the cache and frees it once the poller is done with
+// it; must be called with the lock held
+static void counter_remove(cached_counter_t **c_ptr) {
+  cached_counter_t *c = *c_ptr;
+  *c_ptr = c->next;
+  while (c->polling) pthread_cond_wait(&cache.poll_done_cond, &cache.lock);
+  counter_free(c);
+}
+
+// reads the whole counter array into c->back, called without the lock held
+static pi_status_t poll_counter(pi_session_handle_t session_handle,
+                                cached_counter_t *c,
+                                pi_counter_data_t *buffer) {
+  snapshot_t *snapshot = c->back;
+  snapshot->valid = 0;
+  // a single blocking sync for the whole array, rather than one per range read
+  pi_status_t status = pi_counter_hw_sync(session_handle, c->dev_tgt,
+                                          c->counter_id, NULL, NULL);
+  if (status != PI_STATUS_SUCCESS) return status;
+  for (size_t start = 0; start < c->size; start += POLL_CHUNK_SIZE) {
+    size_t count = c->size - start;
+    if (count > POLL_CHUNK_SIZE) count = POLL_CHUNK_SIZE;
+    status = pi_counter_read_range(session_handle, c->dev_tgt, c->counter_id,
+                                   start, count, PI_COUNTER_FLAGS_NONE, buffer);
+    if (status != PI_STATUS_SUCCESS) return status;
+    for (size_t i = 0; i < count; i++) {
+      snapshot->valid |= buffer[i].valid;
+      snapshot->packets[start + i] = buffer[i].packets;
+      snapshot->bytes[start + i] = buffer[i].bytes;
+    }
+  }
+  snapshot->ts_ns = now_ns();
+  return PI_STATUS_SUCCESS;
+}
+
+// On input, values holds the raw values read from the target and on output the
+// accumulated ones. Because the hardware value is masked, the difference with
+// the previous raw value is correct even if the counter wrapped around once.
+static void accumulate(size_t size, uint64_t wrap_mask,
+                       const uint64_t *restrict prev, uint64_t *restrict raw,
+                       uint64_t *restrict values) {
+  for (size_t i = 0; i < size; i++) {
+    uint64_t v = values[i];
+    values[i] = prev[i] + ((v - raw[i]) & wrap_mask);
+    raw[i] = v;
+  }
+}
+
+// for the cells written since the poll started, replaces the values read by the
+// poller with the written raw values, so that the accumulated values are the
+// written ones; must be called with the lock held
+static void discard_written(cached_counter_t *c) {
+  for (size_t i = 0; i < c->size; i++) {
+    if (c->write_gen[i] != c->poll_gen) continue;
+    c->back->packets[i] = c->raw_packets[i];
+    c->back->bytes[i] = c->raw_bytes[i];
+  }
+}
+
+static void *poller_loop(void *arg) {
+  (void)arg;
+  pi_session_handle_t session_handle;
+  pi_session_init(&session_handle);
+  pi_counter_data_t *buffer = malloc(POLL_CHUNK_SIZE * sizeof(*buffer));
+
+  pthread_mutex_lock(&cache.lock);
+  while (!cache.stop) {
+    uint64_t now = now_ns();
+    cached_counter_t *next = NULL;
+    for (cached_counter_t *c = cache.counters; c; c = c->next) {
+      if (!next || c->next_poll_ns < next->next_poll_ns) next = c;
+    }
+    if (!next) {
+      pthread_cond_wait(&cache.poller_cond, &cache.lock);
+      continue;
+    }
+    if (next->next_poll_ns > now) {
+      struct timespec deadline;
+      deadline.tv_sec = next->next_poll_ns / 1000000000u;
+      deadline.tv_nsec = next->next_poll_ns % 1000000000u;
+      pthread_cond_timedwait(&cache.poller_cond, &cache.lock, &deadline);
+      continue;
+    }
+
+    next->polling = true;
+    next->poll_gen++;
+    pthread_mutex_unlock(&cache.lock);
+    pi_status_t status = poll_counter(session_handle, next, buffer);
+    pthread_mutex_lock(&cache.lock);
+    next->polling = false;
+    if (status == PI_STATUS_SUCCESS) {
+      // done with the lock held as pi_counter_cache_write may update curr
+      discard_written(next);
+      accumulate(next->size, next->wrap_mask, next->curr->packets,
+                 next->raw_packets, next->back->packets);
+      accumulate(next->size, next->wrap_mask, next->curr->bytes,
+                 next->raw_bytes, next->back->bytes);
+      snapshot_t *tmp = next->prev;
+      next->prev = next->curr;
+      next->curr = next->back;
+      next->back = tmp;
+    }
+    next->next_poll_ns = now + next->poll_interval_ns;
+    pthread_cond_broadcast(&cache.poll_done_cond);
+  }
+  pthread_mutex_unlock(&cache.lock);
+
+  free(buffer);
+  pi_session_cleanup(session_handle);
+  return NULL;
+}
+
+// must be called with the lock held
+static pi_status_t poller_start() {
+  if (cache.running) return PI_STATUS_SUCCESS;
+  pthread_condattr_t attr;
+  pthread_condattr_init(&attr);
+  pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+  pthread_cond_init(&cache.poller_cond, &attr);
+  pthread_condattr_destroy(&attr);
+  pthread_cond_init(&cache.poll_done_cond, NULL);
+  cache.stop = false;
+  if (pthread_create(&cache.poller, NULL, poller_loop, NULL) != 0) {
+    pthread_cond_destroy(&cache.poller_cond);
+    pthread_cond_destroy(&cache.poll_done_cond);
+    return PI_STATUS_ALLOC_ERROR;
+  }
+  cache.running = true;
+  return PI_STATUS_SUCCESS;
+}
+
+pi_status_t pi_counter_cache_enable(pi_dev_tgt_t dev_tgt, pi_p4_id_t counter_id,
+                                    const pi_counter_cache_config_t *config) {
+  const pi_p4info_t *p4info = pi_get_device_p4info(dev_tgt.dev_id);
+  if (!p4info) return PI_STATUS_DEV_NOT_ASSIGNED;
+  if (pi_p4info_counter_get_direct(p4info, counter_id) != PI_INVALID_ID)
+    return PI_STATUS_COUNTER_IS_DIRECT;
+  if (config->poll_interval_ms == 0)
+    return PI_STATUS_COUNTER_CACHE_INVALID_CONFIG;
+  uint64_t poll_interval_ns = config->poll_interval_ms * 1000000ull;
+  uint64_t max_staleness_ns = (config->max_staleness_ms == 0)
+                                  ? 2 * poll_interval_ns
+                                  : config->max_staleness_ms * 1000000ull;
+
+  pthread_mutex_lock(&cache.lock);
+  pi_status_t status = poller_start();
+  if (status != PI_STATUS_SUCCESS) {
+    pthread_mutex_unlock(&cache.lock);
+    return status;
+  }
+  cached_counter_t *c = *find_counter(dev_tgt.dev_id, counter_id);
+  if (!c) {
+    size_t size = pi_p4info_counter_get_size(p4info, counter_id);
+    size_t width = pi_p4info_counter_get_width(p4info, counter_id);
+    c = counter_create(dev_tgt, counter_id, size, width);
+    if (!c) {
+      pthread_mutex_unlock(&cache.lock);
+      return PI_STATUS_ALLOC_ERROR;
+    }
+    c->next = cache.counters;
+    cache.counters = c;
+  }
+  c->poll_interval_ns = poll_interval_ns;
+  c->max_staleness_ns = max_staleness_ns;
+  // take the first snapshot right away
+  c->next_poll_ns = now_ns();
+  pthread_cond_signal(&cache.poller_cond);
+  pthread_mutex_unlock(&cache.lock);
+  return PI_STATUS_SUCCESS;
+}
+
+pi_status_t pi_counter_cache_disable(pi_dev_tgt_t dev_tgt,
+                                     pi_p4_id_t counter_id) {
+  pthread_mutex_lock(&cache.lock);
+  cached_counter_t **c_ptr = find_counter(dev_tgt.dev_id, counter_id);
+  pi_status_t status = PI_STATUS_COUNTER_NOT_CACHED;
+  if (*c_ptr) {
+    counter_remove(c_ptr);
+    status = PI_STATUS_SUCCESS;
+  }
+  pthread_mutex_unlock(&cache.lock);
+  return status;
+}
+
+pi_status_t pi_counter_cache_read(pi_dev_tgt_t dev_tgt, pi_p4_id_t counter_id,
+                                  size_t start, size_t count,
+                                  pi_counter_data_t *counter_data) {
+  pthread_mutex_lock(&cache.lock);
+  const cached_counter_t *c = *find_counter(dev_tgt.dev_id, counter_id);
+  pi_status_t status = PI_STATUS_COUNTER_NOT_CACHED;
+  if (c && c->curr->ts_ns != 0 &&
+      now_ns() - c->curr->ts_ns <= c->max_staleness_ns &&
+      start <= c->size && count <= c->size - start) {
+    const snapshot_t *snapshot = c->curr;
+    for (size_t i = 0; i < count; i++) {
+      counter_data[i].valid = snapshot->valid;
+      counter_data[i].packets = snapshot->packets[start + i];
+      counter_data[i].bytes = snapshot->bytes[start + i];
+    }
+    status = PI_STATUS_SUCCESS;
+  }
+  pthread_mutex_unlock(&cache.lock);
+  return status;
+}
+
+pi_status_t pi_counter_read_rate(pi_dev_tgt_t dev_tgt, pi_p4_id_t counter_id,
+                                 size_t index, pi_counter_rate_t *rate) {
+  pthread_mutex_lock(&cache.lock);
+  const cached_counter_t *c = *find_counter(dev_tgt.dev_id, counter_id);
+  if (!c || c->prev->ts_ns == 0) {
+    pthread_mutex_unlock(&cache.lock);
+    return PI_STATUS_COUNTER_NOT_CACHED;
+  }
+  if (index >= c->size) {
+    pthread_mutex_unlock(&cache.lock);
+    return PI_STATUS_OUT_OF_BOUND_IDX;
+  }
+  const snapshot_t *curr = c->curr;
+  const snapshot_t *prev = c->prev;
+  // if the counter went backwards, it was written in between
+  uint64_t packets = curr->packets[index];
+  if (packets >= prev->packets[index]) packets -= prev->packets[index];
+  uint64_t bytes = curr->bytes[index];
+  if (bytes >= prev->bytes[index]) bytes -= prev->bytes[index];
+  rate->delta.valid = curr->valid;
+  rate->delta.packets = packets;
+  rate->delta.bytes = bytes;
+  rate->interval_ns = curr->ts_ns - prev->ts_ns;
+  pthread_mutex_unlock(&cache.lock);
+
+  double interval_s = rate->interval_ns / 1e9;
+  rate->packets_per_sec = packets / interval_s;
+  rate->bytes_per_sec = bytes / interval_s;
+  return PI_STATUS_SUCCESS;
+}
+
+void pi_counter_cache_write(pi_dev_tgt_t dev_tgt, pi_p4_id_t counter_id,
+                            size_t index,
+                            const pi_counter_data_t *counter_data) {
+  pthread_mutex_lock(&cache.lock);
+  cached_counter_t *c = *find_counter(dev_tgt.dev_id, counter_id);
+  if (c && index < c->size) {
+    // the next poll will accumulate from the written values
+    c->write_gen[index] = c->poll_gen;
+    if (counter_data->valid & PI_COUNTER_UNIT_PACKETS) {
+      c->curr->packets[index] = counter_data->packets;
+      c->raw_packets[index] = counter_data->packets & c->wrap_mask;
+    }
+    if (counter_data->valid & PI_COUNTER_UNIT_BYTES) {
+      c->curr->bytes[index] = counter_data->bytes;
+      c->raw_bytes[index] = counter_data->bytes & c->wrap_mask;
+    }
+  }
+  pthread_mutex_unlock(&cache.lock);
+}
+
+void pi_counter_cache_remove_device(pi_dev_id_t dev_id) {
+  pthread_mutex_lock(&cache.lock);
+  cached_counter_t **c_ptr = &cache.counters;
+  while (*c_ptr) {
+    if ((*c_ptr)->dev_tgt.dev_id == dev_id)
+      counter_remove(c_ptr);
+    else
+      c_ptr = &(*c_ptr)->next;
+  }
+  pthread_mutex_unlock(&cache.lock);
+}
+
+void pi_counter_cache_destroy() {
+  pthread_mutex_lock(&cache.lock);
+  if (!cache.running) {
+    pthread_mutex_unlock(&cache.lock);
+    return;
+  }
+  cache.stop = true;
+  pthread_cond_signal(&cache.poller_cond);
+  pthread_mutex_unlock(&cache.lock);
+  pthread_join(cache.poller, NULL);
+
+  while (cache.counters) counter_remove(&cache.counters);
+  pthread_cond_destroy(&cache.poller_cond);
+  pthread_cond_destroy(&cache.poll_done_cond);
+  cache.running = false;
+}
@@ -0,0 +1,46 @@
+/* Copyright 2013-present Barefoot Networks, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Antonin Bas (antonin@barefootnetworks.com)
+ *
+ */
+
+#ifndef PI_SRC_PI_COUNTER_CACHE_H_
+#define PI_SRC_PI_COUNTER_CACHE_H_
+
+#include <PI/pi_counter.h>
+
+// Copies cells [start, start + count) of a cached counter from the most recent
+// snapshot. Returns PI_STATUS_COUNTER_NOT_CACHED if the counter is not cached
+// or if the snapshot is older than the staleness bound.
+pi_status_t pi_counter_cache_read(pi_dev_tgt_t dev_tgt, pi_p4_id_t counter_id,
+                                  size_t start, size_t count,
+                                  pi_counter_data_t *counter_data);
+
+// Must be called after a successful write to an indirect counter, so that the
+// accumulated value of the cell restarts from the written value.
+void pi_counter_cache_write(pi_dev_tgt_t dev_tgt, pi_p4_id_t counter_id,
+                            size_t index,
+                            const pi_counter_data_t *counter_data);
+
+// Drops all cached counters for the device, waiting for an in-progress poll to
+// complete.
+void pi_counter_cache_remove_device(pi_dev_id_t dev_id);
+
+// Drops all cached counters and stops the poller thread.
+void pi_counter_cache_destroy();
+
+#endif  // PI_SRC_PI_COUNTER_CACHE_H_
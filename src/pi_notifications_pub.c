@@ -24,7 +24,11 @@
 #include <nanomsg/nn.h>
 #include <nanomsg/pubsub.h>
 
+#include <pthread.h>
+#include <stddef.h>
+#include <stdlib.h>
 #include <string.h>
+#include <time.h>
 
 #include "_assert.h"
 #include "pi_notifications_pub.h"
@@ -32,6 +36,30 @@
 static char *addr = NULL;
 static int pub_socket = 0;
 
+#define PACKETIN_BATCH_DEFAULT_MAX_BYTES 65536
+#define PACKETIN_BATCH_DEFAULT_MAX_DELAY_US 1000
+
+typedef struct packetin_batch_s {
+  struct packetin_batch_s *next;
+  pi_dev_id_t dev_id;
+  // allocated with room for max_bytes after the header, NULL when empty
+  char *msg;
+  size_t size;
+  size_t num;
+  // the batch is published when this is reached, even if not full
+  struct timespec deadline;
+} packetin_batch_t;
+
+static struct {
+  pi_notifications_packetin_batch_config_t config;
+  pthread_mutex_t lock;
+  // uses CLOCK_MONOTONIC, signaled when a batch receives its first packet
+  pthread_cond_t cond;
+  // one per device, never removed
+  packetin_batch_t *batches;
+  pthread_t flush_thread;
+} packetin;
+
 static size_t emit_notifications_topic(char *dst, const char *topic) {
   memcpy(dst, topic, sizeof(s_pi_notifications_topic_t));
   return sizeof(s_pi_notifications_topic_t);
@@ -70,8 +98,8 @@ void pi_notifications_pub_learn(const pi_learn_msg_t *msg) {
   pub_notification(pub_msg, pub_msg_size);
 }
 
-void pi_notifications_pub_packetin(pi_dev_id_t dev_id, const char *pkt,
-                                   size_t size) {
+static void pub_packetin_one(pi_dev_id_t dev_id, const char *pkt,
+                             size_t size) {
   size_t pub_msg_size = sizeof(s_pi_notifications_topic_t);
   pub_msg_size += sizeof(s_pi_dev_id_t);
   pub_msg_size += sizeof(uint32_t);
@@ -86,11 +114,136 @@ void pi_notifications_pub_packetin(pi_dev_id_t dev_id, const char *pkt,
   pub_notification(pub_msg, pub_msg_size);
 }
 
+static bool batching_enabled() { return packetin.config.max_packets > 1; }
+
+static size_t batch_capacity() {
+  return sizeof(s_pi_packetin_batch_hdr_t) + packetin.config.max_bytes;
+}
+
+// must be called with the lock held
+static void batch_publish(packetin_batch_t *batch) {
+  emit_uint32(batch->msg + offsetof(s_pi_packetin_batch_hdr_t, num),
+              batch->num);
+  // shrinking the message does not copy it
+  char *msg = nn_reallocmsg(batch->msg, batch->size);
+  pub_notification(msg, batch->size);
+  batch->msg = NULL;
+  batch->size = 0;
+  batch->num = 0;
+}
+
+// must be called with the lock held
+static packetin_batch_t *batch_get(pi_dev_id_t dev_id) {
+  packetin_batch_t *batch = packetin.batches;
+  while (batch && batch->dev_id != dev_id) batch = batch->next;
+  if (batch) return batch;
+  batch = calloc(1, sizeof(*batch));
+  batch->dev_id = dev_id;
+  batch->next = packetin.batches;
+  packetin.batches = batch;
+  return batch;
+}
+
+static bool deadline_reached(const struct timespec *deadline,
+                             const struct timespec *now) {
+  return (now->tv_sec > deadline->tv_sec) ||
+         (now->tv_sec == deadline->tv_sec && now->tv_nsec >= deadline->tv_nsec);
+}
+
+// publishes the batches which are not full after max_delay_us
+static void *flush_loop(void *arg) {
+  (void)arg;
+  pthread_mutex_lock(&packetin.lock);
+  while (1) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    struct timespec *next_deadline = NULL;
+    for (packetin_batch_t *batch = packetin.batches; batch;
+         batch = batch->next) {
+      if (!batch->msg) continue;
+      if (deadline_reached(&batch->deadline, &now)) {
+        batch_publish(batch);
+      } else if (!next_deadline ||
+                 deadline_reached(next_deadline, &batch->deadline)) {
+        next_deadline = &batch->deadline;
+      }
+    }
+    if (next_deadline) {
+      struct timespec deadline = *next_deadline;
+      pthread_cond_timedwait(&packetin.cond, &packetin.lock, &deadline);
+    } else {
+      pthread_cond_wait(&packetin.cond, &packetin.lock);
+    }
+  }
+  pthread_mutex_unlock(&packetin.lock);
+  return NULL;
+}
+
+void pi_notifications_pub_packetin(pi_dev_id_t dev_id, const char *pkt,
+                                   size_t size) {
+  if (!batching_enabled()) {
+    pub_packetin_one(dev_id, pkt, size);
+    return;
+  }
+
+  size_t required = sizeof(uint32_t) + size;
+  pthread_mutex_lock(&packetin.lock);
+  packetin_batch_t *batch = batch_get(dev_id);
+  if (batch->msg && batch->size + required > batch_capacity())
+    batch_publish(batch);
+  // too big for a batch, the pending packets are published first to preserve
+  // ordering
+  if (sizeof(s_pi_packetin_batch_hdr_t) + required > batch_capacity()) {
+    pub_packetin_one(dev_id, pkt, size);
+    pthread_mutex_unlock(&packetin.lock);
+    return;
+  }
+
+  if (!batch->msg) {
+    batch->msg = nn_allocmsg(batch_capacity(), 0);
+    batch->size = 0;
+    batch->size += emit_notifications_topic(batch->msg, "PIPKB|");
+    batch->size += emit_dev_id(batch->msg + batch->size, dev_id);
+    batch->size += sizeof(uint32_t);  // num, written when publishing
+    clock_gettime(CLOCK_MONOTONIC, &batch->deadline);
+    uint64_t nsec =
+        batch->deadline.tv_nsec + packetin.config.max_delay_us * 1000ull;
+    batch->deadline.tv_sec += nsec / 1000000000ull;
+    batch->deadline.tv_nsec = nsec % 1000000000ull;
+    pthread_cond_signal(&packetin.cond);
+  }
+  batch->size += emit_uint32(batch->msg + batch->size, size);
+  memcpy(batch->msg + batch->size, pkt, size);
+  batch->size += size;
+  if (++batch->num >= packetin.config.max_packets) batch_publish(batch);
+  pthread_mutex_unlock(&packetin.lock);
+}
+
+void pi_notifications_set_packetin_batching(
+    const pi_notifications_packetin_batch_config_t *config) {
+  packetin.config = *config;
+  if (packetin.config.max_bytes == 0)
+    packetin.config.max_bytes = PACKETIN_BATCH_DEFAULT_MAX_BYTES;
+  if (packetin.config.max_delay_us == 0)
+    packetin.config.max_delay_us = PACKETIN_BATCH_DEFAULT_MAX_DELAY_US;
+}
+
 pi_status_t pi_notifications_init(const char *notifications_addr) {
   assert(notifications_addr);
   addr = strdup(notifications_addr);
   pub_socket = nn_socket(AF_SP, NN_PUB);
   assert(pub_socket >= 0);
   if (nn_bind(pub_socket, addr) < 0) return PI_STATUS_NOTIF_BIND_ERROR;
+
+  if (batching_enabled()) {
+    pthread_mutex_init(&packetin.lock, NULL);
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&packetin.cond, &attr);
+    pthread_condattr_destroy(&attr);
+    if (pthread_create(&packetin.flush_thread, NULL, flush_loop, NULL) != 0)
+      return PI_STATUS_ALLOC_ERROR;
+  }
   return PI_STATUS_SUCCESS;
 }
@@ -23,6 +23,21 @@
 
 #include <PI/pi_learn.h>
 
+// Packet-ins for a given device are accumulated and published together as a
+// single "PIPKB|" notification once the batch reaches max_packets packets or
+// max_bytes bytes, or max_delay_us microseconds after its first packet. A
+// max_packets value of 0 or 1 disables batching (the default), in which case
+// each packet is published as a "PIPKT|" notification.
+typedef struct {
+  size_t max_packets;
+  size_t max_bytes;
+  uint32_t max_delay_us;
+} pi_notifications_packetin_batch_config_t;
+
+// must be called before pi_notifications_init
+void pi_notifications_set_packetin_batching(
+    const pi_notifications_packetin_batch_config_t *config);
+
 pi_status_t pi_notifications_init(const char *notifications_addr);
 
 void pi_notifications_pub_learn(const pi_learn_msg_t *msg);
@@ -21,6 +21,7 @@
 #include "PI/int/pi_int.h"
 #include "PI/int/rpc_common.h"
 #include "PI/int/serialize.h"
+#include "PI/int/shm_transport.h"
 #include "PI/target/pi_act_prof_imp.h"
 #include "PI/target/pi_counter_imp.h"
 #include "PI/target/pi_imp.h"
@@ -31,6 +32,9 @@
 #include <nanomsg/nn.h>
 #include <nanomsg/reqrep.h>
 
+#include <pthread.h>
+#include <stdbool.h>
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -40,14 +44,39 @@
 
 typedef struct {
   int init;
-  pi_rpc_id_t req_id;
   int s;
+  // with a worker pool, s is a raw socket and each reply needs to be sent with
+  // the routing header of its request
+  bool raw;
+  // used instead of s for "shm://" addresses
+  pi_shm_transport_t *shm;
 } pi_rpc_state_t;
 
+// replies to the requests in a PI_RPC_BATCH message, each one preceded by its
+// size
+typedef struct {
+  char *data;
+  size_t size;
+  size_t capacity;
+} rep_buffer_t;
+
+// the request being handled by the current thread
+typedef struct {
+  pi_rpc_id_t req_id;
+  // routing header received with the request, only used with a raw socket
+  void *control;
+  // not NULL while handling the requests in a PI_RPC_BATCH message
+  rep_buffer_t *batch;
+  // end of the request, for the handlers which need to check the sizes read
+  // from the request
+  const char *req_end;
+} pi_rpc_ctx_t;
+
 static char *rpc_addr = NULL;
 static char *notifications_addr = NULL;
 
 static pi_rpc_state_t state;
+static __thread pi_rpc_ctx_t ctx;
 
 static void init_addrs(const pi_remote_addr_t *remote_addr) {
   if (!remote_addr || !remote_addr->rpc_addr)
@@ -61,15 +90,63 @@ static void init_addrs(const pi_remote_addr_t *remote_addr) {
 
 static size_t emit_rep_hdr(char *hdr, pi_status_t status) {
   size_t s = 0;
-  s += emit_rpc_id(hdr, state.req_id);
+  s += emit_rpc_id(hdr, ctx.req_id);
   s += emit_status(hdr + s, status);
   return s;
 }
 
+static void rep_buffer_append(rep_buffer_t *buffer, const void *buf,
+                              size_t len) {
+  size_t required = buffer->size + sizeof(uint32_t) + len;
+  if (required > buffer->capacity) {
+    buffer->capacity = (required > 2 * buffer->capacity)
+                           ? required
+                           : 2 * buffer->capacity;
+    buffer->data = realloc(buffer->data, buffer->capacity);
+    assert(buffer->data);
+  }
+  buffer->size += emit_uint32(buffer->data + buffer->size, len);
+  memcpy(buffer->data + buffer->size, buf, len);
+  buffer->size += len;
+}
+
+// all replies go through this function, which has the same semantics as nn_send
+static int send_rep(void *buf, size_t len) {
+  if (ctx.batch) {
+    // nanomsg messages go through send_rep_msg
+    assert(len != NN_MSG);
+    rep_buffer_append(ctx.batch, buf, len);
+    return len;
+  }
+  if (state.shm) return pi_shm_send(state.shm, buf, len);
+  if (!state.raw) return nn_send(state.s, buf, len, 0);
+  struct nn_iovec iov;
+  iov.iov_base = buf;
+  iov.iov_len = len;
+  struct nn_msghdr hdr;
+  memset(&hdr, 0, sizeof(hdr));
+  hdr.msg_iov = &iov;
+  hdr.msg_iovlen = 1;
+  hdr.msg_control = &ctx.control;
+  hdr.msg_controllen = NN_MSG;
+  int bytes = nn_sendmsg(state.s, &hdr, 0);
+  // on success, nanomsg takes ownership of the header
+  if (bytes >= 0) ctx.control = NULL;
+  return bytes;
+}
+
+// for a reply allocated with nn_allocmsg, which is released on success
+static int send_rep_msg(char *rep, size_t size) {
+  if (!ctx.batch && !state.shm) return send_rep(&rep, NN_MSG);
+  int bytes = send_rep(rep, size);
+  if (bytes >= 0) nn_freemsg(rep);
+  return bytes;
+}
+
 static void send_status(pi_status_t status) {
   rep_hdr_t rep;
   size_t s = emit_rep_hdr((char *)&rep, status);
-  int bytes = nn_send(state.s, &rep, sizeof(rep), 0);
+  int bytes = send_rep(&rep, sizeof(rep));
   _PI_UNUSED(s);
   _PI_UNUSED(bytes);
   assert((size_t)bytes == s);
@@ -154,8 +231,10 @@ static void __pi_init(char *req) {
     status = _pi_init(NULL);
   }
 
+  // p4info objects are sent in the PI binary format, which is much cheaper to
+  // load on the client side than JSON
   typedef struct {
-    char *json;
+    char *blob;
     size_t size;
   } p4info_tmp_t;
   p4info_tmp_t *p4info_tmp = NULL;
@@ -165,6 +244,10 @@ static void __pi_init(char *req) {
 
   if (num_devices > 0) {
     p4info_tmp = calloc(num_devices, sizeof(*p4info_tmp));
+    if (!p4info_tmp) {
+      send_status(PI_STATUS_ALLOC_ERROR);
+      return;
+    }
   }
 
   size_t num_assigned_devices = 0;
@@ -174,8 +257,16 @@ static void __pi_init(char *req) {
     num_assigned_devices++;
     s += sizeof(s_pi_dev_id_t);
     s += sizeof(uint32_t);  // version
-    p4info_tmp[dev_id].json = pi_serialize_config(devices[dev_id].p4info, 0);
-    p4info_tmp[dev_id].size = strlen(p4info_tmp[dev_id].json) + 1;
+    s += sizeof(uint32_t);  // p4info size
+    p4info_tmp[dev_id].blob = pi_serialize_config_binary(
+        devices[dev_id].p4info, &p4info_tmp[dev_id].size);
+    if (!p4info_tmp[dev_id].blob) {
+      // blobs are NULL for the devices which were not serialized
+      for (pi_dev_id_t i = 0; i < dev_id; i++) free(p4info_tmp[i].blob);
+      free(p4info_tmp);
+      send_status(PI_STATUS_ALLOC_ERROR);
+      return;
+    }
     s += p4info_tmp[dev_id].size;
   }
 
@@ -187,8 +278,10 @@ static void __pi_init(char *req) {
     if (devices[dev_id].version == 0) continue;
     rep_ += emit_dev_id(rep_, dev_id);
     rep_ += emit_uint32(rep_, devices[dev_id].version);
-    memcpy(rep_, p4info_tmp[dev_id].json, p4info_tmp[dev_id].size);
+    rep_ += emit_uint32(rep_, p4info_tmp[dev_id].size);
+    memcpy(rep_, p4info_tmp[dev_id].blob, p4info_tmp[dev_id].size);
     rep_ += p4info_tmp[dev_id].size;
+    free(p4info_tmp[dev_id].blob);
   }
 
   if (num_devices > 0) {
@@ -198,7 +291,7 @@ static void __pi_init(char *req) {
 
   assert((size_t)(rep_ - rep) == s);
 
-  int bytes = nn_send(state.s, &rep, NN_MSG, 0);
+  int bytes = send_rep_msg(rep, s);
   _PI_UNUSED(bytes);
   assert((size_t)bytes == s);
 }
@@ -335,17 +428,22 @@ static void __pi_session_init(char *req) {
   rep_ += emit_rep_hdr(rep_, status);
   rep_ += emit_session_handle(rep_, sess);
 
-  int bytes = nn_send(state.s, &rep, sizeof(rep), 0);
+  int bytes = send_rep(&rep, sizeof(rep));
   _PI_UNUSED(bytes);
   assert(bytes == sizeof(rep));
 }
 
+static void release_fetch_cursors(pi_session_handle_t sess);
+
 static void __pi_session_cleanup(char *req) {
   printf("RPC: _pi_session_cleanup\n");
 
   pi_session_handle_t sess;
   req += retrieve_session_handle(req, &sess);
 
+  // the client may not have ended all its paginated fetches
+  release_fetch_cursors(sess);
+
   send_status(_pi_session_cleanup(sess));
 }
 
@@ -369,6 +467,114 @@ static void __pi_batch_end(char *req) {
   send_status(_pi_batch_end(sess, (bool)hw_sync));
 }
 
+static void handle_req(char *req, size_t size);
+
+static bool is_batchable(pi_rpc_type_t type) {
+  switch (type) {
+    case PI_RPC_TABLE_ENTRY_ADD:
+    case PI_RPC_TABLE_DEFAULT_ACTION_SET:
+    case PI_RPC_TABLE_ENTRY_DELETE:
+    case PI_RPC_TABLE_ENTRY_DELETE_WKEY:
+    case PI_RPC_TABLE_ENTRY_MODIFY:
+    case PI_RPC_TABLE_ENTRY_MODIFY_WKEY:
+    case PI_RPC_ACT_PROF_MBR_CREATE:
+    case PI_RPC_ACT_PROF_MBR_DELETE:
+    case PI_RPC_ACT_PROF_MBR_MODIFY:
+    case PI_RPC_ACT_PROF_GRP_CREATE:
+    case PI_RPC_ACT_PROF_GRP_DELETE:
+    case PI_RPC_ACT_PROF_GRP_ADD_MBR:
+    case PI_RPC_ACT_PROF_GRP_REMOVE_MBR:
+    case PI_RPC_COUNTER_WRITE:
+    case PI_RPC_COUNTER_WRITE_DIRECT:
+    case PI_RPC_METER_SET:
+    case PI_RPC_METER_SET_DIRECT:
+      return true;
+    default:
+      return false;
+  }
+}
+
+// returns true if the num requests starting at src, each one preceded by its
+// size, all fit before end
+static bool batch_reqs_fit(const char *src, const char *end, uint32_t num) {
+  for (uint32_t i = 0; i < num; i++) {
+    uint32_t size;
+    if ((size_t)(end - src) < sizeof(uint32_t)) return false;
+    src += retrieve_uint32(src, &size);
+    if (size < sizeof(req_hdr_t) || (size_t)(end - src) < size) return false;
+    src += size;
+  }
+  return true;
+}
+
+// The requests are executed in order, in a batch which is started and / or
+// ended depending on the flags. The reply includes the reply to each request,
+// which is exactly what would have been sent if the request had been received
+// on its own.
+static void __pi_batch(char *req) {
+  printf("RPC: _pi_batch\n");
+
+  pi_status_t status = PI_STATUS_SUCCESS;
+  pi_session_handle_t sess = 0;
+  uint32_t flags = 0;
+  uint32_t num = 0;
+  // num and the request sizes come from the client: nothing is executed unless
+  // all the requests fit in the message
+  size_t hdr_size = sizeof(s_pi_session_handle_t) + 2 * sizeof(uint32_t);
+  if ((size_t)(ctx.req_end - req) < hdr_size) {
+    status = PI_STATUS_RPC_TRANSPORT_ERROR;
+  } else {
+    req += retrieve_session_handle(req, &sess);
+    req += retrieve_uint32(req, &flags);
+    req += retrieve_uint32(req, &num);
+    if (!batch_reqs_fit(req, ctx.req_end, num))
+      status = PI_STATUS_RPC_TRANSPORT_ERROR;
+  }
+
+  if (status == PI_STATUS_SUCCESS && (flags & PI_RPC_BATCH_FLAGS_BEGIN))
+    status = _pi_batch_begin(sess);
+
+  pi_rpc_id_t req_id = ctx.req_id;
+  rep_buffer_t reps = {NULL, 0, 0};
+  uint32_t num_done = 0;
+  if (status == PI_STATUS_SUCCESS) {
+    ctx.batch = &reps;
+    for (; num_done < num; num_done++) {
+      uint32_t size;
+      req += retrieve_uint32(req, &size);
+      pi_rpc_type_t type;
+      retrieve_rpc_type(req + sizeof(s_pi_rpc_id_t), &type);
+      if (is_batchable(type)) {
+        handle_req(req, size);
+      } else {
+        retrieve_rpc_id(req, &ctx.req_id);
+        send_status(PI_STATUS_RPC_NOT_IMPLEMENTED);
+      }
+      req += size;
+    }
+    ctx.batch = NULL;
+    ctx.req_id = req_id;
+    if (flags & PI_RPC_BATCH_FLAGS_END)
+      status = _pi_batch_end(sess, flags & PI_RPC_BATCH_FLAGS_HW_SYNC);
+  }
+
+  size_t s = sizeof(rep_hdr_t) + sizeof(uint32_t) + reps.size;
+  char *rep = nn_allocmsg(s, 0);
+  char *rep_ = rep;
+  rep_ += emit_rep_hdr(rep_, status);
+  rep_ += emit_uint32(rep_, num_done);
+  if (reps.size > 0) memcpy(rep_, reps.data, reps.size);
+  rep_ += reps.size;
+  free(reps.data);
+
+  // make sure I have copied exactly the right amount
+  assert((size_t)(rep_ - rep) == s);
+
+  int bytes = send_rep_msg(rep, s);
+  _PI_UNUSED(bytes);
+  assert((size_t)bytes == s);
+}
+
 // src cannot const because we are not copying key data, instead we are pointing
 // directly inside the message buffer
 static size_t retrieve_match_key(char *src, pi_match_key_t *match_key) {
@@ -427,7 +633,7 @@ static void __pi_table_entry_add(char *req) {
   rep_ += emit_rep_hdr(rep_, status);
   rep_ += emit_entry_handle(rep_, entry_handle);
 
-  int bytes = nn_send(state.s, &rep, sizeof(rep), 0);
+  int bytes = send_rep(&rep, sizeof(rep));
   _PI_UNUSED(bytes);
   assert(bytes == sizeof(rep));
 }
@@ -490,7 +696,7 @@ static void __pi_table_default_action_get(char *req) {
   // make sure I have copied exactly the right amount
   assert((size_t)(rep_ - rep) == s);
 
-  int bytes = nn_send(state.s, &rep, NN_MSG, 0);
+  int bytes = send_rep_msg(rep, s);
   _PI_UNUSED(bytes);
   assert((size_t)bytes == s);
 }
@@ -578,6 +784,188 @@ static void __pi_table_entry_modify_wkey(char *req) {
   __pi_table_entry_modify_common(req, true);
 }
 
+// returns the size of the encoded batch entry (match key, then action entry
+// and direct resource configs if has_entry is true) starting at src, or 0 if
+// the entry does not fit before end
+static size_t batch_entry_size(const char *src, const char *end,
+                               bool has_entry) {
+  const char *start = src;
+  uint32_t size;
+  if ((size_t)(end - src) < 2 * sizeof(uint32_t)) return 0;
+  src += sizeof(uint32_t);  // priority
+  src += retrieve_uint32(src, &size);
+  if ((size_t)(end - src) < size) return 0;
+  src += size;
+  if (!has_entry) return src - start;
+
+  if ((size_t)(end - src) < sizeof(s_pi_action_entry_type_t)) return 0;
+  pi_action_entry_type_t entry_type;
+  src += retrieve_action_entry_type(src, &entry_type);
+  switch (entry_type) {
+    case PI_ACTION_ENTRY_TYPE_NONE:
+      break;
+    case PI_ACTION_ENTRY_TYPE_DATA:
+      if ((size_t)(end - src) < sizeof(s_pi_p4_id_t) + sizeof(uint32_t))
+        return 0;
+      src += sizeof(s_pi_p4_id_t);
+      src += retrieve_uint32(src, &size);
+      if ((size_t)(end - src) < size) return 0;
+      src += size;
+      break;
+    case PI_ACTION_ENTRY_TYPE_INDIRECT:
+      if ((size_t)(end - src) < sizeof(s_pi_indirect_handle_t)) return 0;
+      src += sizeof(s_pi_indirect_handle_t);
+      break;
+    default:
+      return 0;
+  }
+
+  uint32_t num_configs;
+  if ((size_t)(end - src) < sizeof(uint32_t)) return 0;
+  src += retrieve_uint32(src, &num_configs);
+  for (uint32_t i = 0; i < num_configs; i++) {
+    if ((size_t)(end - src) < sizeof(s_pi_p4_id_t) + sizeof(uint32_t))
+      return 0;
+    pi_p4_id_t res_id;
+    src += retrieve_p4_id(src, &res_id);
+    src += retrieve_uint32(src, &size);
+    if ((size_t)(end - src) < size) return 0;
+    src += size;
+    if (pi_direct_res_get_fns(PI_GET_TYPE_ID(res_id), NULL, NULL, NULL,
+                              NULL) != PI_STATUS_SUCCESS)
+      return 0;
+  }
+  return src - start;
+}
+
+// handles all 3 types of batch requests; we go through the PI core functions so
+// that the target batch functions are used if they are implemented
+static void __pi_table_entries_batch(char *req, pi_rpc_type_t type) {
+  const char *req_end = ctx.req_end;
+  size_t hdr_size = sizeof(s_pi_session_handle_t) + sizeof(s_pi_dev_tgt_t) +
+                    sizeof(s_pi_p4_id_t) + 2 * sizeof(uint32_t);
+  if ((size_t)(req_end - req) < hdr_size) {
+    send_status(PI_STATUS_RPC_TRANSPORT_ERROR);
+    return;
+  }
+
+  pi_session_handle_t sess;
+  req += retrieve_session_handle(req, &sess);
+  pi_dev_tgt_t dev_tgt;
+  req += retrieve_dev_tgt(req, &dev_tgt);
+  pi_p4_id_t table_id;
+  req += retrieve_p4_id(req, &table_id);
+  uint32_t num;
+  req += retrieve_uint32(req, &num);
+  uint32_t overwrite;
+  req += retrieve_uint32(req, &overwrite);
+
+  bool has_entries = (type != PI_RPC_TABLE_ENTRIES_DELETE_WKEY_BATCH);
+  // num comes from the client: every entry must fit in the request before we
+  // allocate anything for them
+  for (size_t i = 0, offset = 0; i < num; i++) {
+    size_t s = batch_entry_size(req + offset, req_end, has_entries);
+    if (s == 0) {
+      send_status(PI_STATUS_RPC_TRANSPORT_ERROR);
+      return;
+    }
+    offset += s;
+  }
+
+  pi_match_key_t *match_keys = malloc(num * sizeof(*match_keys));
+  const pi_match_key_t **match_key_ptrs = malloc(num * sizeof(*match_key_ptrs));
+  pi_table_entry_t *table_entries = NULL;
+  pi_action_data_t *action_datas = NULL;
+  if (has_entries) {
+    table_entries = malloc(num * sizeof(*table_entries));
+    action_datas = malloc(num * sizeof(*action_datas));
+  }
+  for (size_t i = 0; i < num; i++) {
+    match_keys[i].p4info = NULL;  // TODO(antonin)
+    match_keys[i].table_id = table_id;
+    req += retrieve_match_key(req, &match_keys[i]);
+    match_key_ptrs[i] = &match_keys[i];
+    if (!has_entries) continue;
+    table_entries[i].entry.action_data = &action_datas[i];
+    // entry properties are not sent over RPC
+    table_entries[i].entry_properties = NULL;
+    req += retrieve_table_entry(req, &table_entries[i], 0);
+    pi_direct_res_config_t *direct_config = allocate_direct_res_config(req);
+    req += retrieve_direct_res_config(req, direct_config);
+    table_entries[i].direct_res_config = direct_config;
+  }
+
+  pi_status_t *statuses = malloc(num * sizeof(*statuses));
+  pi_entry_handle_t *entry_handles = NULL;
+  switch (type) {
+    case PI_RPC_TABLE_ENTRIES_ADD_BATCH:
+      entry_handles = malloc(num * sizeof(*entry_handles));
+      pi_table_entries_add_batch(sess, dev_tgt, table_id, num, match_key_ptrs,
+                                 table_entries, overwrite, statuses,
+                                 entry_handles);
+      break;
+    case PI_RPC_TABLE_ENTRIES_MODIFY_WKEY_BATCH:
+      pi_table_entries_modify_wkey_batch(sess, dev_tgt.dev_id, table_id, num,
+                                         match_key_ptrs, table_entries,
+                                         statuses);
+      break;
+    case PI_RPC_TABLE_ENTRIES_DELETE_WKEY_BATCH:
+      pi_table_entries_delete_wkey_batch(sess, dev_tgt.dev_id, table_id, num,
+                                         match_key_ptrs, statuses);
+      break;
+    default:
+      assert(0);
+  }
+
+  if (has_entries) {
+    for (size_t i = 0; i < num; i++)
+      free_direct_res_config(
+          (pi_direct_res_config_t *)table_entries[i].direct_res_config);
+  }
+  free(match_keys);
+  free(match_key_ptrs);
+  free(table_entries);
+  free(action_datas);
+
+  size_t s = 0;
+  s += sizeof(rep_hdr_t);
+  s += num * sizeof(s_pi_status_t);
+  if (entry_handles) s += num * sizeof(s_pi_entry_handle_t);
+
+  char *rep = nn_allocmsg(s, 0);
+  char *rep_ = rep;
+  // per-entry statuses are included in the reply
+  rep_ += emit_rep_hdr(rep_, PI_STATUS_SUCCESS);
+  for (size_t i = 0; i < num; i++) {
+    rep_ += emit_status(rep_, statuses[i]);
+    if (entry_handles) rep_ += emit_entry_handle(rep_, entry_handles[i]);
+  }
+  free(statuses);
+  free(entry_handles);
+
+  // make sure I have copied exactly the right amount
+  assert((size_t)(rep_ - rep) == s);
+
+  int bytes = send_rep_msg(rep, s);
+  _PI_UNUSED(bytes);
+  assert((size_t)bytes == s);
+}
+
+static void __pi_table_entries_add_batch(char *req) {
+  printf("RPC: _pi_table_entries_add_batch\n");
+  __pi_table_entries_batch(req, PI_RPC_TABLE_ENTRIES_ADD_BATCH);
+}
+
+static void __pi_table_entries_modify_wkey_batch(char *req) {
+  printf("RPC: _pi_table_entries_modify_wkey_batch\n");
+  __pi_table_entries_batch(req, PI_RPC_TABLE_ENTRIES_MODIFY_WKEY_BATCH);
+}
+
+static void __pi_table_entries_delete_wkey_batch(char *req) {
+  printf("RPC: _pi_table_entries_delete_wkey_batch\n");
+  __pi_table_entries_batch(req, PI_RPC_TABLE_ENTRIES_DELETE_WKEY_BATCH);
+}
+
 static void __pi_table_entries_fetch(char *req) {
   printf("RPC: _pi_table_entries_fetch\n");
 
@@ -618,11 +1006,217 @@ static void __pi_table_entries_fetch(char *req) {
   // make sure I have copied exactly the right amount
   assert((size_t)(rep_ - rep) == s);
 
-  int bytes = nn_send(state.s, &rep, NN_MSG, 0);
+  int bytes = send_rep_msg(rep, s);
   _PI_UNUSED(bytes);
   assert((size_t)bytes == s);
 }
 
+// goes through the PI core, which reads the direct resources itself if the
+// target cannot return them with the entries
+static void __pi_table_entries_fetch_wflags(char *req) {
+  printf("RPC: _pi_table_entries_fetch_wflags\n");
+
+  pi_session_handle_t sess;
+  req += retrieve_session_handle(req, &sess);
+  pi_dev_id_t dev_id;
+  req += retrieve_dev_id(req, &dev_id);
+  pi_p4_id_t table_id;
+  req += retrieve_p4_id(req, &table_id);
+  uint32_t flags;
+  req += retrieve_uint32(req, &flags);
+
+  pi_table_fetch_res_t *res;
+  pi_status_t status =
+      pi_table_entries_fetch_wflags(sess, dev_id, table_id, flags, &res);
+
+  if (status != PI_STATUS_SUCCESS) {
+    send_status(status);
+    return;
+  }
+
+  size_t s = 0;
+  s += sizeof(rep_hdr_t);
+  s += sizeof(uint32_t);  // num entries
+  s += sizeof(uint32_t);  // mkey nbytes
+  s += sizeof(uint32_t);  // entries_size (in bytes)
+  s += res->entries_size;
+
+  char *rep = nn_allocmsg(s, 0);
+  char *rep_ = rep;
+  rep_ += emit_rep_hdr(rep_, status);
+  rep_ += emit_uint32(rep_, res->num_entries);
+  rep_ += emit_uint32(rep_, res->mkey_nbytes);
+  rep_ += emit_uint32(rep_, res->entries_size);
+  memcpy(rep_, res->entries, res->entries_size);
+  rep_ += res->entries_size;
+
+  pi_table_entries_fetch_done(sess, res);
+
+  // make sure I have copied exactly the right amount
+  assert((size_t)(rep_ - rep) == s);
+
+  int bytes = send_rep_msg(rep, s);
+  _PI_UNUSED(bytes);
+  assert((size_t)bytes == s);
+}
+
+// open paginated fetches, the cursor handle sent to the client is the index in
+// this array
+#define MAX_FETCH_CURSORS 64
+typedef struct {
+  pi_table_fetch_cursor_t *cursor;
+  // the session which opened the cursor, which is the only one allowed to use
+  // it; requests for a session are all handled by the same worker, so a cursor
+  // is never used concurrently
+  pi_session_handle_t sess;
+} fetch_cursor_slot_t;
+static fetch_cursor_slot_t fetch_cursors[MAX_FETCH_CURSORS];
+// the array is shared by all the workers, the lock is only held to access it
+static pthread_mutex_t fetch_cursors_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void __pi_table_entries_fetch_begin(char *req) {
+  printf("RPC: _pi_table_entries_fetch_begin\n");
+
+  pi_session_handle_t sess;
+  req += retrieve_session_handle(req, &sess);
+  pi_dev_id_t dev_id;
+  req += retrieve_dev_id(req, &dev_id);
+  pi_p4_id_t table_id;
+  req += retrieve_p4_id(req, &table_id);
+  uint64_t max_entries;
+  req += retrieve_uint64(req, &max_entries);
+  uint64_t max_bytes;
+  req += retrieve_uint64(req, &max_bytes);
+
+  // may retrieve the whole table from the target, so done without the lock
+  pi_table_fetch_cursor_t *cursor;
+  pi_status_t status = pi_table_entries_fetch_begin(
+      sess, dev_id, table_id, max_entries, max_bytes, &cursor);
+
+  uint64_t cursor_handle = 0;
+  if (status == PI_STATUS_SUCCESS) {
+    pthread_mutex_lock(&fetch_cursors_lock);
+    while (cursor_handle < MAX_FETCH_CURSORS &&
+           fetch_cursors[cursor_handle].cursor)
+      cursor_handle++;
+    if (cursor_handle < MAX_FETCH_CURSORS) {
+      fetch_cursors[cursor_handle].cursor = cursor;
+      fetch_cursors[cursor_handle].sess = sess;
+    }
+    pthread_mutex_unlock(&fetch_cursors_lock);
+    if (cursor_handle == MAX_FETCH_CURSORS) {
+      pi_table_entries_fetch_end(cursor);
+      status = PI_STATUS_ALLOC_ERROR;
+    }
+  }
+
+  typedef struct __attribute__((packed)) {
+    rep_hdr_t hdr;
+    uint64_t cursor_handle;
+  } rep_t;
+  rep_t rep;
+  char *rep_ = (char *)&rep;
+  rep_ += emit_rep_hdr(rep_, status);
+  rep_ += emit_uint64(rep_, cursor_handle);
+
+  int bytes = send_rep(&rep, sizeof(rep));
+  _PI_UNUSED(bytes);
+  assert(bytes == sizeof(rep));
+}
+
+// returns NULL if the handle does not refer to a cursor opened by the session;
+// the cursor is removed from the array if release is true
+static pi_table_fetch_cursor_t *retrieve_fetch_cursor(char *req,
+                                                      pi_session_handle_t *sess,
+                                                      bool release) {
+  req += retrieve_session_handle(req, sess);
+  uint64_t handle;
+  retrieve_uint64(req, &handle);
+  if (handle >= MAX_FETCH_CURSORS) return NULL;
+  pthread_mutex_lock(&fetch_cursors_lock);
+  fetch_cursor_slot_t *slot = &fetch_cursors[handle];
+  pi_table_fetch_cursor_t *cursor = NULL;
+  if (slot->cursor && slot->sess == *sess) {
+    cursor = slot->cursor;
+    if (release) slot->cursor = NULL;
+  }
+  pthread_mutex_unlock(&fetch_cursors_lock);
+  return cursor;
+}
+
+// ends the fetches which the session did not end itself, called when the
+// session is cleaned up
+static void release_fetch_cursors(pi_session_handle_t sess) {
+  pi_table_fetch_cursor_t *cursors[MAX_FETCH_CURSORS];
+  size_t num_cursors = 0;
+  pthread_mutex_lock(&fetch_cursors_lock);
+  for (size_t i = 0; i < MAX_FETCH_CURSORS; i++) {
+    fetch_cursor_slot_t *slot = &fetch_cursors[i];
+    if (!slot->cursor || slot->sess != sess) continue;
+    cursors[num_cursors++] = slot->cursor;
+    slot->cursor = NULL;
+  }
+  pthread_mutex_unlock(&fetch_cursors_lock);
+  for (size_t i = 0; i < num_cursors; i++)
+    pi_table_entries_fetch_end(cursors[i]);
+}
+
+static void __pi_table_entries_fetch_next_chunk(char *req) {
+  printf("RPC: _pi_table_entries_fetch_next_chunk\n");
+
+  pi_session_handle_t sess;
+  pi_table_fetch_cursor_t *cursor = retrieve_fetch_cursor(req, &sess, false);
+  if (!cursor) {
+    send_status(PI_STATUS_OUT_OF_BOUND_IDX);
+    return;
+  }
+
+  // the encoded entries are forwarded as is, there is no need to decode them
+  pi_table_fetch_res_t chunk;
+  pi_status_t status = pi_table_entries_fetch_next_chunk_raw(cursor, &chunk);
+  if (status != PI_STATUS_SUCCESS) {
+    send_status(status);
+    return;
+  }
+
+  // an empty chunk tells the client that all entries have been returned
+  size_t s = 0;
+  s += sizeof(rep_hdr_t);
+  s += sizeof(uint32_t);  // num entries
+  s += sizeof(uint32_t);  // mkey nbytes
+  s += sizeof(uint32_t);  // entries_size (in bytes)
+  s += chunk.entries_size;
+
+  char *rep = nn_allocmsg(s, 0);
+  char *rep_ = rep;
+  rep_ += emit_rep_hdr(rep_, status);
+  rep_ += emit_uint32(rep_, chunk.num_entries);
+  rep_ += emit_uint32(rep_, chunk.mkey_nbytes);
+  rep_ += emit_uint32(rep_, chunk.entries_size);
+  if (chunk.entries_size > 0) memcpy(rep_, chunk.entries, chunk.entries_size);
+  rep_ += chunk.entries_size;
+  pi_table_entries_fetch_chunk_raw_done(cursor, &chunk);
+
+  // make sure I have copied exactly the right amount
+  assert((size_t)(rep_ - rep) == s);
+
+  int bytes = send_rep_msg(rep, s);
+  _PI_UNUSED(bytes);
+  assert((size_t)bytes == s);
+}
+
+static void __pi_table_entries_fetch_end(char *req) {
+  printf("RPC: _pi_table_entries_fetch_end\n");
+
+  pi_session_handle_t sess;
+  pi_table_fetch_cursor_t *cursor = retrieve_fetch_cursor(req, &sess, true);
+  if (!cursor) {
+    send_status(PI_STATUS_OUT_OF_BOUND_IDX);
+    return;
+  }
+  send_status(pi_table_entries_fetch_end(cursor));
+}
+
 static void send_indirect_handle(pi_status_t status, pi_indirect_handle_t h) {
   typedef struct __attribute__((packed)) {
     rep_hdr_t hdr;
@@ -633,7 +1227,7 @@ static void send_indirect_handle(pi_status_t status, pi_indirect_handle_t h) {
   rep_ += emit_rep_hdr(rep_, status);
   rep_ += emit_indirect_handle(rep_, h);
 
-  int bytes = nn_send(state.s, &rep, sizeof(rep), 0);
+  int bytes = send_rep(&rep, sizeof(rep));
   _PI_UNUSED(bytes);
   assert(bytes == sizeof(rep));
 }
@@ -826,7 +1420,7 @@ static void __pi_act_prof_entries_fetch(char *req) {
   // make sure I have copied exactly the right amount
   assert((size_t)(rep_ - rep) == s);
 
-  int bytes = nn_send(state.s, &rep, NN_MSG, 0);
+  int bytes = send_rep_msg(rep, s);
   _PI_UNUSED(bytes);
   assert((size_t)bytes == s);
 }
@@ -868,7 +1462,7 @@ static void counter_read(char *req, pi_rpc_type_t direct_or_not) {
   rep_ += emit_rep_hdr(rep_, status);
   rep_ += emit_counter_data(rep_, &counter_data);
 
-  int bytes = nn_send(state.s, &rep, sizeof(rep), 0);
+  int bytes = send_rep(&rep, sizeof(rep));
   _PI_UNUSED(bytes);
   assert(bytes == sizeof(rep));
 }
@@ -883,6 +1477,59 @@ static void __pi_counter_read_direct(char *req) {
   counter_read(req, PI_RPC_COUNTER_READ_DIRECT);
 }
 
+static void __pi_counter_read_range(char *req) {
+  printf("RPC: _pi_counter_read_range\n");
+
+  pi_session_handle_t sess;
+  req += retrieve_session_handle(req, &sess);
+  pi_dev_tgt_t dev_tgt;
+  req += retrieve_dev_tgt(req, &dev_tgt);
+  pi_p4_id_t counter_id;
+  req += retrieve_p4_id(req, &counter_id);
+  uint64_t start;
+  req += retrieve_uint64(req, &start);
+  uint64_t count;
+  req += retrieve_uint64(req, &count);
+  uint32_t flags;
+  req += retrieve_uint32(req, &flags);
+
+  // go through the PI core, which checks the range and falls back to one read
+  // per index if the target does not support range reads
+  pi_counter_data_t *counter_data = malloc(count * sizeof(*counter_data));
+  pi_status_t status =
+      (counter_data == NULL && count > 0)
+          ? PI_STATUS_ALLOC_ERROR
+          : pi_counter_read_range(sess, dev_tgt, counter_id, start, count,
+                                  flags, counter_data);
+
+  if (status != PI_STATUS_SUCCESS) {
+    free(counter_data);
+    send_status(status);
+    return;
+  }
+
+  size_t s = 0;
+  s += sizeof(rep_hdr_t);
+  s += sizeof(uint64_t);  // count
+  s += count * sizeof(s_pi_counter_data_t);
+
+  char *rep = nn_allocmsg(s, 0);
+  char *rep_ = rep;
+  rep_ += emit_rep_hdr(rep_, status);
+  rep_ += emit_uint64(rep_, count);
+  for (size_t i = 0; i < count; i++)
+    rep_ += emit_counter_data(rep_, &counter_data[i]);
+
+  free(counter_data);
+
+  // make sure I have copied exactly the right amount
+  assert((size_t)(rep_ - rep) == s);
+
+  int bytes = send_rep_msg(rep, s);
+  _PI_UNUSED(bytes);
+  assert((size_t)bytes == s);
+}
+
 static void counter_write(char *req, pi_rpc_type_t direct_or_not) {
   pi_session_handle_t sess;
   req += retrieve_session_handle(req, &sess);
@@ -956,7 +1603,7 @@ static void meter_read(char *req, pi_rpc_type_t direct_or_not) {
   rep_ += emit_rep_hdr(rep_, status);
   rep_ += emit_meter_spec(rep_, &meter_spec);
 
-  int bytes = nn_send(state.s, &rep, sizeof(rep), 0);
+  int bytes = send_rep(&rep, sizeof(rep));
   _PI_UNUSED(bytes);
   assert(bytes == sizeof(rep));
 }
@@ -1046,12 +1693,320 @@ static void packetin_cb(pi_dev_id_t dev_id, const char *pkt, size_t size,
   pi_notifications_pub_packetin(dev_id, pkt, size);
 }
 
-pi_status_t pi_rpc_server_run(const pi_remote_addr_t *remote_addr) {
+static void handle_req(char *req, size_t size) {
+  pi_rpc_type_t type;
+  char *req_ = req;
+  ctx.req_end = req + size;
+  req_ += retrieve_rpc_id(req_, &ctx.req_id);
+  printf("req_id: %u\n", ctx.req_id);
+  req_ += retrieve_rpc_type(req_, &type);
+
+  switch (type) {
+    case PI_RPC_INIT:
+      __pi_init(req_);
+      break;
+    case PI_RPC_ASSIGN_DEVICE:
+      __pi_assign_device(req_);
+      break;
+    case PI_RPC_UPDATE_DEVICE_START:
+      __pi_update_device_start(req_);
+      break;
+    case PI_RPC_UPDATE_DEVICE_END:
+      __pi_update_device_end(req_);
+      break;
+    case PI_RPC_REMOVE_DEVICE:
+      __pi_remove_device(req_);
+      break;
+    case PI_RPC_DESTROY:
+      __pi_destroy(req_);
+      break;
+    case PI_RPC_SESSION_INIT:
+      __pi_session_init(req_);
+      break;
+    case PI_RPC_SESSION_CLEANUP:
+      __pi_session_cleanup(req_);
+      break;
+    case PI_RPC_BATCH_BEGIN:
+      __pi_batch_begin(req_);
+      break;
+    case PI_RPC_BATCH_END:
+      __pi_batch_end(req_);
+      break;
+    case PI_RPC_BATCH:
+      __pi_batch(req_);
+      break;
+    case PI_RPC_TABLE_ENTRY_ADD:
+      __pi_table_entry_add(req_);
+      break;
+    case PI_RPC_TABLE_DEFAULT_ACTION_SET:
+      __pi_table_default_action_set(req_);
+      break;
+    case PI_RPC_TABLE_DEFAULT_ACTION_GET:
+      __pi_table_default_action_get(req_);
+      break;
+    case PI_RPC_TABLE_ENTRY_DELETE:
+      __pi_table_entry_delete(req_);
+      break;
+    case PI_RPC_TABLE_ENTRY_DELETE_WKEY:
+      __pi_table_entry_delete_wkey(req_);
+      break;
+    case PI_RPC_TABLE_ENTRY_MODIFY:
+      __pi_table_entry_modify(req_);
+      break;
+    case PI_RPC_TABLE_ENTRY_MODIFY_WKEY:
+      __pi_table_entry_modify_wkey(req_);
+      break;
+    case PI_RPC_TABLE_ENTRIES_FETCH:
+      __pi_table_entries_fetch(req_);
+      break;
+    case PI_RPC_TABLE_ENTRIES_ADD_BATCH:
+      __pi_table_entries_add_batch(req_);
+      break;
+    case PI_RPC_TABLE_ENTRIES_MODIFY_WKEY_BATCH:
+      __pi_table_entries_modify_wkey_batch(req_);
+      break;
+    case PI_RPC_TABLE_ENTRIES_DELETE_WKEY_BATCH:
+      __pi_table_entries_delete_wkey_batch(req_);
+      break;
+    case PI_RPC_TABLE_ENTRIES_FETCH_BEGIN:
+      __pi_table_entries_fetch_begin(req_);
+      break;
+    case PI_RPC_TABLE_ENTRIES_FETCH_NEXT_CHUNK:
+      __pi_table_entries_fetch_next_chunk(req_);
+      break;
+    case PI_RPC_TABLE_ENTRIES_FETCH_END:
+      __pi_table_entries_fetch_end(req_);
+      break;
+    case PI_RPC_TABLE_ENTRIES_FETCH_WFLAGS:
+      __pi_table_entries_fetch_wflags(req_);
+      break;
+
+    case PI_RPC_ACT_PROF_MBR_CREATE:
+      __pi_act_prof_mbr_create(req_);
+      break;
+    case PI_RPC_ACT_PROF_MBR_DELETE:
+      __pi_act_prof_mbr_delete(req_);
+      break;
+    case PI_RPC_ACT_PROF_MBR_MODIFY:
+      __pi_act_prof_mbr_modify(req_);
+      break;
+    case PI_RPC_ACT_PROF_GRP_CREATE:
+      __pi_act_prof_grp_create(req_);
+      break;
+    case PI_RPC_ACT_PROF_GRP_DELETE:
+      __pi_act_prof_grp_delete(req_);
+      break;
+    case PI_RPC_ACT_PROF_GRP_ADD_MBR:
+      __pi_act_prof_grp_add_mbr(req_);
+      break;
+    case PI_RPC_ACT_PROF_GRP_REMOVE_MBR:
+      __pi_act_prof_grp_remove_mbr(req_);
+      break;
+    case PI_RPC_ACT_PROF_ENTRIES_FETCH:
+      __pi_act_prof_entries_fetch(req_);
+      break;
+
+    case PI_RPC_COUNTER_READ:
+      __pi_counter_read(req_);
+      break;
+    case PI_RPC_COUNTER_READ_DIRECT:
+      __pi_counter_read_direct(req_);
+      break;
+    case PI_RPC_COUNTER_WRITE:
+      __pi_counter_write(req_);
+      break;
+    case PI_RPC_COUNTER_WRITE_DIRECT:
+      __pi_counter_write_direct(req_);
+      break;
+    case PI_RPC_COUNTER_READ_RANGE:
+      __pi_counter_read_range(req_);
+      break;
+
+    case PI_RPC_METER_READ:
+      __pi_meter_read(req_);
+      break;
+    case PI_RPC_METER_READ_DIRECT:
+      __pi_meter_read_direct(req_);
+      break;
+    case PI_RPC_METER_SET:
+      __pi_meter_set(req_);
+      break;
+    case PI_RPC_METER_SET_DIRECT:
+      __pi_meter_set_direct(req_);
+      break;
+
+    case PI_RPC_LEARN_MSG_ACK:
+      __pi_learn_msg_ack(req_);
+      break;
+
+    case PI_RPC_PACKETOUT_SEND:
+      __pi_packetout_send(req_);
+      break;
+
+    default:
+      assert(0);
+  }
+}
+
+// Worker pool mode: the main thread receives requests on a raw socket and
+// dispatches them to the workers, each of which has its own FIFO queue.
+// Requests for a given session always go to the same worker, as do device
+// management requests for a given device, which preserves their ordering.
+
+typedef struct rpc_work_s {
+  struct rpc_work_s *next;
+  char *req;
+  size_t size;
+  void *control;
+} rpc_work_t;
+
+typedef struct {
+  pthread_t thread;
+  pthread_mutex_t lock;
+  pthread_cond_t cond;
+  rpc_work_t *head;
+  rpc_work_t *tail;
+} rpc_worker_t;
+
+static size_t get_worker_key(const char *req, size_t size) {
+  if (size < sizeof(req_hdr_t)) return 0;
+  pi_rpc_type_t type;
+  retrieve_rpc_type(req + sizeof(s_pi_rpc_id_t), &type);
+  const char *body = req + sizeof(req_hdr_t);
+  size -= sizeof(req_hdr_t);
+  switch (type) {
+    case PI_RPC_INIT:
+    case PI_RPC_DESTROY:
+    case PI_RPC_SESSION_INIT:
+    case PI_RPC_INT_GET_STATE:
+      return 0;
+    case PI_RPC_ASSIGN_DEVICE:
+    case PI_RPC_UPDATE_DEVICE_START:
+    case PI_RPC_UPDATE_DEVICE_END:
+    case PI_RPC_REMOVE_DEVICE:
+    case PI_RPC_PACKETOUT_SEND: {
+      if (size < sizeof(s_pi_dev_id_t)) return 0;
+      pi_dev_id_t dev_id;
+      retrieve_dev_id(body, &dev_id);
+      return dev_id;
+    }
+    default: {
+      // all other requests start with the session handle
+      if (size < sizeof(s_pi_session_handle_t)) return 0;
+      pi_session_handle_t sess;
+      retrieve_session_handle(body, &sess);
+      return sess;
+    }
+  }
+}
+
+static void release_req(char *req) {
+  if (state.shm)
+    pi_shm_release(state.shm, req);
+  else
+    nn_freemsg(req);
+}
+
+static void *worker_loop(void *arg) {
+  rpc_worker_t *worker = (rpc_worker_t *)arg;
+  while (1) {
+    pthread_mutex_lock(&worker->lock);
+    while (!worker->head) pthread_cond_wait(&worker->cond, &worker->lock);
+    rpc_work_t *work = worker->head;
+    worker->head = work->next;
+    if (!worker->head) worker->tail = NULL;
+    pthread_mutex_unlock(&worker->lock);
+
+    ctx.control = work->control;
+    handle_req(work->req, work->size);
+    // in case no reply was sent
+    if (ctx.control) nn_freemsg(ctx.control);
+    release_req(work->req);
+    free(work);
+  }
+  return NULL;
+}
+
+static void worker_push(rpc_worker_t *worker, char *req, size_t size,
+                        void *control) {
+  rpc_work_t *work = malloc(sizeof(*work));
+  work->next = NULL;
+  work->req = req;
+  work->size = size;
+  work->control = control;
+  pthread_mutex_lock(&worker->lock);
+  if (worker->tail)
+    worker->tail->next = work;
+  else
+    worker->head = work;
+  worker->tail = work;
+  pthread_cond_signal(&worker->cond);
+  pthread_mutex_unlock(&worker->lock);
+}
+
+// Returns the size of the request, or -1 on error. Requests received through
+// shared memory point into the ring; in all cases, they must be released with
+// release_req.
+static int recv_req(char **req, void **control) {
+  if (state.shm) return pi_shm_recv(state.shm, req);
+  if (!state.raw) return nn_recv(state.s, req, NN_MSG, 0);
+  struct nn_iovec iov;
+  iov.iov_base = req;
+  iov.iov_len = NN_MSG;
+  struct nn_msghdr hdr;
+  memset(&hdr, 0, sizeof(hdr));
+  hdr.msg_iov = &iov;
+  hdr.msg_iovlen = 1;
+  hdr.msg_control = control;
+  hdr.msg_controllen = NN_MSG;
+  return nn_recvmsg(state.s, &hdr, 0);
+}
+
+static pi_status_t run_workers(size_t num_workers) {
+  rpc_worker_t *workers = calloc(num_workers, sizeof(*workers));
+  if (!workers) return PI_STATUS_ALLOC_ERROR;
+  for (size_t i = 0; i < num_workers; i++) {
+    rpc_worker_t *worker = &workers[i];
+    pthread_mutex_init(&worker->lock, NULL);
+    pthread_cond_init(&worker->cond, NULL);
+    if (pthread_create(&worker->thread, NULL, worker_loop, worker) != 0)
+      return PI_STATUS_ALLOC_ERROR;
+  }
+
+  while (1) {
+    char *req = NULL;
+    void *control = NULL;
+    int bytes = recv_req(&req, &control);
+    if (bytes < 0) return PI_STATUS_RPC_TRANSPORT_ERROR;
+    if (bytes == 0) {
+      release_req(req);
+      if (control) nn_freemsg(control);
+      continue;
+    }
+    size_t key = get_worker_key(req, bytes);
+    worker_push(&workers[key % num_workers], req, bytes, control);
+  }
+
+  return PI_STATUS_SUCCESS;
+}
+
+// With num_workers == 0, requests are handled one at a time by the calling
+// thread. Otherwise they are handled concurrently by a pool of num_workers
+// threads, see run_workers.
+pi_status_t pi_rpc_server_run_with_workers(const pi_remote_addr_t *remote_addr,
+                                           size_t num_workers) {
   assert(!state.init);
   init_addrs(remote_addr);
-  state.s = nn_socket(AF_SP, NN_REP);
-  if (state.s < 0) return PI_STATUS_RPC_CONNECT_ERROR;
-  if (nn_bind(state.s, rpc_addr) < 0) return PI_STATUS_RPC_CONNECT_ERROR;
+  if (pi_shm_is_shm_addr(rpc_addr)) {
+    // replies are matched to requests by the client, no routing header needed
+    state.shm = pi_shm_transport_create(rpc_addr);
+    if (!state.shm) return PI_STATUS_RPC_CONNECT_ERROR;
+  } else {
+    state.raw = (num_workers > 0);
+    state.s = nn_socket(state.raw ? AF_SP_RAW : AF_SP, NN_REP);
+    if (state.s < 0) return PI_STATUS_RPC_CONNECT_ERROR;
+    if (nn_bind(state.s, rpc_addr) < 0) return PI_STATUS_RPC_CONNECT_ERROR;
+  }
 
   if (notifications_addr) {
     pi_status_t status = pi_notifications_init(notifications_addr);
@@ -1064,143 +2019,32 @@ pi_status_t pi_rpc_server_run(const pi_remote_addr_t *remote_addr) {
 
   state.init = 1;
 
+  if (num_workers > 0) return run_workers(num_workers);
+
   while (1) {
     char *req = NULL;
-    int bytes = nn_recv(state.s, &req, NN_MSG, 0);
+    int bytes = recv_req(&req, NULL);
     if (bytes < 0) return PI_STATUS_RPC_TRANSPORT_ERROR;
-    if (bytes == 0) continue;
-
-    pi_rpc_type_t type;
-    char *req_ = req;
-    req_ += retrieve_rpc_id(req_, &state.req_id);
-    printf("req_id: %u\n", state.req_id);
-    req_ += retrieve_rpc_type(req_, &type);
-
-    switch (type) {
-      case PI_RPC_INIT:
-        __pi_init(req_);
-        break;
-      case PI_RPC_ASSIGN_DEVICE:
-        __pi_assign_device(req_);
-        break;
-      case PI_RPC_UPDATE_DEVICE_START:
-        __pi_update_device_start(req_);
-        break;
-      case PI_RPC_UPDATE_DEVICE_END:
-        __pi_update_device_end(req_);
-        break;
-      case PI_RPC_REMOVE_DEVICE:
-        __pi_remove_device(req_);
-        break;
-      case PI_RPC_DESTROY:
-        __pi_destroy(req_);
-        break;
-      case PI_RPC_SESSION_INIT:
-        __pi_session_init(req_);
-        break;
-      case PI_RPC_SESSION_CLEANUP:
-        __pi_session_cleanup(req_);
-        break;
-      case PI_RPC_BATCH_BEGIN:
-        __pi_batch_begin(req_);
-        break;
-      case PI_RPC_BATCH_END:
-        __pi_batch_end(req_);
-        break;
-      case PI_RPC_TABLE_ENTRY_ADD:
-        __pi_table_entry_add(req_);
-        break;
-      case PI_RPC_TABLE_DEFAULT_ACTION_SET:
-        __pi_table_default_action_set(req_);
-        break;
-      case PI_RPC_TABLE_DEFAULT_ACTION_GET:
-        __pi_table_default_action_get(req_);
-        break;
-      case PI_RPC_TABLE_ENTRY_DELETE:
-        __pi_table_entry_delete(req_);
-        break;
-      case PI_RPC_TABLE_ENTRY_DELETE_WKEY:
-        __pi_table_entry_delete_wkey(req_);
-        break;
-      case PI_RPC_TABLE_ENTRY_MODIFY:
-        __pi_table_entry_modify(req_);
-        break;
-      case PI_RPC_TABLE_ENTRY_MODIFY_WKEY:
-        __pi_table_entry_modify_wkey(req_);
-        break;
-      case PI_RPC_TABLE_ENTRIES_FETCH:
-        __pi_table_entries_fetch(req_);
-        break;
-
-      case PI_RPC_ACT_PROF_MBR_CREATE:
-        __pi_act_prof_mbr_create(req_);
-        break;
-      case PI_RPC_ACT_PROF_MBR_DELETE:
-        __pi_act_prof_mbr_delete(req_);
-        break;
-      case PI_RPC_ACT_PROF_MBR_MODIFY:
-        __pi_act_prof_mbr_modify(req_);
-        break;
-      case PI_RPC_ACT_PROF_GRP_CREATE:
-        __pi_act_prof_grp_create(req_);
-        break;
-      case PI_RPC_ACT_PROF_GRP_DELETE:
-        __pi_act_prof_grp_delete(req_);
-        break;
-      case PI_RPC_ACT_PROF_GRP_ADD_MBR:
-        __pi_act_prof_grp_add_mbr(req_);
-        break;
-      case PI_RPC_ACT_PROF_GRP_REMOVE_MBR:
-        __pi_act_prof_grp_remove_mbr(req_);
-        break;
-      case PI_RPC_ACT_PROF_ENTRIES_FETCH:
-        __pi_act_prof_entries_fetch(req_);
-        break;
-
-      case PI_RPC_COUNTER_READ:
-        __pi_counter_read(req_);
-        break;
-      case PI_RPC_COUNTER_READ_DIRECT:
-        __pi_counter_read_direct(req_);
-        break;
-      case PI_RPC_COUNTER_WRITE:
-        __pi_counter_write(req_);
-        break;
-      case PI_RPC_COUNTER_WRITE_DIRECT:
-        __pi_counter_write_direct(req_);
-        break;
-
-      case PI_RPC_METER_READ:
-        __pi_meter_read(req_);
-        break;
-      case PI_RPC_METER_READ_DIRECT:
-        __pi_meter_read_direct(req_);
-        break;
-      case PI_RPC_METER_SET:
-        __pi_meter_set(req_);
-        break;
-      case PI_RPC_METER_SET_DIRECT:
-        __pi_meter_set_direct(req_);
-        break;
-
-      case PI_RPC_LEARN_MSG_ACK:
-        __pi_learn_msg_ack(req_);
-        break;
-
-      case PI_RPC_PACKETOUT_SEND:
-        __pi_packetout_send(req_);
-        break;
-
-      default:
-        assert(0);
-    }
+    if (bytes > 0) handle_req(req, bytes);
 
-    nn_freemsg(req);
+    release_req(req);
   }
 
   return PI_STATUS_SUCCESS;
 }
 
+// Must be called before starting the server, see pi_notifications_pub.h.
+void pi_rpc_server_set_packetin_batching(size_t max_packets, size_t max_bytes,
+                                         uint32_t max_delay_us) {
+  pi_notifications_packetin_batch_config_t config = {max_packets, max_bytes,
+                                                     max_delay_us};
+  pi_notifications_set_packetin_batching(&config);
+}
+
+pi_status_t pi_rpc_server_run(const pi_remote_addr_t *remote_addr) {
+  return pi_rpc_server_run_with_workers(remote_addr, 0);
+}
+
 // some helper functions declared in rpc_common.h
 
 size_t emit_rpc_id(char *dst, pi_rpc_id_t v) { return emit_uint32(dst, v); }
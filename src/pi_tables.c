@@ -22,11 +22,25 @@
 #include <PI/int/serialize.h>
 #include <PI/pi.h>
 #include <PI/pi_tables.h>
+#include <PI/target/pi_counter_imp.h>
+#include <PI/target/pi_meter_imp.h>
 #include <PI/target/pi_tables_imp.h>
 
 #include <stdlib.h>
 #include <string.h>
 
+// the batch target functions are optional, their address is NULL if the target
+// does not implement them
+#pragma weak _pi_table_entries_add_batch
+#pragma weak _pi_table_entries_modify_wkey_batch
+#pragma weak _pi_table_entries_delete_wkey_batch
+// same for the other fetch functions
+#pragma weak _pi_table_entries_fetch_begin
+#pragma weak _pi_table_entries_fetch_next_chunk
+#pragma weak _pi_table_entries_fetch_end
+#pragma weak _pi_table_entries_fetch_filtered
+#pragma weak _pi_table_entries_fetch_wflags
+
 void pi_entry_properties_clear(pi_entry_properties_t *properties) {
   memset(properties, 0, sizeof(*properties));
 }
@@ -158,93 +172,666 @@ pi_status_t pi_table_entry_modify_wkey(pi_session_handle_t session_handle,
                                      match_key, table_entry);
 }
 
+static pi_status_t batch_status(pi_status_t target_status, size_t num,
+                                pi_status_t *statuses) {
+  if (target_status != PI_STATUS_SUCCESS) {
+    for (size_t i = 0; i < num; i++) statuses[i] = target_status;
+    return target_status;
+  }
+  for (size_t i = 0; i < num; i++) {
+    if (statuses[i] != PI_STATUS_SUCCESS) return statuses[i];
+  }
+  return PI_STATUS_SUCCESS;
+}
+
+pi_status_t pi_table_entries_add_batch(pi_session_handle_t session_handle,
+                                       pi_dev_tgt_t dev_tgt,
+                                       pi_p4_id_t table_id, size_t num,
+                                       const pi_match_key_t *const *match_keys,
+                                       const pi_table_entry_t *table_entries,
+                                       int overwrite, pi_status_t *statuses,
+                                       pi_entry_handle_t *entry_handles) {
+  const pi_p4info_t *p4info = pi_get_device_p4info(dev_tgt.dev_id);
+  if (!p4info) return batch_status(PI_STATUS_DEV_NOT_ASSIGNED, num, statuses);
+  bool all_valid = true;
+  for (size_t i = 0; i < num; i++) {
+    statuses[i] = check_table_entry(p4info, table_id, &table_entries[i]);
+    if (statuses[i] != PI_STATUS_SUCCESS) all_valid = false;
+  }
+
+  // invalid entries are never sent to the target, so we only use the batch
+  // function if all entries are valid
+  if (all_valid && _pi_table_entries_add_batch) {
+    pi_status_t status = _pi_table_entries_add_batch(
+        session_handle, dev_tgt, table_id, num, match_keys, table_entries,
+        overwrite, statuses, entry_handles);
+    return batch_status(status, num, statuses);
+  }
+
+  for (size_t i = 0; i < num; i++) {
+    if (statuses[i] != PI_STATUS_SUCCESS) continue;
+    statuses[i] = _pi_table_entry_add(session_handle, dev_tgt, table_id,
+                                      match_keys[i], &table_entries[i],
+                                      overwrite, &entry_handles[i]);
+  }
+  return batch_status(PI_STATUS_SUCCESS, num, statuses);
+}
+
+pi_status_t pi_table_entries_modify_wkey_batch(
+    pi_session_handle_t session_handle, pi_dev_id_t dev_id, pi_p4_id_t table_id,
+    size_t num, const pi_match_key_t *const *match_keys,
+    const pi_table_entry_t *table_entries, pi_status_t *statuses) {
+  if (_pi_table_entries_modify_wkey_batch) {
+    pi_status_t status = _pi_table_entries_modify_wkey_batch(
+        session_handle, dev_id, table_id, num, match_keys, table_entries,
+        statuses);
+    return batch_status(status, num, statuses);
+  }
+
+  for (size_t i = 0; i < num; i++) {
+    statuses[i] = _pi_table_entry_modify_wkey(
+        session_handle, dev_id, table_id, match_keys[i], &table_entries[i]);
+  }
+  return batch_status(PI_STATUS_SUCCESS, num, statuses);
+}
+
+pi_status_t pi_table_entries_delete_wkey_batch(
+    pi_session_handle_t session_handle, pi_dev_id_t dev_id, pi_p4_id_t table_id,
+    size_t num, const pi_match_key_t *const *match_keys,
+    pi_status_t *statuses) {
+  if (_pi_table_entries_delete_wkey_batch) {
+    pi_status_t status = _pi_table_entries_delete_wkey_batch(
+        session_handle, dev_id, table_id, num, match_keys, statuses);
+    return batch_status(status, num, statuses);
+  }
+
+  for (size_t i = 0; i < num; i++) {
+    statuses[i] = _pi_table_entry_delete_wkey(session_handle, dev_id, table_id,
+                                              match_keys[i]);
+  }
+  return batch_status(PI_STATUS_SUCCESS, num, statuses);
+}
+
+// returns the number of bytes used by the encoded entry starting at src, not
+// including its direct resources
+static size_t entry_base_size(const char *src, size_t mkey_nbytes) {
+  const char *start = src;
+  pi_entry_handle_t handle;
+  src += retrieve_entry_handle(src, &handle);
+  uint32_t priority;
+  src += retrieve_uint32(src, &priority);
+  src += mkey_nbytes;
+  pi_action_entry_type_t entry_type;
+  src += retrieve_action_entry_type(src, &entry_type);
+  switch (entry_type) {
+    case PI_ACTION_ENTRY_TYPE_NONE:
+      break;
+    case PI_ACTION_ENTRY_TYPE_DATA: {
+      pi_p4_id_t action_id;
+      src += retrieve_p4_id(src, &action_id);
+      uint32_t nbytes;
+      src += retrieve_uint32(src, &nbytes);
+      src += nbytes;
+    } break;
+    case PI_ACTION_ENTRY_TYPE_INDIRECT: {
+      pi_indirect_handle_t indirect_handle;
+      src += retrieve_indirect_handle(src, &indirect_handle);
+    } break;
+  }
+  uint32_t valid_properties;
+  src += retrieve_uint32(src, &valid_properties);
+  if (valid_properties & (1 << PI_ENTRY_PROPERTY_TYPE_TTL)) {
+    uint32_t ttl;
+    src += retrieve_uint32(src, &ttl);
+  }
+  return src - start;
+}
+
+// decoded direct resource configs are aligned on this
+#define CONFIG_ALIGN(s) (((s) + 7) & (~(size_t)7))
+
+// returns the number of bytes used by the direct resources of an encoded
+// entry; if not NULL, num_configs and configs_size are incremented by the
+// number of configs and the memory required to decode them
+static size_t direct_res_size(const char *src, size_t *num_configs,
+                              size_t *configs_size) {
+  const char *start = src;
+  uint32_t num;
+  src += retrieve_uint32(src, &num);
+  for (uint32_t i = 0; i < num; i++) {
+    pi_p4_id_t res_id;
+    src += retrieve_p4_id(src, &res_id);
+    uint32_t msg_size;
+    src += retrieve_uint32(src, &msg_size);
+    src += msg_size;
+    size_t size_of = 0;
+    pi_direct_res_get_fns(PI_GET_TYPE_ID(res_id), NULL, NULL, &size_of, NULL);
+    if (configs_size) *configs_size += CONFIG_ALIGN(size_of);
+  }
+  if (num_configs) *num_configs += num;
+  return src - start;
+}
+
+static size_t entry_size(const char *src, const pi_table_fetch_res_t *res) {
+  size_t s = entry_base_size(src, res->mkey_nbytes);
+  if (res->flags & PI_TABLE_FETCH_FLAGS_DIRECT_RES)
+    s += direct_res_size(src + s, NULL, NULL);
+  return s;
+}
+
+// evaluates the filter on the encoded entry starting at src, without decoding
+// it
+static bool entry_matches(const char *src, size_t mkey_nbytes,
+                          const pi_table_fetch_filter_t *filter) {
+  pi_entry_handle_t handle;
+  src += retrieve_entry_handle(src, &handle);
+  if ((filter->flags & PI_TABLE_FETCH_FILTER_ENTRY_HANDLE) &&
+      handle != filter->entry_handle)
+    return false;
+  uint32_t priority;
+  src += retrieve_uint32(src, &priority);
+  if ((filter->flags & PI_TABLE_FETCH_FILTER_PRIORITY) &&
+      priority != filter->priority)
+    return false;
+  if (filter->flags & PI_TABLE_FETCH_FILTER_MATCH_KEY) {
+    const char *key = filter->match_key->data;
+    const char *mask = filter->match_key_mask;
+    if (filter->match_key->data_size != mkey_nbytes) return false;
+    if (mask) {
+      for (size_t i = 0; i < mkey_nbytes; i++)
+        if ((src[i] & mask[i]) != (key[i] & mask[i])) return false;
+    } else if (memcmp(src, key, mkey_nbytes)) {
+      return false;
+    }
+  }
+  src += mkey_nbytes;
+  if (filter->flags & PI_TABLE_FETCH_FILTER_ACTION_ID) {
+    pi_action_entry_type_t entry_type;
+    src += retrieve_action_entry_type(src, &entry_type);
+    if (entry_type != PI_ACTION_ENTRY_TYPE_DATA) return false;
+    pi_p4_id_t action_id;
+    retrieve_p4_id(src, &action_id);
+    if (action_id != filter->action_id) return false;
+  }
+  return true;
+}
+
+// decodes all the entries in one pass; match keys and action data point
+// directly into the entries blob. Encoded entries which do not match the filter
+// (if any) are skipped.
+static void decode_entries(pi_table_fetch_res_t *res, size_t num_encoded,
+                           const pi_table_fetch_filter_t *filter) {
+  const char *src = res->entries;
+  pi_direct_res_config_one_t *next_config = res->direct_res_config_ones;
+  char *next_config_data = res->direct_res_data;
+  size_t i = 0;
+  for (size_t j = 0; j < num_encoded; j++) {
+    if (filter && !entry_matches(src, res->mkey_nbytes, filter)) {
+      src += entry_size(src, res);
+      continue;
+    }
+    src += retrieve_entry_handle(src, &res->entry_handles[i]);
+
+    pi_table_ma_entry_t *ma_entry = &res->ma_entries[i];
+    pi_match_key_t *match_key = &res->match_keys[i];
+    ma_entry->match_key = match_key;
+    match_key->p4info = res->p4info;
+    match_key->table_id = res->table_id;
+    src += retrieve_uint32(src, &match_key->priority);
+    match_key->data_size = res->mkey_nbytes;
+    match_key->data = (char *)src;
+    src += res->mkey_nbytes;
+
+    pi_table_entry_t *t_entry = &ma_entry->entry;
+    t_entry->direct_res_config = NULL;
+    src += retrieve_action_entry_type(src, &t_entry->entry_type);
+    switch (t_entry->entry_type) {
+      case PI_ACTION_ENTRY_TYPE_NONE:  // does it even make sense?
+        break;
+      case PI_ACTION_ENTRY_TYPE_DATA: {
+        pi_action_data_t *action_data = &res->action_datas[i];
+        t_entry->entry.action_data = action_data;
+        action_data->p4info = res->p4info;
+        src += retrieve_p4_id(src, &action_data->action_id);
+        uint32_t nbytes;
+        src += retrieve_uint32(src, &nbytes);
+        action_data->data_size = nbytes;
+        action_data->data = (char *)src;
+        src += nbytes;
+      } break;
+      case PI_ACTION_ENTRY_TYPE_INDIRECT:
+        src += retrieve_indirect_handle(src, &t_entry->entry.indirect_handle);
+        break;
+    }
+
+    pi_entry_properties_t *properties = &res->properties[i];
+    t_entry->entry_properties = properties;
+    src += retrieve_uint32(src, &properties->valid_properties);
+    if (properties->valid_properties & (1 << PI_ENTRY_PROPERTY_TYPE_TTL))
+      src += retrieve_uint32(src, &properties->ttl);
+
+    if (res->flags & PI_TABLE_FETCH_FLAGS_DIRECT_RES) {
+      pi_direct_res_config_t *direct_res_config = &res->direct_res_configs[i];
+      uint32_t num_configs;
+      src += retrieve_uint32(src, &num_configs);
+      direct_res_config->num_configs = num_configs;
+      direct_res_config->configs = next_config;
+      for (uint32_t k = 0; k < num_configs; k++) {
+        pi_direct_res_config_one_t *config = next_config++;
+        src += retrieve_p4_id(src, &config->res_id);
+        uint32_t msg_size;
+        src += retrieve_uint32(src, &msg_size);
+        size_t size_of;
+        PIDirectResRetrieveFn retrieve_fn;
+        pi_status_t status = pi_direct_res_get_fns(
+            PI_GET_TYPE_ID(config->res_id), NULL, NULL, &size_of, &retrieve_fn);
+        if (status == PI_STATUS_SUCCESS) {
+          config->config = next_config_data;
+          next_config_data += CONFIG_ALIGN(size_of);
+          retrieve_fn(src, config->config);
+        } else {
+          config->config = NULL;
+        }
+        src += msg_size;
+      }
+      t_entry->direct_res_config = direct_res_config;
+    }
+    i++;
+  }
+  assert(i == res->num_entries);
+  assert((size_t)(src - res->entries) <= res->entries_size);
+}
+
+// returns the number of entries to decode, as well as the number of direct
+// resource configs and the memory required for them
+static size_t count_entries(const pi_table_fetch_res_t *tmp,
+                            const pi_table_fetch_filter_t *filter,
+                            size_t *num_configs, size_t *configs_size) {
+  size_t count = 0;
+  const char *src = tmp->entries;
+  for (size_t i = 0; i < tmp->num_entries; i++) {
+    bool selected = !filter || entry_matches(src, tmp->mkey_nbytes, filter);
+    if (selected) count++;
+    src += entry_base_size(src, tmp->mkey_nbytes);
+    if (tmp->flags & PI_TABLE_FETCH_FLAGS_DIRECT_RES) {
+      src += direct_res_size(src, selected ? num_configs : NULL,
+                             selected ? configs_size : NULL);
+    }
+  }
+  return count;
+}
+
+// builds the result object for the entries returned by the target (in tmp) and
+// decodes them, keeping only the ones matching the filter if not NULL
+static pi_table_fetch_res_t *make_fetch_res(
+    const pi_table_fetch_res_t *tmp, pi_dev_id_t dev_id, pi_p4_id_t table_id,
+    const pi_table_fetch_filter_t *filter) {
+  // a single allocation for the result object and all the per-entry
+  // structures; the order ensures that every array is properly aligned
+  size_t n = tmp->num_entries;
+  size_t num_configs = 0;
+  size_t configs_size = 0;
+  if (filter || (tmp->flags & PI_TABLE_FETCH_FLAGS_DIRECT_RES))
+    n = count_entries(tmp, filter, &num_configs, &configs_size);
+  bool has_direct_res = (tmp->flags & PI_TABLE_FETCH_FLAGS_DIRECT_RES);
+  size_t num_direct_res_configs = has_direct_res ? n : 0;
+  size_t s = sizeof(pi_table_fetch_res_t);
+  s += n * sizeof(pi_table_ma_entry_t);
+  s += n * sizeof(pi_entry_handle_t);
+  s += n * sizeof(pi_match_key_t);
+  s += n * sizeof(pi_action_data_t);
+  s += num_direct_res_configs * sizeof(pi_direct_res_config_t);
+  s += num_configs * sizeof(pi_direct_res_config_one_t);
+  s += configs_size;
+  s += n * sizeof(pi_entry_properties_t);
+  char *arena = malloc(s);
+  pi_table_fetch_res_t *res = (pi_table_fetch_res_t *)arena;
+  *res = *tmp;
+  arena += sizeof(pi_table_fetch_res_t);
+  res->ma_entries = (pi_table_ma_entry_t *)arena;
+  arena += n * sizeof(pi_table_ma_entry_t);
+  res->entry_handles = (pi_entry_handle_t *)arena;
+  arena += n * sizeof(pi_entry_handle_t);
+  res->match_keys = (pi_match_key_t *)arena;
+  arena += n * sizeof(pi_match_key_t);
+  res->action_datas = (pi_action_data_t *)arena;
+  arena += n * sizeof(pi_action_data_t);
+  res->direct_res_configs = (pi_direct_res_config_t *)arena;
+  arena += num_direct_res_configs * sizeof(pi_direct_res_config_t);
+  res->direct_res_config_ones = (pi_direct_res_config_one_t *)arena;
+  arena += num_configs * sizeof(pi_direct_res_config_one_t);
+  res->direct_res_data = arena;
+  arena += configs_size;
+  res->properties = (pi_entry_properties_t *)arena;
+
+  res->p4info = pi_get_device_p4info(dev_id);
+  res->table_id = table_id;
+  res->num_entries = n;
+  res->idx = 0;
+  decode_entries(res, tmp->num_entries, filter);
+  return res;
+}
+
 pi_status_t pi_table_entries_fetch(pi_session_handle_t session_handle,
                                    pi_dev_id_t dev_id, pi_p4_id_t table_id,
                                    pi_table_fetch_res_t **res) {
-  pi_table_fetch_res_t *res_ = malloc(sizeof(pi_table_fetch_res_t));
+  pi_table_fetch_res_t tmp;
+  memset(&tmp, 0, sizeof(tmp));
+  pi_status_t status =
+      _pi_table_entries_fetch(session_handle, dev_id, table_id, &tmp);
+  if (status != PI_STATUS_SUCCESS) {
+    *res = NULL;
+    return status;
+  }
+  *res = make_fetch_res(&tmp, dev_id, table_id, NULL);
+  return status;
+}
+
+pi_status_t pi_table_entries_fetch_filtered(
+    pi_session_handle_t session_handle, pi_dev_id_t dev_id, pi_p4_id_t table_id,
+    const pi_table_fetch_filter_t *filter, pi_table_fetch_res_t **res) {
+  pi_table_fetch_res_t tmp;
+  memset(&tmp, 0, sizeof(tmp));
+  pi_status_t status;
+  if (_pi_table_entries_fetch_filtered) {
+    status = _pi_table_entries_fetch_filtered(session_handle, dev_id, table_id,
+                                              filter, &tmp);
+  } else {
+    status = _pi_table_entries_fetch(session_handle, dev_id, table_id, &tmp);
+  }
+  if (status != PI_STATUS_SUCCESS) {
+    *res = NULL;
+    return status;
+  }
+  // the target may return entries which do not match the filter
+  *res = make_fetch_res(&tmp, dev_id, table_id, filter);
+  return status;
+}
+
+// used when the target cannot return direct resources with the entries: reads
+// the direct resources of every entry, only for the types requested in flags,
+// and builds a new entries blob which includes them
+static pi_status_t add_direct_res(pi_session_handle_t session_handle,
+                                  pi_dev_id_t dev_id, pi_p4_id_t table_id,
+                                  int flags, pi_table_fetch_res_t *tmp) {
+  const pi_p4info_t *p4info = pi_get_device_p4info(dev_id);
+  size_t num_table_direct;
+  const pi_p4_id_t *table_direct_ids = pi_p4info_table_get_direct_resources(
+      p4info, table_id, &num_table_direct);
+  pi_p4_id_t *direct_ids = malloc(num_table_direct * sizeof(*direct_ids) + 1);
+  size_t num_direct = 0;
+  for (size_t k = 0; k < num_table_direct; k++) {
+    pi_p4_id_t res_id = table_direct_ids[k];
+    if ((PI_GET_TYPE_ID(res_id) == PI_COUNTER_ID &&
+         (flags & PI_TABLE_FETCH_FLAGS_DIRECT_COUNTERS)) ||
+        (PI_GET_TYPE_ID(res_id) == PI_METER_ID &&
+         (flags & PI_TABLE_FETCH_FLAGS_DIRECT_METERS)))
+      direct_ids[num_direct++] = res_id;
+  }
+  // all the entries have the same direct resources, so the same encoded size
+  size_t direct_size = sizeof(uint32_t);
+  for (size_t k = 0; k < num_direct; k++) {
+    direct_size += sizeof(s_pi_p4_id_t) + sizeof(uint32_t);
+    switch (PI_GET_TYPE_ID(direct_ids[k])) {
+      case PI_COUNTER_ID:
+        direct_size += sizeof(s_pi_counter_data_t);
+        break;
+      case PI_METER_ID:
+        direct_size += sizeof(s_pi_meter_spec_t);
+        break;
+      default:
+        assert(0 && "Unsupported direct resource type");
+    }
+  }
+
+  char *entries = malloc(tmp->entries_size + tmp->num_entries * direct_size);
+  const char *src = tmp->entries;
+  char *dst = entries;
+  pi_dev_tgt_t dev_tgt = {dev_id, 0xffff};
+  pi_status_t status = PI_STATUS_SUCCESS;
+  for (size_t i = 0; i < tmp->num_entries; i++) {
+    pi_entry_handle_t entry_handle;
+    retrieve_entry_handle(src, &entry_handle);
+    size_t s = entry_base_size(src, tmp->mkey_nbytes);
+    memcpy(dst, src, s);
+    src += s;
+    dst += s;
+    dst += emit_uint32(dst, num_direct);
+    for (size_t k = 0; k < num_direct; k++) {
+      pi_p4_id_t res_id = direct_ids[k];
+      dst += emit_p4_id(dst, res_id);
+      if (PI_GET_TYPE_ID(res_id) == PI_COUNTER_ID) {
+        pi_counter_data_t counter_data;
+        status = _pi_counter_read_direct(session_handle, dev_tgt, res_id,
+                                         entry_handle, PI_COUNTER_FLAGS_NONE,
+                                         &counter_data);
+        if (status != PI_STATUS_SUCCESS) break;
+        dst += emit_uint32(dst, sizeof(s_pi_counter_data_t));
+        dst += emit_counter_data(dst, &counter_data);
+      } else {
+        pi_meter_spec_t meter_spec;
+        status = _pi_meter_read_direct(session_handle, dev_tgt, res_id,
+                                       entry_handle, &meter_spec);
+        if (status != PI_STATUS_SUCCESS) break;
+        dst += emit_uint32(dst, sizeof(s_pi_meter_spec_t));
+        dst += emit_meter_spec(dst, &meter_spec);
+      }
+    }
+    if (status != PI_STATUS_SUCCESS) break;
+  }
+
+  _pi_table_entries_fetch_done(session_handle, tmp);
+  free(direct_ids);
+  if (status != PI_STATUS_SUCCESS) {
+    free(entries);
+    return status;
+  }
+  tmp->entries = entries;
+  tmp->entries_size = dst - entries;
+  tmp->core_entries = true;
+  return status;
+}
+
+// retrieves all the entries, with the direct resources requested in flags
+static pi_status_t fetch_wflags(pi_session_handle_t session_handle,
+                                pi_dev_id_t dev_id, pi_p4_id_t table_id,
+                                int flags, pi_table_fetch_res_t *tmp) {
+  memset(tmp, 0, sizeof(*tmp));
+  pi_status_t status;
+  if (_pi_table_entries_fetch_wflags) {
+    status = _pi_table_entries_fetch_wflags(session_handle, dev_id, table_id,
+                                            flags, tmp);
+  } else {
+    status = _pi_table_entries_fetch(session_handle, dev_id, table_id, tmp);
+    if (status == PI_STATUS_SUCCESS &&
+        (flags & PI_TABLE_FETCH_FLAGS_DIRECT_RES)) {
+      status = add_direct_res(session_handle, dev_id, table_id, flags, tmp);
+    }
+  }
+  tmp->flags = flags;
+  return status;
+}
+
+pi_status_t pi_table_entries_fetch_wflags(pi_session_handle_t session_handle,
+                                          pi_dev_id_t dev_id,
+                                          pi_p4_id_t table_id, int flags,
+                                          pi_table_fetch_res_t **res) {
+  pi_table_fetch_res_t tmp;
   pi_status_t status =
-      _pi_table_entries_fetch(session_handle, dev_id, table_id, res_);
-  res_->p4info = pi_get_device_p4info(dev_id);
-  res_->table_id = table_id;
-  res_->idx = 0;
-  res_->curr = 0;
-  // TODO(antonin): use contiguous memory
-  res_->match_keys = malloc(res_->num_entries * sizeof(pi_match_key_t));
-  res_->action_datas = malloc(res_->num_entries * sizeof(pi_action_data_t));
-  res_->properties = malloc(res_->num_entries * sizeof(pi_entry_properties_t));
-  *res = res_;
+      fetch_wflags(session_handle, dev_id, table_id, flags, &tmp);
+  if (status != PI_STATUS_SUCCESS) {
+    *res = NULL;
+    return status;
+  }
+  *res = make_fetch_res(&tmp, dev_id, table_id, NULL);
   return status;
 }
 
 pi_status_t pi_table_entries_fetch_done(pi_session_handle_t session_handle,
                                         pi_table_fetch_res_t *res) {
-  pi_status_t status = _pi_table_entries_fetch_done(session_handle, res);
-  if (status != PI_STATUS_SUCCESS) return status;
+  // for chunks split by the PI core, the entries are released with the cursor
+  if (res->core_entries) {
+    free(res->entries);
+  } else if (!res->cursor) {
+    pi_status_t status = _pi_table_entries_fetch_done(session_handle, res);
+    if (status != PI_STATUS_SUCCESS) return status;
+  }
 
-  assert(res->match_keys);
-  free(res->match_keys);
-  assert(res->action_datas);
-  free(res->action_datas);
-  assert(res->properties);
-  free(res->properties);
+  // per-entry structures are part of the same allocation
   free(res);
   return PI_STATUS_SUCCESS;
 }
 
-size_t pi_table_entries_num(pi_table_fetch_res_t *res) {
-  return res->num_entries;
+struct pi_table_fetch_cursor_s {
+  pi_session_handle_t session_handle;
+  pi_dev_id_t dev_id;
+  pi_p4_id_t table_id;
+  size_t max_entries;
+  size_t max_bytes;
+  // used if the target supports paginated fetches
+  uint64_t cursor_handle;
+  // otherwise, all the entries are fetched by pi_table_entries_fetch_begin
+  bool split;
+  pi_table_fetch_res_t all;
+  size_t next_idx;
+  size_t next_offset;
+};
+
+pi_status_t pi_table_entries_fetch_begin(pi_session_handle_t session_handle,
+                                         pi_dev_id_t dev_id,
+                                         pi_p4_id_t table_id,
+                                         size_t max_entries, size_t max_bytes,
+                                         pi_table_fetch_cursor_t **cursor) {
+  return pi_table_entries_fetch_begin_wflags(
+      session_handle, dev_id, table_id, PI_TABLE_FETCH_FLAGS_NONE, max_entries,
+      max_bytes, cursor);
 }
 
-size_t pi_table_entries_next(pi_table_fetch_res_t *res,
-                             pi_table_ma_entry_t *entry,
-                             pi_entry_handle_t *entry_handle) {
-  if (res->idx == res->num_entries) return res->idx;
+pi_status_t pi_table_entries_fetch_begin_wflags(
+    pi_session_handle_t session_handle, pi_dev_id_t dev_id,
+    pi_p4_id_t table_id, int flags, size_t max_entries, size_t max_bytes,
+    pi_table_fetch_cursor_t **cursor) {
+  pi_table_fetch_cursor_t *cursor_ = calloc(1, sizeof(*cursor_));
+  cursor_->session_handle = session_handle;
+  cursor_->dev_id = dev_id;
+  cursor_->table_id = table_id;
+  cursor_->max_entries = max_entries;
+  cursor_->max_bytes = max_bytes;
+
+  pi_status_t status;
+  // target cursors do not return direct resources
+  if (_pi_table_entries_fetch_begin && flags == PI_TABLE_FETCH_FLAGS_NONE) {
+    status = _pi_table_entries_fetch_begin(session_handle, dev_id, table_id,
+                                           max_entries, max_bytes,
+                                           &cursor_->cursor_handle);
+  } else {
+    cursor_->split = true;
+    status = fetch_wflags(session_handle, dev_id, table_id, flags,
+                          &cursor_->all);
+  }
+  if (status != PI_STATUS_SUCCESS) {
+    free(cursor_);
+    *cursor = NULL;
+    return status;
+  }
+  *cursor = cursor_;
+  return status;
+}
 
-  res->curr += retrieve_entry_handle(res->entries + res->curr, entry_handle);
-
-  entry->match_key = &res->match_keys[res->idx];
-  entry->match_key->p4info = res->p4info;
-  entry->match_key->table_id = res->table_id;
-  res->curr +=
-      retrieve_uint32(res->entries + res->curr, &entry->match_key->priority);
-  entry->match_key->data_size = res->mkey_nbytes;
-  entry->match_key->data = res->entries + res->curr;
-  res->curr += res->mkey_nbytes;
-
-  pi_table_entry_t *t_entry = &entry->entry;
-  res->curr += retrieve_action_entry_type(res->entries + res->curr,
-                                          &t_entry->entry_type);
-  switch (t_entry->entry_type) {
-    case PI_ACTION_ENTRY_TYPE_NONE:  // does it even make sense?
+// slices the next chunk out of the entries retrieved by
+// pi_table_entries_fetch_begin, without copying them
+static void split_next_chunk(pi_table_fetch_cursor_t *cursor,
+                             pi_table_fetch_res_t *chunk) {
+  const pi_table_fetch_res_t *all = &cursor->all;
+  memset(chunk, 0, sizeof(*chunk));
+  chunk->mkey_nbytes = all->mkey_nbytes;
+  chunk->flags = all->flags;
+  chunk->entries = all->entries + cursor->next_offset;
+  chunk->cursor = cursor;
+  while (cursor->next_idx < all->num_entries) {
+    if (cursor->max_entries > 0 && chunk->num_entries == cursor->max_entries)
       break;
-    case PI_ACTION_ENTRY_TYPE_DATA: {
-      pi_p4_id_t action_id;
-      res->curr += retrieve_p4_id(res->entries + res->curr, &action_id);
-      uint32_t nbytes;
-      res->curr += retrieve_uint32(res->entries + res->curr, &nbytes);
-      pi_action_data_t *action_data = &res->action_datas[res->idx];
-      t_entry->entry.action_data = action_data;
-      action_data->p4info = res->p4info;
-      action_data->action_id = action_id;
-      action_data->data_size = nbytes;
-      action_data->data = res->entries + res->curr;
-      res->curr += nbytes;
-    } break;
-    case PI_ACTION_ENTRY_TYPE_INDIRECT: {
-      pi_indirect_handle_t indirect_handle;
-      res->curr +=
-          retrieve_indirect_handle(res->entries + res->curr, &indirect_handle);
-      t_entry->entry.indirect_handle = indirect_handle;
-    } break;
+    size_t s = entry_size(chunk->entries + chunk->entries_size, all);
+    if (cursor->max_bytes > 0 && chunk->num_entries > 0 &&
+        chunk->entries_size + s > cursor->max_bytes)
+      break;
+    chunk->num_entries++;
+    chunk->entries_size += s;
+    cursor->next_idx++;
+  }
+  cursor->next_offset += chunk->entries_size;
+}
+
+pi_status_t pi_table_entries_fetch_next_chunk_raw(
+    pi_table_fetch_cursor_t *cursor, pi_table_fetch_res_t *chunk) {
+  if (cursor->split) {
+    split_next_chunk(cursor, chunk);
+    return PI_STATUS_SUCCESS;
+  }
+  memset(chunk, 0, sizeof(*chunk));
+  return _pi_table_entries_fetch_next_chunk(cursor->session_handle,
+                                            cursor->cursor_handle, chunk);
+}
+
+pi_status_t pi_table_entries_fetch_chunk_raw_done(
+    pi_table_fetch_cursor_t *cursor, pi_table_fetch_res_t *chunk) {
+  // split chunks point into the entries owned by the cursor
+  if (cursor->split) return PI_STATUS_SUCCESS;
+  return _pi_table_entries_fetch_done(cursor->session_handle, chunk);
+}
+
+pi_status_t pi_table_entries_fetch_next_chunk(pi_table_fetch_cursor_t *cursor,
+                                              pi_table_fetch_res_t **res) {
+  pi_table_fetch_res_t tmp;
+  pi_status_t status = pi_table_entries_fetch_next_chunk_raw(cursor, &tmp);
+  if (status != PI_STATUS_SUCCESS) {
+    *res = NULL;
+    return status;
+  }
+  if (tmp.num_entries == 0) {
+    *res = NULL;
+    return pi_table_entries_fetch_chunk_raw_done(cursor, &tmp);
   }
+  *res = make_fetch_res(&tmp, cursor->dev_id, cursor->table_id, NULL);
+  return status;
+}
 
-  pi_entry_properties_t *properties = res->properties + res->idx;
-  t_entry->entry_properties = properties;
-  res->curr +=
-      retrieve_uint32(res->entries + res->curr, &properties->valid_properties);
-  if (properties->valid_properties & (1 << PI_ENTRY_PROPERTY_TYPE_TTL)) {
-    res->curr += retrieve_uint32(res->entries + res->curr, &properties->ttl);
+pi_status_t pi_table_entries_fetch_end(pi_table_fetch_cursor_t *cursor) {
+  pi_status_t status;
+  if (cursor->split && cursor->all.core_entries) {
+    free(cursor->all.entries);
+    status = PI_STATUS_SUCCESS;
+  } else if (cursor->split) {
+    status = _pi_table_entries_fetch_done(cursor->session_handle, &cursor->all);
+  } else {
+    status = _pi_table_entries_fetch_end(cursor->session_handle,
+                                         cursor->cursor_handle);
   }
+  free(cursor);
+  return status;
+}
+
+size_t pi_table_entries_num(pi_table_fetch_res_t *res) {
+  return res->num_entries;
+}
 
+const pi_table_ma_entry_t *pi_table_entries_get(const pi_table_fetch_res_t *res,
+                                                size_t i) {
+  assert(i < res->num_entries);
+  return &res->ma_entries[i];
+}
+
+pi_entry_handle_t pi_table_entries_get_handle(const pi_table_fetch_res_t *res,
+                                              size_t i) {
+  assert(i < res->num_entries);
+  return res->entry_handles[i];
+}
+
+size_t pi_table_entries_next(pi_table_fetch_res_t *res,
+                             pi_table_ma_entry_t *entry,
+                             pi_entry_handle_t *entry_handle) {
+  if (res->idx == res->num_entries) return res->idx;
+  *entry = res->ma_entries[res->idx];
+  *entry_handle = res->entry_handles[res->idx];
   return res->idx++;
 }
@@ -31,15 +31,24 @@ static inline pi_status_t get_bitwidth_and_mask(const pi_p4info_t *p4info,
                                                 pi_p4_id_t obj_id,
                                                 size_t *bitwidth, char *mask) {
   switch (PI_GET_TYPE_ID(parent_id)) {
-    case PI_ACTION_ID:
-      *bitwidth = pi_p4info_action_param_bitwidth(p4info, parent_id, obj_id);
-      *mask = pi_p4info_action_param_byte0_mask(p4info, parent_id, obj_id);
+    case PI_ACTION_ID: {
+      const pi_p4info_action_data_layout_t *layout =
+          pi_p4info_action_data_layout(p4info, parent_id);
+      size_t index = pi_p4info_action_data_layout_index(layout, obj_id);
+      if (index == (size_t)-1) return PI_STATUS_NETV_INVALID_OBJ_ID;
+      *bitwidth = layout->params[index].bitwidth;
+      *mask = layout->params[index].byte0_mask;
       return PI_STATUS_SUCCESS;
-    case PI_TABLE_ID:
-      *bitwidth =
-          pi_p4info_table_match_field_bitwidth(p4info, parent_id, obj_id);
-      *mask = pi_p4info_table_match_field_byte0_mask(p4info, parent_id, obj_id);
+    }
+    case PI_TABLE_ID: {
+      const pi_p4info_match_key_layout_t *layout =
+          pi_p4info_table_match_key_layout(p4info, parent_id);
+      size_t index = pi_p4info_match_key_layout_index(layout, obj_id);
+      if (index == (size_t)-1) return PI_STATUS_NETV_INVALID_OBJ_ID;
+      *bitwidth = layout->fields[index].bitwidth;
+      *mask = layout->fields[index].byte0_mask;
       return PI_STATUS_SUCCESS;
+    }
     default:
       return PI_STATUS_NETV_INVALID_OBJ_ID;
   }
@@ -0,0 +1,470 @@
+/* Copyright 2013-present Barefoot Networks, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Antonin Bas (antonin@barefootnetworks.com)
+ *
+ */
+
+#include <PI/int/shm_transport.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <linux/futex.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#define SHM_MAGIC 0x50494d53u  // "PIMS"
+#define SHM_VERSION 2
+
+#define CACHE_LINE 64
+// every message in a ring is preceded by a msg_hdr_t and padded to this
+#define MSG_ALIGN 8
+// size of a message header marking the end of the ring as unused, when the next
+// message does not fit before the end
+#define WRAP_MARKER UINT32_MAX
+
+// messages are never split across the end of the ring, so that the receiver can
+// hand out pointers to them; released is only accessed by the receiving
+// process, once the message has been handed out
+typedef struct {
+  uint32_t len;
+  uint32_t released;
+} msg_hdr_t;
+
+// head and tail are free-running byte counters, only reduced modulo the
+// capacity when accessing data; the producer only writes head and the consumer
+// only writes tail, so no lock is needed between the 2 processes
+typedef struct {
+  uint64_t head __attribute__((aligned(CACHE_LINE)));
+  // futex word, incremented every time head is updated
+  uint32_t data_seq;
+  uint32_t consumer_waiting;
+  uint64_t tail __attribute__((aligned(CACHE_LINE)));
+  // futex word, incremented every time tail is updated
+  uint32_t space_seq;
+  uint32_t producer_waiting;
+} ring_ctrl_t;
+
+typedef struct {
+  uint32_t magic;
+  uint32_t version;
+  uint64_t ring_size;
+  // pid of the client using the segment, 0 if none
+  uint32_t client_pid;
+  // rings[0] is for requests, rings[1] for replies
+  ring_ctrl_t rings[2];
+} shm_hdr_t;
+
+typedef struct {
+  ring_ctrl_t *ctrl;
+  char *data;
+  uint64_t mask;
+  // incoming ring only: position of the next message to hand out; tail lags
+  // behind it until the messages in between are released
+  uint64_t read_pos;
+} ring_t;
+
+struct pi_shm_transport_s {
+  char *name;
+  bool owner;
+  void *mem;
+  size_t mem_size;
+  ring_t out;
+  ring_t in;
+  int spin_iterations;
+  // multiple threads in this process may send concurrently
+  pthread_mutex_t send_lock;
+  // messages may be released concurrently by different threads
+  pthread_mutex_t release_lock;
+  int shutdown;
+};
+
+static long futex(uint32_t *addr, int op, uint32_t val) {
+  return syscall(SYS_futex, addr, op, val, NULL, NULL, 0);
+}
+
+static void futex_wait(uint32_t *addr, uint32_t val) {
+  futex(addr, FUTEX_WAIT, val);
+}
+
+static void futex_wake_all(uint32_t *addr) { futex(addr, FUTEX_WAKE, INT_MAX); }
+
+static inline void cpu_relax() {
+#if defined(__x86_64__) || defined(__i386__)
+  __builtin_ia32_pause();
+#endif
+}
+
+static inline uint64_t load(uint64_t *v) {
+  return __atomic_load_n(v, __ATOMIC_SEQ_CST);
+}
+
+static bool is_shutdown(pi_shm_transport_t *transport) {
+  return __atomic_load_n(&transport->shutdown, __ATOMIC_ACQUIRE);
+}
+
+// Spins, then sleeps on seq, until cond_fn returns true. The waiting flag is
+// set before checking the condition for the last time, and the other side
+// always increments seq before checking the flag, so a wakeup cannot be missed.
+// Returns false once the transport has been shut down, even if the condition
+// holds.
+static bool wait_for(pi_shm_transport_t *transport, uint32_t *seq,
+                     uint32_t *waiting,
+                     bool (*cond_fn)(ring_t *, uint64_t), ring_t *ring,
+                     uint64_t arg) {
+  if (is_shutdown(transport)) return false;
+  for (int i = 0; i < transport->spin_iterations; i++) {
+    if (cond_fn(ring, arg)) return true;
+    if (is_shutdown(transport)) return false;
+    cpu_relax();
+  }
+  while (1) {
+    uint32_t v = __atomic_load_n(seq, __ATOMIC_SEQ_CST);
+    __atomic_store_n(waiting, 1, __ATOMIC_SEQ_CST);
+    if (cond_fn(ring, arg)) break;
+    if (is_shutdown(transport)) {
+      __atomic_store_n(waiting, 0, __ATOMIC_SEQ_CST);
+      return false;
+    }
+    futex_wait(seq, v);
+  }
+  __atomic_store_n(waiting, 0, __ATOMIC_SEQ_CST);
+  return true;
+}
+
+static void notify(uint32_t *seq, uint32_t *waiting) {
+  __atomic_fetch_add(seq, 1, __ATOMIC_SEQ_CST);
+  if (__atomic_load_n(waiting, __ATOMIC_SEQ_CST)) futex_wake_all(seq);
+}
+
+static bool has_space(ring_t *ring, uint64_t required) {
+  uint64_t used = ring->ctrl->head - load(&ring->ctrl->tail);
+  return (ring->mask + 1) - used >= required;
+}
+
+static bool has_data(ring_t *ring, uint64_t unused) {
+  (void)unused;
+  return load(&ring->ctrl->head) != ring->read_pos;
+}
+
+static msg_hdr_t *msg_at(ring_t *ring, uint64_t pos) {
+  return (msg_hdr_t *)(ring->data + (pos & ring->mask));
+}
+
+static size_t msg_footprint(size_t len) {
+  return (sizeof(msg_hdr_t) + len + MSG_ALIGN - 1) & ~(size_t)(MSG_ALIGN - 1);
+}
+
+// number of bytes between pos and the end of the ring
+static size_t bytes_to_end(ring_t *ring, uint64_t pos) {
+  return ring->mask + 1 - (pos & ring->mask);
+}
+
+int pi_shm_send(pi_shm_transport_t *transport, const void *buf, size_t len) {
+  ring_t *ring = &transport->out;
+  size_t required = msg_footprint(len);
+  if (required > ring->mask + 1 || len > INT_MAX) return -1;
+
+  pthread_mutex_lock(&transport->send_lock);
+  uint64_t head = ring->ctrl->head;
+  size_t gap = bytes_to_end(ring, head);
+  if (gap < required) {
+    // the message does not fit before the end of the ring, skip to the start;
+    // gap is a multiple of MSG_ALIGN so there is room for the marker
+    if (!wait_for(transport, &ring->ctrl->space_seq,
+                  &ring->ctrl->producer_waiting, has_space, ring, gap)) {
+      pthread_mutex_unlock(&transport->send_lock);
+      return -1;
+    }
+    msg_hdr_t *marker = msg_at(ring, head);
+    marker->len = WRAP_MARKER;
+    marker->released = 0;
+    head += gap;
+    __atomic_store_n(&ring->ctrl->head, head, __ATOMIC_SEQ_CST);
+    notify(&ring->ctrl->data_seq, &ring->ctrl->consumer_waiting);
+  }
+  if (!wait_for(transport, &ring->ctrl->space_seq,
+                &ring->ctrl->producer_waiting, has_space, ring, required)) {
+    pthread_mutex_unlock(&transport->send_lock);
+    return -1;
+  }
+  msg_hdr_t *hdr = msg_at(ring, head);
+  hdr->len = len;
+  hdr->released = 0;
+  memcpy(hdr + 1, buf, len);
+  __atomic_store_n(&ring->ctrl->head, head + required, __ATOMIC_SEQ_CST);
+  notify(&ring->ctrl->data_seq, &ring->ctrl->consumer_waiting);
+  pthread_mutex_unlock(&transport->send_lock);
+  return len;
+}
+
+// Gives back to the producer the space used by the released messages at the
+// tail of the ring. Messages can be released in any order, but the tail only
+// moves past a message once all the ones before it have been released. Must be
+// called with the release lock held.
+static void reclaim(ring_t *ring) {
+  uint64_t tail = ring->ctrl->tail;
+  uint64_t read_pos = __atomic_load_n(&ring->read_pos, __ATOMIC_ACQUIRE);
+  while (tail != read_pos) {
+    msg_hdr_t *hdr = msg_at(ring, tail);
+    if (!hdr->released) break;
+    tail += (hdr->len == WRAP_MARKER) ? bytes_to_end(ring, tail)
+                                      : msg_footprint(hdr->len);
+  }
+  if (tail == ring->ctrl->tail) return;
+  __atomic_store_n(&ring->ctrl->tail, tail, __ATOMIC_SEQ_CST);
+  notify(&ring->ctrl->space_seq, &ring->ctrl->producer_waiting);
+}
+
+static void release_hdr(pi_shm_transport_t *transport, msg_hdr_t *hdr) {
+  pthread_mutex_lock(&transport->release_lock);
+  hdr->released = 1;
+  reclaim(&transport->in);
+  pthread_mutex_unlock(&transport->release_lock);
+}
+
+int pi_shm_recv(pi_shm_transport_t *transport, char **msg) {
+  ring_t *ring = &transport->in;
+  size_t capacity = ring->mask + 1;
+  while (1) {
+    if (!wait_for(transport, &ring->ctrl->data_seq,
+                  &ring->ctrl->consumer_waiting, has_data, ring, 0)) {
+      return -1;
+    }
+    uint64_t pos = ring->read_pos;
+    uint64_t available = load(&ring->ctrl->head) - pos;
+    size_t gap = bytes_to_end(ring, pos);
+    msg_hdr_t *hdr = msg_at(ring, pos);
+    // the header is written by the other process, which cannot be trusted to
+    // keep the ring consistent
+    if (available > capacity) return -1;
+    if (hdr->len == WRAP_MARKER) {
+      if (available < gap) return -1;
+      __atomic_store_n(&ring->read_pos, pos + gap, __ATOMIC_RELEASE);
+      release_hdr(transport, hdr);
+      continue;
+    }
+    if (hdr->len > capacity - sizeof(msg_hdr_t)) return -1;
+    size_t footprint = msg_footprint(hdr->len);
+    if (footprint > gap || footprint > available) return -1;
+    __atomic_store_n(&ring->read_pos, pos + footprint, __ATOMIC_RELEASE);
+    *msg = (char *)(hdr + 1);
+    return hdr->len;
+  }
+}
+
+void pi_shm_release(pi_shm_transport_t *transport, char *msg) {
+  release_hdr(transport, (msg_hdr_t *)msg - 1);
+}
+
+void pi_shm_shutdown(pi_shm_transport_t *transport) {
+  __atomic_store_n(&transport->shutdown, 1, __ATOMIC_RELEASE);
+  // spurious increments are harmless, waiters always re-check their condition
+  __atomic_fetch_add(&transport->in.ctrl->data_seq, 1, __ATOMIC_SEQ_CST);
+  futex_wake_all(&transport->in.ctrl->data_seq);
+  __atomic_fetch_add(&transport->out.ctrl->space_seq, 1, __ATOMIC_SEQ_CST);
+  futex_wake_all(&transport->out.ctrl->space_seq);
+}
+
+bool pi_shm_is_shm_addr(const char *addr) {
+  return addr &&
+         !strncmp(addr, PI_SHM_ADDR_PREFIX, sizeof(PI_SHM_ADDR_PREFIX) - 1);
+}
+
+// splits "shm://<name>?size=<n>&spin=<n>"; returns false if the address is
+// invalid
+static bool parse_addr(const char *addr, char **name, size_t *ring_size,
+                       int *spin_iterations) {
+  if (!pi_shm_is_shm_addr(addr)) return false;
+  const char *start = addr + sizeof(PI_SHM_ADDR_PREFIX) - 1;
+  const char *end = strchr(start, '?');
+  size_t name_len = end ? (size_t)(end - start) : strlen(start);
+  if (name_len == 0 || memchr(start, '/', name_len)) return false;
+  // shm_open requires a leading '/'
+  *name = malloc(name_len + 2);
+  (*name)[0] = '/';
+  memcpy(*name + 1, start, name_len);
+  (*name)[name_len + 1] = '\0';
+
+  *ring_size = PI_SHM_DEFAULT_RING_SIZE;
+  *spin_iterations = PI_SHM_DEFAULT_SPIN_ITERATIONS;
+  while (end) {
+    const char *param = end + 1;
+    end = strchr(param, '&');
+    char *endptr;
+    if (!strncmp(param, "size=", 5)) {
+      *ring_size = strtoull(param + 5, &endptr, 10);
+    } else if (!strncmp(param, "spin=", 5)) {
+      *spin_iterations = strtol(param + 5, &endptr, 10);
+    } else {
+      endptr = NULL;
+    }
+    if (!endptr || (*endptr != '\0' && *endptr != '&')) {
+      free(*name);
+      return false;
+    }
+  }
+  return true;
+}
+
+static void setup_rings(pi_shm_transport_t *transport, bool server) {
+  shm_hdr_t *hdr = (shm_hdr_t *)transport->mem;
+  char *data = (char *)transport->mem + sizeof(shm_hdr_t);
+  ring_t rings[2];
+  for (size_t i = 0; i < 2; i++) {
+    rings[i].ctrl = &hdr->rings[i];
+    rings[i].data = data + i * hdr->ring_size;
+    rings[i].mask = hdr->ring_size - 1;
+    rings[i].read_pos = 0;
+  }
+  transport->out = server ? rings[1] : rings[0];
+  transport->in = server ? rings[0] : rings[1];
+}
+
+static pi_shm_transport_t *transport_new(char *name, bool owner,
+                                         int spin_iterations) {
+  pi_shm_transport_t *transport = calloc(1, sizeof(*transport));
+  transport->name = name;
+  transport->owner = owner;
+  transport->spin_iterations = spin_iterations;
+  pthread_mutex_init(&transport->send_lock, NULL);
+  pthread_mutex_init(&transport->release_lock, NULL);
+  return transport;
+}
+
+pi_shm_transport_t *pi_shm_transport_create(const char *addr) {
+  char *name;
+  size_t ring_size;
+  int spin_iterations;
+  if (!parse_addr(addr, &name, &ring_size, &spin_iterations)) return NULL;
+  size_t size = CACHE_LINE;
+  while (size < ring_size) size <<= 1;
+  ring_size = size;
+
+  shm_unlink(name);
+  int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+  if (fd < 0) {
+    free(name);
+    return NULL;
+  }
+  size_t mem_size = sizeof(shm_hdr_t) + 2 * ring_size;
+  void *mem = MAP_FAILED;
+  if (ftruncate(fd, mem_size) == 0)
+    mem = mmap(NULL, mem_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (mem == MAP_FAILED) {
+    shm_unlink(name);
+    free(name);
+    return NULL;
+  }
+
+  // the segment is zero-filled by ftruncate
+  shm_hdr_t *hdr = (shm_hdr_t *)mem;
+  hdr->ring_size = ring_size;
+  hdr->version = SHM_VERSION;
+  __atomic_store_n(&hdr->magic, SHM_MAGIC, __ATOMIC_RELEASE);
+
+  pi_shm_transport_t *transport = transport_new(name, true, spin_iterations);
+  transport->mem = mem;
+  transport->mem_size = mem_size;
+  setup_rings(transport, true);
+  return transport;
+}
+
+// The rings have a single consumer and a single producer on each side, so only
+// one client can use the segment at a time. The client records its pid in the
+// segment, and a segment still recorded as used by a process which no longer
+// exists (e.g. which crashed) can be taken over.
+static bool attach_client(shm_hdr_t *hdr) {
+  uint32_t self = getpid();
+  uint32_t pid = 0;
+  while (!__atomic_compare_exchange_n(&hdr->client_pid, &pid, self, false,
+                                      __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST)) {
+    // pid now holds the current client
+    if (pid == self || kill((pid_t)pid, 0) == 0 || errno != ESRCH) return false;
+  }
+  return true;
+}
+
+pi_shm_transport_t *pi_shm_transport_connect(const char *addr) {
+  char *name;
+  size_t ring_size;
+  int spin_iterations;
+  if (!parse_addr(addr, &name, &ring_size, &spin_iterations)) return NULL;
+
+  int fd = shm_open(name, O_RDWR, 0);
+  struct stat st;
+  if (fd < 0 || fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(shm_hdr_t)) {
+    if (fd >= 0) close(fd);
+    free(name);
+    return NULL;
+  }
+  size_t mem_size = st.st_size;
+  void *mem = mmap(NULL, mem_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (mem == MAP_FAILED) {
+    free(name);
+    return NULL;
+  }
+  shm_hdr_t *hdr = (shm_hdr_t *)mem;
+  if (__atomic_load_n(&hdr->magic, __ATOMIC_ACQUIRE) != SHM_MAGIC ||
+      hdr->version != SHM_VERSION ||
+      mem_size != sizeof(shm_hdr_t) + 2 * hdr->ring_size) {
+    munmap(mem, mem_size);
+    free(name);
+    return NULL;
+  }
+
+  if (!attach_client(hdr)) {
+    munmap(mem, mem_size);
+    free(name);
+    return NULL;
+  }
+
+  pi_shm_transport_t *transport = transport_new(name, false, spin_iterations);
+  transport->mem = mem;
+  transport->mem_size = mem_size;
+  setup_rings(transport, false);
+  // drop any reply left over by a previous client
+  ring_t *in = &transport->in;
+  in->read_pos = load(&in->ctrl->head);
+  __atomic_store_n(&in->ctrl->tail, in->read_pos, __ATOMIC_SEQ_CST);
+  notify(&in->ctrl->space_seq, &in->ctrl->producer_waiting);
+  return transport;
+}
+
+void pi_shm_transport_destroy(pi_shm_transport_t *transport) {
+  if (!transport->owner) {
+    shm_hdr_t *hdr = (shm_hdr_t *)transport->mem;
+    uint32_t pid = getpid();
+    __atomic_compare_exchange_n(&hdr->client_pid, &pid, 0, false,
+                                __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+  }
+  munmap(transport->mem, transport->mem_size);
+  if (transport->owner) shm_unlink(transport->name);
+  pthread_mutex_destroy(&transport->send_lock);
+  pthread_mutex_destroy(&transport->release_lock);
+  free(transport->name);
+  free(transport);
+}
@@ -21,6 +21,7 @@
 #include <PI/pi.h>
 #include <PI/target/pi_imp.h>
 
+#include <atomic>
 #include <iostream>
 #include <string>
 
@@ -47,6 +48,10 @@ namespace {
 
 pibmv2::CpuSendRecv *cpu_send_recv = nullptr;
 
+// handles are not used by bmv2, but distinct handles let the RPC server spread
+// sessions across its workers
+std::atomic<pi_session_handle_t> next_session_handle{0};
+
 }  // namespace
 
 extern "C" {
@@ -148,7 +153,7 @@ pi_status_t _pi_destroy() {
 
 // bmv2 does not support transaction and has no use for the session_handle
 pi_status_t _pi_session_init(pi_session_handle_t *session_handle) {
-  *session_handle = 0;
+  *session_handle = next_session_handle++;
   return PI_STATUS_SUCCESS;
 }
 
@@ -22,6 +22,7 @@
 #include <PI/int/serialize.h>
 #include <PI/p4info.h>
 #include <PI/pi.h>
+#include <PI/target/pi_tables_imp.h>
 
 #include <algorithm>
 #include <iostream>
@@ -580,6 +581,17 @@ pi_status_t _pi_table_entries_fetch(pi_session_handle_t session_handle,
                                     pi_dev_id_t dev_id,
                                     pi_p4_id_t table_id,
                                     pi_table_fetch_res_t *res) {
+  pi_table_fetch_filter_t filter;
+  std::memset(&filter, 0, sizeof(filter));
+  return _pi_table_entries_fetch_filtered(session_handle, dev_id, table_id,
+                                          &filter, res);
+}
+
+// only the entry handle is used, the PI core takes care of the rest of the
+// filter
+pi_status_t _pi_table_entries_fetch_filtered(
+    pi_session_handle_t session_handle, pi_dev_id_t dev_id, pi_p4_id_t table_id,
+    const pi_table_fetch_filter_t *filter, pi_table_fetch_res_t *res) {
   (void) session_handle;
 
   pibmv2::device_info_t *d_info = pibmv2::get_device_info(dev_id);
@@ -590,8 +602,14 @@ pi_status_t _pi_table_entries_fetch(pi_session_handle_t session_handle,
 
   std::vector<BmMtEntry> entries;
   try {
-    conn_mgr_client(pibmv2::conn_mgr_state, dev_id).c->bm_mt_get_entries(
-        entries, 0, t_name);
+    auto client = conn_mgr_client(pibmv2::conn_mgr_state, dev_id);
+    if (filter->flags & PI_TABLE_FETCH_FILTER_ENTRY_HANDLE) {
+      entries.emplace_back();
+      client.c->bm_mt_get_entry(entries.back(), 0, t_name,
+                                filter->entry_handle);
+    } else {
+      client.c->bm_mt_get_entries(entries, 0, t_name);
+    }
   } catch (InvalidTableOperation &ito) {
     const char *what =
         _TableOperationErrorCode_VALUES_TO_NAMES.find(ito.code)->second;
@@ -0,0 +1,27 @@
+/* Copyright 2013-present Barefoot Networks, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Antonin Bas (antonin@barefootnetworks.com)
+ *
+ */
+
+#ifndef PI_TARGETS_DUMMY_COUNTERS_STATE_H_
+#define PI_TARGETS_DUMMY_COUNTERS_STATE_H_
+
+// removes all the indirect counter values stored by the dummy target
+void dummy_counters_reset();
+
+#endif  // PI_TARGETS_DUMMY_COUNTERS_STATE_H_
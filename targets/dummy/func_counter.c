@@ -22,11 +22,16 @@
 
 #include <Judy.h>
 
+#include <pthread.h>
 #include <stdio.h>
 
-typedef struct { Pvoid_t array; } func_counter_t;
+// the lock is needed as the RPC server may call the target from several threads
+typedef struct {
+  Pvoid_t array;
+  pthread_mutex_t lock;
+} func_counter_t;
 
-static func_counter_t func_counter;
+static func_counter_t func_counter = {NULL, PTHREAD_MUTEX_INITIALIZER};
 
 void func_counter_init() { func_counter.array = (Pvoid_t)NULL; }
 
@@ -35,14 +40,19 @@ void func_counter_increment(const char *func_name) {
   printf("%s\n", func_name);
 #endif
   Word_t *PValue;
+  pthread_mutex_lock(&func_counter.lock);
   JSLI(PValue, func_counter.array, (const uint8_t *)func_name);
   (*PValue)++;
+  pthread_mutex_unlock(&func_counter.lock);
 }
 
 int func_counter_get(const char *func_name) {
   Word_t *PValue;
+  pthread_mutex_lock(&func_counter.lock);
   JSLG(PValue, func_counter.array, (const uint8_t *)func_name);
-  return (PValue == NULL) ? -1 : (int)*PValue;
+  int count = (PValue == NULL) ? -1 : (int)*PValue;
+  pthread_mutex_unlock(&func_counter.lock);
+  return count;
 }
 
 int func_counter_dump_to_file(const char *path) {
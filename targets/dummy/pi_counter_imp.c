@@ -20,21 +20,66 @@
 
 #include <PI/target/pi_counter_imp.h>
 
+#include <Judy.h>
+
+#include <pthread.h>
 #include <stdio.h>
+#include <stdlib.h>
 
+#include "counters_state.h"
 #include "func_counter.h"
 
+// The dummy target keeps the values of indirect counter cells in memory, so
+// that reads return what was written; cells which were never written read as
+// 0. The device id is ignored.
+
+// counter id -> (index -> pi_counter_data_t *)
+static Pvoid_t counters = (Pvoid_t)NULL;
+static pthread_mutex_t counters_lock = PTHREAD_MUTEX_INITIALIZER;
+
+void dummy_counters_reset() {
+  pthread_mutex_lock(&counters_lock);
+  Word_t *PValue;
+  Word_t counter_id = 0;
+  JLF(PValue, counters, counter_id);
+  while (PValue) {
+    Pvoid_t cells = (Pvoid_t)*PValue;
+    Word_t *PCell;
+    Word_t index = 0;
+    JLF(PCell, cells, index);
+    while (PCell) {
+      free((pi_counter_data_t *)*PCell);
+      JLN(PCell, cells, index);
+    }
+    Word_t bytes_freed;
+    JLFA(bytes_freed, cells);
+    JLN(PValue, counters, counter_id);
+  }
+  Word_t bytes_freed;
+  JLFA(bytes_freed, counters);
+  pthread_mutex_unlock(&counters_lock);
+}
+
 pi_status_t _pi_counter_read(pi_session_handle_t session_handle,
                              pi_dev_tgt_t dev_tgt, pi_p4_id_t counter_id,
                              size_t index, int flags,
                              pi_counter_data_t *counter_data) {
   (void)session_handle;
   (void)dev_tgt;
-  (void)counter_id;
-  (void)index;
   (void)flags;
-  (void)counter_data;
   func_counter_increment(__func__);
+  counter_data->valid = PI_COUNTER_UNIT_PACKETS | PI_COUNTER_UNIT_BYTES;
+  counter_data->packets = 0;
+  counter_data->bytes = 0;
+  pthread_mutex_lock(&counters_lock);
+  Word_t *PValue;
+  JLG(PValue, counters, counter_id);
+  if (PValue) {
+    Word_t *PCell;
+    JLG(PCell, (Pvoid_t)*PValue, index);
+    if (PCell) *counter_data = *(pi_counter_data_t *)*PCell;
+  }
+  pthread_mutex_unlock(&counters_lock);
   return PI_STATUS_SUCCESS;
 }
 
@@ -44,10 +89,24 @@ pi_status_t _pi_counter_write(pi_session_handle_t session_handle,
                               const pi_counter_data_t *counter_data) {
   (void)session_handle;
   (void)dev_tgt;
-  (void)counter_id;
-  (void)index;
-  (void)counter_data;
   func_counter_increment(__func__);
+  pthread_mutex_lock(&counters_lock);
+  Word_t *PValue;
+  JLI(PValue, counters, counter_id);
+  Word_t *PCell;
+  JLI(PCell, *(Pvoid_t *)PValue, index);
+  if (*PCell == 0) {
+    pi_counter_data_t *cell = calloc(1, sizeof(*cell));
+    cell->valid = PI_COUNTER_UNIT_PACKETS | PI_COUNTER_UNIT_BYTES;
+    *PCell = (Word_t)cell;
+  }
+  // only the units present in counter_data are written
+  pi_counter_data_t *cell = (pi_counter_data_t *)*PCell;
+  if (counter_data->valid & PI_COUNTER_UNIT_PACKETS)
+    cell->packets = counter_data->packets;
+  if (counter_data->valid & PI_COUNTER_UNIT_BYTES)
+    cell->bytes = counter_data->bytes;
+  pthread_mutex_unlock(&counters_lock);
   return PI_STATUS_SUCCESS;
 }
 
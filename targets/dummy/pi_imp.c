@@ -25,10 +25,14 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "counters_state.h"
 #include "func_counter.h"
+#include "tables_state.h"
 
 static char *counter_dump_path = NULL;
 
+static pi_session_handle_t next_session_handle = 0;
+
 pi_status_t _pi_init(void *extra) {
   if (extra)
     counter_dump_path = strdup((const char *)extra);
@@ -69,11 +73,15 @@ pi_status_t _pi_update_device_end(pi_dev_id_t dev_id) {
 pi_status_t _pi_remove_device(pi_dev_id_t dev_id) {
   (void)dev_id;
   func_counter_increment(__func__);
+  dummy_tables_reset();
+  dummy_counters_reset();
   return PI_STATUS_SUCCESS;
 }
 
 pi_status_t _pi_destroy() {
   func_counter_increment(__func__);
+  dummy_tables_reset();
+  dummy_counters_reset();
   if (counter_dump_path) {
     func_counter_dump_to_file(counter_dump_path);
     free(counter_dump_path);
@@ -84,7 +92,8 @@ pi_status_t _pi_destroy() {
 }
 
 pi_status_t _pi_session_init(pi_session_handle_t *session_handle) {
-  *session_handle = 0;
+  // distinct handles let the RPC server spread sessions across its workers
+  *session_handle = __sync_fetch_and_add(&next_session_handle, 1);
   func_counter_increment(__func__);
   return PI_STATUS_SUCCESS;
 }
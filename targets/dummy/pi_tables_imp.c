@@ -18,11 +18,157 @@
  *
  */
 
+#include "PI/int/pi_int.h"
+#include "PI/int/serialize.h"
 #include "PI/pi.h"
+#include "PI/target/pi_tables_imp.h"
 
+#include <Judy.h>
+
+#include <pthread.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include "func_counter.h"
+#include "tables_state.h"
+
+// The dummy target keeps the entries of each table in memory, so that fetches
+// return what was added. Entries are stored already encoded in the format
+// expected from _pi_table_entries_fetch and are indexed by handle, handles are
+// never reused. The device id is ignored.
+
+typedef struct {
+  size_t size;
+  char data[];
+} dummy_entry_t;
+
+typedef struct {
+  Pvoid_t entries;  // handle -> dummy_entry_t *
+  size_t num_entries;
+} dummy_table_t;
+
+static Pvoid_t tables = (Pvoid_t)NULL;  // table id -> dummy_table_t *
+static pi_entry_handle_t next_handle = 0;
+static pthread_mutex_t tables_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// the match key starts right after the handle and the priority
+#define ENTRY_KEY_OFFSET (sizeof(s_pi_entry_handle_t) + sizeof(uint32_t))
+
+static dummy_table_t *get_table(pi_p4_id_t table_id, bool create) {
+  Word_t *PValue;
+  JLG(PValue, tables, table_id);
+  if (PValue) return (dummy_table_t *)*PValue;
+  if (!create) return NULL;
+  dummy_table_t *table = calloc(1, sizeof(*table));
+  JLI(PValue, tables, table_id);
+  *PValue = (Word_t)table;
+  return table;
+}
+
+static dummy_entry_t *encode_entry(pi_entry_handle_t handle,
+                                   const pi_match_key_t *match_key,
+                                   const pi_table_entry_t *table_entry) {
+  const pi_action_data_t *action_data = NULL;
+  size_t s = ENTRY_KEY_OFFSET + match_key->data_size;
+  s += sizeof(s_pi_action_entry_type_t);
+  if (table_entry->entry_type == PI_ACTION_ENTRY_TYPE_DATA) {
+    action_data = table_entry->entry.action_data;
+    s += sizeof(s_pi_p4_id_t) + sizeof(uint32_t) + action_data->data_size;
+  } else if (table_entry->entry_type == PI_ACTION_ENTRY_TYPE_INDIRECT) {
+    s += sizeof(s_pi_indirect_handle_t);
+  }
+  const pi_entry_properties_t *properties = table_entry->entry_properties;
+  uint32_t valid_properties = properties ? properties->valid_properties : 0;
+  s += sizeof(uint32_t);
+  if (valid_properties & (1 << PI_ENTRY_PROPERTY_TYPE_TTL))
+    s += sizeof(uint32_t);
+
+  dummy_entry_t *entry = malloc(sizeof(*entry) + s);
+  entry->size = s;
+  char *dst = entry->data;
+  dst += emit_entry_handle(dst, handle);
+  dst += emit_uint32(dst, match_key->priority);
+  memcpy(dst, match_key->data, match_key->data_size);
+  dst += match_key->data_size;
+  dst += emit_action_entry_type(dst, table_entry->entry_type);
+  if (table_entry->entry_type == PI_ACTION_ENTRY_TYPE_DATA) {
+    dst += emit_p4_id(dst, action_data->action_id);
+    dst += emit_uint32(dst, action_data->data_size);
+    memcpy(dst, action_data->data, action_data->data_size);
+    dst += action_data->data_size;
+  } else if (table_entry->entry_type == PI_ACTION_ENTRY_TYPE_INDIRECT) {
+    dst += emit_indirect_handle(dst, table_entry->entry.indirect_handle);
+  }
+  dst += emit_uint32(dst, valid_properties);
+  if (valid_properties & (1 << PI_ENTRY_PROPERTY_TYPE_TTL))
+    dst += emit_uint32(dst, properties->ttl);
+  return entry;
+}
+
+static bool entry_has_key(const dummy_entry_t *entry,
+                          const pi_match_key_t *match_key) {
+  uint32_t priority;
+  retrieve_uint32(entry->data + sizeof(s_pi_entry_handle_t), &priority);
+  return priority == match_key->priority &&
+         entry->size >= ENTRY_KEY_OFFSET + match_key->data_size &&
+         !memcmp(entry->data + ENTRY_KEY_OFFSET, match_key->data,
+                 match_key->data_size);
+}
+
+static Word_t *find_entry(dummy_table_t *table,
+                          const pi_match_key_t *match_key) {
+  Word_t *PValue;
+  Word_t handle = 0;
+  JLF(PValue, table->entries, handle);
+  while (PValue) {
+    if (entry_has_key((dummy_entry_t *)*PValue, match_key)) return PValue;
+    JLN(PValue, table->entries, handle);
+  }
+  return NULL;
+}
+
+static void replace_entry(Word_t *PValue, const pi_match_key_t *match_key,
+                          const pi_table_entry_t *table_entry) {
+  dummy_entry_t *entry = (dummy_entry_t *)*PValue;
+  pi_entry_handle_t handle;
+  retrieve_entry_handle(entry->data, &handle);
+  *PValue = (Word_t)encode_entry(handle, match_key, table_entry);
+  free(entry);
+}
+
+static void remove_entry(dummy_table_t *table, pi_entry_handle_t handle) {
+  Word_t *PValue;
+  JLG(PValue, table->entries, handle);
+  free((dummy_entry_t *)*PValue);
+  int Rc_int;
+  JLD(Rc_int, table->entries, handle);
+  table->num_entries--;
+}
+
+void dummy_tables_reset() {
+  pthread_mutex_lock(&tables_lock);
+  Word_t *PValue;
+  Word_t table_id = 0;
+  JLF(PValue, tables, table_id);
+  while (PValue) {
+    dummy_table_t *table = (dummy_table_t *)*PValue;
+    Word_t *PEntry;
+    Word_t handle = 0;
+    JLF(PEntry, table->entries, handle);
+    while (PEntry) {
+      free((dummy_entry_t *)*PEntry);
+      JLN(PEntry, table->entries, handle);
+    }
+    Word_t bytes_freed;
+    JLFA(bytes_freed, table->entries);
+    free(table);
+    JLN(PValue, tables, table_id);
+  }
+  Word_t bytes_freed;
+  JLFA(bytes_freed, tables);
+  pthread_mutex_unlock(&tables_lock);
+}
 
 pi_status_t _pi_table_entry_add(pi_session_handle_t session_handle,
                                 pi_dev_tgt_t dev_tgt, pi_p4_id_t table_id,
@@ -32,13 +178,24 @@ pi_status_t _pi_table_entry_add(pi_session_handle_t session_handle,
                                 pi_entry_handle_t *entry_handle) {
   (void)session_handle;
   (void)dev_tgt;
-  (void)table_id;
-  (void)match_key;
-  (void)table_entry;
-  (void)overwrite;
-  (void)entry_handle;
   func_counter_increment(__func__);
-  return PI_STATUS_SUCCESS;
+  pi_status_t status = PI_STATUS_SUCCESS;
+  pthread_mutex_lock(&tables_lock);
+  dummy_table_t *table = get_table(table_id, true);
+  Word_t *PValue = find_entry(table, match_key);
+  if (PValue && !overwrite) {
+    status = PI_STATUS_TARGET_ERROR;
+  } else if (PValue) {
+    replace_entry(PValue, match_key, table_entry);
+    retrieve_entry_handle(((dummy_entry_t *)*PValue)->data, entry_handle);
+  } else {
+    *entry_handle = next_handle++;
+    JLI(PValue, table->entries, *entry_handle);
+    *PValue = (Word_t)encode_entry(*entry_handle, match_key, table_entry);
+    table->num_entries++;
+  }
+  pthread_mutex_unlock(&tables_lock);
+  return status;
 }
 
 pi_status_t _pi_table_default_action_set(pi_session_handle_t session_handle,
@@ -78,10 +235,18 @@ pi_status_t _pi_table_entry_delete(pi_session_handle_t session_handle,
                                    pi_entry_handle_t entry_handle) {
   (void)session_handle;
   (void)dev_id;
-  (void)table_id;
-  (void)entry_handle;
   func_counter_increment(__func__);
-  return PI_STATUS_SUCCESS;
+  pi_status_t status = PI_STATUS_TARGET_ERROR;
+  pthread_mutex_lock(&tables_lock);
+  dummy_table_t *table = get_table(table_id, false);
+  Word_t *PValue = NULL;
+  if (table) JLG(PValue, table->entries, entry_handle);
+  if (PValue) {
+    remove_entry(table, entry_handle);
+    status = PI_STATUS_SUCCESS;
+  }
+  pthread_mutex_unlock(&tables_lock);
+  return status;
 }
 
 pi_status_t _pi_table_entry_delete_wkey(pi_session_handle_t session_handle,
@@ -89,10 +254,19 @@ pi_status_t _pi_table_entry_delete_wkey(pi_session_handle_t session_handle,
                                         const pi_match_key_t *match_key) {
   (void)session_handle;
   (void)dev_id;
-  (void)table_id;
-  (void)match_key;
   func_counter_increment(__func__);
-  return PI_STATUS_SUCCESS;
+  pi_status_t status = PI_STATUS_TARGET_ERROR;
+  pthread_mutex_lock(&tables_lock);
+  dummy_table_t *table = get_table(table_id, false);
+  Word_t *PValue = table ? find_entry(table, match_key) : NULL;
+  if (PValue) {
+    pi_entry_handle_t handle;
+    retrieve_entry_handle(((dummy_entry_t *)*PValue)->data, &handle);
+    remove_entry(table, handle);
+    status = PI_STATUS_SUCCESS;
+  }
+  pthread_mutex_unlock(&tables_lock);
+  return status;
 }
 
 pi_status_t _pi_table_entry_modify(pi_session_handle_t session_handle,
@@ -100,12 +274,26 @@ pi_status_t _pi_table_entry_modify(pi_session_handle_t session_handle,
                                    pi_entry_handle_t entry_handle,
                                    const pi_table_entry_t *table_entry) {
   (void)session_handle;
-  (void)dev_id;
-  (void)table_id;
-  (void)entry_handle;
-  (void)table_entry;
   func_counter_increment(__func__);
-  return PI_STATUS_SUCCESS;
+  pi_status_t status = PI_STATUS_TARGET_ERROR;
+  pthread_mutex_lock(&tables_lock);
+  dummy_table_t *table = get_table(table_id, false);
+  Word_t *PValue = NULL;
+  if (table) JLG(PValue, table->entries, entry_handle);
+  if (PValue) {
+    // the match key is not changed by a modify
+    dummy_entry_t *entry = (dummy_entry_t *)*PValue;
+    pi_match_key_t match_key;
+    retrieve_uint32(entry->data + sizeof(s_pi_entry_handle_t),
+                    &match_key.priority);
+    match_key.data = entry->data + ENTRY_KEY_OFFSET;
+    match_key.data_size =
+        pi_p4info_table_match_key_size(pi_get_device_p4info(dev_id), table_id);
+    replace_entry(PValue, &match_key, table_entry);
+    status = PI_STATUS_SUCCESS;
+  }
+  pthread_mutex_unlock(&tables_lock);
+  return status;
 }
 
 pi_status_t _pi_table_entry_modify_wkey(pi_session_handle_t session_handle,
@@ -114,28 +302,57 @@ pi_status_t _pi_table_entry_modify_wkey(pi_session_handle_t session_handle,
                                         const pi_table_entry_t *table_entry) {
   (void)session_handle;
   (void)dev_id;
-  (void)table_id;
-  (void)match_key;
-  (void)table_entry;
   func_counter_increment(__func__);
-  return PI_STATUS_SUCCESS;
+  pi_status_t status = PI_STATUS_TARGET_ERROR;
+  pthread_mutex_lock(&tables_lock);
+  dummy_table_t *table = get_table(table_id, false);
+  Word_t *PValue = table ? find_entry(table, match_key) : NULL;
+  if (PValue) {
+    replace_entry(PValue, match_key, table_entry);
+    status = PI_STATUS_SUCCESS;
+  }
+  pthread_mutex_unlock(&tables_lock);
+  return status;
 }
 
 pi_status_t _pi_table_entries_fetch(pi_session_handle_t session_handle,
                                     pi_dev_id_t dev_id, pi_p4_id_t table_id,
                                     pi_table_fetch_res_t *res) {
   (void)session_handle;
-  (void)dev_id;
-  (void)table_id;
-  (void)res;
   func_counter_increment(__func__);
+  const pi_p4info_t *p4info = pi_get_device_p4info(dev_id);
+  if (!p4info) return PI_STATUS_DEV_NOT_ASSIGNED;
+  res->mkey_nbytes = pi_p4info_table_match_key_size(p4info, table_id);
+  pthread_mutex_lock(&tables_lock);
+  dummy_table_t *table = get_table(table_id, false);
+  res->num_entries = table ? table->num_entries : 0;
+  size_t size = 0;
+  Word_t *PValue = NULL;
+  Word_t handle = 0;
+  if (table) JLF(PValue, table->entries, handle);
+  while (table && PValue) {
+    size += ((dummy_entry_t *)*PValue)->size;
+    JLN(PValue, table->entries, handle);
+  }
+  res->entries_size = size;
+  res->entries = malloc(size > 0 ? size : 1);
+  char *dst = res->entries;
+  handle = 0;
+  if (table) JLF(PValue, table->entries, handle);
+  while (table && PValue) {
+    dummy_entry_t *entry = (dummy_entry_t *)*PValue;
+    memcpy(dst, entry->data, entry->size);
+    dst += entry->size;
+    JLN(PValue, table->entries, handle);
+  }
+  pthread_mutex_unlock(&tables_lock);
   return PI_STATUS_SUCCESS;
 }
 
 pi_status_t _pi_table_entries_fetch_done(pi_session_handle_t session_handle,
                                          pi_table_fetch_res_t *res) {
   (void)session_handle;
-  (void)res;
   func_counter_increment(__func__);
+  free(res->entries);
   return PI_STATUS_SUCCESS;
 }
@@ -39,9 +39,66 @@ static int pub_socket = 0;
 
 static pthread_t receive_thread;
 
+// Learn messages point directly inside the received nanomsg message, which is
+// only released by _pi_learn_msg_done. The headers are recycled to avoid an
+// allocation per message.
+typedef struct rpc_learn_msg_s {
+  pi_learn_msg_t msg;  // must be first
+  char *nn_msg;
+  struct rpc_learn_msg_s *next;
+} rpc_learn_msg_t;
+
+// maximum number of free headers kept around
+#define LEARN_MSG_POOL_SIZE 64
+
+static struct {
+  pthread_mutex_t lock;
+  rpc_learn_msg_t *free_list;
+  size_t num_free;
+} learn_msg_pool = {PTHREAD_MUTEX_INITIALIZER, NULL, 0};
+
+static rpc_learn_msg_t *learn_msg_alloc() {
+  pthread_mutex_lock(&learn_msg_pool.lock);
+  rpc_learn_msg_t *learn_msg = learn_msg_pool.free_list;
+  if (learn_msg) {
+    learn_msg_pool.free_list = learn_msg->next;
+    learn_msg_pool.num_free--;
+  }
+  pthread_mutex_unlock(&learn_msg_pool.lock);
+  if (!learn_msg) learn_msg = malloc(sizeof(*learn_msg));
+  return learn_msg;
+}
+
+void learn_msg_release(pi_learn_msg_t *msg) {
+  rpc_learn_msg_t *learn_msg = (rpc_learn_msg_t *)msg;
+  nn_freemsg(learn_msg->nn_msg);
+  pthread_mutex_lock(&learn_msg_pool.lock);
+  if (learn_msg_pool.num_free < LEARN_MSG_POOL_SIZE) {
+    learn_msg->next = learn_msg_pool.free_list;
+    learn_msg_pool.free_list = learn_msg;
+    learn_msg_pool.num_free++;
+    learn_msg = NULL;
+  }
+  pthread_mutex_unlock(&learn_msg_pool.lock);
+  free(learn_msg);
+}
+
+size_t learn_msg_pool_num_free() {
+  pthread_mutex_lock(&learn_msg_pool.lock);
+  size_t num_free = learn_msg_pool.num_free;
+  pthread_mutex_unlock(&learn_msg_pool.lock);
+  return num_free;
+}
+
+// takes ownership of msg
 static void handle_LEA(char *msg) {
-  pi_learn_msg_t *learn_msg;
-  learn_msg = malloc(sizeof(*learn_msg));
+  rpc_learn_msg_t *rpc_learn_msg = learn_msg_alloc();
+  if (!rpc_learn_msg) {  // out of memory, drop the learn message
+    nn_freemsg(msg);
+    return;
+  }
+  rpc_learn_msg->nn_msg = msg;
+  pi_learn_msg_t *learn_msg = &rpc_learn_msg->msg;
   size_t s = 0;
   s += sizeof(s_pi_notifications_topic_t);
   s += retrieve_dev_tgt(msg + s, &learn_msg->dev_tgt);
@@ -53,14 +110,11 @@ static void handle_LEA(char *msg) {
   s += retrieve_uint32(msg + s, &tmp32);
   learn_msg->entry_size = tmp32;
 
-  // in theory I can just point to the NN msg and postpone free'ing the msg
-  // (call to nn_freemsg). I will implement it if needed for performance.
-  /* learn_msg->entries = msg + s; */
-  size_t entries_size = learn_msg->num_entries * learn_msg->entry_size;
-  learn_msg->entries = malloc(entries_size);
-  memcpy(learn_msg->entries, msg + s, entries_size);
+  learn_msg->entries = msg + s;
 
-  pi_learn_new_msg(learn_msg);
+  // if no callback was called, nobody will call _pi_learn_msg_done
+  if (pi_learn_new_msg(learn_msg) != PI_STATUS_SUCCESS)
+    learn_msg_release(learn_msg);
 }
 
 static void handle_PKT(char *msg) {
@@ -75,21 +129,68 @@ static void handle_PKT(char *msg) {
   nn_freemsg(msg);
 }
 
+// returns false if num or the size of one of the packets would run past the
+// end of the message
+static bool check_PKB(const char *msg, size_t bytes) {
+  size_t s = 0;
+  s += sizeof(s_pi_notifications_topic_t);
+  s += sizeof(s_pi_dev_id_t);
+  if (bytes < s + sizeof(uint32_t)) return false;
+  uint32_t num;
+  s += retrieve_uint32(msg + s, &num);
+  for (uint32_t i = 0; i < num; i++) {
+    uint32_t pkt_size;
+    if (bytes - s < sizeof(uint32_t)) return false;
+    s += retrieve_uint32(msg + s, &pkt_size);
+    if (bytes - s < pkt_size) return false;
+    s += pkt_size;
+  }
+  return true;
+}
+
+static void handle_PKB(char *msg, size_t bytes) {
+  // the whole batch is checked before any packet is delivered
+  if (!check_PKB(msg, bytes)) {
+    printf("Dropping malformed packet-in batch\n");
+    nn_freemsg(msg);
+    return;
+  }
+  size_t s = 0;
+  s += sizeof(s_pi_notifications_topic_t);
+  pi_dev_id_t dev_id;
+  s += retrieve_dev_id(msg + s, &dev_id);
+  uint32_t num;
+  s += retrieve_uint32(msg + s, &num);
+  for (uint32_t i = 0; i < num; i++) {
+    uint32_t pkt_size;
+    s += retrieve_uint32(msg + s, &pkt_size);
+    pi_packetin_receive(dev_id, msg + s, pkt_size);
+    s += pkt_size;
+  }
+  nn_freemsg(msg);
+}
+
+static bool is_topic(const char *msg, const char *topic) {
+  return !memcmp(topic, msg, sizeof(s_pi_notifications_topic_t));
+}
+
 static void *receive_loop(void *arg) {
   (void)arg;
   while (1) {
     char *msg = NULL;
-    if (nn_recv(pub_socket, &msg, NN_MSG, 0) <= 0) {
+    int bytes = nn_recv(pub_socket, &msg, NN_MSG, 0);
+    if (bytes <= 0) {
       continue;
     }
 
-    if (!memcmp("PILEA|", msg, sizeof "PILEA|")) {
+    if (is_topic(msg, "PILEA|")) {
       /* printf("Received learning notification.\n"); */
       handle_LEA(msg);
-      nn_freemsg(msg);
-    } else if (!memcmp("PIPKT|", msg, sizeof "PIPKT|")) {
+    } else if (is_topic(msg, "PIPKT|")) {
       /* printf("Received packet-in notification.\n"); */
       handle_PKT(msg);
+    } else if (is_topic(msg, "PIPKB|")) {
+      handle_PKB(msg, bytes);
     } else {
       printf("Unknow notification type\n");
       nn_freemsg(msg);
@@ -31,7 +31,7 @@ static pi_status_t wait_for_handle(uint32_t req_id, pi_indirect_handle_t *h) {
     s_pi_indirect_handle_t h;
   } rep_t;
   rep_t rep;
-  int rc = nn_recv(state.s, &rep, sizeof(rep), 0);
+  int rc = rpc_recv(req_id, &rep, sizeof(rep));
   if (rc != sizeof(rep)) return PI_STATUS_RPC_TRANSPORT_ERROR;
   pi_status_t status = retrieve_rep_hdr((char *)&rep, req_id);
   // condition on success?
@@ -46,6 +46,10 @@ pi_status_t _pi_act_prof_mbr_create(pi_session_handle_t session_handle,
                                     pi_indirect_handle_t *mbr_handle) {
   if (!state.init) return PI_STATUS_RPC_NOT_INIT;
 
+  // the caller needs the handle right away, so this request is never batched
+  pi_status_t status = rpc_batch_flush(session_handle);
+  if (status != PI_STATUS_SUCCESS) return status;
+
   size_t s = 0;
   s += sizeof(req_hdr_t);
   s += sizeof(s_pi_session_handle_t);
@@ -55,7 +59,7 @@ pi_status_t _pi_act_prof_mbr_create(pi_session_handle_t session_handle,
 
   char *req = nn_allocmsg(s, 0);
   char *req_ = req;
-  pi_rpc_id_t req_id = state.req_id++;
+  pi_rpc_id_t req_id = next_req_id();
   req_ += emit_req_hdr(req_, req_id, PI_RPC_ACT_PROF_MBR_CREATE);
   req_ += emit_session_handle(req_, session_handle);
   req_ += emit_dev_tgt(req_, dev_tgt);
@@ -65,7 +69,7 @@ pi_status_t _pi_act_prof_mbr_create(pi_session_handle_t session_handle,
   // make sure I have copied exactly the right amount
   assert((size_t)(req_ - req) == s);
 
-  int rc = nn_send(state.s, &req, NN_MSG, 0);
+  int rc = rpc_send_msg(req, s);
   if ((size_t)rc != s) return PI_STATUS_RPC_TRANSPORT_ERROR;
 
   return wait_for_handle(req_id, mbr_handle);
@@ -85,7 +89,7 @@ pi_status_t _pi_act_prof_mbr_delete(pi_session_handle_t session_handle,
   } req_t;
   req_t req;
   char *req_ = (char *)&req;
-  pi_rpc_id_t req_id = state.req_id++;
+  pi_rpc_id_t req_id = next_req_id();
 
   req_ += emit_req_hdr(req_, req_id, PI_RPC_ACT_PROF_MBR_DELETE);
   req_ += emit_session_handle(req_, session_handle);
@@ -93,7 +97,10 @@ pi_status_t _pi_act_prof_mbr_delete(pi_session_handle_t session_handle,
   req_ += emit_p4_id(req_, act_prof_id);
   req_ += emit_indirect_handle(req_, mbr_handle);
 
-  int rc = nn_send(state.s, &req, sizeof(req), 0);
+  if (rpc_batch_add(session_handle, (char *)&req, sizeof(req)))
+    return PI_STATUS_SUCCESS;
+
+  int rc = rpc_send(&req, sizeof(req));
   if (rc != sizeof(req)) return PI_STATUS_RPC_TRANSPORT_ERROR;
 
   return wait_for_status(req_id);
@@ -115,7 +122,7 @@ pi_status_t _pi_act_prof_mbr_modify(pi_session_handle_t session_handle,
 
   char *req = nn_allocmsg(s, 0);
   char *req_ = req;
-  pi_rpc_id_t req_id = state.req_id++;
+  pi_rpc_id_t req_id = next_req_id();
   req_ += emit_req_hdr(req_, req_id, PI_RPC_ACT_PROF_MBR_MODIFY);
   req_ += emit_session_handle(req_, session_handle);
   req_ += emit_dev_id(req_, dev_id);
@@ -126,7 +133,12 @@ pi_status_t _pi_act_prof_mbr_modify(pi_session_handle_t session_handle,
   // make sure I have copied exactly the right amount
   assert((size_t)(req_ - req) == s);
 
-  int rc = nn_send(state.s, &req, NN_MSG, 0);
+  if (rpc_batch_add(session_handle, req, s)) {
+    nn_freemsg(req);
+    return PI_STATUS_SUCCESS;
+  }
+
+  int rc = rpc_send_msg(req, s);
   if ((size_t)rc != s) return PI_STATUS_RPC_TRANSPORT_ERROR;
 
   return wait_for_status(req_id);
@@ -138,6 +150,10 @@ pi_status_t _pi_act_prof_grp_create(pi_session_handle_t session_handle,
                                     pi_indirect_handle_t *grp_handle) {
   if (!state.init) return PI_STATUS_RPC_NOT_INIT;
 
+  // the caller needs the handle right away, so this request is never batched
+  pi_status_t status = rpc_batch_flush(session_handle);
+  if (status != PI_STATUS_SUCCESS) return status;
+
   typedef struct __attribute__((packed)) {
     req_hdr_t hdr;
     s_pi_session_handle_t sess;
@@ -147,7 +163,7 @@ pi_status_t _pi_act_prof_grp_create(pi_session_handle_t session_handle,
   } req_t;
   req_t req;
   char *req_ = (char *)&req;
-  pi_rpc_id_t req_id = state.req_id++;
+  pi_rpc_id_t req_id = next_req_id();
 
   req_ += emit_req_hdr(req_, req_id, PI_RPC_ACT_PROF_GRP_CREATE);
   req_ += emit_session_handle(req_, session_handle);
@@ -155,7 +171,7 @@ pi_status_t _pi_act_prof_grp_create(pi_session_handle_t session_handle,
   req_ += emit_p4_id(req_, act_prof_id);
   req_ += emit_uint32(req_, max_size);
 
-  int rc = nn_send(state.s, &req, sizeof(req), 0);
+  int rc = rpc_send(&req, sizeof(req));
   if (rc != sizeof(req)) return PI_STATUS_RPC_TRANSPORT_ERROR;
 
   return wait_for_handle(req_id, grp_handle);
@@ -175,7 +191,7 @@ pi_status_t _pi_act_prof_grp_delete(pi_session_handle_t session_handle,
   } req_t;
   req_t req;
   char *req_ = (char *)&req;
-  pi_rpc_id_t req_id = state.req_id++;
+  pi_rpc_id_t req_id = next_req_id();
 
   req_ += emit_req_hdr(req_, req_id, PI_RPC_ACT_PROF_GRP_DELETE);
   req_ += emit_session_handle(req_, session_handle);
@@ -183,7 +199,10 @@ pi_status_t _pi_act_prof_grp_delete(pi_session_handle_t session_handle,
   req_ += emit_p4_id(req_, act_prof_id);
   req_ += emit_indirect_handle(req_, grp_handle);
 
-  int rc = nn_send(state.s, &req, sizeof(req), 0);
+  if (rpc_batch_add(session_handle, (char *)&req, sizeof(req)))
+    return PI_STATUS_SUCCESS;
+
+  int rc = rpc_send(&req, sizeof(req));
   if (rc != sizeof(req)) return PI_STATUS_RPC_TRANSPORT_ERROR;
 
   return wait_for_status(req_id);
@@ -207,7 +226,7 @@ static pi_status_t grp_add_remove_mbr(pi_session_handle_t session_handle,
   } req_t;
   req_t req;
   char *req_ = (char *)&req;
-  pi_rpc_id_t req_id = state.req_id++;
+  pi_rpc_id_t req_id = next_req_id();
 
   req_ += emit_req_hdr(req_, req_id, add_or_remove);
   req_ += emit_session_handle(req_, session_handle);
@@ -216,7 +235,10 @@ static pi_status_t grp_add_remove_mbr(pi_session_handle_t session_handle,
   req_ += emit_indirect_handle(req_, grp_handle);
   req_ += emit_indirect_handle(req_, mbr_handle);
 
-  int rc = nn_send(state.s, &req, sizeof(req), 0);
+  if (rpc_batch_add(session_handle, (char *)&req, sizeof(req)))
+    return PI_STATUS_SUCCESS;
+
+  int rc = rpc_send(&req, sizeof(req));
   if (rc != sizeof(req)) return PI_STATUS_RPC_TRANSPORT_ERROR;
 
   return wait_for_status(req_id);
@@ -245,6 +267,9 @@ pi_status_t _pi_act_prof_entries_fetch(pi_session_handle_t session_handle,
                                        pi_act_prof_fetch_res_t *res) {
   if (!state.init) return PI_STATUS_RPC_NOT_INIT;
 
+  pi_status_t status = rpc_batch_flush(session_handle);
+  if (status != PI_STATUS_SUCCESS) return status;
+
   typedef struct __attribute__((packed)) {
     req_hdr_t hdr;
     s_pi_session_handle_t sess;
@@ -253,23 +278,23 @@ pi_status_t _pi_act_prof_entries_fetch(pi_session_handle_t session_handle,
   } req_t;
   req_t req;
   char *req_ = (char *)&req;
-  pi_rpc_id_t req_id = state.req_id++;
+  pi_rpc_id_t req_id = next_req_id();
   req_ += emit_req_hdr(req_, req_id, PI_RPC_ACT_PROF_ENTRIES_FETCH);
   req_ += emit_session_handle(req_, session_handle);
   req_ += emit_dev_id(req_, dev_id);
   req_ += emit_p4_id(req_, act_prof_id);
 
-  int rc = nn_send(state.s, &req, sizeof(req), 0);
+  int rc = rpc_send(&req, sizeof(req));
   if (rc != sizeof(req)) return PI_STATUS_RPC_TRANSPORT_ERROR;
 
   char *rep = NULL;
-  int bytes = nn_recv(state.s, &rep, NN_MSG, 0);
+  int bytes = rpc_recv(req_id, &rep, NN_MSG);
   if (bytes <= 0) return PI_STATUS_RPC_TRANSPORT_ERROR;
 
   char *rep_ = rep;
-  pi_status_t status = retrieve_rep_hdr(rep_, req_id);
+  status = retrieve_rep_hdr(rep_, req_id);
   if (status != PI_STATUS_SUCCESS) {
-    nn_freemsg(rep);
+    rpc_free_rep(rep);
     return status;
   }
   rep_ += sizeof(rep_hdr_t);
@@ -299,7 +324,7 @@ pi_status_t _pi_act_prof_entries_fetch(pi_session_handle_t session_handle,
   res->mbr_handles = malloc(mbr_handles_size);
   memcpy(res->mbr_handles, rep_, mbr_handles_size);
 
-  nn_freemsg(rep);
+  rpc_free_rep(rep);
   return status;
 }
 
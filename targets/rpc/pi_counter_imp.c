@@ -29,7 +29,7 @@ static pi_status_t wait_for_counter_data(uint32_t req_id,
     s_pi_counter_data_t counter_data;
   } rep_t;
   rep_t rep;
-  int rc = nn_recv(state.s, &rep, sizeof(rep), 0);
+  int rc = rpc_recv(req_id, &rep, sizeof(rep));
   if (rc != sizeof(rep)) return PI_STATUS_RPC_TRANSPORT_ERROR;
   pi_status_t status = retrieve_rep_hdr((char *)&rep, req_id);
   // really needed?
@@ -48,6 +48,9 @@ static pi_status_t counter_read(pi_rpc_type_t type,
 
   if (!state.init) return PI_STATUS_RPC_NOT_INIT;
 
+  pi_status_t status = rpc_batch_flush(session_handle);
+  if (status != PI_STATUS_SUCCESS) return status;
+
   typedef struct __attribute__((packed)) {
     req_hdr_t hdr;
     s_pi_session_handle_t sess;
@@ -58,7 +61,7 @@ static pi_status_t counter_read(pi_rpc_type_t type,
   } req_t;
   req_t req;
   char *req_ = (char *)&req;
-  pi_rpc_id_t req_id = state.req_id++;
+  pi_rpc_id_t req_id = next_req_id();
 
   req_ += emit_req_hdr(req_, req_id, type);
   req_ += emit_session_handle(req_, session_handle);
@@ -67,7 +70,7 @@ static pi_status_t counter_read(pi_rpc_type_t type,
   req_ += emit_uint64(req_, h);
   req_ += emit_uint32(req_, flags);
 
-  int rc = nn_send(state.s, &req, sizeof(req), 0);
+  int rc = rpc_send(&req, sizeof(req));
   if (rc != sizeof(req)) return PI_STATUS_RPC_TRANSPORT_ERROR;
 
   return wait_for_counter_data(req_id, counter_data);
@@ -93,7 +96,7 @@ static pi_status_t counter_write(pi_rpc_type_t type,
   } req_t;
   req_t req;
   char *req_ = (char *)&req;
-  pi_rpc_id_t req_id = state.req_id++;
+  pi_rpc_id_t req_id = next_req_id();
 
   req_ += emit_req_hdr(req_, req_id, type);
   req_ += emit_session_handle(req_, session_handle);
@@ -102,7 +105,10 @@ static pi_status_t counter_write(pi_rpc_type_t type,
   req_ += emit_uint64(req_, h);
   req_ += emit_counter_data(req_, counter_data);
 
-  int rc = nn_send(state.s, &req, sizeof(req), 0);
+  if (rpc_batch_add(session_handle, (char *)&req, sizeof(req)))
+    return PI_STATUS_SUCCESS;
+
+  int rc = rpc_send(&req, sizeof(req));
   if (rc != sizeof(req)) return PI_STATUS_RPC_TRANSPORT_ERROR;
 
   return wait_for_status(req_id);
@@ -116,6 +122,62 @@ pi_status_t _pi_counter_read(pi_session_handle_t session_handle,
                       index, flags, counter_data);
 }
 
+pi_status_t _pi_counter_read_range(pi_session_handle_t session_handle,
+                                   pi_dev_tgt_t dev_tgt, pi_p4_id_t counter_id,
+                                   size_t start, size_t count, int flags,
+                                   pi_counter_data_t *counter_data) {
+  if (!state.init) return PI_STATUS_RPC_NOT_INIT;
+
+  pi_status_t status = rpc_batch_flush(session_handle);
+  if (status != PI_STATUS_SUCCESS) return status;
+
+  typedef struct __attribute__((packed)) {
+    req_hdr_t hdr;
+    s_pi_session_handle_t sess;
+    s_pi_dev_tgt_t dev_tgt;
+    s_pi_p4_id_t counter_id;
+    uint64_t start;
+    uint64_t count;
+    uint32_t flags;
+  } req_t;
+  req_t req;
+  char *req_ = (char *)&req;
+  pi_rpc_id_t req_id = next_req_id();
+
+  req_ += emit_req_hdr(req_, req_id, PI_RPC_COUNTER_READ_RANGE);
+  req_ += emit_session_handle(req_, session_handle);
+  req_ += emit_dev_tgt(req_, dev_tgt);
+  req_ += emit_p4_id(req_, counter_id);
+  req_ += emit_uint64(req_, start);
+  req_ += emit_uint64(req_, count);
+  req_ += emit_uint32(req_, flags);
+
+  int rc = rpc_send(&req, sizeof(req));
+  if (rc != sizeof(req)) return PI_STATUS_RPC_TRANSPORT_ERROR;
+
+  char *rep = NULL;
+  int bytes = rpc_recv(req_id, &rep, NN_MSG);
+  if (bytes <= 0) return PI_STATUS_RPC_TRANSPORT_ERROR;
+
+  char *rep_ = rep;
+  status = retrieve_rep_hdr(rep_, req_id);
+  if (status != PI_STATUS_SUCCESS) {
+    rpc_free_rep(rep);
+    return status;
+  }
+  rep_ += sizeof(rep_hdr_t);
+
+  uint64_t num;
+  rep_ += retrieve_uint64(rep_, &num);
+  assert(num == count);
+  for (size_t i = 0; i < count; i++)
+    rep_ += retrieve_counter_data(rep_, &counter_data[i]);
+  assert((size_t)(rep_ - rep) == (size_t)bytes);
+
+  rpc_free_rep(rep);
+  return status;
+}
+
 pi_status_t _pi_counter_write(pi_session_handle_t session_handle,
                               pi_dev_tgt_t dev_tgt, pi_p4_id_t counter_id,
                               size_t index,
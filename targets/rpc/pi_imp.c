@@ -34,27 +34,40 @@
 #include <stdlib.h>
 #include <string.h>
 
-static void process_state_sync(const char *rep) {
+static pi_status_t process_state_sync(const char *rep, size_t size) {
+  const char *end = rep + size;
   uint32_t num;
+  if (size < sizeof(uint32_t)) return PI_STATUS_RPC_TRANSPORT_ERROR;
   rep += retrieve_uint32(rep, &num);
   size_t num_devices;
   pi_device_info_t *devices = pi_get_devices(&num_devices);
   for (size_t i = 0; i < num; i++) {
     pi_dev_id_t dev_id;
     uint32_t version;
-    /* uint32_t p4info_size; */
+    uint32_t p4info_size;
+    if ((size_t)(end - rep) < sizeof(s_pi_dev_id_t) + 2 * sizeof(uint32_t))
+      return PI_STATUS_RPC_TRANSPORT_ERROR;
     rep += retrieve_dev_id(rep, &dev_id);
     rep += retrieve_uint32(rep, &version);
-    /* rep += retrieve_uint32(rep, &p4info_size); */
-
-    assert(dev_id <= num_devices);
-
-    assert(devices[dev_id].version < version);
-    devices[dev_id].version = version;
+    rep += retrieve_uint32(rep, &p4info_size);
+    if ((size_t)(end - rep) < p4info_size ||
+        p4info_size < PI_CONFIG_BINARY_HEADER_SIZE)
+      return PI_STATUS_RPC_TRANSPORT_ERROR;
+    if (dev_id >= num_devices) return PI_STATUS_DEV_OUT_OF_RANGE;
+
+    // never replace a config with an older (or the same) one
+    if (devices[dev_id].version >= version)
+      return PI_STATUS_DEV_ALREADY_ASSIGNED;
+    if (pi_config_binary_size(rep) != p4info_size)
+      return PI_STATUS_CONFIG_READER_ERROR;
     pi_p4info_t *p4info;
-    pi_add_config(rep, PI_CONFIG_TYPE_NATIVE_JSON, &p4info);
+    pi_status_t status = pi_add_config(rep, PI_CONFIG_TYPE_BINARY, &p4info);
+    if (status != PI_STATUS_SUCCESS) return status;
+    devices[dev_id].version = version;
     devices[dev_id].p4info = p4info;
+    rep += p4info_size;
   }
+  return PI_STATUS_SUCCESS;
 }
 
 // Saving these functions for later, if needed
@@ -68,14 +81,14 @@ static void process_state_sync(const char *rep) {
 /*   } req_t; */
 /*   req_t req; */
 /*   char *req_ = (char *) &req; */
-/*   pi_rpc_id_t req_id = state.req_id++; */
+/*   pi_rpc_id_t req_id = next_req_id(); */
 /*   req_ += emit_req_hdr(req_, req_id, PI_RPC_INT_GET_STATE); */
 /*   req_ += emit_uint32(req_, 1); */
 /*   req_ += emit_dev_id(req_, dev_id); */
 /*   req_ += emit_uint32(req_, pi_get_device_info(dev_id)->version); */
 
 /*   char *rep = NULL; */
-/*   int bytes = nn_recv(state.s, &rep, NN_MSG, 0); */
+/*   int bytes = rpc_recv(req_id, &rep, NN_MSG); */
 /*   if (bytes <= 0) return PI_STATUS_RPC_TRANSPORT_ERROR; */
 
 /*   char *rep_ = rep; */
@@ -99,7 +112,7 @@ static void process_state_sync(const char *rep) {
 /*   s += num_devices * (sizeof(s_pi_dev_id_t) + sizeof(uint32_t)); */
 /*   char *req = nn_allocmsg(s, 0); */
 /*   char *req_ = req; */
-/*   pi_rpc_id_t req_id = state.req_id++; */
+/*   pi_rpc_id_t req_id = next_req_id(); */
 /*   req_ += emit_req_hdr(req_, req_id, PI_RPC_INT_GET_STATE); */
 /*   req_ += emit_uint32(req_, num_devices); */
 /*   for (pi_dev_id_t dev_id = 0; dev_id < num_devices; dev_id++) { */
@@ -109,11 +122,11 @@ static void process_state_sync(const char *rep) {
 
 /*   assert((size_t) (req_ - req) == s); */
 
-/*   int rc = nn_send(state.s, (char *) &req, sizeof(req), 0); */
+/*   int rc = rpc_send(&req, sizeof(req)); */
 /*   if (rc != sizeof(req)) return PI_STATUS_RPC_TRANSPORT_ERROR; */
 
 /*   char *rep = NULL; */
-/*   int bytes = nn_recv(state.s, &rep, NN_MSG, 0); */
+/*   int bytes = rpc_recv(req_id, &rep, NN_MSG); */
 /*   if (bytes <= 0) return PI_STATUS_RPC_TRANSPORT_ERROR; */
 
 /*   char *rep_ = rep; */
@@ -143,45 +156,43 @@ static void free_addrs() {
   if (notifications_addr) free(notifications_addr);
 }
 
-extern pi_status_t notifications_start(const char *);
-
 pi_status_t _pi_init(void *extra) {
   assert(!state.init);
   init_addrs((pi_remote_addr_t *)extra);
-  state.s = nn_socket(AF_SP, NN_REQ);
-  if (state.s < 0) return PI_STATUS_RPC_CONNECT_ERROR;
-  if (nn_connect(state.s, rpc_addr) < 0) return PI_STATUS_RPC_CONNECT_ERROR;
+  pi_status_t status = rpc_start(rpc_addr);
+  if (status != PI_STATUS_SUCCESS) return status;
   state.init = 1;
 
-  pi_status_t status;
-
   if (notifications_addr) {
     status = notifications_start(notifications_addr);
     if (status != PI_STATUS_SUCCESS) return status;
   }
 
   req_hdr_t req;
-  pi_rpc_id_t req_id = state.req_id++;
+  pi_rpc_id_t req_id = next_req_id();
   emit_req_hdr((char *)&req, req_id, PI_RPC_INIT);
 
-  int rc = nn_send(state.s, (char *)&req, sizeof(req), 0);
+  int rc = rpc_send(&req, sizeof(req));
   if (rc != sizeof(req)) return PI_STATUS_RPC_TRANSPORT_ERROR;
 
   char *rep = NULL;
-  int bytes = nn_recv(state.s, &rep, NN_MSG, 0);
-  if (bytes <= 0) return PI_STATUS_RPC_TRANSPORT_ERROR;
+  int bytes = rpc_recv(req_id, &rep, NN_MSG);
+  if (bytes < (int)sizeof(rep_hdr_t)) {
+    if (bytes > 0) rpc_free_rep(rep);
+    return PI_STATUS_RPC_TRANSPORT_ERROR;
+  }
 
   char *rep_ = rep;
   status = retrieve_rep_hdr(rep_, req_id);
   if (status != PI_STATUS_SUCCESS) {
-    nn_freemsg(rep);
+    rpc_free_rep(rep);
     return status;
   }
   rep_ += sizeof(rep_hdr_t);
 
-  process_state_sync(rep_);
-
-  return PI_STATUS_SUCCESS;
+  status = process_state_sync(rep_, bytes - sizeof(rep_hdr_t));
+  rpc_free_rep(rep);
+  return status;
 }
 
 pi_status_t _pi_assign_device(pi_dev_id_t dev_id, const pi_p4info_t *p4info,
@@ -205,7 +216,7 @@ pi_status_t _pi_assign_device(pi_dev_id_t dev_id, const pi_p4info_t *p4info,
   char *req = nn_allocmsg(s, 0);
   char *req_ = req;
 
-  pi_rpc_id_t req_id = state.req_id++;
+  pi_rpc_id_t req_id = next_req_id();
   req_ += emit_req_hdr(req_, req_id, PI_RPC_ASSIGN_DEVICE);
   req_ += emit_dev_id(req_, dev_id);
   memcpy(req_, p4info_json, p4info_size);
@@ -220,7 +231,7 @@ pi_status_t _pi_assign_device(pi_dev_id_t dev_id, const pi_p4info_t *p4info,
     req_ = strchr(req_, '\0') + 1;
   }
 
-  int rc = nn_send(state.s, &req, NN_MSG, 0);
+  int rc = rpc_send_msg(req, s);
   if ((size_t)rc != s) return PI_STATUS_RPC_TRANSPORT_ERROR;
 
   return wait_for_status(req_id);
@@ -241,7 +252,7 @@ pi_status_t _pi_update_device_start(pi_dev_id_t dev_id,
   char *req = nn_allocmsg(s, 0);
   char *req_ = req;
 
-  pi_rpc_id_t req_id = state.req_id++;
+  pi_rpc_id_t req_id = next_req_id();
   req_ += emit_req_hdr(req_, req_id, PI_RPC_UPDATE_DEVICE_START);
   req_ += emit_dev_id(req_, dev_id);
   memcpy(req_, p4info_json, p4info_size);
@@ -250,7 +261,7 @@ pi_status_t _pi_update_device_start(pi_dev_id_t dev_id,
   req_ += emit_uint32(req_, device_data_size);
   memcpy(req_, device_data, device_data_size);
 
-  int rc = nn_send(state.s, &req, NN_MSG, 0);
+  int rc = rpc_send_msg(req, s);
   if ((size_t)rc != s) return PI_STATUS_RPC_TRANSPORT_ERROR;
 
   return wait_for_status(req_id);
@@ -264,11 +275,11 @@ pi_status_t _pi_update_device_end(pi_dev_id_t dev_id) {
   } req_t;
   req_t req;
   char *req_ = (char *)&req;
-  pi_rpc_id_t req_id = state.req_id++;
+  pi_rpc_id_t req_id = next_req_id();
   req_ += emit_req_hdr(req_, req_id, PI_RPC_UPDATE_DEVICE_END);
   req_ += emit_dev_id(req_, dev_id);
 
-  int rc = nn_send(state.s, &req, sizeof(req), 0);
+  int rc = rpc_send(&req, sizeof(req));
   if (rc != sizeof(req)) return PI_STATUS_RPC_TRANSPORT_ERROR;
 
   return wait_for_status(req_id);
@@ -282,11 +293,11 @@ pi_status_t _pi_remove_device(pi_dev_id_t dev_id) {
   } req_t;
   req_t req;
   char *req_ = (char *)&req;
-  pi_rpc_id_t req_id = state.req_id++;
+  pi_rpc_id_t req_id = next_req_id();
   req_ += emit_req_hdr(req_, req_id, PI_RPC_REMOVE_DEVICE);
   req_ += emit_dev_id(req_, dev_id);
 
-  int rc = nn_send(state.s, &req, sizeof(req), 0);
+  int rc = rpc_send(&req, sizeof(req));
   if (rc != sizeof(req)) return PI_STATUS_RPC_TRANSPORT_ERROR;
 
   return wait_for_status(req_id);
@@ -295,25 +306,28 @@ pi_status_t _pi_remove_device(pi_dev_id_t dev_id) {
 pi_status_t _pi_destroy() {
   if (!state.init) return PI_STATUS_RPC_NOT_INIT;
   req_hdr_t req;
-  pi_rpc_id_t req_id = state.req_id++;
+  pi_rpc_id_t req_id = next_req_id();
   emit_req_hdr((char *)&req, req_id, PI_RPC_DESTROY);
 
-  int rc = nn_send(state.s, (char *)&req, sizeof(req), 0);
+  int rc = rpc_send(&req, sizeof(req));
   if (rc != sizeof(req)) return PI_STATUS_RPC_TRANSPORT_ERROR;
 
   free_addrs();
 
-  return wait_for_status(req_id);
+  pi_status_t status = wait_for_status(req_id);
+  rpc_stop();
+  state.init = 0;
+  return status;
 }
 
 pi_status_t _pi_session_init(pi_session_handle_t *session_handle) {
   if (!state.init) return PI_STATUS_RPC_NOT_INIT;
 
   req_hdr_t req;
-  pi_rpc_id_t req_id = state.req_id++;
+  pi_rpc_id_t req_id = next_req_id();
   emit_req_hdr((char *)&req, req_id, PI_RPC_SESSION_INIT);
 
-  int rc = nn_send(state.s, (char *)&req, sizeof(req), 0);
+  int rc = rpc_send(&req, sizeof(req));
   if (rc != sizeof(req)) return PI_STATUS_RPC_TRANSPORT_ERROR;
 
   typedef struct __attribute__((packed)) {
@@ -321,7 +335,7 @@ pi_status_t _pi_session_init(pi_session_handle_t *session_handle) {
     s_pi_session_handle_t h;
   } rep_t;
   rep_t rep;
-  rc = nn_recv(state.s, &rep, sizeof(rep), 0);
+  rc = rpc_recv(req_id, &rep, sizeof(rep));
   if (rc != sizeof(rep)) return PI_STATUS_RPC_TRANSPORT_ERROR;
   pi_status_t status = retrieve_rep_hdr((char *)&rep, req_id);
   // condition on success?
@@ -332,60 +346,32 @@ pi_status_t _pi_session_init(pi_session_handle_t *session_handle) {
 pi_status_t _pi_session_cleanup(pi_session_handle_t session_handle) {
   if (!state.init) return PI_STATUS_RPC_NOT_INIT;
 
+  rpc_batch_discard(session_handle);
+
   typedef struct __attribute__((packed)) {
     req_hdr_t hdr;
     s_pi_session_handle_t h;
   } req_t;
   req_t req;
   char *req_ = (char *)&req;
-  pi_rpc_id_t req_id = state.req_id++;
+  pi_rpc_id_t req_id = next_req_id();
   req_ += emit_req_hdr(req_, req_id, PI_RPC_SESSION_CLEANUP);
   req_ += emit_session_handle(req_, session_handle);
 
-  int rc = nn_send(state.s, &req, sizeof(req), 0);
+  int rc = rpc_send(&req, sizeof(req));
   if (rc != sizeof(req)) return PI_STATUS_RPC_TRANSPORT_ERROR;
 
   return wait_for_status(req_id);
 }
 
+// operations issued inside a batch are buffered and sent together when the
+// batch ends, see pi_rpc_batch.c
 pi_status_t _pi_batch_begin(pi_session_handle_t session_handle) {
-  if (!state.init) return PI_STATUS_RPC_NOT_INIT;
-
-  typedef struct __attribute__((packed)) {
-    req_hdr_t hdr;
-    s_pi_session_handle_t h;
-  } req_t;
-  req_t req;
-  char *req_ = (char *)&req;
-  pi_rpc_id_t req_id = state.req_id++;
-  req_ += emit_req_hdr(req_, req_id, PI_RPC_BATCH_BEGIN);
-  req_ += emit_session_handle(req_, session_handle);
-
-  int rc = nn_send(state.s, &req, sizeof(req), 0);
-  if (rc != sizeof(req)) return PI_STATUS_RPC_TRANSPORT_ERROR;
-
-  return wait_for_status(req_id);
+  return rpc_batch_begin(session_handle);
 }
 
 pi_status_t _pi_batch_end(pi_session_handle_t session_handle, bool hw_sync) {
-  if (!state.init) return PI_STATUS_RPC_NOT_INIT;
-
-  typedef struct __attribute__((packed)) {
-    req_hdr_t hdr;
-    s_pi_session_handle_t h;
-    uint32_t hw_sync;
-  } req_t;
-  req_t req;
-  char *req_ = (char *)&req;
-  pi_rpc_id_t req_id = state.req_id++;
-  req_ += emit_req_hdr(req_, req_id, PI_RPC_BATCH_END);
-  req_ += emit_session_handle(req_, session_handle);
-  req_ += emit_uint32(req_, hw_sync);
-
-  int rc = nn_send(state.s, &req, sizeof(req), 0);
-  if (rc != sizeof(req)) return PI_STATUS_RPC_TRANSPORT_ERROR;
-
-  return wait_for_status(req_id);
+  return rpc_batch_end(session_handle, hw_sync);
 }
 
 pi_status_t _pi_packetout_send(pi_dev_id_t dev_id, const char *pkt,
@@ -400,13 +386,13 @@ pi_status_t _pi_packetout_send(pi_dev_id_t dev_id, const char *pkt,
 
   char *req = nn_allocmsg(s, 0);
   char *req_ = req;
-  pi_rpc_id_t req_id = state.req_id++;
+  pi_rpc_id_t req_id = next_req_id();
   req_ += emit_req_hdr(req_, req_id, PI_RPC_PACKETOUT_SEND);
   req_ += emit_dev_id(req_, dev_id);
   req_ += emit_uint32(req_, size);
   memcpy(req_, pkt, size);
 
-  int rc = nn_send(state.s, &req, NN_MSG, 0);
+  int rc = rpc_send_msg(req, s);
   if ((size_t)rc != s) return PI_STATUS_RPC_TRANSPORT_ERROR;
 
   return wait_for_status(req_id);
@@ -21,10 +21,17 @@
 #include <PI/target/pi_learn_imp.h>
 
 #include <stdio.h>
-#include <stdlib.h>
 
 #include "pi_rpc.h"
 
+static void learn_msg_ack_done(pi_rpc_id_t req_id, char *rep, size_t size,
+                               void *cookie) {
+  (void)req_id;
+  (void)size;
+  (void)cookie;
+  if (rep) rpc_free_rep(rep);
+}
+
 pi_status_t _pi_learn_msg_ack(pi_session_handle_t session_handle,
                               pi_dev_id_t dev_id, pi_p4_id_t learn_id,
                               pi_learn_msg_id_t msg_id) {
@@ -39,7 +46,7 @@ pi_status_t _pi_learn_msg_ack(pi_session_handle_t session_handle,
   } req_t;
   req_t req;
   char *req_ = (char *)&req;
-  pi_rpc_id_t req_id = state.req_id++;
+  pi_rpc_id_t req_id = next_req_id();
 
   req_ += emit_req_hdr(req_, req_id, PI_RPC_LEARN_MSG_ACK);
   req_ += emit_session_handle(req_, session_handle);
@@ -47,14 +54,15 @@ pi_status_t _pi_learn_msg_ack(pi_session_handle_t session_handle,
   req_ += emit_p4_id(req_, learn_id);
   req_ += emit_learn_msg_id(req_, msg_id);
 
-  int rc = nn_send(state.s, &req, sizeof(req), 0);
+  // acks are sent on the data path and nobody acts on a failure, so we do not
+  // wait for the server to process them
+  int rc = rpc_send_async(&req, sizeof(req), learn_msg_ack_done, NULL);
   if (rc != sizeof(req_t)) return PI_STATUS_RPC_TRANSPORT_ERROR;
 
-  return wait_for_status(req_id);
+  return PI_STATUS_SUCCESS;
 }
 
 pi_status_t _pi_learn_msg_done(pi_learn_msg_t *msg) {
-  free(msg->entries);
-  free(msg);
+  learn_msg_release(msg);
   return PI_STATUS_SUCCESS;
 }
@@ -29,7 +29,7 @@ static pi_status_t wait_for_meter_spec(uint32_t req_id,
     s_pi_meter_spec_t meter_spec;
   } rep_t;
   rep_t rep;
-  int rc = nn_recv(state.s, &rep, sizeof(rep), 0);
+  int rc = rpc_recv(req_id, &rep, sizeof(rep));
   if (rc != sizeof(rep)) return PI_STATUS_RPC_TRANSPORT_ERROR;
   pi_status_t status = retrieve_rep_hdr((char *)&rep, req_id);
   // condition on success?
@@ -46,6 +46,9 @@ static pi_status_t meter_read(pi_rpc_type_t type,
 
   if (!state.init) return PI_STATUS_RPC_NOT_INIT;
 
+  pi_status_t status = rpc_batch_flush(session_handle);
+  if (status != PI_STATUS_SUCCESS) return status;
+
   typedef struct __attribute__((packed)) {
     req_hdr_t hdr;
     s_pi_session_handle_t sess;
@@ -55,7 +58,7 @@ static pi_status_t meter_read(pi_rpc_type_t type,
   } req_t;
   req_t req;
   char *req_ = (char *)&req;
-  pi_rpc_id_t req_id = state.req_id++;
+  pi_rpc_id_t req_id = next_req_id();
 
   req_ += emit_req_hdr(req_, req_id, type);
   req_ += emit_session_handle(req_, session_handle);
@@ -63,7 +66,7 @@ static pi_status_t meter_read(pi_rpc_type_t type,
   req_ += emit_p4_id(req_, meter_id);
   req_ += emit_uint64(req_, h);
 
-  int rc = nn_send(state.s, &req, sizeof(req), 0);
+  int rc = rpc_send(&req, sizeof(req));
   if (rc != sizeof(req)) return PI_STATUS_RPC_TRANSPORT_ERROR;
 
   return wait_for_meter_spec(req_id, meter_spec);
@@ -88,7 +91,7 @@ static pi_status_t meter_set(pi_rpc_type_t type,
   } req_t;
   req_t req;
   char *req_ = (char *)&req;
-  pi_rpc_id_t req_id = state.req_id++;
+  pi_rpc_id_t req_id = next_req_id();
 
   req_ += emit_req_hdr(req_, req_id, type);
   req_ += emit_session_handle(req_, session_handle);
@@ -97,7 +100,10 @@ static pi_status_t meter_set(pi_rpc_type_t type,
   req_ += emit_uint64(req_, h);
   req_ += emit_meter_spec(req_, meter_spec);
 
-  int rc = nn_send(state.s, &req, sizeof(req), 0);
+  if (rpc_batch_add(session_handle, (char *)&req, sizeof(req)))
+    return PI_STATUS_SUCCESS;
+
+  int rc = rpc_send(&req, sizeof(req));
   if (rc != sizeof(req)) return PI_STATUS_RPC_TRANSPORT_ERROR;
 
   return wait_for_status(req_id);
@@ -20,11 +20,287 @@
 
 #include "pi_rpc.h"
 
+#include <PI/int/shm_transport.h>
+
+#include <arpa/inet.h>
+#include <assert.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
 char *rpc_addr = NULL;
 char *notifications_addr = NULL;
 
 pi_rpc_state_t state;
 
+// a request waiting for its reply
+typedef struct pending_s {
+  struct pending_s *next;
+  pi_rpc_id_t req_id;
+  // NULL for synchronous requests
+  PIRpcReplyCb cb;
+  void *cookie;
+  char *rep;
+  // 0 until the reply is received, negative if it never will be
+  int bytes;
+} pending_t;
+
+static struct {
+  pthread_mutex_t lock;
+  // broadcast when the reply to a synchronous request is received
+  pthread_cond_t cond;
+  pending_t *pending;
+  pthread_t demux_thread;
+  // used instead of state.s for "shm://" addresses
+  pi_shm_transport_t *shm;
+} rpc = {PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER, NULL, 0, NULL};
+
+// must be called with the lock held
+static pending_t *pending_unlink(pi_rpc_id_t req_id) {
+  for (pending_t **p = &rpc.pending; *p; p = &(*p)->next) {
+    if ((*p)->req_id != req_id) continue;
+    pending_t *found = *p;
+    *p = found->next;
+    return found;
+  }
+  return NULL;
+}
+
+static void complete_async(pending_t *p) {
+  p->cb(p->req_id, p->rep, (p->bytes > 0) ? p->bytes : 0, p->cookie);
+  free(p);
+}
+
+// Replies received through shared memory point into the ring; in all cases,
+// they must be released with rpc_free_rep. Returns -2 once rpc_stop has been
+// called.
+static int recv_rep(char **rep) {
+  if (rpc.shm) {
+    int bytes = pi_shm_recv(rpc.shm, rep);
+    return (bytes < 0) ? -2 : bytes;
+  }
+  int bytes = nn_recv(state.s, rep, NN_MSG, 0);
+  // the socket was closed by rpc_stop
+  if (bytes < 0 && (nn_errno() == EBADF || nn_errno() == ETERM)) return -2;
+  return bytes;
+}
+
+static void *demux_loop(void *arg) {
+  (void)arg;
+  while (1) {
+    char *rep = NULL;
+    int bytes = recv_rep(&rep);
+    if (bytes == -2) break;
+    if (bytes < 0) continue;
+    if ((size_t)bytes < sizeof(rep_hdr_t)) {
+      rpc_free_rep(rep);
+      continue;
+    }
+    pi_rpc_id_t req_id;
+    retrieve_rpc_id(rep, &req_id);
+
+    pthread_mutex_lock(&rpc.lock);
+    pending_t *p;
+    for (p = rpc.pending; p; p = p->next) {
+      if (p->req_id == req_id) break;
+    }
+    if (!p) {
+      pthread_mutex_unlock(&rpc.lock);
+      rpc_free_rep(rep);
+      continue;
+    }
+    p->rep = rep;
+    p->bytes = bytes;
+    if (p->cb) {
+      pending_unlink(req_id);
+      pthread_mutex_unlock(&rpc.lock);
+      complete_async(p);
+      continue;
+    }
+    pthread_cond_broadcast(&rpc.cond);
+    pthread_mutex_unlock(&rpc.lock);
+  }
+
+  // no more replies will be received, fail all outstanding requests
+  pthread_mutex_lock(&rpc.lock);
+  pending_t *async = NULL;
+  pending_t **p = &rpc.pending;
+  while (*p) {
+    pending_t *current = *p;
+    if (current->bytes != 0) {
+      p = &current->next;
+      continue;
+    }
+    current->bytes = -1;
+    if (current->cb) {
+      *p = current->next;
+      current->next = async;
+      async = current;
+    } else {
+      p = &current->next;
+    }
+  }
+  pthread_cond_broadcast(&rpc.cond);
+  pthread_mutex_unlock(&rpc.lock);
+  while (async) {
+    pending_t *next = async->next;
+    complete_async(async);
+    async = next;
+  }
+  return NULL;
+}
+
+pi_status_t rpc_start(const char *addr) {
+  if (pi_shm_is_shm_addr(addr)) {
+    rpc.shm = pi_shm_transport_connect(addr);
+    if (!rpc.shm) return PI_STATUS_RPC_CONNECT_ERROR;
+  } else {
+    state.s = nn_socket(AF_SP_RAW, NN_REQ);
+    if (state.s < 0) return PI_STATUS_RPC_CONNECT_ERROR;
+    if (nn_connect(state.s, addr) < 0) return PI_STATUS_RPC_CONNECT_ERROR;
+  }
+  if (pthread_create(&rpc.demux_thread, NULL, demux_loop, NULL) != 0)
+    return PI_STATUS_RPC_CONNECT_ERROR;
+  return PI_STATUS_SUCCESS;
+}
+
+void rpc_stop() {
+  if (rpc.shm) {
+    pi_shm_shutdown(rpc.shm);
+    pthread_join(rpc.demux_thread, NULL);
+    pi_shm_transport_destroy(rpc.shm);
+    rpc.shm = NULL;
+    return;
+  }
+  nn_close(state.s);
+  pthread_join(rpc.demux_thread, NULL);
+}
+
+pi_rpc_id_t next_req_id() { return __sync_fetch_and_add(&state.req_id, 1); }
+
+// if is_nn_msg is true, msg was allocated with nn_allocmsg and is released on
+// success
+static int transport_send(char *msg, size_t size, bool is_nn_msg,
+                          pi_rpc_id_t req_id) {
+  if (rpc.shm) {
+    int rc = pi_shm_send(rpc.shm, msg, size);
+    if (rc >= 0 && is_nn_msg) nn_freemsg(msg);
+    return rc;
+  }
+
+  // with a raw socket, we have to provide the REQ protocol header ourselves:
+  // a request id with the top bit set, which the server sends back as is
+  struct nn_iovec iov;
+  iov.iov_base = is_nn_msg ? (void *)&msg : (void *)msg;
+  iov.iov_len = is_nn_msg ? NN_MSG : size;
+  char control[NN_CMSG_SPACE(sizeof(uint32_t))];
+  memset(control, 0, sizeof(control));
+  struct nn_msghdr hdr;
+  memset(&hdr, 0, sizeof(hdr));
+  hdr.msg_iov = &iov;
+  hdr.msg_iovlen = 1;
+  hdr.msg_control = control;
+  hdr.msg_controllen = sizeof(control);
+  struct nn_cmsghdr *cmsg = NN_CMSG_FIRSTHDR(&hdr);
+  cmsg->cmsg_level = PROTO_SP;
+  cmsg->cmsg_type = SP_HDR;
+  cmsg->cmsg_len = NN_CMSG_LEN(sizeof(uint32_t));
+  uint32_t sp_id = htonl(req_id | 0x80000000u);
+  memcpy(NN_CMSG_DATA(cmsg), &sp_id, sizeof(sp_id));
+
+  return nn_sendmsg(state.s, &hdr, 0);
+}
+
+static int send_common(char *msg, size_t size, bool is_nn_msg,
+                       PIRpcReplyCb cb, void *cookie) {
+  pi_rpc_id_t req_id;
+  retrieve_rpc_id(msg, &req_id);
+
+  // registered before sending, so that the reply cannot be missed
+  pending_t *p = calloc(1, sizeof(*p));
+  if (!p) return -1;
+  p->req_id = req_id;
+  p->cb = cb;
+  p->cookie = cookie;
+  pthread_mutex_lock(&rpc.lock);
+  p->next = rpc.pending;
+  rpc.pending = p;
+  pthread_mutex_unlock(&rpc.lock);
+
+  int rc = transport_send(msg, size, is_nn_msg, req_id);
+  if (rc < 0) {
+    pthread_mutex_lock(&rpc.lock);
+    pending_unlink(req_id);
+    pthread_mutex_unlock(&rpc.lock);
+    free(p);
+  }
+  return rc;
+}
+
+int rpc_send(const void *req, size_t size) {
+  return send_common((char *)req, size, false, NULL, NULL);
+}
+
+int rpc_send_msg(char *req, size_t size) {
+  return send_common(req, size, true, NULL, NULL);
+}
+
+int rpc_send_async(const void *req, size_t size, PIRpcReplyCb cb,
+                   void *cookie) {
+  assert(cb);
+  return send_common((char *)req, size, false, cb, cookie);
+}
+
+int rpc_recv(pi_rpc_id_t req_id, void *rep, size_t len) {
+  pthread_mutex_lock(&rpc.lock);
+  pending_t *p;
+  for (p = rpc.pending; p; p = p->next) {
+    if (p->req_id == req_id) break;
+  }
+  if (!p) {
+    pthread_mutex_unlock(&rpc.lock);
+    return -1;
+  }
+  while (p->bytes == 0) pthread_cond_wait(&rpc.cond, &rpc.lock);
+  pending_unlink(req_id);
+  pthread_mutex_unlock(&rpc.lock);
+
+  int bytes = p->bytes;
+  if (bytes > 0) {
+    if (len == NN_MSG) {
+      *(char **)rep = p->rep;
+    } else {
+      memcpy(rep, p->rep, ((size_t)bytes < len) ? (size_t)bytes : len);
+      rpc_free_rep(p->rep);
+    }
+  }
+  free(p);
+  return bytes;
+}
+
+void rpc_free_rep(char *rep) {
+  if (rpc.shm)
+    pi_shm_release(rpc.shm, rep);
+  else
+    nn_freemsg(rep);
+}
+
+char *rpc_rep_detach(char *rep, size_t size) {
+  if (!rpc.shm) return rep;
+  char *copy = malloc(size);
+  if (copy) memcpy(copy, rep, size);
+  pi_shm_release(rpc.shm, rep);
+  return copy;
+}
+
+void rpc_free_detached_rep(char *rep) {
+  if (rpc.shm)
+    free(rep);
+  else
+    nn_freemsg(rep);
+}
+
 pi_status_t retrieve_rep_hdr(const char *rep, pi_rpc_id_t req_id) {
   pi_rpc_id_t recv_id;
   pi_status_t recv_status;
@@ -37,7 +313,7 @@ pi_status_t retrieve_rep_hdr(const char *rep, pi_rpc_id_t req_id) {
 
 pi_status_t wait_for_status(pi_rpc_id_t req_id) {
   rep_hdr_t rep;
-  int rc = nn_recv(state.s, &rep, sizeof(rep), 0);
+  int rc = rpc_recv(req_id, &rep, sizeof(rep));
   if (rc != sizeof(rep)) return PI_STATUS_RPC_TRANSPORT_ERROR;
   return retrieve_rep_hdr((char *)&rep, req_id);
 }
@@ -25,12 +25,14 @@
 #include <PI/int/rpc_common.h>
 #include <PI/int/serialize.h>
 #include <PI/pi.h>
+#include <PI/pi_learn.h>
 
 #include <nanomsg/nn.h>
 #include <nanomsg/reqrep.h>
 
 typedef struct {
   int init;
+  // do not access directly, use next_req_id
   pi_rpc_id_t req_id;
   int s;
 } pi_rpc_state_t;
@@ -40,10 +42,96 @@ extern char *notifications_addr;
 
 extern pi_rpc_state_t state;
 
+// Requests are sent on a raw REQ socket, so several of them can be outstanding
+// at the same time, and replies are received by a demultiplexer thread which
+// hands them to the right caller based on their id. All these functions can be
+// called concurrently from different threads.
+
+pi_status_t rpc_start(const char *addr);
+
+void rpc_stop();
+
+pi_rpc_id_t next_req_id();
+
+// Sends a request and returns the number of bytes sent, or -1 on error. The
+// request id is read from the message header. The reply must be claimed with
+// rpc_recv. The address can be a nanomsg address or a "shm://" one, see
+// PI/int/shm_transport.h.
+int rpc_send(const void *req, size_t size);
+
+// Same as rpc_send, for a message allocated with nn_allocmsg, which is
+// released on success.
+int rpc_send_msg(char *req, size_t size);
+
+// Waits for the reply to request req_id, with the same semantics as nn_recv.
+int rpc_recv(pi_rpc_id_t req_id, void *rep, size_t len);
+
+// Releases a reply obtained with rpc_recv(..., NN_MSG) or passed to a
+// PIRpcReplyCb. With the shared memory transport, the reply points into the
+// ring and holds its space until it is released, so replies must not be kept
+// for long; use rpc_rep_detach for the ones which outlive the call.
+void rpc_free_rep(char *rep);
+
+// Takes ownership of a reply obtained with rpc_recv(..., NN_MSG), and returns
+// a buffer with the same contents which can be kept for as long as needed and
+// must be released with rpc_free_detached_rep. Only the shared memory transport
+// requires a copy. Returns NULL if the copy cannot be allocated.
+char *rpc_rep_detach(char *rep, size_t size);
+
+void rpc_free_detached_rep(char *rep);
+
+// Called by the demultiplexer thread when the reply to an asynchronous request
+// is received. The callback owns rep and must release it with rpc_free_rep. If
+// the client is stopped before the reply is received, rep is NULL.
+typedef void (*PIRpcReplyCb)(pi_rpc_id_t req_id, char *rep, size_t size,
+                             void *cookie);
+
+// Sends a request without waiting for the reply, which is passed to cb.
+int rpc_send_async(const void *req, size_t size, PIRpcReplyCb cb,
+                   void *cookie);
+
+// Between _pi_batch_begin and _pi_batch_end, the requests which only modify
+// state are buffered by the client and sent to the server in PI_RPC_BATCH
+// messages. Any other request for the session must call rpc_batch_flush first
+// to preserve ordering. A session is only used by one thread at a time, so a
+// batch is never accessed concurrently.
+
+pi_status_t rpc_batch_begin(pi_session_handle_t session_handle);
+
+// Returns the batch status, or the status of the first buffered request which
+// failed.
+pi_status_t rpc_batch_end(pi_session_handle_t session_handle, bool hw_sync);
+
+// Sends the buffered requests, if any, without ending the batch. The status of
+// these requests is only returned by rpc_batch_end.
+pi_status_t rpc_batch_flush(pi_session_handle_t session_handle);
+
+// Drops the batch without sending the buffered requests.
+void rpc_batch_discard(pi_session_handle_t session_handle);
+
+// Returns false if the session has no ongoing batch, in which case the request
+// must be sent normally. Otherwise the request is copied to the batch. Only
+// requests whose reply carries nothing but a status can be batched: requests
+// which return a handle are sent synchronously after flushing the batch.
+bool rpc_batch_add(pi_session_handle_t session_handle, const char *req,
+                   size_t size);
+
 pi_status_t retrieve_rep_hdr(const char *rep, pi_rpc_id_t req_id);
 
 pi_status_t wait_for_status(pi_rpc_id_t req_id);
 
 size_t emit_req_hdr(char *hdr, pi_rpc_id_t id, pi_rpc_type_t type);
 
+// defined in notifications.c
+
+pi_status_t notifications_start(const char *addr);
+
+// Releases a learn message received from the server, once the application is
+// done with it.
+void learn_msg_release(pi_learn_msg_t *msg);
+
+// Returns the number of released learn message headers kept for reuse, used by
+// the tests.
+size_t learn_msg_pool_num_free();
+
 #endif  // PI_RPC_PI_RPC_H_
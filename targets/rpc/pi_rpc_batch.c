@@ -0,0 +1,211 @@
+/* Copyright 2013-present Barefoot Networks, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Antonin Bas (antonin@barefootnetworks.com)
+ *
+ */
+
+#include "pi_rpc.h"
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+  pi_rpc_id_t req_id;
+} batch_op_t;
+
+typedef struct batch_s {
+  struct batch_s *next;
+  pi_session_handle_t session_handle;
+  // true once the batch has been started on the server by a first flush
+  bool started;
+  // buffered requests, each one preceded by its size
+  char *buf;
+  size_t size;
+  size_t capacity;
+  batch_op_t *ops;
+  size_t num_ops;
+  size_t ops_capacity;
+  // status of the first buffered request which failed
+  pi_status_t status;
+} batch_t;
+
+// only protects the list itself, see pi_rpc.h
+static pthread_mutex_t batches_lock = PTHREAD_MUTEX_INITIALIZER;
+static batch_t *batches = NULL;
+
+static batch_t *batch_find(pi_session_handle_t session_handle) {
+  pthread_mutex_lock(&batches_lock);
+  batch_t *b = batches;
+  while (b && b->session_handle != session_handle) b = b->next;
+  pthread_mutex_unlock(&batches_lock);
+  return b;
+}
+
+static batch_t *batch_unlink(pi_session_handle_t session_handle) {
+  pthread_mutex_lock(&batches_lock);
+  batch_t **p = &batches;
+  while (*p && (*p)->session_handle != session_handle) p = &(*p)->next;
+  batch_t *b = *p;
+  if (b) *p = b->next;
+  pthread_mutex_unlock(&batches_lock);
+  return b;
+}
+
+static void batch_free(batch_t *b) {
+  free(b->buf);
+  free(b->ops);
+  free(b);
+}
+
+pi_status_t rpc_batch_begin(pi_session_handle_t session_handle) {
+  if (!state.init) return PI_STATUS_RPC_NOT_INIT;
+  if (batch_find(session_handle)) return PI_STATUS_SUCCESS;
+  batch_t *b = calloc(1, sizeof(*b));
+  if (!b) return PI_STATUS_ALLOC_ERROR;
+  b->session_handle = session_handle;
+  b->status = PI_STATUS_SUCCESS;
+  pthread_mutex_lock(&batches_lock);
+  b->next = batches;
+  batches = b;
+  pthread_mutex_unlock(&batches_lock);
+  return PI_STATUS_SUCCESS;
+}
+
+bool rpc_batch_add(pi_session_handle_t session_handle, const char *req,
+                   size_t size) {
+  batch_t *b = batch_find(session_handle);
+  if (!b) return false;
+
+  size_t required = b->size + sizeof(uint32_t) + size;
+  if (required > b->capacity) {
+    b->capacity = (required > 2 * b->capacity) ? required : 2 * b->capacity;
+    b->buf = realloc(b->buf, b->capacity);
+    assert(b->buf);
+  }
+  b->size += emit_uint32(b->buf + b->size, size);
+  memcpy(b->buf + b->size, req, size);
+  b->size += size;
+
+  if (b->num_ops == b->ops_capacity) {
+    b->ops_capacity = (b->ops_capacity == 0) ? 16 : 2 * b->ops_capacity;
+    b->ops = realloc(b->ops, b->ops_capacity * sizeof(*b->ops));
+    assert(b->ops);
+  }
+  batch_op_t *op = &b->ops[b->num_ops++];
+  retrieve_rpc_id(req, &op->req_id);
+  return true;
+}
+
+// sends all the buffered requests and dispatches the replies; returns the
+// status of the PI_RPC_BATCH request itself
+static pi_status_t batch_send(batch_t *b, uint32_t flags) {
+  if (!b->started) flags |= PI_RPC_BATCH_FLAGS_BEGIN;
+
+  size_t s = 0;
+  s += sizeof(req_hdr_t);
+  s += sizeof(s_pi_session_handle_t);
+  s += sizeof(uint32_t);  // flags
+  s += sizeof(uint32_t);  // num requests
+  s += b->size;
+
+  char *req = nn_allocmsg(s, 0);
+  char *req_ = req;
+  pi_rpc_id_t req_id = next_req_id();
+  req_ += emit_req_hdr(req_, req_id, PI_RPC_BATCH);
+  req_ += emit_session_handle(req_, b->session_handle);
+  req_ += emit_uint32(req_, flags);
+  req_ += emit_uint32(req_, b->num_ops);
+  if (b->size > 0) memcpy(req_, b->buf, b->size);
+  req_ += b->size;
+
+  // make sure I have copied exactly the right amount
+  assert((size_t)(req_ - req) == s);
+
+  size_t num_ops = b->num_ops;
+  b->size = 0;
+  b->num_ops = 0;
+  b->started = true;
+
+  int rc = rpc_send_msg(req, s);
+  if ((size_t)rc != s) return PI_STATUS_RPC_TRANSPORT_ERROR;
+
+  char *rep = NULL;
+  int bytes = rpc_recv(req_id, &rep, NN_MSG);
+  if (bytes <= 0) return PI_STATUS_RPC_TRANSPORT_ERROR;
+
+  // the reply is checked against the number of bytes received before being
+  // parsed
+  const char *rep_ = rep;
+  const char *rep_end = rep + bytes;
+  if ((size_t)bytes < sizeof(rep_hdr_t) + sizeof(uint32_t)) {
+    rpc_free_rep(rep);
+    return PI_STATUS_RPC_TRANSPORT_ERROR;
+  }
+  pi_status_t status = retrieve_rep_hdr(rep_, req_id);
+  rep_ += sizeof(rep_hdr_t);
+  uint32_t num_done;
+  rep_ += retrieve_uint32(rep_, &num_done);
+  if (num_done > num_ops) {
+    rpc_free_rep(rep);
+    return PI_STATUS_RPC_TRANSPORT_ERROR;
+  }
+  for (size_t i = 0; i < num_done; i++) {
+    batch_op_t *op = &b->ops[i];
+    uint32_t size = 0;
+    if ((size_t)(rep_end - rep_) >= sizeof(uint32_t))
+      rep_ += retrieve_uint32(rep_, &size);
+    if (size < sizeof(rep_hdr_t) || (size_t)(rep_end - rep_) < size) {
+      rpc_free_rep(rep);
+      return PI_STATUS_RPC_TRANSPORT_ERROR;
+    }
+    pi_status_t op_status = retrieve_rep_hdr(rep_, op->req_id);
+    if (b->status == PI_STATUS_SUCCESS) b->status = op_status;
+    rep_ += size;
+  }
+
+  rpc_free_rep(rep);
+  return status;
+}
+
+pi_status_t rpc_batch_end(pi_session_handle_t session_handle, bool hw_sync) {
+  if (!state.init) return PI_STATUS_RPC_NOT_INIT;
+  batch_t *b = batch_unlink(session_handle);
+  if (!b) return PI_STATUS_SUCCESS;
+  pi_status_t status = PI_STATUS_SUCCESS;
+  // nothing to do on the server if nothing was ever sent
+  if (b->started || b->num_ops > 0) {
+    uint32_t flags = PI_RPC_BATCH_FLAGS_END;
+    if (hw_sync) flags |= PI_RPC_BATCH_FLAGS_HW_SYNC;
+    status = batch_send(b, flags);
+  }
+  if (status == PI_STATUS_SUCCESS) status = b->status;
+  batch_free(b);
+  return status;
+}
+
+pi_status_t rpc_batch_flush(pi_session_handle_t session_handle) {
+  batch_t *b = batch_find(session_handle);
+  if (!b || b->num_ops == 0) return PI_STATUS_SUCCESS;
+  return batch_send(b, 0);
+}
+
+void rpc_batch_discard(pi_session_handle_t session_handle) {
+  batch_t *b = batch_unlink(session_handle);
+  if (b) batch_free(b);
+}
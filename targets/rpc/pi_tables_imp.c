@@ -23,6 +23,10 @@
 #include <stdlib.h>
 #include <string.h>
 
+// the entries blob returned by _pi_table_entries_fetch starts after the reply
+// header and 3 uint32 fields (num entries, mkey nbytes and entries size)
+#define FETCH_REP_HDR_SIZE (sizeof(rep_hdr_t) + 3 * sizeof(uint32_t))
+
 static pi_status_t wait_for_handle(uint32_t req_id,
                                    pi_entry_handle_t *entry_handle) {
   typedef struct __attribute__((packed)) {
@@ -30,7 +34,7 @@ static pi_status_t wait_for_handle(uint32_t req_id,
     s_pi_entry_handle_t h;
   } rep_t;
   rep_t rep;
-  int rc = nn_recv(state.s, &rep, sizeof(rep), 0);
+  int rc = rpc_recv(req_id, &rep, sizeof(rep));
   if (rc != sizeof(rep)) return PI_STATUS_RPC_TRANSPORT_ERROR;
   pi_status_t status = retrieve_rep_hdr((char *)&rep, req_id);
   // condition on success?
@@ -62,6 +66,10 @@ pi_status_t _pi_table_entry_add(pi_session_handle_t session_handle,
                                 pi_entry_handle_t *entry_handle) {
   if (!state.init) return PI_STATUS_RPC_NOT_INIT;
 
+  // the caller needs the handle right away, so this request is never batched
+  pi_status_t status = rpc_batch_flush(session_handle);
+  if (status != PI_STATUS_SUCCESS) return status;
+
   size_t s = 0;
   s += sizeof(req_hdr_t);
   s += sizeof(s_pi_session_handle_t);
@@ -73,7 +81,7 @@ pi_status_t _pi_table_entry_add(pi_session_handle_t session_handle,
 
   char *req = nn_allocmsg(s, 0);
   char *req_ = req;
-  pi_rpc_id_t req_id = state.req_id++;
+  pi_rpc_id_t req_id = next_req_id();
   req_ += emit_req_hdr(req_, req_id, PI_RPC_TABLE_ENTRY_ADD);
   req_ += emit_session_handle(req_, session_handle);
   req_ += emit_dev_tgt(req_, dev_tgt);
@@ -85,7 +93,7 @@ pi_status_t _pi_table_entry_add(pi_session_handle_t session_handle,
   // make sure I have copied exactly the right amount
   assert((size_t)(req_ - req) == s);
 
-  int rc = nn_send(state.s, &req, NN_MSG, 0);
+  int rc = rpc_send_msg(req, s);
   if ((size_t)rc != s) return PI_STATUS_RPC_TRANSPORT_ERROR;
 
   return wait_for_handle(req_id, entry_handle);
@@ -106,7 +114,7 @@ pi_status_t _pi_table_default_action_set(pi_session_handle_t session_handle,
 
   char *req = nn_allocmsg(s, 0);
   char *req_ = req;
-  pi_rpc_id_t req_id = state.req_id++;
+  pi_rpc_id_t req_id = next_req_id();
   req_ += emit_req_hdr(req_, req_id, PI_RPC_TABLE_DEFAULT_ACTION_SET);
   req_ += emit_session_handle(req_, session_handle);
   req_ += emit_dev_tgt(req_, dev_tgt);
@@ -116,7 +124,12 @@ pi_status_t _pi_table_default_action_set(pi_session_handle_t session_handle,
   // make sure I have copied exactly the right amount
   assert((size_t)(req_ - req) == s);
 
-  int rc = nn_send(state.s, &req, NN_MSG, 0);
+  if (rpc_batch_add(session_handle, req, s)) {
+    nn_freemsg(req);
+    return PI_STATUS_SUCCESS;
+  }
+
+  int rc = rpc_send_msg(req, s);
   if ((size_t)rc != s) return PI_STATUS_RPC_TRANSPORT_ERROR;
 
   return wait_for_status(req_id);
@@ -128,6 +141,9 @@ pi_status_t _pi_table_default_action_get(pi_session_handle_t session_handle,
                                          pi_table_entry_t *table_entry) {
   if (!state.init) return PI_STATUS_RPC_NOT_INIT;
 
+  pi_status_t status = rpc_batch_flush(session_handle);
+  if (status != PI_STATUS_SUCCESS) return status;
+
   typedef struct __attribute__((packed)) {
     req_hdr_t hdr;
     s_pi_session_handle_t sess;
@@ -136,23 +152,23 @@ pi_status_t _pi_table_default_action_get(pi_session_handle_t session_handle,
   } req_t;
   req_t req;
   char *req_ = (char *)&req;
-  pi_rpc_id_t req_id = state.req_id++;
+  pi_rpc_id_t req_id = next_req_id();
   req_ += emit_req_hdr(req_, req_id, PI_RPC_TABLE_DEFAULT_ACTION_GET);
   req_ += emit_session_handle(req_, session_handle);
   req_ += emit_dev_id(req_, dev_id);
   req_ += emit_p4_id(req_, table_id);
 
-  int rc = nn_send(state.s, &req, sizeof(req), 0);
+  int rc = rpc_send(&req, sizeof(req));
   if (rc != sizeof(req)) return PI_STATUS_RPC_TRANSPORT_ERROR;
 
   char *rep = NULL;
-  int bytes = nn_recv(state.s, &rep, NN_MSG, 0);
+  int bytes = rpc_recv(req_id, &rep, NN_MSG);
   if (bytes <= 0) return PI_STATUS_RPC_TRANSPORT_ERROR;
 
   char *rep_ = rep;
-  pi_status_t status = retrieve_rep_hdr(rep_, req_id);
+  status = retrieve_rep_hdr(rep_, req_id);
   if (status != PI_STATUS_SUCCESS) {
-    nn_freemsg(rep);
+    rpc_free_rep(rep);
     return status;
   }
   rep_ += sizeof(rep_hdr_t);
@@ -161,7 +177,7 @@ pi_status_t _pi_table_default_action_get(pi_session_handle_t session_handle,
   rep_ += retrieve_table_entry(rep_, table_entry, 1);
   // table_entry->entry.action_data->p4info = NULL;  // TODO(antonin)
 
-  nn_freemsg(rep);
+  rpc_free_rep(rep);
   return status;
 }
 
@@ -188,14 +204,17 @@ pi_status_t _pi_table_entry_delete(pi_session_handle_t session_handle,
   } req_t;
   req_t req;
   char *req_ = (char *)&req;
-  pi_rpc_id_t req_id = state.req_id++;
+  pi_rpc_id_t req_id = next_req_id();
   req_ += emit_req_hdr(req_, req_id, PI_RPC_TABLE_ENTRY_DELETE);
   req_ += emit_session_handle(req_, session_handle);
   req_ += emit_dev_id(req_, dev_id);
   req_ += emit_p4_id(req_, table_id);
   req_ += emit_entry_handle(req_, entry_handle);
 
-  int rc = nn_send(state.s, &req, sizeof(req), 0);
+  if (rpc_batch_add(session_handle, (char *)&req, sizeof(req)))
+    return PI_STATUS_SUCCESS;
+
+  int rc = rpc_send(&req, sizeof(req));
   if (rc != sizeof(req)) return PI_STATUS_RPC_TRANSPORT_ERROR;
 
   return wait_for_status(req_id);
@@ -215,7 +234,7 @@ pi_status_t _pi_table_entry_delete_wkey(pi_session_handle_t session_handle,
 
   char *req = nn_allocmsg(s, 0);
   char *req_ = req;
-  pi_rpc_id_t req_id = state.req_id++;
+  pi_rpc_id_t req_id = next_req_id();
   req_ += emit_req_hdr(req_, req_id, PI_RPC_TABLE_ENTRY_DELETE_WKEY);
   req_ += emit_session_handle(req_, session_handle);
   req_ += emit_dev_id(req_, dev_id);
@@ -225,7 +244,12 @@ pi_status_t _pi_table_entry_delete_wkey(pi_session_handle_t session_handle,
   // make sure I have copied exactly the right amount
   assert((size_t)(req_ - req) == s);
 
-  int rc = nn_send(state.s, &req, NN_MSG, 0);
+  if (rpc_batch_add(session_handle, req, s)) {
+    nn_freemsg(req);
+    return PI_STATUS_SUCCESS;
+  }
+
+  int rc = rpc_send_msg(req, s);
   if ((size_t)rc != s) return PI_STATUS_RPC_TRANSPORT_ERROR;
 
   return wait_for_status(req_id);
@@ -247,7 +271,7 @@ pi_status_t _pi_table_entry_modify(pi_session_handle_t session_handle,
 
   char *req = nn_allocmsg(s, 0);
   char *req_ = req;
-  pi_rpc_id_t req_id = state.req_id++;
+  pi_rpc_id_t req_id = next_req_id();
   req_ += emit_req_hdr(req_, req_id, PI_RPC_TABLE_ENTRY_MODIFY);
   req_ += emit_session_handle(req_, session_handle);
   req_ += emit_dev_id(req_, dev_id);
@@ -258,7 +282,12 @@ pi_status_t _pi_table_entry_modify(pi_session_handle_t session_handle,
   // make sure I have copied exactly the right amount
   assert((size_t)(req_ - req) == s);
 
-  int rc = nn_send(state.s, &req, NN_MSG, 0);
+  if (rpc_batch_add(session_handle, req, s)) {
+    nn_freemsg(req);
+    return PI_STATUS_SUCCESS;
+  }
+
+  int rc = rpc_send_msg(req, s);
   if ((size_t)rc != s) return PI_STATUS_RPC_TRANSPORT_ERROR;
 
   return wait_for_status(req_id);
@@ -280,7 +309,7 @@ pi_status_t _pi_table_entry_modify_wkey(pi_session_handle_t session_handle,
 
   char *req = nn_allocmsg(s, 0);
   char *req_ = req;
-  pi_rpc_id_t req_id = state.req_id++;
+  pi_rpc_id_t req_id = next_req_id();
   req_ += emit_req_hdr(req_, req_id, PI_RPC_TABLE_ENTRY_MODIFY_WKEY);
   req_ += emit_session_handle(req_, session_handle);
   req_ += emit_dev_id(req_, dev_id);
@@ -291,46 +320,165 @@ pi_status_t _pi_table_entry_modify_wkey(pi_session_handle_t session_handle,
   // make sure I have copied exactly the right amount
   assert((size_t)(req_ - req) == s);
 
-  int rc = nn_send(state.s, &req, NN_MSG, 0);
+  if (rpc_batch_add(session_handle, req, s)) {
+    nn_freemsg(req);
+    return PI_STATUS_SUCCESS;
+  }
+
+  int rc = rpc_send_msg(req, s);
   if ((size_t)rc != s) return PI_STATUS_RPC_TRANSPORT_ERROR;
 
   return wait_for_status(req_id);
 }
 
-pi_status_t _pi_table_entries_fetch(pi_session_handle_t session_handle,
-                                    pi_dev_id_t dev_id, pi_p4_id_t table_id,
-                                    pi_table_fetch_res_t *res) {
-  if (!state.init) return PI_STATUS_RPC_NOT_INIT;
+// The whole batch is sent as a single request, and the server replies with the
+// status of each entry (followed by the entry handle for additions).
+static pi_status_t send_batch(pi_rpc_type_t type,
+                              pi_session_handle_t session_handle,
+                              pi_dev_tgt_t dev_tgt, pi_p4_id_t table_id,
+                              size_t num,
+                              const pi_match_key_t *const *match_keys,
+                              const pi_table_entry_t *table_entries,
+                              int overwrite, pi_rpc_id_t *req_id) {
+  pi_status_t status = rpc_batch_flush(session_handle);
+  if (status != PI_STATUS_SUCCESS) return status;
 
-  typedef struct __attribute__((packed)) {
-    req_hdr_t hdr;
-    s_pi_session_handle_t sess;
-    s_pi_dev_id_t dev_id;
-    s_pi_p4_id_t table_id;
-  } req_t;
-  req_t req;
-  char *req_ = (char *)&req;
-  pi_rpc_id_t req_id = state.req_id++;
-  req_ += emit_req_hdr(req_, req_id, PI_RPC_TABLE_ENTRIES_FETCH);
+  size_t s = 0;
+  s += sizeof(req_hdr_t);
+  s += sizeof(s_pi_session_handle_t);
+  s += sizeof(s_pi_dev_tgt_t);
+  s += sizeof(s_pi_p4_id_t);  // table_id
+  s += sizeof(uint32_t);      // num
+  s += sizeof(uint32_t);      // overwrite
+  for (size_t i = 0; i < num; i++) {
+    s += match_key_size(match_keys[i]);
+    if (table_entries) s += table_entry_size(&table_entries[i]);
+  }
+
+  char *req = nn_allocmsg(s, 0);
+  char *req_ = req;
+  *req_id = next_req_id();
+  req_ += emit_req_hdr(req_, *req_id, type);
   req_ += emit_session_handle(req_, session_handle);
-  req_ += emit_dev_id(req_, dev_id);
+  req_ += emit_dev_tgt(req_, dev_tgt);
   req_ += emit_p4_id(req_, table_id);
+  req_ += emit_uint32(req_, num);
+  req_ += emit_uint32(req_, overwrite);
+  for (size_t i = 0; i < num; i++) {
+    req_ += emit_match_key(req_, match_keys[i]);
+    if (table_entries) req_ += emit_table_entry(req_, &table_entries[i]);
+  }
 
-  int rc = nn_send(state.s, &req, sizeof(req), 0);
-  if (rc != sizeof(req)) return PI_STATUS_RPC_TRANSPORT_ERROR;
+  // make sure I have copied exactly the right amount
+  assert((size_t)(req_ - req) == s);
 
+  int rc = rpc_send_msg(req, s);
+  if ((size_t)rc != s) return PI_STATUS_RPC_TRANSPORT_ERROR;
+  return PI_STATUS_SUCCESS;
+}
+
+static pi_status_t wait_for_batch(pi_rpc_id_t req_id, size_t num,
+                                  pi_status_t *statuses,
+                                  pi_entry_handle_t *entry_handles) {
   char *rep = NULL;
-  int bytes = nn_recv(state.s, &rep, NN_MSG, 0);
+  int bytes = rpc_recv(req_id, &rep, NN_MSG);
   if (bytes <= 0) return PI_STATUS_RPC_TRANSPORT_ERROR;
 
   char *rep_ = rep;
   pi_status_t status = retrieve_rep_hdr(rep_, req_id);
   if (status != PI_STATUS_SUCCESS) {
-    nn_freemsg(rep);
+    rpc_free_rep(rep);
     return status;
   }
   rep_ += sizeof(rep_hdr_t);
 
+  size_t one_size = sizeof(s_pi_status_t);
+  if (entry_handles) one_size += sizeof(s_pi_entry_handle_t);
+  if ((size_t)bytes != sizeof(rep_hdr_t) + num * one_size) {
+    rpc_free_rep(rep);
+    return PI_STATUS_RPC_TRANSPORT_ERROR;
+  }
+  for (size_t i = 0; i < num; i++) {
+    rep_ += retrieve_status(rep_, &statuses[i]);
+    if (entry_handles) rep_ += retrieve_entry_handle(rep_, &entry_handles[i]);
+  }
+
+  rpc_free_rep(rep);
+  return PI_STATUS_SUCCESS;
+}
+
+pi_status_t _pi_table_entries_add_batch(pi_session_handle_t session_handle,
+                                        pi_dev_tgt_t dev_tgt,
+                                        pi_p4_id_t table_id, size_t num,
+                                        const pi_match_key_t *const *match_keys,
+                                        const pi_table_entry_t *table_entries,
+                                        int overwrite, pi_status_t *statuses,
+                                        pi_entry_handle_t *entry_handles) {
+  if (!state.init) return PI_STATUS_RPC_NOT_INIT;
+
+  pi_rpc_id_t req_id;
+  pi_status_t status = send_batch(PI_RPC_TABLE_ENTRIES_ADD_BATCH,
+                                  session_handle, dev_tgt, table_id, num,
+                                  match_keys, table_entries, overwrite,
+                                  &req_id);
+  if (status != PI_STATUS_SUCCESS) return status;
+  return wait_for_batch(req_id, num, statuses, entry_handles);
+}
+
+pi_status_t _pi_table_entries_modify_wkey_batch(
+    pi_session_handle_t session_handle, pi_dev_id_t dev_id, pi_p4_id_t table_id,
+    size_t num, const pi_match_key_t *const *match_keys,
+    const pi_table_entry_t *table_entries, pi_status_t *statuses) {
+  if (!state.init) return PI_STATUS_RPC_NOT_INIT;
+
+  pi_dev_tgt_t dev_tgt = {dev_id, 0xffff};
+  pi_rpc_id_t req_id;
+  pi_status_t status = send_batch(PI_RPC_TABLE_ENTRIES_MODIFY_WKEY_BATCH,
+                                  session_handle, dev_tgt, table_id, num,
+                                  match_keys, table_entries, 0, &req_id);
+  if (status != PI_STATUS_SUCCESS) return status;
+  return wait_for_batch(req_id, num, statuses, NULL);
+}
+
+pi_status_t _pi_table_entries_delete_wkey_batch(
+    pi_session_handle_t session_handle, pi_dev_id_t dev_id, pi_p4_id_t table_id,
+    size_t num, const pi_match_key_t *const *match_keys,
+    pi_status_t *statuses) {
+  if (!state.init) return PI_STATUS_RPC_NOT_INIT;
+
+  pi_dev_tgt_t dev_tgt = {dev_id, 0xffff};
+  pi_rpc_id_t req_id;
+  pi_status_t status = send_batch(PI_RPC_TABLE_ENTRIES_DELETE_WKEY_BATCH,
+                                  session_handle, dev_tgt, table_id, num,
+                                  match_keys, NULL, 0, &req_id);
+  if (status != PI_STATUS_SUCCESS) return status;
+  return wait_for_batch(req_id, num, statuses, NULL);
+}
+
+static pi_status_t wait_for_fetch_res(pi_rpc_id_t req_id,
+                                      pi_table_fetch_res_t *res) {
+  char *rep = NULL;
+  int bytes = rpc_recv(req_id, &rep, NN_MSG);
+  if (bytes <= 0) return PI_STATUS_RPC_TRANSPORT_ERROR;
+  if ((size_t)bytes < sizeof(rep_hdr_t)) {
+    rpc_free_rep(rep);
+    return PI_STATUS_RPC_TRANSPORT_ERROR;
+  }
+
+  char *rep_ = rep;
+  pi_status_t status = retrieve_rep_hdr(rep_, req_id);
+  if (status != PI_STATUS_SUCCESS) {
+    rpc_free_rep(rep);
+    return status;
+  }
+  // the reply is checked against the number of bytes received before being
+  // parsed, like in batch_send
+  if ((size_t)bytes < FETCH_REP_HDR_SIZE) {
+    rpc_free_rep(rep);
+    return PI_STATUS_RPC_TRANSPORT_ERROR;
+  }
+  rep_ += sizeof(rep_hdr_t);
+
   uint32_t tmp32;
   rep_ += retrieve_uint32(rep_, &tmp32);
   res->num_entries = tmp32;
@@ -338,17 +486,173 @@ pi_status_t _pi_table_entries_fetch(pi_session_handle_t session_handle,
   res->mkey_nbytes = tmp32;
   rep_ += retrieve_uint32(rep_, &tmp32);
   res->entries_size = tmp32;
+  assert((size_t)(rep_ - rep) == FETCH_REP_HDR_SIZE);
+  if (res->entries_size > (size_t)bytes - FETCH_REP_HDR_SIZE) {
+    rpc_free_rep(rep);
+    return PI_STATUS_RPC_TRANSPORT_ERROR;
+  }
 
-  res->entries = malloc(res->entries_size);
-  memcpy(res->entries, rep_, res->entries_size);
+  // the entries are kept in the reply message until
+  // _pi_table_entries_fetch_done, which is only copied if needed
+  rep = rpc_rep_detach(rep, bytes);
+  if (!rep) return PI_STATUS_ALLOC_ERROR;
+  res->entries = rep + FETCH_REP_HDR_SIZE;
 
-  nn_freemsg(rep);
   return status;
 }
 
+pi_status_t _pi_table_entries_fetch(pi_session_handle_t session_handle,
+                                    pi_dev_id_t dev_id, pi_p4_id_t table_id,
+                                    pi_table_fetch_res_t *res) {
+  if (!state.init) return PI_STATUS_RPC_NOT_INIT;
+
+  pi_status_t status = rpc_batch_flush(session_handle);
+  if (status != PI_STATUS_SUCCESS) return status;
+
+  typedef struct __attribute__((packed)) {
+    req_hdr_t hdr;
+    s_pi_session_handle_t sess;
+    s_pi_dev_id_t dev_id;
+    s_pi_p4_id_t table_id;
+  } req_t;
+  req_t req;
+  char *req_ = (char *)&req;
+  pi_rpc_id_t req_id = next_req_id();
+  req_ += emit_req_hdr(req_, req_id, PI_RPC_TABLE_ENTRIES_FETCH);
+  req_ += emit_session_handle(req_, session_handle);
+  req_ += emit_dev_id(req_, dev_id);
+  req_ += emit_p4_id(req_, table_id);
+
+  int rc = rpc_send(&req, sizeof(req));
+  if (rc != sizeof(req)) return PI_STATUS_RPC_TRANSPORT_ERROR;
+
+  return wait_for_fetch_res(req_id, res);
+}
+
+pi_status_t _pi_table_entries_fetch_wflags(pi_session_handle_t session_handle,
+                                           pi_dev_id_t dev_id,
+                                           pi_p4_id_t table_id, int flags,
+                                           pi_table_fetch_res_t *res) {
+  if (!state.init) return PI_STATUS_RPC_NOT_INIT;
+
+  pi_status_t status = rpc_batch_flush(session_handle);
+  if (status != PI_STATUS_SUCCESS) return status;
+
+  typedef struct __attribute__((packed)) {
+    req_hdr_t hdr;
+    s_pi_session_handle_t sess;
+    s_pi_dev_id_t dev_id;
+    s_pi_p4_id_t table_id;
+    uint32_t flags;
+  } req_t;
+  req_t req;
+  char *req_ = (char *)&req;
+  pi_rpc_id_t req_id = next_req_id();
+  req_ += emit_req_hdr(req_, req_id, PI_RPC_TABLE_ENTRIES_FETCH_WFLAGS);
+  req_ += emit_session_handle(req_, session_handle);
+  req_ += emit_dev_id(req_, dev_id);
+  req_ += emit_p4_id(req_, table_id);
+  req_ += emit_uint32(req_, flags);
+
+  int rc = rpc_send(&req, sizeof(req));
+  if (rc != sizeof(req)) return PI_STATUS_RPC_TRANSPORT_ERROR;
+
+  return wait_for_fetch_res(req_id, res);
+}
+
 pi_status_t _pi_table_entries_fetch_done(pi_session_handle_t session_handle,
                                          pi_table_fetch_res_t *res) {
   (void)session_handle;
-  free(res->entries);
+  rpc_free_detached_rep(res->entries - FETCH_REP_HDR_SIZE);
   return PI_STATUS_SUCCESS;
 }
+
+pi_status_t _pi_table_entries_fetch_begin(pi_session_handle_t session_handle,
+                                          pi_dev_id_t dev_id,
+                                          pi_p4_id_t table_id,
+                                          size_t max_entries, size_t max_bytes,
+                                          uint64_t *cursor_handle) {
+  if (!state.init) return PI_STATUS_RPC_NOT_INIT;
+
+  pi_status_t status = rpc_batch_flush(session_handle);
+  if (status != PI_STATUS_SUCCESS) return status;
+
+  typedef struct __attribute__((packed)) {
+    req_hdr_t hdr;
+    s_pi_session_handle_t sess;
+    s_pi_dev_id_t dev_id;
+    s_pi_p4_id_t table_id;
+    uint64_t max_entries;
+    uint64_t max_bytes;
+  } req_t;
+  req_t req;
+  char *req_ = (char *)&req;
+  pi_rpc_id_t req_id = next_req_id();
+  req_ += emit_req_hdr(req_, req_id, PI_RPC_TABLE_ENTRIES_FETCH_BEGIN);
+  req_ += emit_session_handle(req_, session_handle);
+  req_ += emit_dev_id(req_, dev_id);
+  req_ += emit_p4_id(req_, table_id);
+  req_ += emit_uint64(req_, max_entries);
+  req_ += emit_uint64(req_, max_bytes);
+
+  int rc = rpc_send(&req, sizeof(req));
+  if (rc != sizeof(req)) return PI_STATUS_RPC_TRANSPORT_ERROR;
+
+  typedef struct __attribute__((packed)) {
+    rep_hdr_t hdr;
+    uint64_t cursor_handle;
+  } rep_t;
+  rep_t rep;
+  rc = rpc_recv(req_id, &rep, sizeof(rep));
+  if (rc != sizeof(rep)) return PI_STATUS_RPC_TRANSPORT_ERROR;
+  status = retrieve_rep_hdr((char *)&rep, req_id);
+  retrieve_uint64((char *)&rep.cursor_handle, cursor_handle);
+  return status;
+}
+
+static pi_status_t send_cursor_req(pi_session_handle_t session_handle,
+                                   uint64_t cursor_handle, pi_rpc_type_t type,
+                                   pi_rpc_id_t *req_id) {
+  pi_status_t status = rpc_batch_flush(session_handle);
+  if (status != PI_STATUS_SUCCESS) return status;
+
+  typedef struct __attribute__((packed)) {
+    req_hdr_t hdr;
+    s_pi_session_handle_t sess;
+    uint64_t cursor_handle;
+  } req_t;
+  req_t req;
+  char *req_ = (char *)&req;
+  *req_id = next_req_id();
+  req_ += emit_req_hdr(req_, *req_id, type);
+  req_ += emit_session_handle(req_, session_handle);
+  req_ += emit_uint64(req_, cursor_handle);
+
+  int rc = rpc_send(&req, sizeof(req));
+  if (rc != sizeof(req)) return PI_STATUS_RPC_TRANSPORT_ERROR;
+  return PI_STATUS_SUCCESS;
+}
+
+pi_status_t _pi_table_entries_fetch_next_chunk(
+    pi_session_handle_t session_handle, uint64_t cursor_handle,
+    pi_table_fetch_res_t *res) {
+  if (!state.init) return PI_STATUS_RPC_NOT_INIT;
+
+  pi_rpc_id_t req_id;
+  pi_status_t status =
+      send_cursor_req(session_handle, cursor_handle,
+                      PI_RPC_TABLE_ENTRIES_FETCH_NEXT_CHUNK, &req_id);
+  if (status != PI_STATUS_SUCCESS) return status;
+  return wait_for_fetch_res(req_id, res);
+}
+
+pi_status_t _pi_table_entries_fetch_end(pi_session_handle_t session_handle,
+                                        uint64_t cursor_handle) {
+  if (!state.init) return PI_STATUS_RPC_NOT_INIT;
+
+  pi_rpc_id_t req_id;
+  pi_status_t status = send_cursor_req(session_handle, cursor_handle,
+                                       PI_RPC_TABLE_ENTRIES_FETCH_END, &req_id);
+  if (status != PI_STATUS_SUCCESS) return status;
+  return wait_for_status(req_id);
+}
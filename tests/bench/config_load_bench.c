@@ -0,0 +1,150 @@
+/* Copyright 2013-present Barefoot Networks, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Antonin Bas (antonin@barefootnetworks.com)
+ *
+ */
+
+// Times pi_add_config_from_file on synthetic bmv2 JSON configs of increasing
+// size. Objects are emitted in reverse alphabetical order, which is the worst
+// case for the name-based sorting done by the reader.
+// Usage: config_load_bench [num_objects]...
+
+#include "PI/p4info.h"
+#include "utils/logging.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#define NUM_HEADERS 64
+#define NUM_FIELDS_PER_HEADER 16
+// ids generated by the bmv2 reader are on 16 bits, for each resource type
+#define MAX_OBJECTS_PER_TYPE 60000
+
+static double now_ns() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void write_headers(FILE *f) {
+  fprintf(f, "\"header_types\":[{\"name\":\"h_t\",\"fields\":[");
+  for (int i = 0; i < NUM_FIELDS_PER_HEADER; i++)
+    fprintf(f, "%s[\"f%d\",%d]", (i == 0) ? "" : ",", i, 8 + i);
+  fprintf(f, "]}],\"headers\":[");
+  for (int i = 0; i < NUM_HEADERS; i++) {
+    fprintf(f, "%s{\"name\":\"h%d\",\"header_type\":\"h_t\"}",
+            (i == 0) ? "" : ",", i);
+  }
+  fprintf(f, "],");
+}
+
+static void write_stateful(FILE *f, const char *array_name, const char *prefix,
+                           size_t num, bool meters) {
+  fprintf(f, "\"%s\":[", array_name);
+  for (size_t i = num; i > 0; i--) {
+    fprintf(f, "%s{\"name\":\"%s%zu\",\"is_direct\":false,\"size\":1024%s}",
+            (i == num) ? "" : ",", prefix, i - 1,
+            meters ? ",\"type\":\"packets\"" : "");
+  }
+  fprintf(f, "]");
+}
+
+static void write_config(FILE *f, size_t num_objects) {
+  size_t num_actions = num_objects / 2;
+  size_t num_tables = num_objects / 4;
+  size_t num_counters = num_objects / 8;
+  size_t num_meters = num_objects - num_actions - num_tables - num_counters;
+
+  fprintf(f, "{\"__meta__\":{\"version\":[2,0]},");
+  write_headers(f);
+
+  fprintf(f, "\"actions\":[");
+  for (size_t i = num_actions; i > 0; i--) {
+    fprintf(f,
+            "%s{\"name\":\"a%zu\","
+            "\"runtime_data\":[{\"name\":\"p\",\"bitwidth\":32}]}",
+            (i == num_actions) ? "" : ",", i - 1);
+  }
+  fprintf(f, "],");
+
+  fprintf(f, "\"pipelines\":[{\"name\":\"ingress\",\"tables\":[");
+  for (size_t i = num_tables; i > 0; i--) {
+    size_t t = i - 1;
+    fprintf(f,
+            "%s{\"name\":\"t%zu\",\"type\":\"simple\",\"max_size\":1024,"
+            "\"key\":[",
+            (i == num_tables) ? "" : ",", t);
+    for (size_t j = 0; j < 2; j++) {
+      fprintf(f, "%s{\"match_type\":\"exact\",\"target\":[\"h%zu\",\"f%zu\"]}",
+              (j == 0) ? "" : ",", (t + j) % NUM_HEADERS,
+              (t + j) % NUM_FIELDS_PER_HEADER);
+    }
+    fprintf(f, "],\"actions\":[\"a%zu\",\"a%zu\"]}", (2 * t) % num_actions,
+            (2 * t + 1) % num_actions);
+  }
+  fprintf(f, "],\"action_profiles\":[]}],");
+
+  write_stateful(f, "counter_arrays", "c", num_counters, false);
+  fprintf(f, ",");
+  write_stateful(f, "meter_arrays", "m", num_meters, true);
+  fprintf(f, "}");
+}
+
+static int run(size_t num_objects) {
+  char path[] = "/tmp/pi_config_load_bench_XXXXXX";
+  int fd = mkstemp(path);
+  if (fd < 0) return 1;
+  FILE *f = fdopen(fd, "w");
+  write_config(f, num_objects);
+  fclose(f);
+
+  pi_p4info_t *p4info;
+  double start = now_ns();
+  pi_status_t status =
+      pi_add_config_from_file(path, PI_CONFIG_TYPE_BMV2_JSON, &p4info);
+  double end = now_ns();
+  unlink(path);
+  if (status != PI_STATUS_SUCCESS) {
+    fprintf(stderr, "Error when loading config with %zu objects\n",
+            num_objects);
+    return 1;
+  }
+  printf("%zu objects: %.2f ms\n", num_objects, (end - start) / 1e6);
+  pi_destroy_config(p4info);
+  return 0;
+}
+
+int main(int argc, char *argv[]) {
+  size_t default_sizes[] = {1000, 10000, 100000};
+  size_t num_sizes = (argc > 1) ? (size_t)(argc - 1)
+                                : sizeof(default_sizes) / sizeof(size_t);
+  pi_logs_off();
+  for (size_t i = 0; i < num_sizes; i++) {
+    size_t num_objects =
+        (argc > 1) ? strtoul(argv[i + 1], NULL, 0) : default_sizes[i];
+    if (num_objects < 8 || num_objects / 2 > MAX_OBJECTS_PER_TYPE) {
+      fprintf(stderr, "Usage: %s [num_objects in [8, %d]]...\n", argv[0],
+              2 * MAX_OBJECTS_PER_TYPE);
+      return 1;
+    }
+    if (run(num_objects)) return 1;
+  }
+  return 0;
+}
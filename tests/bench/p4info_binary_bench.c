@@ -0,0 +1,128 @@
+/* Copyright 2013-present Barefoot Networks, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Antonin Bas (antonin@barefootnetworks.com)
+ *
+ */
+
+// Compares the time it takes to load a p4info object from its native JSON
+// representation and from its binary representation.
+// Usage: p4info_binary_bench [num_tables] [num_iterations]
+
+#include "PI/int/pi_int.h"
+#include "PI/p4info.h"
+#include "p4info_int.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define NUM_MATCH_FIELDS 4
+#define NUM_ACTIONS_PER_TABLE 4
+#define NUM_PARAMS 4
+
+static double now_ns() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void build_p4info(pi_p4info_t *p4info, size_t num_tables) {
+  char name[32];
+  size_t num_actions = num_tables * NUM_ACTIONS_PER_TABLE;
+  pi_p4info_action_init(p4info, num_actions);
+  for (size_t i = 0; i < num_actions; i++) {
+    pi_p4_id_t a_id = pi_make_action_id(i);
+    snprintf(name, sizeof(name), "a%zu", i);
+    pi_p4info_action_add(p4info, a_id, name, NUM_PARAMS);
+    for (size_t j = 0; j < NUM_PARAMS; j++) {
+      snprintf(name, sizeof(name), "p%zu", j);
+      pi_p4info_action_add_param(p4info, a_id, j + 1, name, 9 + j);
+    }
+  }
+
+  pi_p4info_table_init(p4info, num_tables);
+  for (size_t i = 0; i < num_tables; i++) {
+    pi_p4_id_t t_id = pi_make_table_id(i);
+    snprintf(name, sizeof(name), "t%zu", i);
+    pi_p4info_table_add(p4info, t_id, name, NUM_MATCH_FIELDS,
+                        NUM_ACTIONS_PER_TABLE, 1024);
+    snprintf(name, sizeof(name), "@annotation%zu", i);
+    pi_p4info_add_annotation(p4info, t_id, name);
+    for (size_t j = 0; j < NUM_MATCH_FIELDS; j++) {
+      snprintf(name, sizeof(name), "f%zu", j);
+      pi_p4info_table_add_match_field(p4info, t_id, j + 1, name,
+                                      PI_P4INFO_MATCH_TYPE_EXACT, 32);
+    }
+    for (size_t j = 0; j < NUM_ACTIONS_PER_TABLE; j++) {
+      pi_p4info_table_add_action(
+          p4info, t_id, pi_make_action_id(i * NUM_ACTIONS_PER_TABLE + j));
+    }
+  }
+
+  pi_p4info_act_prof_init(p4info, 0);
+  pi_p4info_counter_init(p4info, 0);
+  pi_p4info_meter_init(p4info, 0);
+}
+
+// returns the average cost of loading the config in us
+static double run(const char *config, pi_config_type_t config_type,
+                  size_t num_iterations) {
+  double start = now_ns();
+  for (size_t i = 0; i < num_iterations; i++) {
+    pi_p4info_t *p4info;
+    if (pi_add_config(config, config_type, &p4info) != PI_STATUS_SUCCESS) {
+      fprintf(stderr, "Error when loading config\n");
+      exit(1);
+    }
+    pi_destroy_config(p4info);
+  }
+  double end = now_ns();
+  return (end - start) / num_iterations / 1000.;
+}
+
+int main(int argc, char *argv[]) {
+  size_t num_tables = (argc > 1) ? strtoul(argv[1], NULL, 0) : 4096;
+  size_t num_iterations = (argc > 2) ? strtoul(argv[2], NULL, 0) : 20;
+  if (num_tables == 0 || num_tables > 0x10000 / NUM_ACTIONS_PER_TABLE ||
+      num_iterations == 0) {
+    fprintf(stderr, "Usage: %s [num_tables <= 16384] [num_iterations]\n",
+            argv[0]);
+    return 1;
+  }
+
+  pi_p4info_t *p4info;
+  pi_add_config(NULL, PI_CONFIG_TYPE_NONE, &p4info);
+  build_p4info(p4info, num_tables);
+
+  char *json = pi_serialize_config(p4info, 0);
+  size_t binary_size;
+  char *binary = pi_serialize_config_binary(p4info, &binary_size);
+
+  double cost_json = run(json, PI_CONFIG_TYPE_NATIVE_JSON, num_iterations);
+  double cost_binary = run(binary, PI_CONFIG_TYPE_BINARY, num_iterations);
+
+  printf("%zu tables, %zu actions, %zu iterations\n", num_tables,
+         num_tables * NUM_ACTIONS_PER_TABLE, num_iterations);
+  printf("native JSON (%zu bytes): %.2f us / load\n", strlen(json), cost_json);
+  printf("binary (%zu bytes):      %.2f us / load\n", binary_size, cost_binary);
+
+  free(json);
+  free(binary);
+  pi_destroy_config(p4info);
+  return 0;
+}
@@ -0,0 +1,97 @@
+/* Copyright 2013-present Barefoot Networks, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Antonin Bas (antonin@barefootnetworks.com)
+ *
+ */
+
+// Compares the cost of the most common p4info queries before and after the
+// p4info object is frozen (Judy lookup vs dense array lookup).
+// Usage: p4info_lookup_bench [num_tables] [num_iterations]
+
+#include "PI/int/pi_int.h"
+#include "PI/p4info.h"
+#include "p4info_int.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define NUM_MATCH_FIELDS 8
+
+static double now_ns() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void build_p4info(pi_p4info_t *p4info, size_t num_tables) {
+  char name[32];
+  pi_p4info_table_init(p4info, num_tables);
+  for (size_t i = 0; i < num_tables; i++) {
+    pi_p4_id_t t_id = pi_make_table_id(i);
+    snprintf(name, sizeof(name), "t%zu", i);
+    pi_p4info_table_add(p4info, t_id, name, NUM_MATCH_FIELDS, 0, 1024);
+    for (size_t j = 0; j < NUM_MATCH_FIELDS; j++) {
+      snprintf(name, sizeof(name), "f%zu", j);
+      pi_p4info_table_add_match_field(p4info, t_id, j + 1, name,
+                                      PI_P4INFO_MATCH_TYPE_EXACT, 32);
+    }
+  }
+}
+
+// returns the average cost of one iteration (3 queries) in ns
+static double run(const pi_p4info_t *p4info, size_t num_tables,
+                  size_t num_iterations) {
+  size_t acc = 0;
+  double start = now_ns();
+  for (size_t i = 0; i < num_iterations; i++) {
+    pi_p4_id_t t_id = pi_make_table_id((i * 7919) % num_tables);
+    acc += pi_p4info_is_valid_id(p4info, t_id);
+    acc += (size_t)pi_p4info_table_name_from_id(p4info, t_id);
+    acc += pi_p4info_table_match_field_offset(p4info, t_id,
+                                              1 + i % NUM_MATCH_FIELDS);
+  }
+  double end = now_ns();
+  // prevent the compiler from optimizing away the loop
+  if (acc == 0) fprintf(stderr, "unexpected result\n");
+  return (end - start) / num_iterations;
+}
+
+int main(int argc, char *argv[]) {
+  size_t num_tables = (argc > 1) ? strtoul(argv[1], NULL, 0) : 4096;
+  size_t num_iterations = (argc > 2) ? strtoul(argv[2], NULL, 0) : 10000000;
+  if (num_tables == 0 || num_tables > 0x10000 || num_iterations == 0) {
+    fprintf(stderr, "Usage: %s [num_tables <= 65536] [num_iterations]\n",
+            argv[0]);
+    return 1;
+  }
+
+  pi_p4info_t *p4info;
+  pi_add_config(NULL, PI_CONFIG_TYPE_NONE, &p4info);
+  build_p4info(p4info, num_tables);
+
+  double cost_judy = run(p4info, num_tables, num_iterations);
+  pi_p4info_freeze(p4info);
+  double cost_dense = run(p4info, num_tables, num_iterations);
+
+  printf("%zu tables, %zu iterations\n", num_tables, num_iterations);
+  printf("Judy lookups:  %.2f ns / iteration\n", cost_judy);
+  printf("dense lookups: %.2f ns / iteration\n", cost_dense);
+
+  pi_destroy_config(p4info);
+  return 0;
+}
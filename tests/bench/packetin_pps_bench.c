@@ -0,0 +1,130 @@
+/* Copyright 2013-present Barefoot Networks, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Antonin Bas (antonin@barefootnetworks.com)
+ *
+ */
+
+// Measures the packet-in rate (in packets per second) of the notifications
+// publisher, as seen by a subscriber on the same host, with and without
+// batching. Packets are published back-to-back for a single device. PUB / SUB
+// drops messages when the subscriber cannot keep up, so the number of packets
+// received is reported as well.
+// Usage: packetin_pps_bench [max_packets_per_batch] [pkt_size] [num_packets]
+
+#include "PI/int/rpc_common.h"
+#include "PI/int/serialize.h"
+#include "pi_notifications_pub.h"
+
+#include <nanomsg/nn.h>
+#include <nanomsg/pubsub.h>
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define NOTIFICATIONS_ADDR "ipc:///tmp/pi_packetin_pps_bench.ipc"
+
+typedef struct {
+  int s;
+  size_t expected;
+  size_t num_received;
+  double last_ns;
+} subscriber_t;
+
+static double now_ns() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static size_t count_packets(const char *msg) {
+  if (!memcmp(msg, "PIPKT|", sizeof(s_pi_notifications_topic_t))) return 1;
+  if (!memcmp(msg, "PIPKB|", sizeof(s_pi_notifications_topic_t))) {
+    uint32_t num;
+    retrieve_uint32(msg + offsetof(s_pi_packetin_batch_hdr_t, num), &num);
+    return num;
+  }
+  return 0;
+}
+
+static void *subscriber_loop(void *arg) {
+  subscriber_t *sub = (subscriber_t *)arg;
+  while (sub->num_received < sub->expected) {
+    char *msg = NULL;
+    // times out when packets were dropped
+    if (nn_recv(sub->s, &msg, NN_MSG, 0) < 0) break;
+    sub->num_received += count_packets(msg);
+    sub->last_ns = now_ns();
+    nn_freemsg(msg);
+  }
+  return NULL;
+}
+
+int main(int argc, char *argv[]) {
+  size_t max_packets = (argc > 1) ? strtoul(argv[1], NULL, 0) : 64;
+  size_t pkt_size = (argc > 2) ? strtoul(argv[2], NULL, 0) : 128;
+  size_t num_packets = (argc > 3) ? strtoul(argv[3], NULL, 0) : 1000000;
+
+  pi_notifications_packetin_batch_config_t config = {max_packets, 0, 0};
+  pi_notifications_set_packetin_batching(&config);
+  if (pi_notifications_init(NOTIFICATIONS_ADDR) != PI_STATUS_SUCCESS) {
+    fprintf(stderr, "Cannot bind to %s\n", NOTIFICATIONS_ADDR);
+    return 1;
+  }
+
+  subscriber_t sub;
+  memset(&sub, 0, sizeof(sub));
+  sub.expected = num_packets;
+  sub.s = nn_socket(AF_SP, NN_SUB);
+  nn_setsockopt(sub.s, NN_SUB, NN_SUB_SUBSCRIBE, "", 0);
+  int rcv_timeout_ms = 1000;
+  nn_setsockopt(sub.s, NN_SOL_SOCKET, NN_RCVTIMEO, &rcv_timeout_ms,
+                sizeof(rcv_timeout_ms));
+  if (nn_connect(sub.s, NOTIFICATIONS_ADDR) < 0) {
+    fprintf(stderr, "Cannot connect to %s\n", NOTIFICATIONS_ADDR);
+    return 1;
+  }
+  // give the subscription time to reach the publisher
+  usleep(200000);
+
+  pthread_t thread;
+  pthread_create(&thread, NULL, subscriber_loop, &sub);
+
+  char *pkt = malloc(pkt_size);
+  memset(pkt, 0xab, pkt_size);
+  double start_ns = now_ns();
+  for (size_t i = 0; i < num_packets; i++)
+    pi_notifications_pub_packetin(0, pkt, pkt_size);
+  double publish_ns = now_ns() - start_ns;
+
+  pthread_join(thread, NULL);
+  double receive_ns = sub.last_ns - start_ns;
+
+  printf("max packets per batch: %zu, packet size: %zu\n", max_packets,
+         pkt_size);
+  printf("published: %zu packets at %.0f pps\n", num_packets,
+         num_packets / (publish_ns / 1e9));
+  printf("received: %zu packets at %.0f pps\n", sub.num_received,
+         (receive_ns > 0) ? sub.num_received / (receive_ns / 1e9) : 0.);
+
+  free(pkt);
+  nn_close(sub.s);
+  return 0;
+}
@@ -0,0 +1,147 @@
+/* Copyright 2013-present Barefoot Networks, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Antonin Bas (antonin@barefootnetworks.com)
+ *
+ */
+
+// Measures the request throughput of the RPC server (backed by the dummy
+// target) with several concurrent clients, each one using its own session.
+// Every client sends counter read requests back-to-back on its own REQ socket.
+// The server logs every request to stdout, so redirect it to /dev/null.
+// Usage: rpc_server_bench [num_workers] [num_clients] [num_requests]
+
+#include "PI/int/pi_int.h"
+#include "PI/int/rpc_common.h"
+#include "PI/int/serialize.h"
+#include "PI/pi.h"
+
+#include <nanomsg/nn.h>
+#include <nanomsg/reqrep.h>
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define RPC_ADDR "ipc:///tmp/pi_rpc_server_bench.ipc"
+
+extern pi_status_t pi_rpc_server_run_with_workers(
+    const pi_remote_addr_t *remote_addr, size_t num_workers);
+
+typedef struct {
+  pthread_t thread;
+  pi_session_handle_t session_handle;
+  size_t num_requests;
+  size_t num_errors;
+} client_t;
+
+static size_t num_workers = 4;
+
+static double now_ns() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void *server_loop(void *arg) {
+  (void)arg;
+  pi_remote_addr_t remote_addr = {RPC_ADDR, NULL};
+  pi_rpc_server_run_with_workers(&remote_addr, num_workers);
+  return NULL;
+}
+
+static void *client_loop(void *arg) {
+  client_t *client = (client_t *)arg;
+  int s = nn_socket(AF_SP, NN_REQ);
+  if (s < 0 || nn_connect(s, RPC_ADDR) < 0) {
+    client->num_errors = client->num_requests;
+    return NULL;
+  }
+
+  typedef struct __attribute__((packed)) {
+    req_hdr_t hdr;
+    s_pi_session_handle_t sess;
+    s_pi_dev_tgt_t dev_tgt;
+    s_pi_p4_id_t counter_id;
+    uint64_t h;
+    uint32_t flags;
+  } req_t;
+  typedef struct __attribute__((packed)) {
+    rep_hdr_t hdr;
+    s_pi_counter_data_t counter_data;
+  } rep_t;
+  pi_dev_tgt_t dev_tgt = {0, 0xffff};
+
+  for (size_t i = 0; i < client->num_requests; i++) {
+    req_t req;
+    char *req_ = (char *)&req;
+    req_ += emit_rpc_id(req_, i);
+    req_ += emit_rpc_type(req_, PI_RPC_COUNTER_READ);
+    req_ += emit_session_handle(req_, client->session_handle);
+    req_ += emit_dev_tgt(req_, dev_tgt);
+    req_ += emit_p4_id(req_, pi_make_counter_id(0));
+    req_ += emit_uint64(req_, i);
+    req_ += emit_uint32(req_, 0);
+    rep_t rep;
+    if (nn_send(s, &req, sizeof(req), 0) != sizeof(req) ||
+        nn_recv(s, &rep, sizeof(rep), 0) != sizeof(rep)) {
+      client->num_errors++;
+      continue;
+    }
+    pi_rpc_id_t rep_id;
+    retrieve_rpc_id((char *)&rep.hdr, &rep_id);
+    if (rep_id != i) client->num_errors++;
+  }
+
+  nn_close(s);
+  return NULL;
+}
+
+int main(int argc, char *argv[]) {
+  if (argc > 1) num_workers = strtoul(argv[1], NULL, 0);
+  size_t num_clients = (argc > 2) ? strtoul(argv[2], NULL, 0) : 8;
+  size_t num_requests = (argc > 3) ? strtoul(argv[3], NULL, 0) : 100000;
+
+  pi_init(256, NULL);
+  pthread_t server;
+  pthread_create(&server, NULL, server_loop, NULL);
+
+  client_t *clients = calloc(num_clients, sizeof(*clients));
+  double start = now_ns();
+  for (size_t i = 0; i < num_clients; i++) {
+    clients[i].session_handle = i;
+    clients[i].num_requests = num_requests;
+    pthread_create(&clients[i].thread, NULL, client_loop, &clients[i]);
+  }
+  size_t num_errors = 0;
+  for (size_t i = 0; i < num_clients; i++) {
+    pthread_join(clients[i].thread, NULL);
+    num_errors += clients[i].num_errors;
+  }
+  double elapsed_s = (now_ns() - start) / 1e9;
+
+  size_t total = num_clients * num_requests;
+  fprintf(stderr,
+          "%zu workers, %zu clients: %zu requests in %.2fs (%.0f req/s), "
+          "%zu errors\n",
+          num_workers, num_clients, total, elapsed_s, total / elapsed_s,
+          num_errors);
+
+  free(clients);
+  // the server thread never returns
+  return (num_errors == 0) ? 0 : 1;
+}
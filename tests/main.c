@@ -28,6 +28,10 @@ extern void test_bmv2_json_reader();
 extern void test_getnetv();
 extern void test_p4info();
 extern void test_frontends_generic();
+extern void test_pi_tables();
+extern void test_pi_counters();
+extern void test_rpc();
+extern void test_shm_transport();
 
 static void run() {
 #ifdef TEST_BMV2_JSON_READER
@@ -42,6 +46,18 @@ static void run() {
 #ifdef TEST_FRONTENDS_GENERIC
   test_frontends_generic();
 #endif
+#ifdef TEST_PI_TABLES
+  test_pi_tables();
+#endif
+#ifdef TEST_PI_COUNTERS
+  test_pi_counters();
+#endif
+#ifdef TEST_RPC
+  test_rpc();
+#endif
+#ifdef TEST_SHM_TRANSPORT
+  test_shm_transport();
+#endif
 }
 
 int main(int argc, const char *argv[]) {
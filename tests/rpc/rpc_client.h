@@ -0,0 +1,84 @@
+/* Copyright 2013-present Barefoot Networks, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Antonin Bas (antonin@barefootnetworks.com)
+ *
+ */
+
+// The RPC tests run the RPC client (targets/rpc), the RPC server and the dummy
+// target in the same process. This header is force-included when compiling the
+// RPC client for the tests, and renames its target functions so that they do
+// not clash with the dummy target's. The tests include it before the PI target
+// headers to call the client functions directly.
+
+#ifndef PI_TESTS_RPC_RPC_CLIENT_H_
+#define PI_TESTS_RPC_RPC_CLIENT_H_
+
+#define _pi_act_prof_entries_fetch rpc_client_pi_act_prof_entries_fetch
+#define _pi_act_prof_entries_fetch_done \
+  rpc_client_pi_act_prof_entries_fetch_done
+#define _pi_act_prof_grp_add_mbr rpc_client_pi_act_prof_grp_add_mbr
+#define _pi_act_prof_grp_create rpc_client_pi_act_prof_grp_create
+#define _pi_act_prof_grp_delete rpc_client_pi_act_prof_grp_delete
+#define _pi_act_prof_grp_remove_mbr rpc_client_pi_act_prof_grp_remove_mbr
+#define _pi_act_prof_mbr_create rpc_client_pi_act_prof_mbr_create
+#define _pi_act_prof_mbr_delete rpc_client_pi_act_prof_mbr_delete
+#define _pi_act_prof_mbr_modify rpc_client_pi_act_prof_mbr_modify
+#define _pi_assign_device rpc_client_pi_assign_device
+#define _pi_batch_begin rpc_client_pi_batch_begin
+#define _pi_batch_end rpc_client_pi_batch_end
+#define _pi_counter_hw_sync rpc_client_pi_counter_hw_sync
+#define _pi_counter_read rpc_client_pi_counter_read
+#define _pi_counter_read_direct rpc_client_pi_counter_read_direct
+#define _pi_counter_read_range rpc_client_pi_counter_read_range
+#define _pi_counter_write rpc_client_pi_counter_write
+#define _pi_counter_write_direct rpc_client_pi_counter_write_direct
+#define _pi_destroy rpc_client_pi_destroy
+#define _pi_init rpc_client_pi_init
+#define _pi_learn_msg_ack rpc_client_pi_learn_msg_ack
+#define _pi_learn_msg_done rpc_client_pi_learn_msg_done
+#define _pi_meter_read rpc_client_pi_meter_read
+#define _pi_meter_read_direct rpc_client_pi_meter_read_direct
+#define _pi_meter_set rpc_client_pi_meter_set
+#define _pi_meter_set_direct rpc_client_pi_meter_set_direct
+#define _pi_packetout_send rpc_client_pi_packetout_send
+#define _pi_remove_device rpc_client_pi_remove_device
+#define _pi_session_cleanup rpc_client_pi_session_cleanup
+#define _pi_session_init rpc_client_pi_session_init
+#define _pi_table_default_action_done rpc_client_pi_table_default_action_done
+#define _pi_table_default_action_get rpc_client_pi_table_default_action_get
+#define _pi_table_default_action_set rpc_client_pi_table_default_action_set
+#define _pi_table_entries_add_batch rpc_client_pi_table_entries_add_batch
+#define _pi_table_entries_delete_wkey_batch \
+  rpc_client_pi_table_entries_delete_wkey_batch
+#define _pi_table_entries_fetch rpc_client_pi_table_entries_fetch
+#define _pi_table_entries_fetch_begin rpc_client_pi_table_entries_fetch_begin
+#define _pi_table_entries_fetch_done rpc_client_pi_table_entries_fetch_done
+#define _pi_table_entries_fetch_end rpc_client_pi_table_entries_fetch_end
+#define _pi_table_entries_fetch_next_chunk \
+  rpc_client_pi_table_entries_fetch_next_chunk
+#define _pi_table_entries_fetch_wflags rpc_client_pi_table_entries_fetch_wflags
+#define _pi_table_entries_modify_wkey_batch \
+  rpc_client_pi_table_entries_modify_wkey_batch
+#define _pi_table_entry_add rpc_client_pi_table_entry_add
+#define _pi_table_entry_delete rpc_client_pi_table_entry_delete
+#define _pi_table_entry_delete_wkey rpc_client_pi_table_entry_delete_wkey
+#define _pi_table_entry_modify rpc_client_pi_table_entry_modify
+#define _pi_table_entry_modify_wkey rpc_client_pi_table_entry_modify_wkey
+#define _pi_update_device_end rpc_client_pi_update_device_end
+#define _pi_update_device_start rpc_client_pi_update_device_start
+
+#endif  // PI_TESTS_RPC_RPC_CLIENT_H_
@@ -20,6 +20,7 @@
 
 #include "PI/int/pi_int.h"
 #include "PI/p4info.h"
+#include "p4info/p4info_binary.h"
 #include "p4info_int.h"
 #include "read_file.h"
 
@@ -28,7 +29,9 @@
 #include "unity/unity_fixture.h"
 
 #include <Judy.h>
+#include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 
 #define DEFAULT_TABLE_SIZE 1024
 
@@ -154,6 +157,9 @@ TEST(P4Info, ActionsStress) {
   }
 
   for (size_t i = 0; i < num_actions; i++) {
+    const pi_p4info_action_data_layout_t *layout =
+        pi_p4info_action_data_layout(p4info, adata[i].id);
+    TEST_ASSERT_EQUAL_UINT(adata[i].num_params, layout->num_params);
     size_t offset = 0;
     for (size_t j = 0; j < adata[i].num_params; j++) {
       snprintf(name, sizeof(name), "a%zu_p%zu", i, j);
@@ -170,10 +176,14 @@ TEST(P4Info, ActionsStress) {
 
       TEST_ASSERT_EQUAL_UINT(
           offset, pi_p4info_action_param_offset(p4info, adata[i].id, p_id));
+      size_t index = pi_p4info_action_data_layout_index(layout, p_id);
+      TEST_ASSERT_EQUAL_UINT(offset, layout->params[index].offset);
+      TEST_ASSERT_EQUAL_UINT(j, layout->params[index].bitwidth);
       offset += (j + 7) / 8;
     }
     TEST_ASSERT_EQUAL_UINT(offset,
                            pi_p4info_action_data_size(p4info, adata[i].id));
+    TEST_ASSERT_EQUAL_UINT(offset, layout->action_data_size);
   }
 
   for (size_t i = 0; i < num_actions; i++) {
@@ -326,10 +336,16 @@ TEST(P4Info, TablesStress) {
     TEST_ASSERT_EQUAL_UINT((size_t)-1,
                            pi_p4info_table_match_field_index(
                                p4info, tdata[i].id, tdata[i].num_match_fields));
+    const pi_p4info_match_key_layout_t *layout =
+        pi_p4info_table_match_key_layout(p4info, tdata[i].id);
+    TEST_ASSERT_EQUAL_UINT(tdata[i].num_match_fields, layout->num_fields);
     size_t offset = 0;
     for (size_t j = 0; j < tdata[i].num_match_fields; j++) {
       const pi_p4info_match_field_info_t *finfo =
           pi_p4info_table_match_field_info(p4info, tdata[i].id, j);
+      TEST_ASSERT_EQUAL_UINT(
+          j, pi_p4info_match_key_layout_index(layout, finfo->mf_id));
+      TEST_ASSERT_EQUAL_UINT(offset, layout->fields[j].offset);
       TEST_ASSERT_EQUAL_UINT(tdata[i].match_fields[j], finfo->mf_id);
       TEST_ASSERT_EQUAL_STRING(
           pi_p4info_table_match_field_name_from_id(p4info, tdata[i].id,
@@ -346,6 +362,7 @@ TEST(P4Info, TablesStress) {
     }
     TEST_ASSERT_EQUAL_UINT(offset,
                            pi_p4info_table_match_key_size(p4info, tdata[i].id));
+    TEST_ASSERT_EQUAL_UINT(offset, layout->match_key_size);
 
     TEST_ASSERT_EQUAL_UINT(tdata[i].num_actions,
                            pi_p4info_table_num_actions(p4info, tdata[i].id));
@@ -430,6 +447,77 @@ TEST(P4Info, Serialize) {
   free(config);
 }
 
+TEST(P4Info, SerializeBinary) {
+  pi_p4info_t *p4info_json;
+  char *config = read_file(TESTDATADIR
+                           "/"
+                           "simple_router.json");
+  TEST_ASSERT_EQUAL(
+      PI_STATUS_SUCCESS,
+      pi_add_config(config, PI_CONFIG_TYPE_BMV2_JSON, &p4info_json));
+  pi_p4_id_t t_id = pi_p4info_table_begin(p4info_json);
+  pi_p4info_add_annotation(p4info_json, t_id, "@my_annotation");
+  pi_p4info_add_alias(p4info_json, t_id, "my_alias");
+
+  size_t size;
+  char *blob = pi_serialize_config_binary(p4info_json, &size);
+  TEST_ASSERT_NOT_NULL(blob);
+  TEST_ASSERT_EQUAL_UINT(size, pi_config_binary_size(blob));
+
+  pi_p4info_t *p4info_bin;
+  TEST_ASSERT_EQUAL(PI_STATUS_SUCCESS,
+                    pi_add_config(blob, PI_CONFIG_TYPE_BINARY, &p4info_bin));
+  TEST_ASSERT_EQUAL_UINT(t_id,
+                         pi_p4info_table_id_from_name(p4info_bin, "my_alias"));
+  TEST_ASSERT_EQUAL_UINT(pi_p4info_action_get_num(p4info_json),
+                         pi_p4info_action_get_num(p4info_bin));
+  TEST_ASSERT_EQUAL_UINT(pi_p4info_any_num(p4info_json, PI_TABLE_ID),
+                         pi_p4info_any_num(p4info_bin, PI_TABLE_ID));
+
+  // objects are always serialized in id order, so the binary representation of
+  // a given p4info is canonical
+  size_t size_new;
+  char *blob_new = pi_serialize_config_binary(p4info_bin, &size_new);
+  TEST_ASSERT_EQUAL_UINT(size, size_new);
+  TEST_ASSERT_EQUAL_MEMORY(blob, blob_new, size);
+  TEST_ASSERT_EQUAL(PI_STATUS_SUCCESS, pi_destroy_config(p4info_bin));
+
+  // round trip through a file
+  char path[] = "/tmp/pi_p4info_XXXXXX";
+  int fd = mkstemp(path);
+  TEST_ASSERT_TRUE(fd >= 0);
+  close(fd);
+  TEST_ASSERT_EQUAL_INT((int)size,
+                        pi_serialize_config_binary_to_file(p4info_json, path));
+  TEST_ASSERT_EQUAL(PI_STATUS_SUCCESS,
+                    pi_add_config_from_file(path, PI_CONFIG_TYPE_BINARY,
+                                            &p4info_bin));
+  free(blob_new);
+  blob_new = pi_serialize_config_binary(p4info_bin, &size_new);
+  TEST_ASSERT_EQUAL_MEMORY(blob, blob_new, size);
+  TEST_ASSERT_EQUAL(PI_STATUS_SUCCESS, pi_destroy_config(p4info_bin));
+  // truncated file
+  TEST_ASSERT_EQUAL_INT(0, truncate(path, size - 1));
+  TEST_ASSERT_NOT_EQUAL(
+      PI_STATUS_SUCCESS,
+      pi_add_config_from_file(path, PI_CONFIG_TYPE_BINARY, &p4info_bin));
+  unlink(path);
+
+  // corrupted blobs are rejected
+  pi_bin_header_t *header = (pi_bin_header_t *)blob;
+  header->sections[PI_BIN_SECTION_TABLES].count += 1000;
+  TEST_ASSERT_NOT_EQUAL(
+      PI_STATUS_SUCCESS,
+      pi_add_config(blob, PI_CONFIG_TYPE_BINARY, &p4info_bin));
+  header->magic = 0;
+  TEST_ASSERT_EQUAL_UINT(0, pi_config_binary_size(blob));
+
+  TEST_ASSERT_EQUAL(PI_STATUS_SUCCESS, pi_destroy_config(p4info_json));
+  free(blob);
+  free(blob_new);
+  free(config);
+}
+
 static void add_one_of_each() {
   pi_p4info_action_init(p4info, 1);
   pi_p4info_table_init(p4info, 1);
@@ -447,6 +535,152 @@ static void add_one_of_each() {
                       PI_P4INFO_METER_TYPE_COLOR_UNAWARE, 128);
 }
 
+// returns a copy of the blob, so that each corruption can be tested separately
+static char *copy_blob(const char *blob, size_t size) {
+  char *copy = malloc(size);
+  memcpy(copy, blob, size);
+  return copy;
+}
+
+static void *get_section(char *blob, pi_bin_section_id_t section) {
+  pi_bin_header_t *header = (pi_bin_header_t *)blob;
+  return blob + header->sections[section].offset;
+}
+
+static void check_rejected(char *blob) {
+  pi_p4info_t *p4info_bin;
+  TEST_ASSERT_NOT_EQUAL(
+      PI_STATUS_SUCCESS,
+      pi_add_config(blob, PI_CONFIG_TYPE_BINARY, &p4info_bin));
+  free(blob);
+}
+
+TEST(P4Info, SerializeBinaryValidation) {
+  pi_p4info_action_init(p4info, 1);
+  pi_p4info_table_init(p4info, 2);
+  pi_p4info_act_prof_init(p4info, 0);
+  pi_p4info_counter_init(p4info, 2);
+  pi_p4info_meter_init(p4info, 1);
+
+  pi_p4_id_t a_id = pi_make_action_id(0);
+  pi_p4info_action_add(p4info, a_id, "action0", 2);
+  pi_p4info_action_add_param(p4info, a_id, 1, "p1", 16);
+  pi_p4info_action_add_param(p4info, a_id, 2, "p2", 9);
+  pi_p4info_table_add(p4info, pi_make_table_id(0), "table0", 0, 0, 128);
+  pi_p4_id_t t_id = pi_make_table_id(1);
+  pi_p4info_table_add(p4info, t_id, "table1", 2, 1, 128);
+  pi_p4info_table_add_match_field(p4info, t_id, 1, "f",
+                                  PI_P4INFO_MATCH_TYPE_LPM, 32);
+  pi_p4info_table_add_match_field(p4info, t_id, 2, "g",
+                                  PI_P4INFO_MATCH_TYPE_EXACT, 8);
+  pi_p4info_table_add_action(p4info, t_id, a_id);
+  pi_p4info_counter_add(p4info, pi_make_counter_id(0), "counter0",
+                        PI_P4INFO_COUNTER_UNIT_BOTH, 128);
+  pi_p4_id_t direct_c_id = pi_make_counter_id(1);
+  pi_p4info_counter_add(p4info, direct_c_id, "counter1",
+                        PI_P4INFO_COUNTER_UNIT_PACKETS, 128);
+  pi_p4info_counter_make_direct(p4info, direct_c_id, t_id);
+  pi_p4info_table_add_direct_resource(p4info, t_id, direct_c_id);
+  pi_p4info_meter_add(p4info, pi_make_meter_id(0), "meter0",
+                      PI_P4INFO_METER_UNIT_PACKETS,
+                      PI_P4INFO_METER_TYPE_COLOR_UNAWARE, 128);
+
+  size_t size;
+  char *blob = pi_serialize_config_binary(p4info, &size);
+  TEST_ASSERT_NOT_NULL(blob);
+
+  // the blob can be freed by the caller as soon as the p4info is loaded, since
+  // the p4info keeps its own copy, which names are borrowed from
+  char *copy = copy_blob(blob, size);
+  pi_p4info_t *p4info_bin;
+  TEST_ASSERT_EQUAL(PI_STATUS_SUCCESS,
+                    pi_add_config(copy, PI_CONFIG_TYPE_BINARY, &p4info_bin));
+  memset(copy, 0, size);
+  free(copy);
+  TEST_ASSERT_EQUAL_STRING("table1", pi_p4info_table_name_from_id(p4info_bin,
+                                                                  t_id));
+  TEST_ASSERT_EQUAL_UINT(t_id, pi_p4info_counter_get_direct(p4info_bin,
+                                                            direct_c_id));
+  TEST_ASSERT_EQUAL(PI_STATUS_SUCCESS, pi_destroy_config(p4info_bin));
+
+  pi_bin_header_t *header = (pi_bin_header_t *)blob;
+  TEST_ASSERT_EQUAL_UINT(2, header->sections[PI_BIN_SECTION_TABLES].count);
+  TEST_ASSERT_EQUAL_UINT(2, header->sections[PI_BIN_SECTION_COUNTERS].count);
+
+  // id of the wrong resource type
+  copy = copy_blob(blob, size);
+  ((pi_bin_action_t *)get_section(copy, PI_BIN_SECTION_ACTIONS))[0].id =
+      pi_make_table_id(2);
+  check_rejected(copy);
+
+  // duplicate ids
+  copy = copy_blob(blob, size);
+  {
+    pi_bin_table_t *tables = get_section(copy, PI_BIN_SECTION_TABLES);
+    tables[1].id = tables[0].id;
+  }
+  check_rejected(copy);
+
+  // out-of-range match type
+  copy = copy_blob(blob, size);
+  ((pi_bin_match_field_t *)get_section(copy, PI_BIN_SECTION_MATCH_FIELDS))[0]
+      .match_type = PI_P4INFO_MATCH_TYPE_END;
+  check_rejected(copy);
+
+  // duplicate match field ids
+  copy = copy_blob(blob, size);
+  {
+    pi_bin_match_field_t *mfs = get_section(copy, PI_BIN_SECTION_MATCH_FIELDS);
+    mfs[1].id = mfs[0].id;
+  }
+  check_rejected(copy);
+
+  // duplicate action parameter ids
+  copy = copy_blob(blob, size);
+  {
+    pi_bin_param_t *params = get_section(copy, PI_BIN_SECTION_PARAMS);
+    params[1].id = params[0].id;
+  }
+  check_rejected(copy);
+
+  // invalid bitwidths
+  copy = copy_blob(blob, size);
+  ((pi_bin_match_field_t *)get_section(copy, PI_BIN_SECTION_MATCH_FIELDS))[0]
+      .bitwidth = 0;
+  check_rejected(copy);
+  copy = copy_blob(blob, size);
+  ((pi_bin_match_field_t *)get_section(copy, PI_BIN_SECTION_MATCH_FIELDS))[1]
+      .bitwidth = UINT32_MAX;
+  check_rejected(copy);
+  copy = copy_blob(blob, size);
+  ((pi_bin_param_t *)get_section(copy, PI_BIN_SECTION_PARAMS))[0].bitwidth = 0;
+  check_rejected(copy);
+
+  // out-of-range counter unit
+  copy = copy_blob(blob, size);
+  ((pi_bin_counter_t *)get_section(copy, PI_BIN_SECTION_COUNTERS))[0]
+      .counter_unit = PI_P4INFO_COUNTER_UNIT_BOTH + 1;
+  check_rejected(copy);
+
+  // out-of-range meter type
+  copy = copy_blob(blob, size);
+  ((pi_bin_meter_t *)get_section(copy, PI_BIN_SECTION_METERS))[0].meter_type =
+      0;
+  check_rejected(copy);
+
+  // direct counter referencing a table which does not exist
+  copy = copy_blob(blob, size);
+  ((pi_bin_counter_t *)get_section(copy, PI_BIN_SECTION_COUNTERS))[1]
+      .direct_table = pi_make_table_id(2);
+  check_rejected(copy);
+
+  // the unmodified blob is still accepted
+  TEST_ASSERT_EQUAL(PI_STATUS_SUCCESS,
+                    pi_add_config(blob, PI_CONFIG_TYPE_BINARY, &p4info_bin));
+  TEST_ASSERT_EQUAL(PI_STATUS_SUCCESS, pi_destroy_config(p4info_bin));
+  free(blob);
+}
+
 TEST(P4Info, Generic) {
   add_one_of_each();
 
@@ -476,6 +710,161 @@ TEST(P4Info, Generic) {
   }
 }
 
+TEST(P4Info, CounterWidth) {
+  pi_p4_id_t c0 = pi_make_counter_id(0), c1 = pi_make_counter_id(1);
+  pi_p4info_action_init(p4info, 0);
+  pi_p4info_table_init(p4info, 0);
+  pi_p4info_act_prof_init(p4info, 0);
+  pi_p4info_counter_init(p4info, 2);
+  pi_p4info_meter_init(p4info, 0);
+  pi_p4info_counter_add(p4info, c0, "c0", PI_P4INFO_COUNTER_UNIT_BOTH, 128);
+  pi_p4info_counter_add(p4info, c1, "c1", PI_P4INFO_COUNTER_UNIT_BOTH, 128);
+  pi_p4info_counter_set_width(p4info, c1, 36);
+  TEST_ASSERT_EQUAL_UINT(PI_P4INFO_COUNTER_MAX_WIDTH,
+                         pi_p4info_counter_get_width(p4info, c0));
+  TEST_ASSERT_EQUAL_UINT(36, pi_p4info_counter_get_width(p4info, c1));
+
+  // the width survives both serialization formats
+  char *dump = pi_serialize_config(p4info, 0);
+  pi_p4info_t *p4info_json;
+  TEST_ASSERT_EQUAL(PI_STATUS_SUCCESS,
+                    pi_add_config(dump, PI_CONFIG_TYPE_NATIVE_JSON,
+                                  &p4info_json));
+  TEST_ASSERT_EQUAL_UINT(36, pi_p4info_counter_get_width(p4info_json, c1));
+  TEST_ASSERT_TRUE(pi_p4info_object_equal(p4info, p4info_json, c1));
+
+  size_t size;
+  char *blob = pi_serialize_config_binary(p4info, &size);
+  pi_p4info_t *p4info_bin;
+  TEST_ASSERT_EQUAL(PI_STATUS_SUCCESS,
+                    pi_add_config(blob, PI_CONFIG_TYPE_BINARY, &p4info_bin));
+  TEST_ASSERT_EQUAL_UINT(PI_P4INFO_COUNTER_MAX_WIDTH,
+                         pi_p4info_counter_get_width(p4info_bin, c0));
+  TEST_ASSERT_EQUAL_UINT(36, pi_p4info_counter_get_width(p4info_bin, c1));
+
+  pi_p4info_counter_set_width(p4info_bin, c1, 32);
+  TEST_ASSERT_FALSE(pi_p4info_object_equal(p4info, p4info_bin, c1));
+
+  TEST_ASSERT_EQUAL(PI_STATUS_SUCCESS, pi_destroy_config(p4info_json));
+  TEST_ASSERT_EQUAL(PI_STATUS_SUCCESS, pi_destroy_config(p4info_bin));
+  free(dump);
+  free(blob);
+}
+
+// a0 is used by t0 and a1 by t1, which is implemented by ap0 and has a direct
+// counter c0
+static void add_object_equal_config(pi_p4info_t *p4info, size_t a0_bitwidth) {
+  pi_p4_id_t a0 = pi_make_action_id(0), a1 = pi_make_action_id(1);
+  pi_p4_id_t t0 = pi_make_table_id(0), t1 = pi_make_table_id(1);
+  pi_p4_id_t ap0 = pi_make_act_prof_id(0);
+  pi_p4_id_t c0 = pi_make_counter_id(0);
+  pi_p4info_action_init(p4info, 2);
+  pi_p4info_table_init(p4info, 2);
+  pi_p4info_act_prof_init(p4info, 1);
+  pi_p4info_counter_init(p4info, 1);
+
+  pi_p4info_action_add(p4info, a0, "a0", 1);
+  pi_p4info_action_add_param(p4info, a0, 0, "p", a0_bitwidth);
+  pi_p4info_action_add(p4info, a1, "a1", 1);
+  pi_p4info_action_add_param(p4info, a1, 0, "p", 8);
+
+  pi_p4info_table_add(p4info, t0, "t0", 1, 1, 128);
+  pi_p4info_table_add_match_field(p4info, t0, 0, "f0",
+                                  PI_P4INFO_MATCH_TYPE_EXACT, 32);
+  pi_p4info_table_add_action(p4info, t0, a0);
+  pi_p4info_table_add(p4info, t1, "t1", 1, 1, 128);
+  pi_p4info_table_add_match_field(p4info, t1, 1, "f1",
+                                  PI_P4INFO_MATCH_TYPE_LPM, 32);
+  pi_p4info_table_add_action(p4info, t1, a1);
+  pi_p4info_table_set_implementation(p4info, t1, ap0);
+  pi_p4info_table_add_direct_resource(p4info, t1, c0);
+
+  pi_p4info_act_prof_add(p4info, ap0, "ap0", false, 8);
+  pi_p4info_act_prof_add_table(p4info, ap0, t1);
+  pi_p4info_counter_add(p4info, c0, "c0", PI_P4INFO_COUNTER_UNIT_BOTH, 128);
+  pi_p4info_counter_make_direct(p4info, c0, t1);
+}
+
+TEST(P4Info, ObjectEqual) {
+  pi_p4info_t *p4info_same, *p4info_diff;
+  pi_empty_config(&p4info_same);
+  pi_empty_config(&p4info_diff);
+  add_object_equal_config(p4info, 16);
+  add_object_equal_config(p4info_same, 16);
+  add_object_equal_config(p4info_diff, 32);
+  // aliases are ignored
+  pi_p4info_add_alias(p4info_same, pi_make_table_id(0), "alias");
+
+  pi_p4_id_t ids[] = {pi_make_action_id(0), pi_make_action_id(1),
+                      pi_make_table_id(0), pi_make_table_id(1),
+                      pi_make_act_prof_id(0), pi_make_counter_id(0)};
+  // only a0 and t0 are impacted by the change in a0's parameter
+  bool diff_equal[] = {false, true, false, true, true, true};
+  size_t num_ids = sizeof(ids) / sizeof(ids[0]);
+  for (size_t i = 0; i < num_ids; i++) {
+    TEST_ASSERT_TRUE(pi_p4info_object_equal(p4info, p4info, ids[i]));
+    TEST_ASSERT_TRUE(pi_p4info_object_equal(p4info, p4info_same, ids[i]));
+    TEST_ASSERT_EQUAL_INT(diff_equal[i],
+                          pi_p4info_object_equal(p4info, p4info_diff, ids[i]));
+  }
+
+  // ids which do not exist in one of the p4info objects
+  TEST_ASSERT_FALSE(
+      pi_p4info_object_equal(p4info, p4info_same, pi_make_table_id(2)));
+  TEST_ASSERT_FALSE(
+      pi_p4info_object_equal(p4info, p4info_same, pi_make_meter_id(0)));
+
+  pi_destroy_config(p4info_same);
+  pi_destroy_config(p4info_diff);
+}
+
+TEST(P4Info, Freeze) {
+  // actions use a dense id space, counters use a sparse one (one id every 4096)
+  const size_t num_actions = 1024;
+  const size_t num_counters = 8;
+  pi_p4info_action_init(p4info, num_actions + 1);
+  pi_p4info_counter_init(p4info, num_counters);
+
+  char name[16];
+  for (size_t i = 0; i < num_actions; i++) {
+    snprintf(name, sizeof(name), "a%zu", i);
+    pi_p4info_action_add(p4info, pi_make_action_id(i), name, 0);
+  }
+  for (size_t i = 0; i < num_counters; i++) {
+    snprintf(name, sizeof(name), "c%zu", i);
+    pi_p4info_counter_add(p4info, pi_make_counter_id(i * 4096), name,
+                          PI_P4INFO_COUNTER_UNIT_BOTH, 128);
+  }
+
+  pi_p4info_freeze(p4info);
+
+  for (size_t i = 0; i < num_actions; i++) {
+    snprintf(name, sizeof(name), "a%zu", i);
+    pi_p4_id_t id = pi_make_action_id(i);
+    TEST_ASSERT_TRUE(pi_p4info_is_valid_id(p4info, id));
+    TEST_ASSERT_EQUAL_STRING(name, pi_p4info_action_name_from_id(p4info, id));
+  }
+  TEST_ASSERT_FALSE(
+      pi_p4info_is_valid_id(p4info, pi_make_action_id(num_actions)));
+
+  for (size_t i = 0; i < num_counters; i++) {
+    snprintf(name, sizeof(name), "c%zu", i);
+    pi_p4_id_t id = pi_make_counter_id(i * 4096);
+    TEST_ASSERT_TRUE(pi_p4info_is_valid_id(p4info, id));
+    TEST_ASSERT_FALSE(pi_p4info_is_valid_id(p4info, id + 1));
+    TEST_ASSERT_EQUAL_STRING(name, pi_p4info_counter_name_from_id(p4info, id));
+  }
+
+  // adding a resource to a frozen p4info is still supported
+  pi_p4_id_t new_id = pi_make_action_id(num_actions);
+  pi_p4info_action_add(p4info, new_id, "new_action", 0);
+  TEST_ASSERT_TRUE(pi_p4info_is_valid_id(p4info, new_id));
+  TEST_ASSERT_EQUAL_STRING("new_action",
+                           pi_p4info_action_name_from_id(p4info, new_id));
+  TEST_ASSERT_EQUAL_STRING("a0", pi_p4info_action_name_from_id(
+                                     p4info, pi_make_action_id(0)));
+}
+
 TEST_GROUP_RUNNER(P4Info) {
   RUN_TEST_CASE(P4Info, Actions);
   RUN_TEST_CASE(P4Info, ActionsInvalidId);
@@ -485,7 +874,12 @@ TEST_GROUP_RUNNER(P4Info) {
   RUN_TEST_CASE(P4Info, TablesStress);
   RUN_TEST_CASE(P4Info, TablesIterator);
   RUN_TEST_CASE(P4Info, Serialize);
+  RUN_TEST_CASE(P4Info, SerializeBinary);
+  RUN_TEST_CASE(P4Info, SerializeBinaryValidation);
   RUN_TEST_CASE(P4Info, Generic);
+  RUN_TEST_CASE(P4Info, CounterWidth);
+  RUN_TEST_CASE(P4Info, ObjectEqual);
+  RUN_TEST_CASE(P4Info, Freeze);
 }
 
 void test_p4info() { RUN_TEST_GROUP(P4Info); }
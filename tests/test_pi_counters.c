@@ -0,0 +1,313 @@
+/* Copyright 2013-present Barefoot Networks, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Antonin Bas (antonin@barefootnetworks.com)
+ *
+ */
+
+#include "PI/int/pi_int.h"
+#include "PI/p4info.h"
+#include "PI/pi.h"
+#include "PI/pi_counter.h"
+#include "PI/target/pi_counter_imp.h"
+#include "p4info/counters_int.h"
+
+#include "func_counter.h"
+
+#include "unity/unity_fixture.h"
+
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+// these tests run the PI counter cache and range reads against the dummy
+// target, which stores the values of indirect counters; the tests call the
+// dummy target directly to change these values as the hardware would, without
+// going through the PI core
+
+#define COUNTER_SIZE 4
+
+// how long to wait for the background poller before failing
+#define POLL_TIMEOUT_MS 5000
+
+static pi_p4info_t *p4info;
+static pi_p4_id_t cid;
+// a 16-bit counter, which wraps around in hardware
+static pi_p4_id_t cid_16;
+static pi_dev_tgt_t dev_tgt = {0, 0xffff};
+static pi_session_handle_t sess;
+
+static void sleep_ms(unsigned int ms) {
+  struct timespec ts = {ms / 1000, (ms % 1000) * 1000000};
+  nanosleep(&ts, NULL);
+}
+
+// number of calls to a dummy target function since pi_init
+static int num_calls(const char *func_name) {
+  int count = func_counter_get(func_name);
+  return (count < 0) ? 0 : count;
+}
+
+// sets the value of a cell in the dummy target, as if packets had been counted
+static void set_hw_value(pi_p4_id_t counter_id, size_t index, uint64_t packets,
+                         uint64_t bytes) {
+  pi_counter_data_t counter_data;
+  counter_data.valid = PI_COUNTER_UNIT_PACKETS | PI_COUNTER_UNIT_BYTES;
+  counter_data.packets = packets;
+  counter_data.bytes = bytes;
+  TEST_ASSERT_EQUAL_INT(
+      PI_STATUS_SUCCESS,
+      _pi_counter_write(sess, dev_tgt, counter_id, index, &counter_data));
+}
+
+static void cache_enable(pi_p4_id_t counter_id, uint32_t poll_interval_ms,
+                         uint32_t max_staleness_ms) {
+  pi_counter_cache_config_t config;
+  config.poll_interval_ms = poll_interval_ms;
+  config.max_staleness_ms = max_staleness_ms;
+  // the first snapshot is taken right away
+  TEST_ASSERT_EQUAL_INT(PI_STATUS_SUCCESS,
+                        pi_counter_cache_enable(dev_tgt, counter_id, &config));
+}
+
+// returns once the number of packets read from the cache for the cell differs
+// from old_packets; never goes to the target
+static uint64_t wait_for_cached_change(pi_p4_id_t counter_id, size_t index,
+                                       uint64_t old_packets) {
+  for (int i = 0; i < POLL_TIMEOUT_MS; i++) {
+    int calls = num_calls("_pi_counter_read");
+    pi_counter_data_t counter_data;
+    pi_status_t rc = pi_counter_read(sess, dev_tgt, counter_id, index,
+                                     PI_COUNTER_FLAGS_CACHED, &counter_data);
+    TEST_ASSERT_EQUAL_INT(PI_STATUS_SUCCESS, rc);
+    // if the target was read, no snapshot was available yet
+    if (num_calls("_pi_counter_read") == calls &&
+        counter_data.packets != old_packets)
+      return counter_data.packets;
+    sleep_ms(1);
+  }
+  TEST_FAIL_MESSAGE("Timeout when waiting for counter poll");
+  return 0;
+}
+
+TEST_GROUP(PiCounters);
+
+TEST_SETUP(PiCounters) {
+  pi_init(1, NULL);
+  pi_add_config(NULL, PI_CONFIG_TYPE_NONE, &p4info);
+  pi_p4info_counter_init(p4info, 2);
+  cid = pi_make_counter_id(0);
+  pi_p4info_counter_add(p4info, cid, "c0", PI_P4INFO_COUNTER_UNIT_BOTH,
+                        COUNTER_SIZE);
+  cid_16 = pi_make_counter_id(1);
+  pi_p4info_counter_add(p4info, cid_16, "c1", PI_P4INFO_COUNTER_UNIT_BOTH,
+                        COUNTER_SIZE);
+  pi_p4info_counter_set_width(p4info, cid_16, 16);
+  TEST_ASSERT_EQUAL_INT(PI_STATUS_SUCCESS,
+                        pi_assign_device(dev_tgt.dev_id, p4info, NULL));
+  TEST_ASSERT_EQUAL_INT(PI_STATUS_SUCCESS, pi_session_init(&sess));
+}
+
+TEST_TEAR_DOWN(PiCounters) {
+  pi_session_cleanup(sess);
+  // also drops the cached counters
+  pi_remove_device(dev_tgt.dev_id);
+  pi_destroy_config(p4info);
+  pi_destroy();
+}
+
+TEST(PiCounters, CachedReadStaleness) {
+  set_hw_value(cid, 0, 1, 1);
+  // a single poll for the whole test
+  cache_enable(cid, 1000000, 200);
+  TEST_ASSERT_EQUAL_UINT64(1, wait_for_cached_change(cid, 0, 0));
+
+  // the cached value is returned, even though the target has changed
+  set_hw_value(cid, 0, 5, 5);
+  int calls = num_calls("_pi_counter_read");
+  pi_counter_data_t counter_data;
+  TEST_ASSERT_EQUAL_INT(
+      PI_STATUS_SUCCESS,
+      pi_counter_read(sess, dev_tgt, cid, 0, PI_COUNTER_FLAGS_CACHED,
+                      &counter_data));
+  TEST_ASSERT_EQUAL_UINT64(1, counter_data.packets);
+  TEST_ASSERT_EQUAL_INT(calls, num_calls("_pi_counter_read"));
+
+  // once the snapshot is older than the staleness bound, reads go to the target
+  sleep_ms(300);
+  TEST_ASSERT_EQUAL_INT(
+      PI_STATUS_SUCCESS,
+      pi_counter_read(sess, dev_tgt, cid, 0, PI_COUNTER_FLAGS_CACHED,
+                      &counter_data));
+  TEST_ASSERT_EQUAL_UINT64(5, counter_data.packets);
+  TEST_ASSERT_EQUAL_INT(calls + 1, num_calls("_pi_counter_read"));
+}
+
+TEST(PiCounters, WriteInvalidatesCache) {
+  set_hw_value(cid, 1, 7, 70);
+  cache_enable(cid, 1000000, 1000000);
+  TEST_ASSERT_EQUAL_UINT64(7, wait_for_cached_change(cid, 1, 0));
+
+  pi_counter_data_t counter_data;
+  counter_data.valid = PI_COUNTER_UNIT_PACKETS | PI_COUNTER_UNIT_BYTES;
+  counter_data.packets = 3;
+  counter_data.bytes = 30;
+  TEST_ASSERT_EQUAL_INT(PI_STATUS_SUCCESS,
+                        pi_counter_write(sess, dev_tgt, cid, 1, &counter_data));
+
+  // the pre-write value is never returned, even before the next poll
+  TEST_ASSERT_EQUAL_INT(
+      PI_STATUS_SUCCESS,
+      pi_counter_read(sess, dev_tgt, cid, 1, PI_COUNTER_FLAGS_CACHED,
+                      &counter_data));
+  TEST_ASSERT_EQUAL_UINT64(3, counter_data.packets);
+  TEST_ASSERT_EQUAL_UINT64(30, counter_data.bytes);
+
+  // the next poll accumulates from the written value
+  set_hw_value(cid, 1, 10, 100);
+  cache_enable(cid, 1000000, 1000000);
+  TEST_ASSERT_EQUAL_UINT64(10, wait_for_cached_change(cid, 1, 3));
+  TEST_ASSERT_EQUAL_INT(
+      PI_STATUS_SUCCESS,
+      pi_counter_read(sess, dev_tgt, cid, 1, PI_COUNTER_FLAGS_CACHED,
+                      &counter_data));
+  TEST_ASSERT_EQUAL_UINT64(100, counter_data.bytes);
+}
+
+TEST(PiCounters, ReadRate) {
+  pi_counter_rate_t rate;
+  set_hw_value(cid, 2, 100, 1000);
+  cache_enable(cid, 1000000, 1000000);
+  TEST_ASSERT_EQUAL_UINT64(100, wait_for_cached_change(cid, 2, 0));
+  // a single snapshot is not enough
+  TEST_ASSERT_EQUAL_INT(PI_STATUS_COUNTER_NOT_CACHED,
+                        pi_counter_read_rate(dev_tgt, cid, 2, &rate));
+
+  sleep_ms(10);
+  set_hw_value(cid, 2, 150, 1600);
+  cache_enable(cid, 1000000, 1000000);
+  TEST_ASSERT_EQUAL_UINT64(150, wait_for_cached_change(cid, 2, 100));
+
+  TEST_ASSERT_EQUAL_INT(PI_STATUS_SUCCESS,
+                        pi_counter_read_rate(dev_tgt, cid, 2, &rate));
+  TEST_ASSERT_EQUAL_UINT64(50, rate.delta.packets);
+  TEST_ASSERT_EQUAL_UINT64(600, rate.delta.bytes);
+  TEST_ASSERT_TRUE(rate.interval_ns >= 10000000u);
+  double interval_s = rate.interval_ns / 1e9;
+  TEST_ASSERT_TRUE(rate.packets_per_sec == 50 / interval_s);
+  TEST_ASSERT_TRUE(rate.bytes_per_sec == 600 / interval_s);
+
+  TEST_ASSERT_EQUAL_INT(
+      PI_STATUS_OUT_OF_BOUND_IDX,
+      pi_counter_read_rate(dev_tgt, cid, COUNTER_SIZE, &rate));
+}
+
+TEST(PiCounters, WrapAround) {
+  // the hardware only keeps the 16 low-order bits of each value
+  set_hw_value(cid_16, 0, 0xfff0, 0xfff0);
+  cache_enable(cid_16, 1000000, 1000000);
+  TEST_ASSERT_EQUAL_UINT64(0xfff0, wait_for_cached_change(cid_16, 0, 0));
+
+  // +0x20, the hardware value wrapped around
+  set_hw_value(cid_16, 0, 0x0010, 0x0010);
+  cache_enable(cid_16, 1000000, 1000000);
+  TEST_ASSERT_EQUAL_UINT64(0x10010,
+                           wait_for_cached_change(cid_16, 0, 0xfff0));
+
+  // +0x7ff0, then +0x8005 which wraps around again
+  set_hw_value(cid_16, 0, 0x8000, 0x8000);
+  cache_enable(cid_16, 1000000, 1000000);
+  TEST_ASSERT_EQUAL_UINT64(0x18000,
+                           wait_for_cached_change(cid_16, 0, 0x10010));
+  set_hw_value(cid_16, 0, 0x0005, 0x0005);
+  cache_enable(cid_16, 1000000, 1000000);
+  TEST_ASSERT_EQUAL_UINT64(0x20005,
+                           wait_for_cached_change(cid_16, 0, 0x18000));
+
+  pi_counter_data_t counter_data;
+  TEST_ASSERT_EQUAL_INT(
+      PI_STATUS_SUCCESS,
+      pi_counter_read(sess, dev_tgt, cid_16, 0, PI_COUNTER_FLAGS_CACHED,
+                      &counter_data));
+  TEST_ASSERT_EQUAL_UINT64(0x20005, counter_data.bytes);
+  pi_counter_rate_t rate;
+  TEST_ASSERT_EQUAL_INT(PI_STATUS_SUCCESS,
+                        pi_counter_read_rate(dev_tgt, cid_16, 0, &rate));
+  TEST_ASSERT_EQUAL_UINT64(0x8005, rate.delta.packets);
+}
+
+TEST(PiCounters, ReadRange) {
+  for (size_t i = 0; i < COUNTER_SIZE; i++)
+    set_hw_value(cid, i, 10 * (i + 1), 100 * (i + 1));
+
+  // the dummy target has no range read, so the PI core reads each index
+  pi_counter_data_t counter_data[COUNTER_SIZE];
+  memset(counter_data, 0xff, sizeof(counter_data));
+  int calls = num_calls("_pi_counter_read");
+  TEST_ASSERT_EQUAL_INT(
+      PI_STATUS_SUCCESS,
+      pi_counter_read_range(sess, dev_tgt, cid, 1, 2, 0, counter_data));
+  TEST_ASSERT_EQUAL_INT(calls + 2, num_calls("_pi_counter_read"));
+  TEST_ASSERT_EQUAL_UINT64(20, counter_data[0].packets);
+  TEST_ASSERT_EQUAL_UINT64(200, counter_data[0].bytes);
+  TEST_ASSERT_EQUAL_UINT64(30, counter_data[1].packets);
+  TEST_ASSERT_EQUAL_UINT64(300, counter_data[1].bytes);
+  // nothing written past the requested count
+  TEST_ASSERT_EQUAL_UINT64(UINT64_MAX, counter_data[2].packets);
+
+  // the same values from the cache, without going to the target
+  cache_enable(cid, 1000000, 1000000);
+  TEST_ASSERT_EQUAL_UINT64(40, wait_for_cached_change(cid, 3, 0));
+  memset(counter_data, 0, sizeof(counter_data));
+  calls = num_calls("_pi_counter_read");
+  TEST_ASSERT_EQUAL_INT(
+      PI_STATUS_SUCCESS,
+      pi_counter_read_range(sess, dev_tgt, cid, 1, 2, PI_COUNTER_FLAGS_CACHED,
+                            counter_data));
+  TEST_ASSERT_EQUAL_INT(calls, num_calls("_pi_counter_read"));
+  TEST_ASSERT_EQUAL_UINT64(20, counter_data[0].packets);
+  TEST_ASSERT_EQUAL_UINT64(300, counter_data[1].bytes);
+
+  // ranges which go past the end are rejected before reaching the target
+  calls = num_calls("_pi_counter_read");
+  TEST_ASSERT_EQUAL_INT(
+      PI_STATUS_OUT_OF_BOUND_IDX,
+      pi_counter_read_range(sess, dev_tgt, cid, COUNTER_SIZE - 1, 2, 0,
+                            counter_data));
+  TEST_ASSERT_EQUAL_INT(
+      PI_STATUS_OUT_OF_BOUND_IDX,
+      pi_counter_read_range(sess, dev_tgt, cid, COUNTER_SIZE + 1, 0, 0,
+                            counter_data));
+  TEST_ASSERT_EQUAL_INT(
+      PI_STATUS_OUT_OF_BOUND_IDX,
+      pi_counter_read_range(sess, dev_tgt, cid, 1, SIZE_MAX, 0, counter_data));
+  TEST_ASSERT_EQUAL_INT(calls, num_calls("_pi_counter_read"));
+  // an empty range at the end is valid
+  TEST_ASSERT_EQUAL_INT(
+      PI_STATUS_SUCCESS,
+      pi_counter_read_range(sess, dev_tgt, cid, COUNTER_SIZE, 0, 0,
+                            counter_data));
+}
+
+TEST_GROUP_RUNNER(PiCounters) {
+  RUN_TEST_CASE(PiCounters, CachedReadStaleness);
+  RUN_TEST_CASE(PiCounters, WriteInvalidatesCache);
+  RUN_TEST_CASE(PiCounters, ReadRate);
+  RUN_TEST_CASE(PiCounters, WrapAround);
+  RUN_TEST_CASE(PiCounters, ReadRange);
+}
+
+void test_pi_counters() { RUN_TEST_GROUP(PiCounters); }
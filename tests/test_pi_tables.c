@@ -0,0 +1,314 @@
+/* Copyright 2013-present Barefoot Networks, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Antonin Bas (antonin@barefootnetworks.com)
+ *
+ */
+
+#include "PI/frontends/generic/pi.h"
+#include "PI/int/pi_int.h"
+#include "PI/p4info.h"
+#include "PI/pi.h"
+#include "p4info/actions_int.h"
+#include "p4info/tables_int.h"
+
+#include "func_counter.h"
+
+#include "unity/unity_fixture.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+// these tests run the PI core against the dummy target, which does not
+// implement the optional batch and paginated fetch functions, so they exercise
+// the PI core fallbacks
+
+#define NUM_KEYS 8
+
+static pi_p4info_t *p4info;
+static pi_p4_id_t aid, tid;
+static pi_p4_id_t fid = 0;
+static pi_p4_id_t pid = 0;
+static pi_dev_tgt_t dev_tgt = {0, 0xffff};
+static pi_session_handle_t sess;
+static pi_match_key_t *mkeys[NUM_KEYS];
+static pi_action_data_t *adata;
+static pi_table_entry_t t_entries[NUM_KEYS];
+static pi_status_t statuses[NUM_KEYS];
+static pi_entry_handle_t handles[NUM_KEYS];
+
+static void set_match_key(pi_match_key_t *mkey, uint32_t v) {
+  pi_netv_t fv;
+  pi_match_key_init(mkey);
+  TEST_ASSERT_EQUAL_INT(PI_STATUS_SUCCESS,
+                        pi_getnetv_u32(p4info, tid, fid, v, &fv));
+  TEST_ASSERT_EQUAL_INT(PI_STATUS_SUCCESS, pi_match_key_exact_set(mkey, &fv));
+}
+
+static void set_action_data(uint32_t v) {
+  pi_netv_t argv;
+  pi_action_data_init(adata);
+  TEST_ASSERT_EQUAL_INT(PI_STATUS_SUCCESS,
+                        pi_getnetv_u32(p4info, aid, pid, v, &argv));
+  TEST_ASSERT_EQUAL_INT(PI_STATUS_SUCCESS,
+                        pi_action_data_arg_set(adata, &argv));
+}
+
+// number of calls to a dummy target function since pi_init
+static int num_calls(const char *func_name) {
+  int count = func_counter_get(func_name);
+  return (count < 0) ? 0 : count;
+}
+
+static size_t num_entries_in_table() {
+  pi_table_fetch_res_t *res;
+  TEST_ASSERT_EQUAL_INT(
+      PI_STATUS_SUCCESS,
+      pi_table_entries_fetch(sess, dev_tgt.dev_id, tid, &res));
+  size_t num = pi_table_entries_num(res);
+  pi_table_entries_fetch_done(sess, res);
+  return num;
+}
+
+// Reads the whole table with a cursor and checks that every entry added by the
+// test is returned exactly once, with its match key. Returns the number of
+// chunks.
+static size_t fetch_all_chunks(size_t max_entries, size_t max_bytes,
+                               size_t expected_chunk_size) {
+  pi_table_fetch_cursor_t *cursor;
+  TEST_ASSERT_EQUAL_INT(
+      PI_STATUS_SUCCESS,
+      pi_table_entries_fetch_begin(sess, dev_tgt.dev_id, tid, max_entries,
+                                   max_bytes, &cursor));
+  bool seen[NUM_KEYS] = {false};
+  size_t num_chunks = 0, num_entries = 0;
+  while (1) {
+    pi_table_fetch_res_t *res;
+    TEST_ASSERT_EQUAL_INT(PI_STATUS_SUCCESS,
+                          pi_table_entries_fetch_next_chunk(cursor, &res));
+    if (!res) break;
+    num_chunks++;
+    size_t num = pi_table_entries_num(res);
+    // only the last chunk can be smaller
+    TEST_ASSERT_TRUE(num > 0 && num <= expected_chunk_size);
+    if (num < expected_chunk_size)
+      TEST_ASSERT_EQUAL_UINT(NUM_KEYS, num_entries + num);
+    for (size_t i = 0; i < num; i++) {
+      pi_entry_handle_t h = pi_table_entries_get_handle(res, i);
+      size_t j;
+      for (j = 0; j < NUM_KEYS; j++)
+        if (handles[j] == h) break;
+      TEST_ASSERT_TRUE(j < NUM_KEYS);
+      TEST_ASSERT_FALSE(seen[j]);
+      seen[j] = true;
+      const pi_match_key_t *mk = pi_table_entries_get(res, i)->match_key;
+      TEST_ASSERT_EQUAL_UINT(mkeys[j]->data_size, mk->data_size);
+      TEST_ASSERT_EQUAL_MEMORY(mkeys[j]->data, mk->data, mk->data_size);
+    }
+    num_entries += num;
+    pi_table_entries_fetch_done(sess, res);
+  }
+  TEST_ASSERT_EQUAL_UINT(NUM_KEYS, num_entries);
+  TEST_ASSERT_EQUAL_INT(PI_STATUS_SUCCESS, pi_table_entries_fetch_end(cursor));
+  return num_chunks;
+}
+
+TEST_GROUP(PiTables);
+
+TEST_SETUP(PiTables) {
+  pi_init(1, NULL);
+  pi_add_config(NULL, PI_CONFIG_TYPE_NONE, &p4info);
+  pi_p4info_action_init(p4info, 1);
+  pi_p4info_table_init(p4info, 1);
+  aid = pi_make_action_id(0);
+  pi_p4info_action_add(p4info, aid, "a0", 1);
+  pi_p4info_action_add_param(p4info, aid, pid, "p0_0", 32);
+  tid = pi_make_table_id(0);
+  pi_p4info_table_add(p4info, tid, "t0", 1, 1, 1024);
+  pi_p4info_table_add_match_field(p4info, tid, fid, "f0",
+                                  PI_P4INFO_MATCH_TYPE_EXACT, 32);
+  pi_p4info_table_add_action(p4info, tid, aid);
+  TEST_ASSERT_EQUAL_INT(PI_STATUS_SUCCESS,
+                        pi_assign_device(dev_tgt.dev_id, p4info, NULL));
+  TEST_ASSERT_EQUAL_INT(PI_STATUS_SUCCESS, pi_session_init(&sess));
+
+  for (size_t i = 0; i < NUM_KEYS; i++) {
+    pi_match_key_allocate(p4info, tid, &mkeys[i]);
+    set_match_key(mkeys[i], i);
+  }
+  pi_action_data_allocate(p4info, aid, &adata);
+  set_action_data(0xab);
+  for (size_t i = 0; i < NUM_KEYS; i++) {
+    t_entries[i].entry_type = PI_ACTION_ENTRY_TYPE_DATA;
+    t_entries[i].entry.action_data = adata;
+    t_entries[i].entry_properties = NULL;
+    t_entries[i].direct_res_config = NULL;
+  }
+}
+
+TEST_TEAR_DOWN(PiTables) {
+  for (size_t i = 0; i < NUM_KEYS; i++) pi_match_key_destroy(mkeys[i]);
+  pi_action_data_destroy(adata);
+  pi_session_cleanup(sess);
+  pi_remove_device(dev_tgt.dev_id);
+  pi_destroy_config(p4info);
+  pi_destroy();
+}
+
+TEST(PiTables, AddBatchFallback) {
+  int calls = num_calls("_pi_table_entry_add");
+  pi_status_t rc = pi_table_entries_add_batch(
+      sess, dev_tgt, tid, NUM_KEYS, (const pi_match_key_t *const *)mkeys,
+      t_entries, 0, statuses, handles);
+  TEST_ASSERT_EQUAL_INT(PI_STATUS_SUCCESS, rc);
+  // one call to the target for each entry
+  TEST_ASSERT_EQUAL_INT(calls + NUM_KEYS,
+                        num_calls("_pi_table_entry_add"));
+  for (size_t i = 0; i < NUM_KEYS; i++) {
+    TEST_ASSERT_EQUAL_INT(PI_STATUS_SUCCESS, statuses[i]);
+    for (size_t j = 0; j < i; j++)
+      TEST_ASSERT_TRUE(handles[i] != handles[j]);
+  }
+  TEST_ASSERT_EQUAL_UINT(NUM_KEYS, num_entries_in_table());
+}
+
+TEST(PiTables, AddBatchPerEntryStatus) {
+  // the second half of the batch duplicates the first half
+  for (size_t i = NUM_KEYS / 2; i < NUM_KEYS; i++)
+    set_match_key(mkeys[i], i - NUM_KEYS / 2);
+  pi_status_t rc = pi_table_entries_add_batch(
+      sess, dev_tgt, tid, NUM_KEYS, (const pi_match_key_t *const *)mkeys,
+      t_entries, 0, statuses, handles);
+  TEST_ASSERT_TRUE(rc != PI_STATUS_SUCCESS);
+  for (size_t i = 0; i < NUM_KEYS / 2; i++)
+    TEST_ASSERT_EQUAL_INT(PI_STATUS_SUCCESS, statuses[i]);
+  for (size_t i = NUM_KEYS / 2; i < NUM_KEYS; i++)
+    TEST_ASSERT_EQUAL_INT(PI_STATUS_TARGET_ERROR, statuses[i]);
+  TEST_ASSERT_EQUAL_UINT(NUM_KEYS / 2, num_entries_in_table());
+
+  // with overwrite, duplicates replace the existing entries
+  pi_entry_handle_t handles_overwrite[NUM_KEYS];
+  rc = pi_table_entries_add_batch(
+      sess, dev_tgt, tid, NUM_KEYS, (const pi_match_key_t *const *)mkeys,
+      t_entries, 1, statuses, handles_overwrite);
+  TEST_ASSERT_EQUAL_INT(PI_STATUS_SUCCESS, rc);
+  for (size_t i = 0; i < NUM_KEYS / 2; i++)
+    TEST_ASSERT_EQUAL_UINT64(handles[i], handles_overwrite[i]);
+  TEST_ASSERT_EQUAL_UINT(NUM_KEYS / 2, num_entries_in_table());
+}
+
+TEST(PiTables, AddBatchInvalidEntry) {
+  // an entry with a direct resource which does not belong to the table is
+  // rejected by the PI core and never reaches the target
+  pi_direct_res_config_one_t config = {pi_make_counter_id(0), NULL};
+  pi_direct_res_config_t direct_res_config = {1, &config};
+  t_entries[1].direct_res_config = &direct_res_config;
+  int calls = num_calls("_pi_table_entry_add");
+  pi_status_t rc = pi_table_entries_add_batch(
+      sess, dev_tgt, tid, NUM_KEYS, (const pi_match_key_t *const *)mkeys,
+      t_entries, 0, statuses, handles);
+  TEST_ASSERT_TRUE(rc != PI_STATUS_SUCCESS);
+  TEST_ASSERT_TRUE(statuses[1] != PI_STATUS_SUCCESS);
+  TEST_ASSERT_EQUAL_INT(calls + NUM_KEYS - 1,
+                        num_calls("_pi_table_entry_add"));
+  TEST_ASSERT_EQUAL_UINT(NUM_KEYS - 1, num_entries_in_table());
+}
+
+TEST(PiTables, ModifyDeleteBatchFallback) {
+  pi_table_entries_add_batch(sess, dev_tgt, tid, NUM_KEYS / 2,
+                             (const pi_match_key_t *const *)mkeys, t_entries, 0,
+                             statuses, handles);
+
+  // only the first half of the keys are in the table
+  pi_status_t rc = pi_table_entries_modify_wkey_batch(
+      sess, dev_tgt.dev_id, tid, NUM_KEYS,
+      (const pi_match_key_t *const *)mkeys, t_entries, statuses);
+  TEST_ASSERT_TRUE(rc != PI_STATUS_SUCCESS);
+  for (size_t i = 0; i < NUM_KEYS; i++) {
+    TEST_ASSERT_EQUAL_INT(
+        (i < NUM_KEYS / 2) ? PI_STATUS_SUCCESS : PI_STATUS_TARGET_ERROR,
+        statuses[i]);
+  }
+
+  int calls = num_calls("_pi_table_entry_delete_wkey");
+  rc = pi_table_entries_delete_wkey_batch(sess, dev_tgt.dev_id, tid,
+                                          NUM_KEYS / 2,
+                                          (const pi_match_key_t *const *)mkeys,
+                                          statuses);
+  TEST_ASSERT_EQUAL_INT(PI_STATUS_SUCCESS, rc);
+  TEST_ASSERT_EQUAL_INT(calls + NUM_KEYS / 2,
+                        num_calls("_pi_table_entry_delete_wkey"));
+  TEST_ASSERT_EQUAL_UINT(0, num_entries_in_table());
+}
+
+TEST(PiTables, FetchChunks) {
+  pi_table_entries_add_batch(sess, dev_tgt, tid, NUM_KEYS,
+                             (const pi_match_key_t *const *)mkeys, t_entries, 0,
+                             statuses, handles);
+  // chunks of 3, 3 and 2 entries
+  TEST_ASSERT_EQUAL_UINT(3, fetch_all_chunks(3, 0, 3));
+  // no limit: a single chunk
+  TEST_ASSERT_EQUAL_UINT(1, fetch_all_chunks(0, 0, NUM_KEYS));
+  // a byte limit smaller than an entry still returns one entry per chunk
+  TEST_ASSERT_EQUAL_UINT(NUM_KEYS, fetch_all_chunks(0, 1, 1));
+}
+
+TEST(PiTables, FetchChunksEmptyTable) {
+  pi_table_fetch_cursor_t *cursor;
+  TEST_ASSERT_EQUAL_INT(
+      PI_STATUS_SUCCESS,
+      pi_table_entries_fetch_begin(sess, dev_tgt.dev_id, tid, 3, 0, &cursor));
+  pi_table_fetch_res_t *res;
+  TEST_ASSERT_EQUAL_INT(PI_STATUS_SUCCESS,
+                        pi_table_entries_fetch_next_chunk(cursor, &res));
+  TEST_ASSERT_NULL(res);
+  TEST_ASSERT_EQUAL_INT(PI_STATUS_SUCCESS, pi_table_entries_fetch_end(cursor));
+}
+
+TEST(PiTables, FetchEndEarly) {
+  pi_table_entries_add_batch(sess, dev_tgt, tid, NUM_KEYS,
+                             (const pi_match_key_t *const *)mkeys, t_entries, 0,
+                             statuses, handles);
+  pi_table_fetch_cursor_t *cursor;
+  TEST_ASSERT_EQUAL_INT(
+      PI_STATUS_SUCCESS,
+      pi_table_entries_fetch_begin(sess, dev_tgt.dev_id, tid, 3, 0, &cursor));
+  pi_table_fetch_res_t *res;
+  TEST_ASSERT_EQUAL_INT(PI_STATUS_SUCCESS,
+                        pi_table_entries_fetch_next_chunk(cursor, &res));
+  TEST_ASSERT_NOT_NULL(res);
+  TEST_ASSERT_EQUAL_UINT(3, pi_table_entries_num(res));
+  pi_table_entries_fetch_done(sess, res);
+  // released before the remaining entries are retrieved
+  TEST_ASSERT_EQUAL_INT(PI_STATUS_SUCCESS, pi_table_entries_fetch_end(cursor));
+
+  // the table is unaffected and a new cursor starts from the beginning
+  TEST_ASSERT_EQUAL_UINT(NUM_KEYS, num_entries_in_table());
+  TEST_ASSERT_EQUAL_UINT(3, fetch_all_chunks(3, 0, 3));
+}
+
+TEST_GROUP_RUNNER(PiTables) {
+  RUN_TEST_CASE(PiTables, AddBatchFallback);
+  RUN_TEST_CASE(PiTables, AddBatchPerEntryStatus);
+  RUN_TEST_CASE(PiTables, AddBatchInvalidEntry);
+  RUN_TEST_CASE(PiTables, ModifyDeleteBatchFallback);
+  RUN_TEST_CASE(PiTables, FetchChunks);
+  RUN_TEST_CASE(PiTables, FetchChunksEmptyTable);
+  RUN_TEST_CASE(PiTables, FetchEndEarly);
+}
+
+void test_pi_tables() { RUN_TEST_GROUP(PiTables); }
@@ -0,0 +1,573 @@
+/* Copyright 2013-present Barefoot Networks, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Antonin Bas (antonin@barefootnetworks.com)
+ *
+ */
+
+// End-to-end tests for the RPC client and server: the test calls the RPC client
+// target functions (renamed by rpc/rpc_client.h), which send requests to an
+// RPC server running in a separate thread of the same process, on top of the PI
+// core and the dummy target.
+
+#include "rpc/rpc_client.h"
+
+#include "PI/frontends/generic/pi.h"
+#include "PI/int/pi_int.h"
+#include "PI/p4info.h"
+#include "PI/pi.h"
+#include "PI/target/pi_counter_imp.h"
+#include "PI/target/pi_imp.h"
+#include "PI/target/pi_tables_imp.h"
+#include "p4info/actions_int.h"
+#include "p4info/counters_int.h"
+#include "p4info/tables_int.h"
+
+#include "func_counter.h"
+#include "pi_notifications_pub.h"
+#include "pi_rpc.h"
+
+#include "unity/unity_fixture.h"
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define RPC_ADDR "ipc:///tmp/pi_test_rpc.ipc"
+#define NOTIFICATIONS_ADDR "ipc:///tmp/pi_test_rpc_notifications.ipc"
+
+// the server uses a pool of workers, so requests go through the raw REP socket
+#define NUM_WORKERS 2
+
+#define NUM_KEYS 8
+
+// number of cursors the server can keep open, see pi_rpc_server.c
+#define MAX_FETCH_CURSORS 64
+
+#define COUNTER_SIZE 4
+
+// learn messages are published by the test, the learn id does not need to be
+// in the p4info
+#define LEARN_ID 1
+// how long to wait for a notification before failing
+#define NOTIFICATION_TIMEOUT_MS 5000
+
+extern pi_status_t pi_rpc_server_run_with_workers(
+    const pi_remote_addr_t *remote_addr, size_t num_workers);
+
+static pi_p4info_t *p4info;
+static pi_p4_id_t aid, tid, cid;
+static pi_p4_id_t fid = 0;
+static pi_p4_id_t pid = 0;
+static pi_dev_tgt_t dev_tgt = {0, 0xffff};
+static pi_session_handle_t sess;
+static pi_match_key_t *mkeys[NUM_KEYS];
+static pi_action_data_t *adata;
+static pi_table_entry_t t_entries[NUM_KEYS];
+static pi_status_t statuses[NUM_KEYS];
+static pi_entry_handle_t handles[NUM_KEYS];
+
+static void *server_loop(void *arg) {
+  (void)arg;
+  pi_remote_addr_t remote_addr = {RPC_ADDR, NOTIFICATIONS_ADDR};
+  pi_rpc_server_run_with_workers(&remote_addr, NUM_WORKERS);
+  return NULL;
+}
+
+static void p4info_init() {
+  pi_add_config(NULL, PI_CONFIG_TYPE_NONE, &p4info);
+  // the server reads the config back with the native JSON reader, which
+  // requires every resource type
+  pi_p4info_action_init(p4info, 1);
+  pi_p4info_table_init(p4info, 1);
+  pi_p4info_act_prof_init(p4info, 0);
+  pi_p4info_counter_init(p4info, 1);
+  pi_p4info_meter_init(p4info, 0);
+  aid = pi_make_action_id(0);
+  pi_p4info_action_add(p4info, aid, "a0", 1);
+  pi_p4info_action_add_param(p4info, aid, pid, "p0_0", 32);
+  tid = pi_make_table_id(0);
+  pi_p4info_table_add(p4info, tid, "t0", 1, 1, 1024);
+  pi_p4info_table_add_match_field(p4info, tid, fid, "f0",
+                                  PI_P4INFO_MATCH_TYPE_EXACT, 32);
+  pi_p4info_table_add_action(p4info, tid, aid);
+  cid = pi_make_counter_id(0);
+  pi_p4info_counter_add(p4info, cid, "c0", PI_P4INFO_COUNTER_UNIT_BOTH,
+                        COUNTER_SIZE);
+}
+
+// the server and the client can only be started once per process, so the
+// device is assigned once for all the tests
+static void setup_once() {
+  static bool done = false;
+  if (done) return;
+  done = true;
+
+  pi_init(1, NULL);
+  pthread_t server;
+  pthread_create(&server, NULL, server_loop, NULL);
+  pthread_detach(server);
+
+  pi_remote_addr_t remote_addr = {RPC_ADDR, NOTIFICATIONS_ADDR};
+  TEST_ASSERT_EQUAL_INT(PI_STATUS_SUCCESS, _pi_init(&remote_addr));
+  p4info_init();
+  pi_assign_extra_t extras[1] = {{1, NULL, NULL}};
+  TEST_ASSERT_EQUAL_INT(PI_STATUS_SUCCESS,
+                        _pi_assign_device(dev_tgt.dev_id, p4info, extras));
+}
+
+static void set_match_key(pi_match_key_t *mkey, uint32_t v) {
+  pi_netv_t fv;
+  pi_match_key_init(mkey);
+  TEST_ASSERT_EQUAL_INT(PI_STATUS_SUCCESS,
+                        pi_getnetv_u32(p4info, tid, fid, v, &fv));
+  TEST_ASSERT_EQUAL_INT(PI_STATUS_SUCCESS, pi_match_key_exact_set(mkey, &fv));
+}
+
+// number of calls to a dummy target function since pi_init
+static int num_calls(const char *func_name) {
+  int count = func_counter_get(func_name);
+  return (count < 0) ? 0 : count;
+}
+
+// sends a raw request and returns the status in the reply
+static pi_status_t send_raw_req(const char *req, size_t size) {
+  pi_rpc_id_t req_id;
+  retrieve_rpc_id(req, &req_id);
+  if (rpc_send(req, size) != (int)size) return PI_STATUS_RPC_TRANSPORT_ERROR;
+  return wait_for_status(req_id);
+}
+
+static uint64_t fetch_begin(pi_session_handle_t session, size_t max_entries) {
+  uint64_t cursor;
+  TEST_ASSERT_EQUAL_INT(
+      PI_STATUS_SUCCESS,
+      _pi_table_entries_fetch_begin(session, dev_tgt.dev_id, tid, max_entries,
+                                    0, &cursor));
+  return cursor;
+}
+
+// retrieves one chunk and releases it right away
+static pi_status_t fetch_chunk(pi_session_handle_t session, uint64_t cursor,
+                               size_t *num_entries) {
+  pi_table_fetch_res_t res;
+  memset(&res, 0, sizeof(res));
+  pi_status_t status =
+      _pi_table_entries_fetch_next_chunk(session, cursor, &res);
+  if (status != PI_STATUS_SUCCESS) return status;
+  *num_entries = res.num_entries;
+  _pi_table_entries_fetch_done(session, &res);
+  return status;
+}
+
+static void sleep_ms(unsigned int ms) {
+  struct timespec ts = {ms / 1000, (ms % 1000) * 1000000};
+  nanosleep(&ts, NULL);
+}
+
+// set by the RPC client notifications thread
+static pi_learn_msg_t *learn_msg;
+
+static void learn_cb(pi_learn_msg_t *msg, void *cb_cookie) {
+  (void)cb_cookie;
+  __atomic_store_n(&learn_msg, msg, __ATOMIC_SEQ_CST);
+}
+
+// publishes a learn message from the server side, and returns it as received
+// by the RPC client
+static pi_learn_msg_t *publish_learn_msg(pi_learn_msg_id_t msg_id,
+                                         char *entries, size_t num_entries,
+                                         size_t entry_size) {
+  pi_learn_msg_t msg = {dev_tgt, LEARN_ID, msg_id, num_entries, entry_size,
+                        entries};
+  __atomic_store_n(&learn_msg, NULL, __ATOMIC_SEQ_CST);
+  pi_notifications_pub_learn(&msg);
+  for (int i = 0; i < NOTIFICATION_TIMEOUT_MS; i++) {
+    pi_learn_msg_t *received = __atomic_load_n(&learn_msg, __ATOMIC_SEQ_CST);
+    if (received) return received;
+    sleep_ms(1);
+  }
+  TEST_FAIL_MESSAGE("Timeout when waiting for learn message");
+  return NULL;
+}
+
+// acks are sent asynchronously, returns once the target has received it
+static void wait_for_learn_ack(int calls) {
+  for (int i = 0; i < NOTIFICATION_TIMEOUT_MS; i++) {
+    if (num_calls("_pi_learn_msg_ack") > calls) return;
+    sleep_ms(1);
+  }
+  TEST_FAIL_MESSAGE("Timeout when waiting for learn ack");
+}
+
+static void add_entries() {
+  TEST_ASSERT_EQUAL_INT(PI_STATUS_SUCCESS,
+                        _pi_table_entries_add_batch(
+                            sess, dev_tgt, tid, NUM_KEYS,
+                            (const pi_match_key_t *const *)mkeys, t_entries, 0,
+                            statuses, handles));
+}
+
+TEST_GROUP(Rpc);
+
+TEST_SETUP(Rpc) {
+  setup_once();
+  TEST_ASSERT_EQUAL_INT(PI_STATUS_SUCCESS, _pi_session_init(&sess));
+  for (size_t i = 0; i < NUM_KEYS; i++) {
+    pi_match_key_allocate(p4info, tid, &mkeys[i]);
+    set_match_key(mkeys[i], i);
+  }
+  pi_action_data_allocate(p4info, aid, &adata);
+  pi_action_data_init(adata);
+  for (size_t i = 0; i < NUM_KEYS; i++) {
+    t_entries[i].entry_type = PI_ACTION_ENTRY_TYPE_DATA;
+    t_entries[i].entry.action_data = adata;
+    t_entries[i].entry_properties = NULL;
+    t_entries[i].direct_res_config = NULL;
+  }
+}
+
+TEST_TEAR_DOWN(Rpc) {
+  // leave the table empty for the next test
+  _pi_table_entries_delete_wkey_batch(sess, dev_tgt.dev_id, tid, NUM_KEYS,
+                                      (const pi_match_key_t *const *)mkeys,
+                                      statuses);
+  for (size_t i = 0; i < NUM_KEYS; i++) pi_match_key_destroy(mkeys[i]);
+  pi_action_data_destroy(adata);
+  _pi_session_cleanup(sess);
+}
+
+TEST(Rpc, TableEntriesBatch) {
+  int calls = num_calls("_pi_table_entry_add");
+  pi_status_t rc = _pi_table_entries_add_batch(
+      sess, dev_tgt, tid, NUM_KEYS, (const pi_match_key_t *const *)mkeys,
+      t_entries, 0, statuses, handles);
+  TEST_ASSERT_EQUAL_INT(PI_STATUS_SUCCESS, rc);
+  // the server goes through the PI core fallback
+  TEST_ASSERT_EQUAL_INT(calls + NUM_KEYS, num_calls("_pi_table_entry_add"));
+  for (size_t i = 0; i < NUM_KEYS; i++) {
+    TEST_ASSERT_EQUAL_INT(PI_STATUS_SUCCESS, statuses[i]);
+    for (size_t j = 0; j < i; j++)
+      TEST_ASSERT_TRUE(handles[i] != handles[j]);
+  }
+
+  // re-adding the same entries fails for each one of them
+  pi_entry_handle_t handles_again[NUM_KEYS];
+  rc = _pi_table_entries_add_batch(sess, dev_tgt, tid, NUM_KEYS,
+                                   (const pi_match_key_t *const *)mkeys,
+                                   t_entries, 0, statuses, handles_again);
+  TEST_ASSERT_EQUAL_INT(PI_STATUS_SUCCESS, rc);
+  for (size_t i = 0; i < NUM_KEYS; i++)
+    TEST_ASSERT_EQUAL_INT(PI_STATUS_TARGET_ERROR, statuses[i]);
+
+  rc = _pi_table_entries_modify_wkey_batch(
+      sess, dev_tgt.dev_id, tid, NUM_KEYS,
+      (const pi_match_key_t *const *)mkeys, t_entries, statuses);
+  TEST_ASSERT_EQUAL_INT(PI_STATUS_SUCCESS, rc);
+  for (size_t i = 0; i < NUM_KEYS; i++)
+    TEST_ASSERT_EQUAL_INT(PI_STATUS_SUCCESS, statuses[i]);
+
+  rc = _pi_table_entries_delete_wkey_batch(
+      sess, dev_tgt.dev_id, tid, NUM_KEYS / 2,
+      (const pi_match_key_t *const *)mkeys, statuses);
+  TEST_ASSERT_EQUAL_INT(PI_STATUS_SUCCESS, rc);
+  for (size_t i = 0; i < NUM_KEYS / 2; i++)
+    TEST_ASSERT_EQUAL_INT(PI_STATUS_SUCCESS, statuses[i]);
+}
+
+TEST(Rpc, TableEntriesBatchMalformed) {
+  typedef struct __attribute__((packed)) {
+    req_hdr_t hdr;
+    s_pi_session_handle_t sess;
+    s_pi_dev_tgt_t dev_tgt;
+    s_pi_p4_id_t table_id;
+    uint32_t num;
+    uint32_t overwrite;
+    // one match key
+    uint32_t priority;
+    uint32_t mkey_size;
+    char mkey[4];
+  } req_t;
+  int calls = num_calls("_pi_table_entry_add");
+
+  // the number of entries does not match the size of the request
+  req_t req;
+  memset(&req, 0, sizeof(req));
+  char *req_ = (char *)&req;
+  req_ += emit_req_hdr(req_, next_req_id(), PI_RPC_TABLE_ENTRIES_ADD_BATCH);
+  req_ += emit_session_handle(req_, sess);
+  req_ += emit_dev_tgt(req_, dev_tgt);
+  req_ += emit_p4_id(req_, tid);
+  req_ += emit_uint32(req_, 1u << 30);
+  req_ += emit_uint32(req_, 0);
+  req_ += emit_uint32(req_, 0);
+  req_ += emit_uint32(req_, sizeof(req.mkey));
+  TEST_ASSERT_EQUAL_INT(PI_STATUS_RPC_TRANSPORT_ERROR,
+                        send_raw_req((char *)&req, sizeof(req)));
+
+  // a single entry, which is truncated (no action entry)
+  req_ = (char *)&req;
+  req_ += emit_req_hdr(req_, next_req_id(), PI_RPC_TABLE_ENTRIES_ADD_BATCH);
+  req_ += sizeof(req.sess) + sizeof(req.dev_tgt) + sizeof(req.table_id);
+  req_ += emit_uint32(req_, 1);
+  TEST_ASSERT_EQUAL_INT(PI_STATUS_RPC_TRANSPORT_ERROR,
+                        send_raw_req((char *)&req, sizeof(req)));
+
+  // the match key size is larger than the request
+  req_ = (char *)&req;
+  req_ += emit_req_hdr(req_, next_req_id(),
+                       PI_RPC_TABLE_ENTRIES_DELETE_WKEY_BATCH);
+  req_ += sizeof(req.sess) + sizeof(req.dev_tgt) + sizeof(req.table_id);
+  req_ += sizeof(req.num) + sizeof(req.overwrite) + sizeof(req.priority);
+  req_ += emit_uint32(req_, 1u << 20);
+  TEST_ASSERT_EQUAL_INT(PI_STATUS_RPC_TRANSPORT_ERROR,
+                        send_raw_req((char *)&req, sizeof(req)));
+
+  // nothing reached the target, and the server still works
+  TEST_ASSERT_EQUAL_INT(calls, num_calls("_pi_table_entry_add"));
+  TEST_ASSERT_EQUAL_INT(PI_STATUS_SUCCESS,
+                        _pi_table_entries_add_batch(
+                            sess, dev_tgt, tid, 1,
+                            (const pi_match_key_t *const *)mkeys, t_entries, 0,
+                            statuses, handles));
+  TEST_ASSERT_EQUAL_INT(PI_STATUS_SUCCESS, statuses[0]);
+}
+
+TEST(Rpc, BatchMalformed) {
+  typedef struct __attribute__((packed)) {
+    req_hdr_t hdr;
+    s_pi_session_handle_t sess;
+    uint32_t flags;
+    uint32_t num;
+    // one buffered request
+    uint32_t size;
+    req_hdr_t op_hdr;
+  } req_t;
+  int calls = num_calls("_pi_batch_begin");
+
+  // the size of the buffered request is larger than the message
+  req_t req;
+  memset(&req, 0, sizeof(req));
+  pi_rpc_id_t req_id = next_req_id();
+  char *req_ = (char *)&req;
+  req_ += emit_req_hdr(req_, req_id, PI_RPC_BATCH);
+  req_ += emit_session_handle(req_, sess);
+  req_ += emit_uint32(req_, PI_RPC_BATCH_FLAGS_BEGIN | PI_RPC_BATCH_FLAGS_END);
+  req_ += emit_uint32(req_, 1);
+  req_ += emit_uint32(req_, 1u << 20);
+  req_ += emit_req_hdr(req_, next_req_id(), PI_RPC_TABLE_ENTRY_DELETE);
+  TEST_ASSERT_EQUAL_INT(sizeof(req), rpc_send(&req, sizeof(req)));
+  char *rep = NULL;
+  int bytes = rpc_recv(req_id, &rep, NN_MSG);
+  TEST_ASSERT_EQUAL_INT(sizeof(rep_hdr_t) + sizeof(uint32_t), bytes);
+  TEST_ASSERT_EQUAL_INT(PI_STATUS_RPC_TRANSPORT_ERROR,
+                        retrieve_rep_hdr(rep, req_id));
+  uint32_t num_done;
+  retrieve_uint32(rep + sizeof(rep_hdr_t), &num_done);
+  TEST_ASSERT_EQUAL_UINT(0, num_done);
+  rpc_free_rep(rep);
+
+  // the batch was not even started
+  TEST_ASSERT_EQUAL_INT(calls, num_calls("_pi_batch_begin"));
+}
+
+TEST(Rpc, FetchChunks) {
+  add_entries();
+  uint64_t cursor = fetch_begin(sess, 3);
+  const size_t expected[] = {3, 3, 2, 0};
+  for (size_t i = 0; i < sizeof(expected) / sizeof(expected[0]); i++) {
+    size_t num_entries;
+    TEST_ASSERT_EQUAL_INT(PI_STATUS_SUCCESS,
+                          fetch_chunk(sess, cursor, &num_entries));
+    TEST_ASSERT_EQUAL_UINT(expected[i], num_entries);
+  }
+  TEST_ASSERT_EQUAL_INT(PI_STATUS_SUCCESS,
+                        _pi_table_entries_fetch_end(sess, cursor));
+  // the handle is no longer valid
+  TEST_ASSERT_EQUAL_INT(PI_STATUS_OUT_OF_BOUND_IDX,
+                        _pi_table_entries_fetch_end(sess, cursor));
+}
+
+TEST(Rpc, FetchCursorSession) {
+  add_entries();
+  uint64_t cursor = fetch_begin(sess, 3);
+  pi_session_handle_t other;
+  TEST_ASSERT_EQUAL_INT(PI_STATUS_SUCCESS, _pi_session_init(&other));
+
+  // only the session which opened the cursor can use it
+  size_t num_entries;
+  TEST_ASSERT_EQUAL_INT(PI_STATUS_OUT_OF_BOUND_IDX,
+                        fetch_chunk(other, cursor, &num_entries));
+  TEST_ASSERT_EQUAL_INT(PI_STATUS_OUT_OF_BOUND_IDX,
+                        _pi_table_entries_fetch_end(other, cursor));
+  TEST_ASSERT_EQUAL_INT(PI_STATUS_OUT_OF_BOUND_IDX,
+                        fetch_chunk(other, MAX_FETCH_CURSORS, &num_entries));
+
+  // which is not affected by the other session
+  TEST_ASSERT_EQUAL_INT(PI_STATUS_SUCCESS,
+                        fetch_chunk(sess, cursor, &num_entries));
+  TEST_ASSERT_EQUAL_UINT(3, num_entries);
+  TEST_ASSERT_EQUAL_INT(PI_STATUS_SUCCESS,
+                        _pi_table_entries_fetch_end(sess, cursor));
+  _pi_session_cleanup(other);
+}
+
+TEST(Rpc, FetchCursorLimit) {
+  pi_session_handle_t other;
+  TEST_ASSERT_EQUAL_INT(PI_STATUS_SUCCESS, _pi_session_init(&other));
+  uint64_t cursors[MAX_FETCH_CURSORS];
+  for (size_t i = 0; i < MAX_FETCH_CURSORS; i++)
+    cursors[i] = fetch_begin(other, 0);
+
+  uint64_t rejected;
+  TEST_ASSERT_EQUAL_INT(PI_STATUS_ALLOC_ERROR,
+                        _pi_table_entries_fetch_begin(sess, dev_tgt.dev_id, tid,
+                                                      0, 0, &rejected));
+
+  // ending a cursor frees its slot
+  TEST_ASSERT_EQUAL_INT(PI_STATUS_SUCCESS,
+                        _pi_table_entries_fetch_end(other, cursors[0]));
+  uint64_t cursor = fetch_begin(sess, 0);
+  TEST_ASSERT_EQUAL_INT(PI_STATUS_ALLOC_ERROR,
+                        _pi_table_entries_fetch_begin(sess, dev_tgt.dev_id, tid,
+                                                      0, 0, &rejected));
+  TEST_ASSERT_EQUAL_INT(PI_STATUS_SUCCESS,
+                        _pi_table_entries_fetch_end(sess, cursor));
+
+  // cleaning up the session ends the cursors it left open
+  _pi_session_cleanup(other);
+  for (size_t i = 0; i < MAX_FETCH_CURSORS; i++)
+    cursors[i] = fetch_begin(sess, 0);
+  for (size_t i = 0; i < MAX_FETCH_CURSORS; i++) {
+    TEST_ASSERT_EQUAL_INT(PI_STATUS_SUCCESS,
+                          _pi_table_entries_fetch_end(sess, cursors[i]));
+  }
+}
+
+TEST(Rpc, FetchEndEarly) {
+  add_entries();
+  uint64_t cursor = fetch_begin(sess, 3);
+  size_t num_entries;
+  TEST_ASSERT_EQUAL_INT(PI_STATUS_SUCCESS,
+                        fetch_chunk(sess, cursor, &num_entries));
+  TEST_ASSERT_EQUAL_UINT(3, num_entries);
+  // released before the remaining entries are retrieved
+  TEST_ASSERT_EQUAL_INT(PI_STATUS_SUCCESS,
+                        _pi_table_entries_fetch_end(sess, cursor));
+
+  // a new cursor starts from the beginning
+  cursor = fetch_begin(sess, 0);
+  TEST_ASSERT_EQUAL_INT(PI_STATUS_SUCCESS,
+                        fetch_chunk(sess, cursor, &num_entries));
+  TEST_ASSERT_EQUAL_UINT(NUM_KEYS, num_entries);
+  TEST_ASSERT_EQUAL_INT(PI_STATUS_SUCCESS,
+                        _pi_table_entries_fetch_end(sess, cursor));
+}
+
+TEST(Rpc, CounterReadRange) {
+  for (size_t i = 0; i < COUNTER_SIZE; i++) {
+    pi_counter_data_t counter_data;
+    counter_data.valid = PI_COUNTER_UNIT_PACKETS | PI_COUNTER_UNIT_BYTES;
+    counter_data.packets = 10 * (i + 1);
+    counter_data.bytes = 100 * (i + 1);
+    TEST_ASSERT_EQUAL_INT(
+        PI_STATUS_SUCCESS,
+        _pi_counter_write(sess, dev_tgt, cid, i, &counter_data));
+  }
+
+  // a single request, which the server serves with one target read per index
+  pi_counter_data_t counter_data[COUNTER_SIZE];
+  memset(counter_data, 0xff, sizeof(counter_data));
+  int calls = num_calls("_pi_counter_read");
+  TEST_ASSERT_EQUAL_INT(
+      PI_STATUS_SUCCESS,
+      _pi_counter_read_range(sess, dev_tgt, cid, 1, 2, 0, counter_data));
+  TEST_ASSERT_EQUAL_INT(calls + 2, num_calls("_pi_counter_read"));
+  for (size_t i = 0; i < 2; i++) {
+    TEST_ASSERT_EQUAL_UINT64(10 * (i + 2), counter_data[i].packets);
+    TEST_ASSERT_EQUAL_UINT64(100 * (i + 2), counter_data[i].bytes);
+  }
+  // nothing written past the requested count
+  TEST_ASSERT_EQUAL_UINT64(UINT64_MAX, counter_data[2].packets);
+
+  // the whole counter
+  TEST_ASSERT_EQUAL_INT(PI_STATUS_SUCCESS,
+                        _pi_counter_read_range(sess, dev_tgt, cid, 0,
+                                               COUNTER_SIZE, 0, counter_data));
+  TEST_ASSERT_EQUAL_UINT64(10, counter_data[0].packets);
+  TEST_ASSERT_EQUAL_UINT64(400, counter_data[COUNTER_SIZE - 1].bytes);
+
+  // ranges which go past the end are rejected by the server
+  calls = num_calls("_pi_counter_read");
+  TEST_ASSERT_EQUAL_INT(
+      PI_STATUS_OUT_OF_BOUND_IDX,
+      _pi_counter_read_range(sess, dev_tgt, cid, COUNTER_SIZE - 1, 2, 0,
+                             counter_data));
+  TEST_ASSERT_EQUAL_INT(
+      PI_STATUS_OUT_OF_BOUND_IDX,
+      _pi_counter_read_range(sess, dev_tgt, cid, COUNTER_SIZE + 1, 0, 0,
+                             counter_data));
+  TEST_ASSERT_EQUAL_INT(calls, num_calls("_pi_counter_read"));
+}
+
+TEST(Rpc, LearnMsgAck) {
+  TEST_ASSERT_EQUAL_INT(
+      PI_STATUS_SUCCESS,
+      pi_learn_register_cb(dev_tgt.dev_id, LEARN_ID, learn_cb, NULL));
+  char entries[] = {1, 2, 3, 4, 5, 6};
+  pi_learn_msg_t *first = NULL;
+  for (pi_learn_msg_id_t msg_id = 1; msg_id <= 2; msg_id++) {
+    // the entries are read in place from the received message
+    pi_learn_msg_t *msg = publish_learn_msg(msg_id, entries, 3, 2);
+    TEST_ASSERT_EQUAL_UINT(LEARN_ID, msg->learn_id);
+    TEST_ASSERT_EQUAL_UINT(msg_id, msg->msg_id);
+    TEST_ASSERT_EQUAL_UINT(3, msg->num_entries);
+    TEST_ASSERT_EQUAL_UINT(2, msg->entry_size);
+    TEST_ASSERT_EQUAL_MEMORY(entries, msg->entries, sizeof(entries));
+
+    int calls = num_calls("_pi_learn_msg_ack");
+    TEST_ASSERT_EQUAL_INT(
+        PI_STATUS_SUCCESS,
+        _pi_learn_msg_ack(sess, dev_tgt.dev_id, LEARN_ID, msg->msg_id));
+    wait_for_learn_ack(calls);
+
+    // the header goes back to the pool once the message is done
+    size_t num_free = learn_msg_pool_num_free();
+    TEST_ASSERT_EQUAL_INT(PI_STATUS_SUCCESS, _pi_learn_msg_done(msg));
+    TEST_ASSERT_EQUAL_UINT(num_free + 1, learn_msg_pool_num_free());
+
+    // and is reused for the next message
+    if (first) TEST_ASSERT_EQUAL_PTR(first, msg);
+    first = msg;
+  }
+  pi_learn_deregister_cb(dev_tgt.dev_id, LEARN_ID);
+}
+
+TEST_GROUP_RUNNER(Rpc) {
+  RUN_TEST_CASE(Rpc, TableEntriesBatch);
+  RUN_TEST_CASE(Rpc, TableEntriesBatchMalformed);
+  RUN_TEST_CASE(Rpc, BatchMalformed);
+  RUN_TEST_CASE(Rpc, FetchChunks);
+  RUN_TEST_CASE(Rpc, FetchCursorSession);
+  RUN_TEST_CASE(Rpc, FetchCursorLimit);
+  RUN_TEST_CASE(Rpc, FetchEndEarly);
+  RUN_TEST_CASE(Rpc, CounterReadRange);
+  RUN_TEST_CASE(Rpc, LearnMsgAck);
+}
+
+void test_rpc() { RUN_TEST_GROUP(Rpc); }
@@ -0,0 +1,265 @@
+/* Copyright 2013-present Barefoot Networks, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Antonin Bas (antonin@barefootnetworks.com)
+ *
+ */
+
+// Tests for the shared memory transport used by the RPC client and server. The
+// server and client ends are both opened in the test process; the rings are
+// kept small so that the tests can easily fill them and make them wrap around.
+
+#include "PI/int/shm_transport.h"
+
+#include "unity/unity_fixture.h"
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#define SHM_NAME "pi_test_shm"
+#define RING_SIZE 256
+#define SHM_ADDR "shm://" SHM_NAME "?size=256"
+
+// every message is preceded by an 8-byte header and padded to 8 bytes, see
+// shm_transport.c; with these sizes, 2 messages fit before the end of the ring
+#define MSG_HDR_SIZE 8
+#define MSG_SIZE 100
+
+static pi_shm_transport_t *server;
+static pi_shm_transport_t *client;
+
+static void sleep_ms(unsigned int ms) {
+  struct timespec ts = {ms / 1000, (ms % 1000) * 1000000};
+  nanosleep(&ts, NULL);
+}
+
+static void fill_msg(char *msg, size_t len, char c) {
+  memset(msg, c, len);
+  msg[0] = 'M';
+}
+
+// sends a request from the client, and returns the pointer to it in the ring
+// on the server side
+static char *send_recv(char c) {
+  char msg[MSG_SIZE];
+  fill_msg(msg, sizeof(msg), c);
+  TEST_ASSERT_EQUAL_INT(sizeof(msg), pi_shm_send(client, msg, sizeof(msg)));
+  char *rcv;
+  TEST_ASSERT_EQUAL_INT(sizeof(msg), pi_shm_recv(server, &rcv));
+  TEST_ASSERT_EQUAL_MEMORY(msg, rcv, sizeof(msg));
+  return rcv;
+}
+
+typedef struct {
+  char c;
+  int rc;
+  int done;
+} sender_t;
+
+static void *sender_loop(void *arg) {
+  sender_t *sender = (sender_t *)arg;
+  char msg[MSG_SIZE];
+  fill_msg(msg, sizeof(msg), sender->c);
+  sender->rc = pi_shm_send(client, msg, sizeof(msg));
+  __atomic_store_n(&sender->done, 1, __ATOMIC_SEQ_CST);
+  return NULL;
+}
+
+static bool is_done(sender_t *sender) {
+  return __atomic_load_n(&sender->done, __ATOMIC_SEQ_CST);
+}
+
+// Maps the segment a second time and overwrites the length in the header of
+// the message which has \p payload as its first bytes, as a misbehaving peer
+// could.
+static void corrupt_msg_len(const char *payload, size_t payload_len,
+                            uint32_t len) {
+  int fd = shm_open("/" SHM_NAME, O_RDWR, 0);
+  TEST_ASSERT_TRUE(fd >= 0);
+  struct stat st;
+  TEST_ASSERT_EQUAL_INT(0, fstat(fd, &st));
+  char *mem = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  TEST_ASSERT_TRUE(mem != MAP_FAILED);
+  char *msg = NULL;
+  for (size_t i = MSG_HDR_SIZE; i + payload_len <= (size_t)st.st_size; i++) {
+    if (!memcmp(mem + i, payload, payload_len)) {
+      msg = mem + i;
+      break;
+    }
+  }
+  TEST_ASSERT_NOT_NULL(msg);
+  memcpy(msg - MSG_HDR_SIZE, &len, sizeof(len));
+  munmap(mem, st.st_size);
+}
+
+TEST_GROUP(ShmTransport);
+
+TEST_SETUP(ShmTransport) {
+  server = pi_shm_transport_create(SHM_ADDR);
+  TEST_ASSERT_NOT_NULL(server);
+  client = pi_shm_transport_connect(SHM_ADDR);
+  TEST_ASSERT_NOT_NULL(client);
+}
+
+TEST_TEAR_DOWN(ShmTransport) {
+  if (client) pi_shm_transport_destroy(client);
+  pi_shm_transport_destroy(server);
+}
+
+TEST(ShmTransport, RoundTrip) {
+  char *req = send_recv('a');
+  pi_shm_release(server, req);
+
+  const char rep[] = "reply";
+  TEST_ASSERT_EQUAL_INT(sizeof(rep), pi_shm_send(server, rep, sizeof(rep)));
+  char *rcv;
+  TEST_ASSERT_EQUAL_INT(sizeof(rep), pi_shm_recv(client, &rcv));
+  TEST_ASSERT_EQUAL_STRING(rep, rcv);
+  pi_shm_release(client, rcv);
+}
+
+TEST(ShmTransport, WrapAround) {
+  char *first = send_recv('a');
+  pi_shm_release(server, first);
+  pi_shm_release(server, send_recv('b'));
+  // does not fit before the end of the ring, so the sender leaves a wrap marker
+  // and the message is stored at the start of the ring, where the first one was
+  char *third = send_recv('c');
+  TEST_ASSERT_EQUAL_PTR(first, third);
+  pi_shm_release(server, third);
+
+  // the ring keeps working after wrapping around several times
+  for (char c = 'd'; c < 'z'; c++) pi_shm_release(server, send_recv(c));
+}
+
+TEST(ShmTransport, ReleaseOutOfOrder) {
+  char *first = send_recv('a');
+  char *second = send_recv('b');
+
+  // the ring is full until the first message is released, even if the second
+  // one is released before it
+  sender_t sender = {'c', 0, 0};
+  pthread_t thread;
+  pthread_create(&thread, NULL, sender_loop, &sender);
+  pi_shm_release(server, second);
+  sleep_ms(50);
+  TEST_ASSERT_FALSE(is_done(&sender));
+  pi_shm_release(server, first);
+  pthread_join(thread, NULL);
+  TEST_ASSERT_EQUAL_INT(MSG_SIZE, sender.rc);
+
+  char *rcv;
+  TEST_ASSERT_EQUAL_INT(MSG_SIZE, pi_shm_recv(server, &rcv));
+  TEST_ASSERT_EQUAL_INT('c', rcv[MSG_SIZE - 1]);
+  pi_shm_release(server, rcv);
+}
+
+TEST(ShmTransport, Oversized) {
+  // the largest message which fits in the ring, with its header
+  static char msg[RING_SIZE];
+  size_t max_len = RING_SIZE - MSG_HDR_SIZE;
+  TEST_ASSERT_EQUAL_INT(-1, pi_shm_send(client, msg, max_len + 1));
+  TEST_ASSERT_EQUAL_INT(-1, pi_shm_send(client, msg, sizeof(msg)));
+  TEST_ASSERT_EQUAL_INT(max_len, pi_shm_send(client, msg, max_len));
+  char *rcv;
+  TEST_ASSERT_EQUAL_INT(max_len, pi_shm_recv(server, &rcv));
+  pi_shm_release(server, rcv);
+}
+
+TEST(ShmTransport, MalformedLen) {
+  const char msg[] = "malformed_0";
+  TEST_ASSERT_EQUAL_INT(sizeof(msg), pi_shm_send(client, msg, sizeof(msg)));
+  // larger than the ring
+  corrupt_msg_len(msg, sizeof(msg), 1u << 30);
+  char *rcv;
+  TEST_ASSERT_EQUAL_INT(-1, pi_shm_recv(server, &rcv));
+}
+
+TEST(ShmTransport, MalformedLenPastHead) {
+  const char msg[] = "malformed_1";
+  TEST_ASSERT_EQUAL_INT(sizeof(msg), pi_shm_send(client, msg, sizeof(msg)));
+  // fits in the ring, but goes past what was actually sent
+  corrupt_msg_len(msg, sizeof(msg), MSG_SIZE);
+  char *rcv;
+  TEST_ASSERT_EQUAL_INT(-1, pi_shm_recv(server, &rcv));
+}
+
+TEST(ShmTransport, SingleClient) {
+  // the same process cannot connect twice
+  TEST_ASSERT_NULL(pi_shm_transport_connect(SHM_ADDR));
+
+  // nor can another process while this one is attached
+  pid_t pid = fork();
+  TEST_ASSERT_TRUE(pid >= 0);
+  if (pid == 0) _exit(pi_shm_transport_connect(SHM_ADDR) ? 1 : 0);
+  int status;
+  TEST_ASSERT_EQUAL_INT(pid, waitpid(pid, &status, 0));
+  TEST_ASSERT_TRUE(WIFEXITED(status));
+  TEST_ASSERT_EQUAL_INT(0, WEXITSTATUS(status));
+
+  // once the client is gone, the segment can be used again
+  pi_shm_transport_destroy(client);
+  client = pi_shm_transport_connect(SHM_ADDR);
+  TEST_ASSERT_NOT_NULL(client);
+}
+
+TEST(ShmTransport, DeadClientTakeover) {
+  pi_shm_transport_destroy(client);
+  client = NULL;
+
+  // a client which exits without disconnecting
+  pid_t pid = fork();
+  TEST_ASSERT_TRUE(pid >= 0);
+  if (pid == 0) _exit(pi_shm_transport_connect(SHM_ADDR) ? 0 : 1);
+  int status;
+  TEST_ASSERT_EQUAL_INT(pid, waitpid(pid, &status, 0));
+  TEST_ASSERT_TRUE(WIFEXITED(status));
+  TEST_ASSERT_EQUAL_INT(0, WEXITSTATUS(status));
+
+  // its pid is still recorded in the segment, but it no longer exists
+  client = pi_shm_transport_connect(SHM_ADDR);
+  TEST_ASSERT_NOT_NULL(client);
+  pi_shm_release(server, send_recv('a'));
+}
+
+TEST(ShmTransport, Shutdown) {
+  pi_shm_shutdown(server);
+  char *rcv;
+  TEST_ASSERT_EQUAL_INT(-1, pi_shm_recv(server, &rcv));
+  TEST_ASSERT_EQUAL_INT(-1, pi_shm_send(server, "a", 1));
+}
+
+TEST_GROUP_RUNNER(ShmTransport) {
+  RUN_TEST_CASE(ShmTransport, RoundTrip);
+  RUN_TEST_CASE(ShmTransport, WrapAround);
+  RUN_TEST_CASE(ShmTransport, ReleaseOutOfOrder);
+  RUN_TEST_CASE(ShmTransport, Oversized);
+  RUN_TEST_CASE(ShmTransport, MalformedLen);
+  RUN_TEST_CASE(ShmTransport, MalformedLenPastHead);
+  RUN_TEST_CASE(ShmTransport, SingleClient);
+  RUN_TEST_CASE(ShmTransport, DeadClientTakeover);
+  RUN_TEST_CASE(ShmTransport, Shutdown);
+}
+
+void test_shm_transport() { RUN_TEST_GROUP(ShmTransport); }